@@ -0,0 +1,176 @@
+/* FatFs cluster allocation cost on a full, fragmented FAT32 volume
+ *
+ * cc -O2 -DINTTYPES -Isrc -o alloc_bench alloc_bench.c src/ff.c src/diskio_img.c
+ * cc -O2 -DINTTYPES -Isrc -D_FS_FREEMAP=0 -o alloc_bench0 alloc_bench.c src/ff.c src/diskio_img.c
+ * ./alloc_bench [image file]
+ *
+ * Makes a 300MB FAT32 volume with 512 byte clusters on the diskio_img RAM
+ * disk (or the image file), fills it to 95% with 1 to 40 cluster files and
+ * deletes every 500th, so the free space is a few holes spread over the FAT
+ * and a run at the end. After a remount, so the free map starts empty, it
+ *   appends a cluster to 16 old files from the full front part round robin,
+ *   f_sync after each, 1600 allocations
+ *   writes a new log file of 8000 clusters, f_sync every 64
+ *   runs f_expand for 4000 contiguous clusters 5 times
+ *   runs f_expand for 15000 contiguous clusters 5 times, more than is free
+ * and prints the sector reads, writes, reads per allocated cluster and the
+ * host microseconds per cluster of each step. Every file holds its own
+ * byte pattern, at the end the volume is mounted again and all of them are
+ * read back, a cluster handed out twice shows up as a wrong byte.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ff.h"
+#include "diskio_img.h"
+
+#define SECTORS	600000	// 300MB
+#define OLD	16	// old files appended to
+#define APPEND	100	// clusters appended to each
+#define LOG	8000	// clusters of the new log
+#define PAT_LOG	0xa5
+
+static FATFS fs;
+static FIL f, of[OLD];
+static BYTE buf[512];
+static double t0;
+
+#define CK(x)	do { FRESULT r_ = (x); if (r_) { printf("line %d: %s = %d\n", __LINE__, #x, r_); exit(1); } } while (0)
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void start(void)
+{
+	disk_img_clear();
+	t0 = now_s();
+}
+
+static void show(const char *what, UINT n)
+{
+	double t = now_s() - t0;
+
+	printf("  %-22s %8lu %8lu %10.2f %10.2f\n", what, (unsigned long) disk_img_stat.rsect,
+		(unsigned long) disk_img_stat.wsect, (double) disk_img_stat.rsect / n, t / n * 1e6);
+}
+
+/* 0 if every byte of the file is pat */
+static int check(const char *name, BYTE pat)
+{
+	UINT br, i;
+
+	CK(f_open(&f, name, FA_READ));
+	do {
+		CK(f_read(&f, buf, sizeof(buf), &br));
+		for (i = 0; i < br; i++)
+			if (buf[i] != pat)
+				return printf("%s: byte %lu is %02x\n", name, (unsigned long) (f.fptr - br + i), buf[i]), 1;
+	} while (br);
+	CK(f_close(&f));
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	char name[32];
+	UINT bw, k, n, files, bad = 0;
+	DWORD nclst;
+	FATFS *p;
+	FRESULT res = FR_OK;
+
+	if (argc > 1)
+		disk_img_path = argv[1];
+	disk_img_sectors = SECTORS;
+	srand(1);
+	CK(f_mount(&fs, "0:", 0));
+	CK(f_mkfs("0:", 0, 512));
+	CK(f_mount(&fs, "0:", 1));
+	CK(f_mkdir("fill"));
+	for (files = 0; ; files++) {
+		sprintf(name, "fill/%05u.dat", files);
+		memset(buf, files, sizeof(buf));
+		CK(f_open(&f, name, FA_CREATE_ALWAYS | FA_WRITE));
+		for (n = 1 + rand() % 40, k = 0; k < n; k++)
+			CK(f_write(&f, buf, sizeof(buf), &bw));
+		CK(f_close(&f));
+		CK(f_getfree("0:", &nclst, &p));
+		if (nclst < SECTORS / 20)
+			break;
+	}
+	files++;
+	for (k = 0; k < files; k += 500) {
+		sprintf(name, "fill/%05u.dat", k);
+		CK(f_unlink(name));
+	}
+	CK(f_getfree("0:", &nclst, &p));
+	printf("FAT32, %u files, %lu of %lu clusters free, _FS_FREEMAP %d\n", files, (unsigned long) nclst,
+		(unsigned long) fs.n_fatent - 2, _FS_FREEMAP);
+	printf("  %-22s %8s %8s %10s %10s\n", "step", "rsect", "wsect", "rsect/cl", "us/cl");
+	CK(f_mount(NULL, "0:", 0));
+	CK(f_mount(&fs, "0:", 1));
+
+	start();
+	for (k = 0; k < OLD; k++) {
+		sprintf(name, "fill/%05u.dat", 1 + k * (files / OLD));
+		CK(f_open(&of[k], name, FA_OPEN_EXISTING | FA_WRITE));
+		CK(f_lseek(&of[k], of[k].fsize));
+	}
+	for (n = 0; n < APPEND; n++) {
+		for (k = 0; k < OLD; k++) {
+			memset(buf, 1 + k * (files / OLD), sizeof(buf));
+			CK(f_write(&of[k], buf, sizeof(buf), &bw));
+			CK(f_sync(&of[k]));
+		}
+	}
+	for (k = 0; k < OLD; k++)
+		CK(f_close(&of[k]));
+	show("append to old files", OLD * APPEND);
+
+	start();
+	memset(buf, PAT_LOG, sizeof(buf));
+	CK(f_open(&f, "log.txt", FA_CREATE_ALWAYS | FA_WRITE));
+	for (k = 0; k < LOG; k++) {
+		CK(f_write(&f, buf, sizeof(buf), &bw));
+		if (k % 64 == 63)
+			CK(f_sync(&f));
+	}
+	CK(f_close(&f));
+	show("new log", LOG);
+
+	start();
+	for (k = 0; k < 5; k++) {
+		CK(f_open(&f, "big.dat", FA_CREATE_ALWAYS | FA_WRITE));
+		CK(f_expand(&f, 4000 * 512, 1));
+		CK(f_close(&f));
+	}
+	show("f_expand 4000", 5 * 4000);
+
+	start();
+	for (k = 0; k < 5; k++) {
+		CK(f_open(&f, "huge.dat", FA_CREATE_ALWAYS | FA_WRITE));
+		res = f_expand(&f, 15000 * 512, 1);
+		CK(f_close(&f));
+	}
+	show(res == FR_DENIED ? "f_expand 15000 denied" : "f_expand 15000", 5 * 15000);
+
+	CK(f_mount(NULL, "0:", 0));
+	CK(f_mount(&fs, "0:", 1));
+	for (k = 0; k < files && !bad; k++) {
+		if (k % 500 == 0)
+			continue;
+		sprintf(name, "fill/%05u.dat", k);
+		bad = check(name, k);
+	}
+	if (!bad)
+		bad = check("log.txt", PAT_LOG);
+	printf("read back %s\n", bad ? "FAILED" : "ok");
+	f_mount(NULL, "0:", 0);
+	disk_img_close();
+	return bad;
+}
@@ -0,0 +1,151 @@
+/* FatFs directory cache check and sector reads per open in a big directory
+ *
+ * cc -O2 -DINTTYPES -Isrc -o dir_bench dir_bench.c src/ff.c src/diskio_img.c
+ * cc -O2 -DINTTYPES -Isrc -D_FS_DIRCACHE=0 -o dir_bench0 dir_bench.c src/ff.c src/diskio_img.c
+ * ./dir_bench [files] [image file]
+ *
+ * Makes a 128MB FAT16 volume with 4K clusters on the diskio_img RAM disk (or
+ * the image file) and creates the files (10000 if not given) in one
+ * directory, each holding its number, so the directory clusters are spread
+ * over the FAT between the file clusters. After a remount, so the cache
+ * starts empty, it
+ *   opens the 8 newest files 3 times round robin, the logger reopening
+ *   its last files
+ *   opens 16 files from all over the directory 50 times round robin
+ *   opens 1000 files at random, more names than there are slots
+ *   looks up 100 names that are not there
+ * and prints the sector reads per open (open, read 4 bytes, close) and the
+ * host microseconds per open of each step. A cached open still follows the
+ * directory's cluster chain to the entry, the FAT sector reads of that are
+ * most of its cost. Every open checks the file holds
+ * its number, at the end the volume is mounted again and all files are read
+ * back.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ff.h"
+#include "diskio_img.h"
+
+#define SECTORS	262144	// 128MB
+#define NEWEST	8
+#define HOT	16
+
+static FATFS fs;
+static FIL f;
+static FILINFO fno;
+static UINT files = 10000;
+static double t0;
+
+#define CK(x)	do { FRESULT r_ = (x); if (r_) { printf("line %d: %s = %d\n", __LINE__, #x, r_); exit(1); } } while (0)
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void start(void)
+{
+	disk_img_clear();
+	t0 = now_s();
+}
+
+static void show(const char *what, UINT n)
+{
+	double t = now_s() - t0;
+
+	printf("  %-22s %8lu %10.2f %10.2f\n", what, (unsigned long) disk_img_stat.rsect,
+		(double) disk_img_stat.rsect / n, t / n * 1e6);
+}
+
+static const char *name(UINT i)
+{
+	static char s[24];
+
+	sprintf(s, "logs/L%05u.TXT", i);
+	return s;
+}
+
+/* 0 if file i opens and holds its number */
+static int check(UINT i)
+{
+	DWORD v = 0;
+	UINT br;
+
+	CK(f_open(&f, name(i), FA_READ));
+	CK(f_read(&f, &v, sizeof(v), &br));
+	CK(f_close(&f));
+	if (br != sizeof(v) || v != i)
+		return printf("%s holds %lu\n", name(i), (unsigned long) v), 1;
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	DWORD v;
+	UINT bw, i, k, n, bad = 0;
+
+	if (argc > 1)
+		files = atoi(argv[1]);
+	if (argc > 2)
+		disk_img_path = argv[2];
+	if (files < HOT || files > 65000) {
+		fprintf(stderr, "dir_bench: %d to 65000 files\n", HOT);
+		return 1;
+	}
+	disk_img_sectors = SECTORS;
+	srand(1);
+	CK(f_mount(&fs, "0:", 0));
+	CK(f_mkfs("0:", 0, 4096));
+	CK(f_mount(&fs, "0:", 1));
+	CK(f_mkdir("logs"));
+	start();
+	for (i = 0; i < files; i++) {
+		v = i;
+		CK(f_open(&f, name(i), FA_CREATE_NEW | FA_WRITE));
+		CK(f_write(&f, &v, sizeof(v), &bw));
+		CK(f_close(&f));
+	}
+	printf("FAT%d, %u files in one directory, _FS_DIRCACHE %d\n", fs.fs_type == FS_FAT32 ? 32 : 16, files,
+		_FS_DIRCACHE);
+	printf("  %-22s %8s %10s %10s\n", "step", "rsect", "rsect/op", "us/op");
+	show("create", files);
+	CK(f_mount(NULL, "0:", 0));
+	CK(f_mount(&fs, "0:", 1));
+
+	start();
+	for (k = 0; k < 3; k++)
+		for (i = files - NEWEST; i < files && !bad; i++)
+			bad = check(i);
+	show("newest 8 x3", 3 * NEWEST);
+
+	start();
+	for (k = 0; k < 50; k++)
+		for (i = 0; i < HOT && !bad; i++)
+			bad = check(i * (files / HOT));
+	show("spread 16 x50", 50 * HOT);
+
+	start();
+	for (k = 0; k < 1000 && !bad; k++)
+		bad = check(rand() % files);
+	show("random 1000", 1000);
+
+	start();
+	for (k = 0; k < 100; k++)
+		if (f_stat(name(files + k), &fno) != FR_NO_FILE)
+			bad = printf("%s is there\n", name(files + k));
+	show("missing 100", 100);
+
+	CK(f_mount(NULL, "0:", 0));
+	CK(f_mount(&fs, "0:", 1));
+	for (n = 0; n < files && !bad; n++)
+		bad = check(n);
+	printf("read back %s\n", bad ? "FAILED" : "ok");
+	f_mount(NULL, "0:", 0);
+	disk_img_close();
+	return bad;
+}
@@ -14,6 +14,7 @@ extern "C" {
 #define	MAGIC		0x0003  				// data version checkmark
 
 #define SDSPEED         0               // SDCARD fast SPI speed 0=fastest
+#define SDDMA           1               // SDCARD sector data by DMA block mover, 0=byte loop
 #define	SDPOWER							// SD card 3.3vdc power enable
 #define SPI_CS			0
 
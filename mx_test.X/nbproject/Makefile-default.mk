@@ -51,17 +51,17 @@ OBJECTDIR=build/${CND_CONF}/${IMAGE_TYPE}
 DISTDIR=dist/${CND_CONF}/${IMAGE_TYPE}
 
 # Source Files Quoted if spaced
-SOURCEFILES_QUOTED_IF_SPACED=test_main.c sdspi.c src/diskio.c src/ff.c blinker.c
+SOURCEFILES_QUOTED_IF_SPACED=test_main.c sdspi.c src/diskio.c src/ff.c blinker.c sdblk.c sdlog.c
 
 # Object Files Quoted if spaced
-OBJECTFILES_QUOTED_IF_SPACED=${OBJECTDIR}/test_main.o ${OBJECTDIR}/sdspi.o ${OBJECTDIR}/src/diskio.o ${OBJECTDIR}/src/ff.o ${OBJECTDIR}/blinker.o
-POSSIBLE_DEPFILES=${OBJECTDIR}/test_main.o.d ${OBJECTDIR}/sdspi.o.d ${OBJECTDIR}/src/diskio.o.d ${OBJECTDIR}/src/ff.o.d ${OBJECTDIR}/blinker.o.d
+OBJECTFILES_QUOTED_IF_SPACED=${OBJECTDIR}/test_main.o ${OBJECTDIR}/sdspi.o ${OBJECTDIR}/src/diskio.o ${OBJECTDIR}/src/ff.o ${OBJECTDIR}/blinker.o ${OBJECTDIR}/sdblk.o ${OBJECTDIR}/sdlog.o
+POSSIBLE_DEPFILES=${OBJECTDIR}/test_main.o.d ${OBJECTDIR}/sdspi.o.d ${OBJECTDIR}/src/diskio.o.d ${OBJECTDIR}/src/ff.o.d ${OBJECTDIR}/blinker.o.d ${OBJECTDIR}/sdblk.o.d ${OBJECTDIR}/sdlog.o.d
 
 # Object Files
-OBJECTFILES=${OBJECTDIR}/test_main.o ${OBJECTDIR}/sdspi.o ${OBJECTDIR}/src/diskio.o ${OBJECTDIR}/src/ff.o ${OBJECTDIR}/blinker.o
+OBJECTFILES=${OBJECTDIR}/test_main.o ${OBJECTDIR}/sdspi.o ${OBJECTDIR}/src/diskio.o ${OBJECTDIR}/src/ff.o ${OBJECTDIR}/blinker.o ${OBJECTDIR}/sdblk.o ${OBJECTDIR}/sdlog.o
 
 # Source Files
-SOURCEFILES=test_main.c sdspi.c src/diskio.c src/ff.c blinker.c
+SOURCEFILES=test_main.c sdspi.c src/diskio.c src/ff.c blinker.c sdblk.c sdlog.c
 
 
 CFLAGS=
@@ -130,6 +130,18 @@ ${OBJECTDIR}/blinker.o: blinker.c  nbproject/Makefile-${CND_CONF}.mk
 	@${RM} ${OBJECTDIR}/blinker.o 
 	@${FIXDEPS} "${OBJECTDIR}/blinker.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_ICD3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -O1 -Wall -MMD -MF "${OBJECTDIR}/blinker.o.d" -o ${OBJECTDIR}/blinker.o blinker.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD) 
 	
+${OBJECTDIR}/sdlog.o: sdlog.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/sdlog.o.d 
+	@${RM} ${OBJECTDIR}/sdlog.o 
+	@${FIXDEPS} "${OBJECTDIR}/sdlog.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_ICD3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -O1 -Wall -MMD -MF "${OBJECTDIR}/sdlog.o.d" -o ${OBJECTDIR}/sdlog.o sdlog.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/sdblk.o: sdblk.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/sdblk.o.d 
+	@${RM} ${OBJECTDIR}/sdblk.o 
+	@${FIXDEPS} "${OBJECTDIR}/sdblk.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_ICD3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -O1 -Wall -MMD -MF "${OBJECTDIR}/sdblk.o.d" -o ${OBJECTDIR}/sdblk.o sdblk.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD) 
+	
 else
 ${OBJECTDIR}/test_main.o: test_main.c  nbproject/Makefile-${CND_CONF}.mk
 	@${MKDIR} "${OBJECTDIR}" 
@@ -161,6 +173,18 @@ ${OBJECTDIR}/blinker.o: blinker.c  nbproject/Makefile-${CND_CONF}.mk
 	@${RM} ${OBJECTDIR}/blinker.o 
 	@${FIXDEPS} "${OBJECTDIR}/blinker.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -O1 -Wall -MMD -MF "${OBJECTDIR}/blinker.o.d" -o ${OBJECTDIR}/blinker.o blinker.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD) 
 	
+${OBJECTDIR}/sdlog.o: sdlog.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/sdlog.o.d 
+	@${RM} ${OBJECTDIR}/sdlog.o 
+	@${FIXDEPS} "${OBJECTDIR}/sdlog.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -O1 -Wall -MMD -MF "${OBJECTDIR}/sdlog.o.d" -o ${OBJECTDIR}/sdlog.o sdlog.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD) 
+	
+${OBJECTDIR}/sdblk.o: sdblk.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/sdblk.o.d 
+	@${RM} ${OBJECTDIR}/sdblk.o 
+	@${FIXDEPS} "${OBJECTDIR}/sdblk.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -O1 -Wall -MMD -MF "${OBJECTDIR}/sdblk.o.d" -o ${OBJECTDIR}/sdblk.o sdblk.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD) 
+	
 endif
 
 # ------------------------------------------------------------------------------------
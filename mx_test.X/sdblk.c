@@ -0,0 +1,203 @@
+/* SPI1 SDCARD sector block mover
+ *
+ * The byte loop in xmit_spi_sdcard waits on SpiChnIsBusy and two DelaySPI
+ * calls for every byte, a 512 byte sector here is one DMA block.
+ * DMA channel 0 feeds SPI1BUF from the data buffer (or the 0xff fill table),
+ * DMA channel 1 captures SPI1BUF into the data buffer and its block done
+ * interrupt finishes a read and runs the done callback.
+ * For a write channel 1 runs auto enabled into a one byte sink, a block of
+ * one it keeps repeating, and the channel 0 block done finishes it once the
+ * last byte is off the wire. The RX channel always runs so the SPI receive
+ * buffer never overflows.
+ */
+#if defined(__PIC32MX__)
+#include "mx_test.h"
+#else
+#include <stddef.h>
+#ifndef TRUE
+#define TRUE	1
+#define FALSE	0
+#endif
+#endif
+#include "sdblk.h"
+
+#define SDBLK_SPI	SPI_CHANNEL1	// SDCARD_CHAN in sdspi.c
+#define SDBLK_TX_CHN	DMA_CHANNEL0
+#define SDBLK_RX_CHN	DMA_CHANNEL1
+#define SDBLK_MAX	SDBUFFERSIZE	// largest single block
+
+static volatile int sdblk_active = FALSE, sdblk_status = 0, sdblk_write = FALSE;
+static volatile sdblk_done_t sdblk_done = NULL;
+static sdblk_idle_t sdblk_idle = NULL;
+
+/* dummy clocks for reads, in flash so the DMA can use it without RAM */
+static const BYTE sdblk_fill[SDBLK_MAX] = {[0 ... SDBLK_MAX - 1] = 0xff};
+
+static void sdblk_finish(int status)
+{
+	sdblk_done_t done = sdblk_done;
+
+	sdblk_status = status;
+	sdblk_done = NULL;
+	sdblk_active = FALSE;
+	if (done)
+		done(status);
+}
+
+#if defined(__PIC32MX__)
+
+static BYTE sdblk_sink; // RX data of writes, overwritten by every byte
+
+void sdblk_init(void)
+{
+	DmaChnOpen(SDBLK_TX_CHN, DMA_CHN_PRI3, DMA_OPEN_DEFAULT);
+	DmaChnSetEventControl(SDBLK_TX_CHN, DMA_EV_START_IRQ_EN | DMA_EV_START_IRQ(_SPI1_TX_IRQ));
+	DmaChnSetEvEnableFlags(SDBLK_TX_CHN, DMA_EV_BLOCK_DONE);
+	INTSetVectorPriority(INT_VECTOR_DMA(SDBLK_TX_CHN), INT_PRIORITY_LEVEL_5);
+	INTSetVectorSubPriority(INT_VECTOR_DMA(SDBLK_TX_CHN), INT_SUB_PRIORITY_LEVEL_3);
+	INTEnable(INT_SOURCE_DMA(SDBLK_TX_CHN), INT_ENABLED);
+	DmaChnOpen(SDBLK_RX_CHN, DMA_CHN_PRI3, DMA_OPEN_DEFAULT);
+	DmaChnSetEventControl(SDBLK_RX_CHN, DMA_EV_START_IRQ_EN | DMA_EV_START_IRQ(_SPI1_RX_IRQ));
+	DmaChnSetEvEnableFlags(SDBLK_RX_CHN, DMA_EV_BLOCK_DONE);
+	INTSetVectorPriority(INT_VECTOR_DMA(SDBLK_RX_CHN), INT_PRIORITY_LEVEL_5);
+	INTSetVectorSubPriority(INT_VECTOR_DMA(SDBLK_RX_CHN), INT_SUB_PRIORITY_LEVEL_3);
+	INTEnable(INT_SOURCE_DMA(SDBLK_RX_CHN), INT_ENABLED);
+}
+
+/*
+ * start a full duplex block transfer on SPI1, the card must already be selected
+ * returns ERR1 if a transfer is running or the length is bad
+ */
+int sdblk_start(const BYTE* tx, BYTE* rx, UINT len, sdblk_done_t done)
+{
+	if (sdblk_active || !len || len > SDBLK_MAX)
+		return ERR1;
+
+	sdblk_active = TRUE;
+	sdblk_status = 0;
+	sdblk_done = done;
+	sdblk_write = !rx;
+	V.card_count += len;
+	while (SpiChnDataRdy(SDBLK_SPI)) SpiChnGetC(SDBLK_SPI); // drop stale data
+	SpiChnGetRov(SDBLK_SPI, TRUE);
+
+	if (rx) {
+		DmaChnClrControlFlags(SDBLK_RX_CHN, DMA_CTL_AUTO_EN);
+		DmaChnSetEvEnableFlags(SDBLK_RX_CHN, DMA_EV_BLOCK_DONE);
+		DmaChnSetTxfer(SDBLK_RX_CHN, (void*) &SPI1BUF, rx, 1, len, 1);
+	} else {
+		DmaChnSetControlFlags(SDBLK_RX_CHN, DMA_CTL_AUTO_EN); // rearm after each byte
+		DmaChnClrEvEnableFlags(SDBLK_RX_CHN, DMA_EV_BLOCK_DONE);
+		DmaChnSetTxfer(SDBLK_RX_CHN, (void*) &SPI1BUF, &sdblk_sink, 1, 1, 1);
+	}
+	DmaChnSetTxfer(SDBLK_TX_CHN, tx ? (void*) tx : (void*) sdblk_fill, (void*) &SPI1BUF, len, 1, 1);
+	DmaChnClrEvFlags(SDBLK_RX_CHN, DMA_EV_ALL_EVNTS);
+	DmaChnClrEvFlags(SDBLK_TX_CHN, DMA_EV_ALL_EVNTS);
+	DmaChnEnable(SDBLK_RX_CHN); // arm the capture first
+	DmaChnStartTxfer(SDBLK_TX_CHN, DMA_WAIT_NOT, 0); // first byte forced, the rest on SPI1 TX events
+	return 0;
+}
+
+void __ISR(_DMA1_VECTOR, IPL5AUTO) SdBlkDmaHandler(void)
+{
+	int evnt = DmaChnGetEvFlags(SDBLK_RX_CHN);
+
+	DmaChnClrEvFlags(SDBLK_RX_CHN, DMA_EV_ALL_EVNTS);
+	INTClearFlag(INT_SOURCE_DMA(SDBLK_RX_CHN));
+	if ((evnt & DMA_EV_BLOCK_DONE) && !sdblk_write) {
+		DmaChnDisable(SDBLK_TX_CHN);
+		sdblk_finish(SpiChnGetRov(SDBLK_SPI, TRUE) ? ERR1 : 0);
+	}
+}
+
+/* the last write byte is in SPI1BUF, the sink channel takes what is left */
+void __ISR(_DMA0_VECTOR, IPL5AUTO) SdBlkDmaTxHandler(void)
+{
+	int evnt = DmaChnGetEvFlags(SDBLK_TX_CHN);
+
+	DmaChnClrEvFlags(SDBLK_TX_CHN, DMA_EV_ALL_EVNTS);
+	INTClearFlag(INT_SOURCE_DMA(SDBLK_TX_CHN));
+	if ((evnt & DMA_EV_BLOCK_DONE) && sdblk_write) {
+		while (SpiChnIsBusy(SDBLK_SPI)); // 8 SCK at most
+		DmaChnDisable(SDBLK_RX_CHN);
+		while (SpiChnDataRdy(SDBLK_SPI)) SpiChnGetC(SDBLK_SPI);
+		sdblk_finish(SpiChnGetRov(SDBLK_SPI, TRUE) ? ERR1 : 0);
+	}
+}
+
+sdblk_wire_t sdblk_emu_wire(sdblk_wire_t wire)
+{
+	return NULL; // real SPI wire only
+}
+
+#else
+
+/*
+ * Linux emulation, each byte is passed through the wire function,
+ * the default wire is an idle card that returns 0xff
+ */
+static unsigned char sdblk_emu_idle(unsigned char dat)
+{
+	(void) dat;
+	return 0xff;
+}
+
+static sdblk_wire_t sdblk_wire = sdblk_emu_idle;
+
+void sdblk_init(void)
+{
+	sdblk_active = FALSE;
+	sdblk_status = 0;
+}
+
+int sdblk_start(const BYTE* tx, BYTE* rx, UINT len, sdblk_done_t done)
+{
+	UINT i;
+	unsigned char dat;
+
+	if (sdblk_active || !len || len > SDBLK_MAX)
+		return ERR1;
+
+	sdblk_active = TRUE;
+	sdblk_status = 0;
+	sdblk_done = done;
+	V.card_count += len;
+	for (i = 0; i < len; i++) {
+		dat = sdblk_wire(tx ? tx[i] : sdblk_fill[i]);
+		if (rx) rx[i] = dat;
+	}
+	sdblk_finish(0); // the DMA ISR would run here
+	return 0;
+}
+
+sdblk_wire_t sdblk_emu_wire(sdblk_wire_t wire)
+{
+	sdblk_wire_t old = sdblk_wire;
+
+	sdblk_wire = wire ? wire : sdblk_emu_idle;
+	return old;
+}
+
+#endif
+
+int sdblk_busy(void)
+{
+	return sdblk_active;
+}
+
+int sdblk_wait(void)
+{
+	while (sdblk_active) {
+		if (sdblk_idle)
+			sdblk_idle();
+	}
+	return sdblk_status;
+}
+
+sdblk_idle_t sdblk_set_idle(sdblk_idle_t idle)
+{
+	sdblk_idle_t old = sdblk_idle;
+
+	sdblk_idle = idle;
+	return old;
+}
@@ -0,0 +1,40 @@
+/*
+ * File:   sdblk.h
+ * Author: root
+ *
+ * SPI1 SDCARD block mover, moves a whole sector of data per call instead of
+ * one byte per xmit_spi_sdcard call.
+ * PIC32 builds use a pair of DMA channels (TX dummy fill and RX capture),
+ * other builds use a software emulation of the SPI wire so the sector paths
+ * in sdspi.c can be run on a Linux host (compile with -DINTTYPES).
+ */
+
+#ifndef SDBLK_H
+#define	SDBLK_H
+
+#include "mx_test_types.h"
+#include "src/integer.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+	typedef void (*sdblk_done_t)(int); // transfer complete callback, 0 = OK, runs in ISR context on the PIC32
+	typedef void (*sdblk_idle_t)(void); // called while sdblk_wait spins, poll slaves here
+	typedef unsigned char (*sdblk_wire_t)(unsigned char); // emulation: card side of the SPI wire
+
+	void sdblk_init(void); // setup the DMA channels, call after the SPI ports are open
+	int sdblk_start(const BYTE*, BYTE*, UINT, sdblk_done_t); // tx NULL sends 0xff, rx NULL drops data
+	int sdblk_busy(void);
+	int sdblk_wait(void); // wait for the current transfer, returns the done status
+	sdblk_idle_t sdblk_set_idle(sdblk_idle_t); // returns the old idle function
+	sdblk_wire_t sdblk_emu_wire(sdblk_wire_t); // emulation only, returns the old wire function
+
+	extern volatile struct V_data V;
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* SDBLK_H */
+
@@ -0,0 +1,118 @@
+/* sdblk block mover check and byte loop against block timing
+ *
+ * cc -O2 -DINTTYPES -I. -o sdblk_bench sdblk_bench.c sdblk.c
+ * ./sdblk_bench
+ *
+ * Runs sdblk_start on the emulation backend against a card model on the
+ * wire: a sector write must reach the card byte for byte, a read must
+ * return what the card sends for the 0xff fill, both must add the length
+ * to V.card_count and call the done hook with 0, and a zero or oversize
+ * length must be refused with ERR1. It prints ok or the first failure.
+ *
+ * Then the SPI1 time of one 512 byte sector from the mx_test clocks
+ * (SYS_FREQ 50MHz, FPBDIV 4, SCK = PBCLK / (2 * (BRG + 1))) at the init
+ * and run BRGs of sdspi.c:
+ *   byte loop   each byte is 8 SCK, then the two DelaySPI(1) core timer
+ *               waits of 250 ticks at SYS_FREQ / 2 in xmit_spi_sdcard
+ *   block       8 SCK per byte back to back, the TX DMA is started by the
+ *               SPI1 TX interrupt flag of the byte before
+ * with the sector rate and the share of the block time sdblk_wait hands
+ * to the idle hook. It is a wire time model, plib call overhead is left
+ * out of the byte loop so its numbers are the best it can do.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sdblk.h"
+
+#define SECTOR		512
+#define SYS_FREQ	50000000.0
+#define PB_FREQ		(SYS_FREQ / 4)
+#define CORE_FREQ	(SYS_FREQ / 2)
+#define DELAY_TICKS	250.0	// OpenCoreTimer(500000 / 2000) in DelaySPI
+#define BLOCK_SETUP_US	4.0	// sdblk_start, two DmaChnSetTxfer and the ISR
+
+volatile struct V_data V;
+
+static BYTE card_in[SECTOR], card_out[SECTOR], buf[SECTOR];
+static int card_pos, done_calls, done_status;
+
+/* the card: keeps what is clocked in, clocks out card_out */
+static unsigned char card_wire(unsigned char dat)
+{
+	unsigned char r = card_out[card_pos % SECTOR];
+
+	card_in[card_pos % SECTOR] = dat;
+	card_pos++;
+	return r;
+}
+
+static void done_hook(int status)
+{
+	done_calls++;
+	done_status = status;
+}
+
+static int check(void)
+{
+	uint32_t count;
+	int i;
+
+	for (i = 0; i < SECTOR; i++) {
+		buf[i] = (BYTE) rand();
+		card_out[i] = (BYTE) rand();
+	}
+	sdblk_init();
+	sdblk_emu_wire(card_wire);
+
+	card_pos = done_calls = 0;
+	count = V.card_count;
+	if (sdblk_start(buf, NULL, SECTOR, done_hook) || sdblk_wait())
+		return printf("write: refused or failed\n"), 1;
+	if (memcmp(card_in, buf, SECTOR) || card_pos != SECTOR)
+		return printf("write: card got other data\n"), 1;
+	if (V.card_count - count != SECTOR || done_calls != 1 || done_status)
+		return printf("write: count %u done %d status %d\n",
+		(unsigned) (V.card_count - count), done_calls, done_status), 1;
+
+	card_pos = done_calls = 0;
+	memset(buf, 0, sizeof(buf));
+	if (sdblk_start(NULL, buf, SECTOR, done_hook) || sdblk_wait())
+		return printf("read: refused or failed\n"), 1;
+	if (memcmp(buf, card_out, SECTOR))
+		return printf("read: data differs from the card\n"), 1;
+	for (i = 0; i < SECTOR; i++)
+		if (card_in[i] != 0xff)
+			return printf("read: fill byte %d is %02x\n", i, card_in[i]), 1;
+	if (done_calls != 1 || sdblk_busy())
+		return printf("read: done %d busy %d\n", done_calls, sdblk_busy()), 1;
+
+	if (sdblk_start(buf, NULL, 0, NULL) != ERR1 || sdblk_start(buf, NULL, SECTOR + 1, NULL) != ERR1)
+		return printf("bad length taken\n"), 1;
+	sdblk_emu_wire(NULL);
+	return 0;
+}
+
+static void timing(const char *name, int brg)
+{
+	double sck = PB_FREQ / (2.0 * (brg + 1));
+	double byte_us = 8e6 / sck;
+	double loop_us = SECTOR * (byte_us + 2.0 * DELAY_TICKS / CORE_FREQ * 1e6);
+	double block_us = SECTOR * byte_us + BLOCK_SETUP_US;
+
+	printf("  %-6s %3d %8.0f %10.0f %10.0f %10.0f %10.0f %6.1f %6.1f%%\n", name, brg, sck / 1e3,
+		loop_us, SECTOR / loop_us * 1e6 / 1024.0, block_us, SECTOR / block_us * 1e6 / 1024.0,
+		loop_us / block_us, 100.0 * (block_us - BLOCK_SETUP_US) / block_us);
+}
+
+int main(void)
+{
+	int bad = check();
+
+	printf("emulation check %s\n", bad ? "FAILED" : "ok");
+	printf("  %-6s %3s %8s %10s %10s %10s %10s %6s %7s\n", "SCK", "BRG", "kHz",
+		"loop us", "loop KB/s", "block us", "block KB/s", "x", "idle");
+	timing("init", 64);
+	timing("run", 2);
+	return bad;
+}
@@ -0,0 +1,265 @@
+/* Write-behind record logger
+ *
+ * The old main loop did f_sync before every f_puts, every record cost a FAT,
+ * directory and data sector write. Here records collect in buf and go out as
+ * one f_write of SDLOG_BUFSIZE bytes at a sector aligned file offset (base).
+ * A sync before the buffer is full writes the partial buffer at base and keeps
+ * it, the next write covers the same sectors again so the file never gets an
+ * unaligned tail.
+ * The file is grown in SDLOG_PREALLOC steps with f_lseek so the cluster chain
+ * is built once per step, sdlog_close trims it back to the real data size.
+ * In contig mode the whole file is allocated at open as one cluster run with
+ * f_expand and the link map (fp->cltbl) is built once, f_write then finds
+ * each next cluster in the map instead of following the chain on the FAT.
+ * The directory entry holds the full allocated size from the first f_sync,
+ * so syncs only rewrite the entry's time and the real size goes in at close.
+ */
+#include <string.h>
+#include "sdlog.h"
+
+#ifndef TRUE
+#define TRUE	1
+#define FALSE	0
+#endif
+
+static FRESULT sdlog_fail(SDLOG *log, FRESULT res)
+{
+	log->err = res;
+	log->online = FALSE;
+	return res;
+}
+
+/* extend the file so size covers at least need bytes */
+static FRESULT sdlog_grow(SDLOG *log, DWORD need)
+{
+	FRESULT res;
+	DWORD size = log->alloc;
+
+	while (size < need)
+		size += SDLOG_PREALLOC;
+	res = f_lseek(log->fp, size);
+	if (res != FR_OK)
+		return sdlog_fail(log, res);
+	if (log->fp->fsize < size) // f_lseek stops at the end of free space
+		return sdlog_fail(log, FR_DENIED);
+	log->alloc = log->fp->fsize;
+	return FR_OK;
+}
+
+/* write buf to the card at base, advance base when the buffer is full */
+static FRESULT sdlog_write(SDLOG *log)
+{
+	FRESULT res;
+	UINT bw;
+
+	if (!log->len)
+		return FR_OK;
+	if (log->contig) {
+		if (log->base + log->len > log->alloc)
+			return sdlog_fail(log, FR_DENIED); // fixed size file is full
+	} else if (log->base + SDLOG_BUFSIZE > log->alloc) {
+		res = sdlog_grow(log, log->base + SDLOG_BUFSIZE);
+		if (res != FR_OK)
+			return res;
+	}
+	res = f_lseek(log->fp, log->base);
+	if (res == FR_OK)
+		res = f_write(log->fp, log->buf, log->len, &bw);
+	if (res == FR_OK && bw != log->len)
+		res = FR_DENIED; // disk full
+	if (res != FR_OK)
+		return sdlog_fail(log, res);
+	log->writes++;
+	if (log->len == SDLOG_BUFSIZE) {
+		log->base += SDLOG_BUFSIZE;
+		log->len = 0;
+		log->done = 0;
+	}
+	return FR_OK;
+}
+
+void sdlog_init(SDLOG *log, UINT sync_records, UINT sync_ms)
+{
+	memset(log, 0, sizeof(SDLOG));
+	log->sync_records = sync_records;
+	log->sync_ms = sync_ms;
+	log->err = FR_NOT_READY;
+}
+
+/*
+ * create the log file and pre-allocate the first step, records buffered
+ * while the card was out go to the start of the new file
+ */
+FRESULT sdlog_open(SDLOG *log, FIL *fp, const TCHAR *path)
+{
+	FRESULT res;
+
+	log->fp = fp;
+	log->base = 0;
+	log->alloc = 0;
+	log->online = FALSE;
+	log->contig = FALSE;
+	res = f_open(fp, path, FA_CREATE_ALWAYS | FA_WRITE);
+	if (res != FR_OK)
+		return sdlog_fail(log, res);
+	res = sdlog_grow(log, SDLOG_PREALLOC);
+	if (res == FR_OK)
+		res = f_sync(fp); // commit the cluster chain and size
+	if (res != FR_OK) {
+		f_close(fp);
+		return sdlog_fail(log, res);
+	}
+	log->err = FR_OK;
+	log->online = TRUE;
+	log->last_sync = log->now;
+	return FR_OK;
+}
+
+/*
+ * create a fixed size log file for long acquisitions, a contiguous block if
+ * the card has one, else a normal chain, then the fast seek link map for it
+ */
+FRESULT sdlog_open_contig(SDLOG *log, FIL *fp, const TCHAR *path, DWORD size)
+{
+	FRESULT res;
+
+	log->fp = fp;
+	log->base = 0;
+	log->alloc = 0;
+	log->online = FALSE;
+	log->contig = FALSE;
+	size = (size + SDLOG_BUFSIZE - 1) / SDLOG_BUFSIZE * SDLOG_BUFSIZE;
+	res = f_open(fp, path, FA_CREATE_ALWAYS | FA_WRITE);
+	if (res != FR_OK)
+		return sdlog_fail(log, res);
+	res = f_expand(fp, size, 1);
+	if (res == FR_OK)
+		log->alloc = size;
+	else if (res == FR_DENIED) // fragmented card, the link map still saves the FAT walks
+		res = sdlog_grow(log, size);
+	if (res == FR_OK) {
+		log->clmt[0] = SDLOG_CLMT;
+		fp->cltbl = log->clmt;
+		res = f_lseek(fp, CREATE_LINKMAP);
+		if (res == FR_NOT_ENOUGH_CORE) { // too many fragments, normal FAT chain seeks
+			fp->cltbl = 0;
+			res = FR_OK;
+		}
+	}
+	if (res == FR_OK)
+		res = f_sync(fp);
+	if (res != FR_OK) {
+		f_close(fp);
+		return sdlog_fail(log, res);
+	}
+	log->contig = TRUE;
+	log->err = FR_OK;
+	log->online = TRUE;
+	log->last_sync = log->now;
+	return FR_OK;
+}
+
+FRESULT sdlog_sync(SDLOG *log)
+{
+	FRESULT res;
+
+	if (!log->online)
+		return log->err;
+	res = sdlog_write(log);
+	if (res != FR_OK)
+		return res;
+	res = f_sync(log->fp);
+	if (res != FR_OK)
+		return sdlog_fail(log, res);
+	log->done = log->len;
+	log->pending = 0;
+	log->last_sync = log->now;
+	log->syncs++;
+	return FR_OK;
+}
+
+int sdlog_put(SDLOG *log, const char *rec, DWORD now)
+{
+	UINT n = strlen(rec), space;
+
+	log->now = now;
+	if (!log->online && n > SDLOG_BUFSIZE - log->len) {
+		log->dropped++; // no card and no room, keep the older records
+		return -1;
+	}
+	while (n) {
+		space = SDLOG_BUFSIZE - log->len;
+		if (!space) {
+			if (!log->online || sdlog_write(log) != FR_OK) {
+				log->dropped++;
+				return -1;
+			}
+			continue;
+		}
+		if (space > n)
+			space = n;
+		memcpy(&log->buf[log->len], rec, space);
+		log->len += space;
+		rec += space;
+		n -= space;
+		log->bytes += space;
+	}
+	if (log->len == SDLOG_BUFSIZE && log->online)
+		sdlog_write(log);
+	log->records++;
+	log->pending++;
+	if (log->sync_records && log->pending >= log->sync_records)
+		sdlog_sync(log);
+	else
+		sdlog_poll(log, now);
+	return 0;
+}
+
+FRESULT sdlog_poll(SDLOG *log, DWORD now)
+{
+	log->now = now;
+	if (log->online && log->sync_ms && log->pending && (now - log->last_sync) >= log->sync_ms)
+		return sdlog_sync(log);
+	return log->err;
+}
+
+FRESULT sdlog_close(SDLOG *log)
+{
+	FRESULT res;
+
+	if (!log->online)
+		return log->err;
+	res = sdlog_write(log);
+	if (res != FR_OK)
+		return res;
+	res = f_lseek(log->fp, log->base + log->len);
+	if (res == FR_OK)
+		res = f_truncate(log->fp); // drop the unused pre-allocation
+	if (res == FR_OK)
+		res = f_close(log->fp);
+	if (res != FR_OK)
+		return sdlog_fail(log, res);
+	log->online = FALSE;
+	log->err = FR_NOT_READY;
+	log->base = 0;
+	log->len = 0;
+	log->done = 0;
+	log->pending = 0;
+	return FR_OK;
+}
+
+/*
+ * the card was pulled, the buffer part already synced to it is dropped,
+ * the rest waits for the next sdlog_open
+ */
+void sdlog_eject(SDLOG *log)
+{
+	if (log->done) {
+		memmove(log->buf, &log->buf[log->done], log->len - log->done);
+		log->len -= log->done;
+		log->done = 0;
+	}
+	log->base = 0;
+	log->alloc = 0;
+	sdlog_fail(log, FR_NOT_READY);
+}
@@ -0,0 +1,62 @@
+/*
+ * File:   sdlog.h
+ * Author: root
+ *
+ * Write-behind record logger for FatFs files.
+ * Records are packed into a sector aligned RAM buffer and written to the
+ * card in full buffer sized pieces, the file is pre-allocated so appends
+ * don't have to grow the FAT chain and f_sync only runs when the record or
+ * time budget runs out.
+ * sdlog_open_contig makes a fixed size contiguous file and uses the FatFs fast
+ * seek link map, appends then go to computed sectors without FAT lookups.
+ */
+
+#ifndef SDLOG_H
+#define	SDLOG_H
+
+#include "src/ff.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define SDLOG_SECTORS	8		// buffer size in sectors, match the card cluster size
+#define SDLOG_BUFSIZE	(SDLOG_SECTORS * 512)
+#define SDLOG_PREALLOC	(256UL * 1024UL)	// file pre-allocation step in bytes
+#define SDLOG_SYNC_REC	100		// default f_sync record budget
+#define SDLOG_SYNC_MS	5000		// default f_sync time budget
+#define SDLOG_CLMT	32		// fast seek link map size, 15 fragments if the file can't be contiguous
+
+	typedef struct SDLOG {
+		BYTE buf[SDLOG_BUFSIZE] __attribute__((aligned(4))); // data for the file sectors at base
+		FIL *fp;
+		DWORD base; // file offset of buf[0], always a multiple of SDLOG_BUFSIZE
+		DWORD alloc; // pre-allocated file size
+		UINT len; // bytes used in buf
+		UINT done; // bytes of buf already synced to the card
+		UINT sync_records, sync_ms; // sync budget, 0 disables that budget
+		UINT pending; // records since the last sync
+		DWORD now, last_sync; // time of the last call and the last sync in ms
+		FRESULT err; // last FatFs error, the log is offline when not FR_OK
+		BYTE online;
+		BYTE contig; // fixed size file with a link map, no growing
+		DWORD clmt[SDLOG_CLMT]; // cluster link map table for fast seek
+		/* statistics */
+		DWORD records, dropped, writes, syncs, bytes;
+	} SDLOG;
+
+	void sdlog_init(SDLOG*, UINT, UINT); // record and ms sync budgets
+	FRESULT sdlog_open(SDLOG*, FIL*, const TCHAR*);
+	FRESULT sdlog_open_contig(SDLOG*, FIL*, const TCHAR*, DWORD); // file size in bytes
+	int sdlog_put(SDLOG*, const char*, DWORD); // record text and current time in ms, returns -1 if dropped
+	FRESULT sdlog_poll(SDLOG*, DWORD); // run the time budget from the main loop
+	FRESULT sdlog_sync(SDLOG*);
+	FRESULT sdlog_close(SDLOG*); // flush, trim the pre-allocation and close
+	void sdlog_eject(SDLOG*); // card is gone, keep the buffered records for the next open
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* SDLOG_H */
+
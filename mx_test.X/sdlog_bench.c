@@ -0,0 +1,211 @@
+/* sdlog record logger check and benchmark on a RAM disk
+ *
+ * cc -O2 -DINTTYPES -I. -Isrc -o sdlog_bench sdlog_bench.c sdlog.c src/ff.c src/diskio_img.c
+ * ./sdlog_bench [records] [image file]
+ *
+ * Makes a FAT volume on the diskio_img RAM disk (or the image file) and logs
+ * the records (100000 if not given), a test_main.c R data line each 10 ms of
+ * log time, with
+ *   f_sync+f_puts  the old main loop, f_sync before every record
+ *   sdlog          sdlog_put with the SDLOG_SYNC_REC and SDLOG_SYNC_MS budgets
+ *   sdlog no sync  sdlog_put with both budgets off, full buffer writes only
+ * and prints the card sector writes and reads per record, the disk_write
+ * calls per record and the host records/s. Both sdlog files must read back
+ * as the records in order (f_puts in the old path turns the \n into \r\n,
+ * that file is not compared).
+ * Then it pulls the card in the middle of a buffer: the records after the
+ * last sync must show up at the start of the next file, in order.
+ * Last it logs LONG_MB of records to a file grown by sdlog_open and to a
+ * sdlog_open_contig file (f_expand and the fast seek link map), both with the
+ * default budgets, and prints the FAT sector reads and writes, all sector
+ * reads and the disk_write calls per MB of log.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sdlog.h"
+#include "src/diskio_img.h"
+
+#define TICK_MS	10	// log time between records
+#define LONG_MB	16	// log size of the fast seek run
+
+static FATFS fs;
+static FIL file, ref;
+static SDLOG lg;
+static BYTE a[4096], b[4096];
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char *record(int i)
+{
+	static char rec[128]; // the whole line, up to 111 characters
+
+	snprintf(rec, sizeof(rec), "\r\n  R data %x , %i, %x , %i , %i , %i , %i , %lu.%04lu volts                                         ",
+		i & 0xff, i, 0x5a, i % 7, i % 11, i % 13, i % 17, (unsigned long) i / 10000, (unsigned long) i % 10000);
+	rec[63] = 0; // cut like the 64 byte comm_buffer of test_main.c
+	return rec;
+}
+
+static void report(const char *name, int n, double t)
+{
+	printf("  %-14s %9.3f %9.3f %9.3f %12.0f\n", name, (double) disk_img_stat.wsect / n,
+		(double) disk_img_stat.rsect / n, (double) disk_img_stat.writes / n, n / t);
+}
+
+static int run_old(int n)
+{
+	double t;
+	int i;
+
+	if (f_open(&ref, "0:old.txt", FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+		return -1;
+	disk_img_clear();
+	t = now_s();
+	for (i = 0; i < n; i++) {
+		if (f_sync(&ref) != FR_OK || f_puts(record(i), &ref) < 0)
+			return -1;
+	}
+	if (f_close(&ref) != FR_OK)
+		return -1;
+	report("f_sync+f_puts", n, now_s() - t);
+	return 0;
+}
+
+static int run_sdlog(const char *name, const TCHAR *path, int n, UINT rec, UINT ms)
+{
+	double t;
+	int i;
+
+	sdlog_init(&lg, rec, ms);
+	if (sdlog_open(&lg, &file, path) != FR_OK)
+		return -1;
+	disk_img_clear();
+	t = now_s();
+	for (i = 0; i < n; i++) {
+		if (sdlog_put(&lg, record(i), (DWORD) i * TICK_MS) < 0)
+			return -1;
+	}
+	if (sdlog_close(&lg) != FR_OK)
+		return -1;
+	report(name, n, now_s() - t);
+	return 0;
+}
+
+/* 1 if the file holds records 0 to n - 1 and nothing else */
+static int same(const TCHAR *path, int n)
+{
+	const char *rec;
+	UINT len, got;
+	int i, ok;
+
+	if (f_open(&file, path, FA_READ) != FR_OK)
+		return 0;
+	for (i = 0, ok = 1; ok && i < n; i++) {
+		rec = record(i);
+		len = strlen(rec);
+		ok = f_read(&file, a, len, &got) == FR_OK && got == len && !memcmp(a, rec, len);
+	}
+	if (ok)
+		ok = f_read(&file, a, 1, &got) == FR_OK && !got;
+	f_close(&file);
+	return ok;
+}
+
+/* eject after a sync and a few more records, they go to the next file */
+static int eject(void)
+{
+	UINT n;
+	int i, len = 0;
+
+	sdlog_init(&lg, 10, 0);
+	if (sdlog_open(&lg, &file, "0:e1.txt") != FR_OK)
+		return -1;
+	for (i = 0; i < 25; i++)
+		sdlog_put(&lg, record(i), 0);
+	sdlog_eject(&lg);
+	for (i = 25; i < 30; i++)
+		sdlog_put(&lg, record(i), 0); // card out, buffered
+	if (lg.online || lg.dropped || sdlog_open(&lg, &file, "0:e2.txt") != FR_OK || sdlog_close(&lg) != FR_OK)
+		return -1;
+	for (i = 20; i < 30; i++) {
+		strcpy((char *) &b[len], record(i));
+		len += strlen(record(i));
+	}
+	if (f_open(&file, "0:e2.txt", FA_READ) != FR_OK || f_read(&file, a, sizeof(a), &n) != FR_OK)
+		return -1;
+	f_close(&file);
+	return n == (UINT) len && !memcmp(a, b, len) ? 0 : -1;
+}
+
+static int run_long(const char *name, int contig)
+{
+	const TCHAR *path = contig ? "0:contig.txt" : "0:grow.txt";
+	DISK_IMG_STAT st;
+	double mb;
+	int i, map;
+
+	sdlog_init(&lg, SDLOG_SYNC_REC, SDLOG_SYNC_MS);
+	if ((contig ? sdlog_open_contig(&lg, &file, path, (LONG_MB + 1UL) << 20) : sdlog_open(&lg, &file, path)) != FR_OK)
+		return -1;
+	map = file.cltbl != NULL;
+	disk_img_clear();
+	for (i = 0; lg.bytes < (LONG_MB << 20); i++) {
+		if (sdlog_put(&lg, record(i), (DWORD) i * TICK_MS) < 0)
+			return -1;
+	}
+	if (sdlog_close(&lg) != FR_OK)
+		return -1;
+	st = disk_img_stat; // the log alone, not the read back
+	if (!same(path, i))
+		return -1;
+	mb = lg.bytes / 1048576.0;
+	printf("  %-14s %9.1f %9.1f %9.1f %9.1f %s\n", name, st.fat_rsect / mb, st.fat_wsect / mb,
+		st.rsect / mb, st.writes / mb, contig && !map ? "(no link map)" : "");
+	return f_unlink(path) == FR_OK ? 0 : -1;
+}
+
+int main(int argc, char *argv[])
+{
+	int n = argc > 1 ? atoi(argv[1]) : 100000;
+
+	if (argc > 2)
+		disk_img_path = argv[2];
+	if (n < 1 || f_mount(&fs, "0:", 0) != FR_OK || f_mkfs("0:", 0, 4096) != FR_OK
+		|| f_mount(&fs, "0:", 1) != FR_OK) {
+		fprintf(stderr, "sdlog_bench: no volume\n");
+		return 1;
+	}
+	printf("%d records, %d byte buffer, sync every %d records or %d ms\n", n, SDLOG_BUFSIZE,
+		SDLOG_SYNC_REC, SDLOG_SYNC_MS);
+	printf("  %-14s %9s %9s %9s %12s\n", "path", "wsect/rec", "rsect/rec", "calls/rec", "records/s");
+	if (run_old(n) || run_sdlog("sdlog", "0:log.txt", n, SDLOG_SYNC_REC, SDLOG_SYNC_MS)
+		|| run_sdlog("sdlog no sync", "0:nosync.txt", n, 0, 0)) {
+		fprintf(stderr, "sdlog_bench: write failed\n");
+		return 1;
+	}
+	printf("records %s, eject %s\n", same("0:log.txt", n) && same("0:nosync.txt", n) ? "ok" : "DIFFER",
+		eject() ? "FAILED" : "ok");
+
+	f_unlink("0:old.txt");
+	f_unlink("0:log.txt");
+	f_unlink("0:nosync.txt");
+	disk_img_fat[0] = fs.fatbase;
+	disk_img_fat[1] = fs.fatbase + fs.fsize * fs.n_fats;
+	printf("%d MB log, FAT sectors %lu to %lu, per MB\n", LONG_MB, (unsigned long) disk_img_fat[0],
+		(unsigned long) disk_img_fat[1] - 1);
+	printf("  %-14s %9s %9s %9s %9s\n", "path", "FAT rsect", "FAT wsect", "rsect", "calls");
+	if (run_long("sdlog", 0) || run_long("sdlog contig", 1)) {
+		fprintf(stderr, "sdlog_bench: long log failed\n");
+		return 1;
+	}
+	f_mount(NULL, "0:", 0);
+	disk_img_close();
+	return 0;
+}
@@ -1,6 +1,7 @@
 /* SPI interface to SDCARD */
 #include "mx_test.h"
 #include "sdspi.h"
+#include "sdblk.h"
 #include <string.h>
 #include <time.h>
 #include <sys/time.h>
@@ -229,6 +230,31 @@ unsigned char rcvr_spi_sdcard(void)
 	return xmit_spi_sdcard(0xff);
 }
 
+/*-----------------------------------------------------------------------*/
+/* Move one sector of data, tx NULL reads into rx, SDDMA picks the DMA   */
+/* block mover or the byte loop, returns 0 or ERR1                       */
+
+/*-----------------------------------------------------------------------*/
+
+static int sd_data_block(const BYTE* tx, BYTE* rx)
+{
+#if SDDMA
+	if (sdblk_start(tx, rx, SDBUFFERSIZE, NULL))
+		return ERR1; // a transfer is still running
+	return sdblk_wait() ? ERR1 : 0;
+#else
+	int i;
+
+	for (i = 0; i < SDBUFFERSIZE; i++) {
+		if (rx)
+			rx[i] = rcvr_spi_sdcard();
+		else
+			xmit_spi_sdcard(tx[i]);
+	}
+	return 0;
+#endif
+}
+
 
 /*-----------------------------------------------------------------------*/
 /* Send a command packet to MMC/SD Card                                          */
@@ -423,9 +449,12 @@ int MMC_disk_status(void)
 
 int MMC_disk_write(const BYTE* buff, DWORD sector, UINT count)
 {
-	UINT result;
+	UINT result = 0;
 
-	result = mmc_write_block(buff, sector);
+	while (count-- && !result) { // FatFs sends multi sector writes for full sector f_write data
+		result = mmc_write_block(buff, sector++);
+		buff += SDBUFFERSIZE;
+	}
 	return result;
 }
 
@@ -433,7 +462,7 @@ int MMC_disk_write(const BYTE* buff, DWORD sector, UINT count)
 
 int mmc_write_block(const BYTE* buff, unsigned long block_number)
 {
-	static int retry, i, nsec, ssm;
+	static int retry, nsec, ssm;
 	static unsigned char tmp;
 	static unsigned long block_tmp;
 
@@ -463,8 +492,10 @@ int mmc_write_block(const BYTE* buff, unsigned long block_number)
 	if (SDC0.sdtype == SDT6) {
 		xmit_spi_sdcard(0xFE); // send single block token
 
-		for (i = 0; i < SDBUFFERSIZE; i++) {
-			xmit_spi_sdcard(buff[i]); // send data to card
+		if (sd_data_block(buff, NULL)) { // send data to card
+			sd_deselect();
+			SDEBUGM('E');
+			return ERR1;
 		}
 		xmit_spi_sdcard(0xFF); // dummy CRC16
 		xmit_spi_sdcard(0xFF);
@@ -480,8 +511,10 @@ int mmc_write_block(const BYTE* buff, unsigned long block_number)
 		ssm = vinf->read_block_len / SDBUFFERSIZE;
 		for (nsec = 1; nsec <= ssm; nsec++) {
 			xmit_spi_sdcard(0b11111100); // send multi block token
-			for (i = 0; i < SDBUFFERSIZE; i++) {
-				xmit_spi_sdcard(buff[i]); // send data to card
+			if (sd_data_block(buff, NULL)) { // send data to card
+				sd_deselect();
+				SDEBUGM('E');
+				return ERR1;
 			}
 			xmit_spi_sdcard(0xFF); // dummy CRC16
 			xmit_spi_sdcard(0xFF);
@@ -501,9 +534,12 @@ int mmc_write_block(const BYTE* buff, unsigned long block_number)
 
 int MMC_disk_read(BYTE* buff, DWORD sector, UINT count)
 {
-	UINT result;
+	UINT result = 0;
 
-	result = mmc_read_block(buff, sector);
+	while (count-- && !result) {
+		result = mmc_read_block(buff, sector++);
+		buff += SDBUFFERSIZE;
+	}
 	return result;
 }
 
@@ -513,7 +549,7 @@ int MMC_disk_read(BYTE* buff, DWORD sector, UINT count)
 
 int mmc_read_block(BYTE* buff, unsigned long block_number)
 {
-	static int retry, i, nsec, ssm;
+	static int retry, nsec, ssm;
 	static unsigned char tmp;
 	static unsigned long block_tmp;
 
@@ -550,8 +586,10 @@ int mmc_read_block(BYTE* buff, unsigned long block_number)
 	} while (tmp != (unsigned char) 0xfe); // got data token
 
 	if (SDC0.sdtype == SDT6) {
-		for (i = 0; i < SDBUFFERSIZE; i++) {
-			buff[i] = rcvr_spi_sdcard(); // send data to card
+		if (sd_data_block(NULL, buff)) { // receive data from card
+			sd_deselect();
+			SDEBUGM('E');
+			return ERR1;
 		}
 		rcvr_spi_sdcard(); // CRC16 bytes that are not needed
 		rcvr_spi_sdcard();
@@ -561,8 +599,10 @@ int mmc_read_block(BYTE* buff, unsigned long block_number)
 	} else {
 		ssm = vinf->read_block_len / SDBUFFERSIZE;
 		for (nsec = 1; nsec <= ssm; nsec++) {
-			for (i = 0; i < SDBUFFERSIZE; i++) {
-				buff[i] = rcvr_spi_sdcard(); // send data to card
+			if (sd_data_block(NULL, buff)) { // receive data from card
+				sd_deselect();
+				SDEBUGM('E');
+				return ERR1;
 			}
 			rcvr_spi_sdcard(); // CRC16 bytes that are not needed
 			rcvr_spi_sdcard();
@@ -705,6 +745,9 @@ void init_spi_ports(void)
 	SpiInitDevice1(SDCARD_CHAN, 16); // Initialize the SPI channel 1 as master. slow SCK for SDCARD init
 
 	SpiInitDevice2(BUS_CHAN, 2); // Initialize the SPI channel 2 as master, 2.083 mhz SCK
+#if SDDMA
+	sdblk_init(); // DMA channels for SDCARD sector data
+#endif
 	ps_select(0);
 }
 
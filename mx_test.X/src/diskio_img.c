@@ -0,0 +1,210 @@
+/*-----------------------------------------------------------------------*/
+/* Disk image glue functions for FatFs on a Linux host                   */
+/*-----------------------------------------------------------------------*/
+/* Replaces diskio.c and sdspi.c in hosted builds. Sectors live in a RAM */
+/* disk or an image file, every access is counted in disk_img_stat so    */
+/* the card I/O cost of a FatFs operation can be measured.               */
+/*-----------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "diskio.h"
+#include "diskio_img.h"
+
+#define SS	512
+
+const char*		disk_img_path = NULL;
+DWORD			disk_img_sectors = 131072;	/* 64MB */
+DISK_IMG_STAT	disk_img_stat;
+DWORD			disk_img_fat[2];
+
+static int		img_fd = -1;
+static BYTE*	img_ram;
+static DSTATUS	img_stat = STA_NOINIT;
+
+
+/* Sectors of sector..sector+count-1 in the FAT area */
+static DWORD img_fat_count (DWORD sector, UINT count)
+{
+	DWORD s = sector > disk_img_fat[0] ? sector : disk_img_fat[0];
+	DWORD e = sector + count < disk_img_fat[1] ? sector + count : disk_img_fat[1];
+
+	return e > s ? e - s : 0;
+}
+
+
+void disk_img_clear (void)
+{
+	memset(&disk_img_stat, 0, sizeof disk_img_stat);
+}
+
+void disk_img_close (void)
+{
+	if (img_fd >= 0) close(img_fd);
+	img_fd = -1;
+	free(img_ram);
+	img_ram = NULL;
+	img_stat = STA_NOINIT;
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Inidialize a Drive                                                    */
+/*-----------------------------------------------------------------------*/
+
+DSTATUS disk_initialize (
+	BYTE pdrv				/* Physical drive nmuber (0..) */
+)
+{
+	off_t size;
+
+	if (pdrv) return STA_NOINIT;
+	if (!(img_stat & STA_NOINIT)) return img_stat;
+
+	if (disk_img_path) {
+		img_fd = open(disk_img_path, O_RDWR | O_CREAT, 0644);
+		if (img_fd < 0) return STA_NOINIT;
+		size = lseek(img_fd, 0, SEEK_END);
+		if (size < (off_t)SS) {		/* New image, make it disk_img_sectors long */
+			if (ftruncate(img_fd, (off_t)disk_img_sectors * SS)) return STA_NOINIT;
+		} else {
+			disk_img_sectors = (DWORD)(size / SS);
+		}
+	} else {
+		img_ram = calloc(disk_img_sectors, SS);
+		if (!img_ram) return STA_NOINIT;
+	}
+	img_stat = 0;
+	return img_stat;
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Get Disk Status                                                       */
+/*-----------------------------------------------------------------------*/
+
+DSTATUS disk_status (
+	BYTE pdrv				/* Physical drive nmuber (0..) */
+)
+{
+	return pdrv ? STA_NOINIT : img_stat;
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Read Sector(s)                                                        */
+/*-----------------------------------------------------------------------*/
+
+DRESULT disk_read (
+	BYTE pdrv,				/* Physical drive nmuber (0..) */
+	BYTE *buff,				/* Data buffer to store read data */
+	DWORD sector,			/* Sector address (LBA) */
+	UINT count				/* Number of sectors to read (1..128) */
+)
+{
+	if (pdrv || !count) return RES_PARERR;
+	if (img_stat & STA_NOINIT) return RES_NOTRDY;
+	if (sector + count > disk_img_sectors) return RES_PARERR;
+
+	disk_img_stat.reads++;
+	disk_img_stat.rsect += count;
+	disk_img_stat.fat_rsect += img_fat_count(sector, count);
+	if (img_ram) {
+		memcpy(buff, img_ram + (size_t)sector * SS, (size_t)count * SS);
+	} else {
+		if (pread(img_fd, buff, (size_t)count * SS, (off_t)sector * SS) != (ssize_t)count * SS)
+			return RES_ERROR;
+	}
+	return RES_OK;
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Write Sector(s)                                                       */
+/*-----------------------------------------------------------------------*/
+
+#if _USE_WRITE
+DRESULT disk_write (
+	BYTE pdrv,				/* Physical drive nmuber (0..) */
+	const BYTE *buff,		/* Data to be written */
+	DWORD sector,			/* Sector address (LBA) */
+	UINT count				/* Number of sectors to write (1..128) */
+)
+{
+	if (pdrv || !count) return RES_PARERR;
+	if (img_stat & STA_NOINIT) return RES_NOTRDY;
+	if (sector + count > disk_img_sectors) return RES_PARERR;
+
+	disk_img_stat.writes++;
+	disk_img_stat.wsect += count;
+	disk_img_stat.fat_wsect += img_fat_count(sector, count);
+	if (img_ram) {
+		memcpy(img_ram + (size_t)sector * SS, buff, (size_t)count * SS);
+	} else {
+		if (pwrite(img_fd, buff, (size_t)count * SS, (off_t)sector * SS) != (ssize_t)count * SS)
+			return RES_ERROR;
+	}
+	return RES_OK;
+}
+#endif
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Miscellaneous Functions                                               */
+/*-----------------------------------------------------------------------*/
+
+#if _USE_IOCTL
+DRESULT disk_ioctl (
+	BYTE pdrv,				/* Physical drive nmuber (0..) */
+	BYTE cmd,				/* Control code */
+	void *buff				/* Buffer to send/receive control data */
+)
+{
+	if (pdrv) return RES_PARERR;
+	if (img_stat & STA_NOINIT) return RES_NOTRDY;
+
+	switch (cmd) {
+	case CTRL_SYNC :
+		disk_img_stat.syncs++;
+		return RES_OK;
+	case GET_SECTOR_COUNT :
+		*(DWORD*)buff = disk_img_sectors;
+		return RES_OK;
+	case GET_SECTOR_SIZE :
+		*(WORD*)buff = SS;
+		return RES_OK;
+	case GET_BLOCK_SIZE :
+		*(DWORD*)buff = 1;
+		return RES_OK;
+	}
+	return RES_PARERR;
+}
+#endif
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Current time for the FAT time stamps                                  */
+/*-----------------------------------------------------------------------*/
+
+DWORD get_fattime (void)
+{
+	time_t t = time(NULL);
+	struct tm *tm = localtime(&t);
+
+	return ((DWORD)(tm->tm_year - 80) << 25)
+		| ((DWORD)(tm->tm_mon + 1) << 21)
+		| ((DWORD)tm->tm_mday << 16)
+		| ((DWORD)tm->tm_hour << 11)
+		| ((DWORD)tm->tm_min << 5)
+		| ((DWORD)tm->tm_sec >> 1);
+}
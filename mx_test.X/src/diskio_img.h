@@ -0,0 +1,37 @@
+/*-----------------------------------------------------------------------/
+/  Disk image glue for FatFs on a Linux host                             /
+/-----------------------------------------------------------------------*/
+
+#ifndef _DISKIO_IMG_DEFINED
+#define _DISKIO_IMG_DEFINED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "integer.h"
+
+/* Disk access counters, cleared with disk_img_clear() */
+typedef struct {
+	DWORD	reads;			/* disk_read calls */
+	DWORD	writes;			/* disk_write calls */
+	DWORD	rsect;			/* Sectors read */
+	DWORD	wsect;			/* Sectors written */
+	DWORD	syncs;			/* CTRL_SYNC requests */
+	DWORD	fat_rsect;		/* Sectors read in the disk_img_fat range */
+	DWORD	fat_wsect;		/* Sectors written in the disk_img_fat range */
+} DISK_IMG_STAT;
+
+extern const char*		disk_img_path;	/* Image file, NULL for a RAM disk */
+extern DWORD			disk_img_sectors;	/* RAM disk size, or image size when a new file is made */
+extern DISK_IMG_STAT	disk_img_stat;
+extern DWORD			disk_img_fat[2];	/* FAT area, first and last + 1 sector, set from FATFS fatbase and fsize */
+
+void disk_img_clear (void);
+void disk_img_close (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -964,6 +964,51 @@ FRESULT put_fat (
 
 
 
+/*-----------------------------------------------------------------------*/
+/* FAT handling - Free cluster map                                       */
+/*-----------------------------------------------------------------------*/
+#if !_FS_READONLY && _FS_FREEMAP
+#define	FM_FULL(fs, r)	((fs)->fm_full[(r) / 8] & (1 << ((r) % 8)))
+
+static
+void fm_init (
+	FATFS* fs		/* File system object (fs_type and n_fatent are valid) */
+)
+{
+	DWORD n;
+	UINT i;
+
+
+	n = (fs->n_fatent + _FS_FREEMAP - 1) / _FS_FREEMAP;	/* Clusters per range */
+	if (fs->fs_type != FS_FAT12) {		/* Round up to whole FAT sectors */
+		i = SS(fs) / (fs->fs_type == FS_FAT32 ? 4 : 2);
+		n = (n + i - 1) / i * i;
+	}
+	fs->fm_size = n;
+	mem_set(fs->fm_full, 0, sizeof fs->fm_full);	/* Nothing is known to be full */
+}
+
+
+static
+void fm_mark (
+	FATFS* fs,		/* File system object */
+	DWORD clst,		/* Cluster# in the range */
+	int full		/* 1:Range is full, 0:Range has a free cluster */
+)
+{
+	UINT r = clst / fs->fm_size;
+
+
+	if (full)
+		fs->fm_full[r / 8] |= 1 << (r % 8);
+	else
+		fs->fm_full[r / 8] &= ~(1 << (r % 8));
+}
+#endif
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* FAT handling - Remove a cluster chain                                 */
 /*-----------------------------------------------------------------------*/
@@ -992,6 +1037,9 @@ FRESULT remove_chain (
 			if (nxt == 0xFFFFFFFF) { res = FR_DISK_ERR; break; }	/* Disk error? */
 			res = put_fat(fs, clst, 0);			/* Mark the cluster "empty" */
 			if (res != FR_OK) break;
+#if _FS_FREEMAP
+			fm_mark(fs, clst, 0);
+#endif
 			if (fs->free_clust != 0xFFFFFFFF) {	/* Update FSINFO */
 				fs->free_clust++;
 				fs->fsi_flag |= 1;
@@ -1029,6 +1077,10 @@ DWORD create_chain (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk err
 {
 	DWORD cs, ncl, scl;
 	FRESULT res;
+#if _FS_FREEMAP
+	UINT r;
+	BYTE whole = 0;
+#endif
 
 
 	if (clst == 0) {		/* Create a new chain */
@@ -1050,10 +1102,26 @@ DWORD create_chain (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk err
 			ncl = 2;
 			if (ncl > scl) return 0;	/* No free cluster */
 		}
+#if _FS_FREEMAP
+		r = ncl / fs->fm_size;
+		if (FM_FULL(fs, r)) {			/* Skip a full range */
+			cs = (r + 1) * fs->fm_size - 1;	/* Last cluster of the range */
+			if (scl >= ncl && scl <= cs) return 0;	/* Passed the start point, no free cluster */
+			ncl = cs;
+			continue;
+		}
+		if (ncl % fs->fm_size == 0 || ncl == 2) whole = 1;	/* Entered the range at its start */
+#endif
 		cs = get_fat(fs, ncl);			/* Get the cluster status */
 		if (cs == 0) break;				/* Found a free cluster */
 		if (cs == 0xFFFFFFFF || cs == 1)/* An error occurred */
 			return cs;
+#if _FS_FREEMAP
+		if (whole && ((ncl + 1) % fs->fm_size == 0 || ncl + 1 == fs->n_fatent)) {
+			fm_mark(fs, ncl, 1);		/* Walked all of the range, it is full */
+			whole = 0;
+		}
+#endif
 		if (ncl == scl) return 0;		/* No free cluster */
 	}
 
@@ -1481,13 +1549,88 @@ BYTE sum_sfn (
 
 
 /*-----------------------------------------------------------------------*/
-/* Directory handling - Find an object in the directory                  */
+/* Directory handling - Directory entry cache                            */
 /*-----------------------------------------------------------------------*/
+#if _FS_DIRCACHE
+#if _USE_LFN
+#define	DC_SPAN	((_MAX_LFN + 12) / 13 + 1)	/* Entries of the longest object */
+#else
+#define	DC_SPAN	1
+#endif
 
 static
-FRESULT dir_find (
+WORD dc_hash (	/* Hash of the name in the directory object */
 	DIR* dp			/* Pointer to the directory object linked to the file name */
 )
+{
+	DWORD h = 0x811C9DC5;	/* FNV-1a */
+	UINT i;
+
+
+#if _USE_LFN
+	if (dp->lfn) {			/* LFN is matched case insensitive */
+		for (i = 0; dp->lfn[i]; i++) h = (h ^ ff_wtoupper(dp->lfn[i])) * 0x01000193;
+		return (WORD)(h ^ (h >> 16));
+	}
+#endif
+	for (i = 0; i < 11; i++) h = (h ^ dp->fn[i]) * 0x01000193;
+	return (WORD)(h ^ (h >> 16));
+}
+
+
+static
+void dc_put (	/* Put the object on the first of its two slots */
+	DIR* dp,		/* Pointer to the directory object */
+	WORD h,			/* Name hash */
+	WORD idx		/* Index of the first entry of the object */
+)
+{
+	FATFS *fs = dp->fs;
+	UINT s = h % _FS_DIRCACHE, t = (s + 1) % _FS_DIRCACHE;
+
+
+	if (fs->dc_idx[s] != 0xFFFF && (fs->dc_hash[s] != h || fs->dc_clust[s] != dp->sclust)) {
+		fs->dc_clust[t] = fs->dc_clust[s];	/* Move the older one to the second slot */
+		fs->dc_hash[t] = fs->dc_hash[s];
+		fs->dc_idx[t] = fs->dc_idx[s];
+	}
+	fs->dc_clust[s] = dp->sclust;
+	fs->dc_hash[s] = h;
+	fs->dc_idx[s] = idx;
+}
+
+
+#if !_FS_READONLY && !_FS_MINIMIZE
+static
+void dc_drop (
+	DIR* dp,		/* Pointer to the directory object */
+	WORD idx		/* Index of the first entry of the removed object */
+)
+{
+	UINT s;
+
+
+	for (s = 0; s < _FS_DIRCACHE; s++) {
+		if (dp->fs->dc_idx[s] == idx && dp->fs->dc_clust[s] == dp->sclust)
+			dp->fs->dc_idx[s] = 0xFFFF;
+	}
+}
+#endif
+#endif
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Directory handling - Find an object in the directory                  */
+/*-----------------------------------------------------------------------*/
+
+static
+FRESULT dir_match (	/* FR_OK:Found, FR_NO_FILE:Not in the entries checked */
+	DIR* dp,		/* Pointer to the directory object linked to the file name */
+	UINT idx,		/* Index to start at */
+	UINT n			/* Number of entries to check (0:To the end of the table) */
+)
 {
 	FRESULT res;
 	BYTE c, *dir;
@@ -1495,7 +1638,7 @@ FRESULT dir_find (
 	BYTE a, ord, sum;
 #endif
 
-	res = dir_sdi(dp, 0);			/* Rewind directory object */
+	res = dir_sdi(dp, idx);			/* Rewind directory object */
 	if (res != FR_OK) return res;
 
 #if _USE_LFN
@@ -1532,6 +1675,7 @@ FRESULT dir_find (
 		if (!(dir[DIR_Attr] & AM_VOL) && !mem_cmp(dir, dp->fn, 11)) /* Is it a valid entry? */
 			break;
 #endif
+		if (n && !--n) { res = FR_NO_FILE; break; }	/* Checked all entries given */
 		res = dir_next(dp, 0);		/* Next entry */
 	} while (res == FR_OK);
 
@@ -1539,6 +1683,45 @@ FRESULT dir_find (
 }
 
 
+static
+FRESULT dir_find (
+	DIR* dp			/* Pointer to the directory object linked to the file name */
+)
+{
+#if _FS_DIRCACHE
+	FRESULT res;
+	FATFS *fs = dp->fs;
+	WORD h;
+	UINT s, n;
+
+
+	h = dc_hash(dp);
+	s = h % _FS_DIRCACHE;
+	for (n = 0; n < 2; n++, s = (s + 1) % _FS_DIRCACHE) {	/* Check the cached object first */
+		if (fs->dc_idx[s] != 0xFFFF && fs->dc_hash[s] == h && fs->dc_clust[s] == dp->sclust) {
+			res = dir_match(dp, fs->dc_idx[s], DC_SPAN);
+			if (res == FR_OK) {
+				if (n) dc_put(dp, h, fs->dc_idx[s]);	/* Back to the first slot */
+				return res;
+			}
+			if (res == FR_DISK_ERR) return res;
+		}
+	}
+	res = dir_match(dp, 0, 0);
+	if (res == FR_OK) {
+#if _USE_LFN
+		dc_put(dp, h, (dp->lfn_idx != 0xFFFF) ? dp->lfn_idx : dp->index);
+#else
+		dc_put(dp, h, dp->index);
+#endif
+	}
+	return res;
+#else
+	return dir_match(dp, 0, 0);
+#endif
+}
+
+
 
 
 /*-----------------------------------------------------------------------*/
@@ -1610,6 +1793,9 @@ FRESULT dir_register (	/* FR_OK:Successful, FR_DENIED:No free entry or too many
 )
 {
 	FRESULT res;
+#if _FS_DIRCACHE
+	WORD is;
+#endif
 #if _USE_LFN	/* LFN configuration */
 	UINT n, nent;
 	BYTE sn[12], *fn, sum;
@@ -1641,6 +1827,9 @@ FRESULT dir_register (	/* FR_OK:Successful, FR_DENIED:No free entry or too many
 		nent = 1;
 	}
 	res = dir_alloc(dp, nent);		/* Allocate entries */
+#if _FS_DIRCACHE
+	is = dp->index - (nent - 1);	/* First entry of the object */
+#endif
 
 	if (res == FR_OK && --nent) {	/* Set LFN entry if needed */
 		res = dir_sdi(dp, dp->index - nent);
@@ -1657,6 +1846,9 @@ FRESULT dir_register (	/* FR_OK:Successful, FR_DENIED:No free entry or too many
 	}
 #else	/* Non LFN configuration */
 	res = dir_alloc(dp, 1);		/* Allocate an entry for SFN */
+#if _FS_DIRCACHE
+	is = dp->index;
+#endif
 #endif
 
 	if (res == FR_OK) {				/* Set SFN entry */
@@ -1668,6 +1860,9 @@ FRESULT dir_register (	/* FR_OK:Successful, FR_DENIED:No free entry or too many
 			dp->dir[DIR_NTres] = dp->fn[NS] & (NS_BODY | NS_EXT);	/* Put NT flag */
 #endif
 			dp->fs->wflag = 1;
+#if _FS_DIRCACHE
+			dc_put(dp, dc_hash(dp), is);	/* Reopening it does not scan the directory */
+#endif
 		}
 	}
 
@@ -1693,6 +1888,9 @@ FRESULT dir_remove (	/* FR_OK: Successful, FR_DISK_ERR: A disk error */
 
 	i = dp->index;	/* SFN index */
 	res = dir_sdi(dp, (dp->lfn_idx == 0xFFFF) ? i : dp->lfn_idx);	/* Goto the SFN or top of the LFN entries */
+#if _FS_DIRCACHE
+	dc_drop(dp, dp->index);	/* dp->index is the first entry now */
+#endif
 	if (res == FR_OK) {
 		do {
 			res = move_window(dp->fs, dp->sect);
@@ -1708,6 +1906,9 @@ FRESULT dir_remove (	/* FR_OK: Successful, FR_DISK_ERR: A disk error */
 
 #else			/* Non LFN configuration */
 	res = dir_sdi(dp, dp->index);
+#if _FS_DIRCACHE
+	dc_drop(dp, dp->index);
+#endif
 	if (res == FR_OK) {
 		res = move_window(dp->fs, dp->sect);
 		if (res == FR_OK) {
@@ -2312,6 +2513,12 @@ FRESULT find_volume (	/* FR_OK(0): successful, !=0: any error occurred */
 #endif
 	fs->fs_type = fmt;	/* FAT sub-type */
 	fs->id = ++Fsid;	/* File system mount ID */
+#if !_FS_READONLY && _FS_FREEMAP
+	fm_init(fs);
+#endif
+#if _FS_DIRCACHE
+	mem_set(fs->dc_idx, 0xFF, sizeof fs->dc_idx);	/* Empty directory cache */
+#endif
 #if _FS_RPATH
 	fs->cdir = 0;		/* Set current directory to root */
 #endif
@@ -3430,6 +3637,84 @@ FRESULT f_truncate (
 
 
 
+#if _USE_FASTSEEK
+/*-----------------------------------------------------------------------*/
+/* Allocate a Contiguous Block to the File                               */
+/*-----------------------------------------------------------------------*/
+
+FRESULT f_expand (
+	FIL* fp,		/* Pointer to the file object (must be empty) */
+	DWORD fsz,		/* File size to be expanded to */
+	BYTE opt		/* 0:Find only, 1:Find and allocate */
+)
+{
+	FRESULT res;
+	DWORD n, clst, stcl, scl, ncl, tcl, lclst;
+#if _FS_FREEMAP
+	UINT r;
+#endif
+
+
+	res = validate(fp);						/* Check validity of the object */
+	if (res != FR_OK) LEAVE_FF(fp->fs, res);
+	if (fp->err) LEAVE_FF(fp->fs, (FRESULT)fp->err);
+	if (fsz == 0 || fp->fsize != 0 || !(fp->flag & FA_WRITE))
+		LEAVE_FF(fp->fs, FR_DENIED);
+
+	n = (DWORD)fp->fs->csize * SS(fp->fs);	/* Cluster size */
+	tcl = fsz / n + ((fsz & (n - 1)) ? 1 : 0);	/* Number of clusters required */
+	stcl = fp->fs->last_clust;				/* Search from the last allocated cluster */
+	if (stcl < 2 || stcl >= fp->fs->n_fatent) stcl = 2;
+	scl = clst = stcl; ncl = 0;
+	for (;;) {								/* Find a run of tcl free clusters on the FAT */
+#if _FS_FREEMAP
+		r = clst / fp->fs->fm_size;
+		if (FM_FULL(fp->fs, r)) {			/* Skip a full range */
+			n = (r + 1) * fp->fs->fm_size;	/* First cluster of the next range */
+			if (stcl > clst && stcl < n) { res = FR_DENIED; break; }
+			clst = scl = n; ncl = 0;
+			if (clst >= fp->fs->n_fatent) clst = scl = 2;
+			if (clst == stcl) { res = FR_DENIED; break; }
+			continue;
+		}
+#endif
+		n = get_fat(fp->fs, clst);
+		if (n == 1) { res = FR_INT_ERR; break; }
+		if (n == 0xFFFFFFFF) { res = FR_DISK_ERR; break; }
+		if (n == 0) {						/* A free cluster */
+			if (++ncl == tcl) break;		/* Found a contiguous block */
+		} else {
+			scl = clst + 1; ncl = 0;		/* Not free, restart after it */
+		}
+		if (++clst >= fp->fs->n_fatent) {	/* Wrap around, a block cannot cross the end */
+			clst = scl = 2; ncl = 0;
+		}
+		if (clst == stcl) { res = FR_DENIED; break; }	/* No contiguous space */
+	}
+
+	if (res == FR_OK && opt) {				/* Make the cluster chain */
+		for (clst = scl, lclst = scl + tcl - 1; res == FR_OK && clst < lclst; clst++)
+			res = put_fat(fp->fs, clst, clst + 1);
+		if (res == FR_OK) res = put_fat(fp->fs, lclst, 0x0FFFFFFF);
+		if (res == FR_OK) {
+			fp->sclust = scl;				/* Set the start cluster, the size goes to the directory at f_sync */
+			fp->fsize = fsz;
+			fp->flag |= FA__WRITTEN;
+			fp->fs->last_clust = lclst;
+			if (fp->fs->free_clust != 0xFFFFFFFF) {
+				fp->fs->free_clust -= tcl;
+				fp->fs->fsi_flag |= 1;
+			}
+		}
+	}
+
+	LEAVE_FF(fp->fs, res);
+}
+#endif /* _USE_FASTSEEK */
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Delete a File or Directory                                            */
 /*-----------------------------------------------------------------------*/
@@ -104,6 +104,15 @@ typedef struct {
 	DWORD	database;		/* Data start sector */
 	DWORD	winsect;		/* Current sector appearing in the win[] */
 	BYTE	win[_MAX_SS];	/* Disk access window for Directory, FAT (and file data at tiny cfg) */
+#if _FS_DIRCACHE
+	DWORD	dc_clust[_FS_DIRCACHE];	/* Directory start cluster of each slot */
+	WORD	dc_hash[_FS_DIRCACHE];	/* Name hash */
+	WORD	dc_idx[_FS_DIRCACHE];	/* Index of the first entry of the object (0xFFFF:Empty slot) */
+#endif
+#if !_FS_READONLY && _FS_FREEMAP
+	DWORD	fm_size;		/* Clusters per free map range */
+	BYTE	fm_full[(_FS_FREEMAP + 7) / 8];	/* Full range bit map */
+#endif
 } FATFS;
 
 
@@ -212,6 +221,7 @@ FRESULT f_write (FIL* fp, const void* buff, UINT btw, UINT* bw);	/* Write data t
 FRESULT f_forward (FIL* fp, UINT(*func)(const BYTE*,UINT), UINT btf, UINT* bf);	/* Forward data to the stream */
 FRESULT f_lseek (FIL* fp, DWORD ofs);								/* Move file pointer of a file object */
 FRESULT f_truncate (FIL* fp);										/* Truncate file */
+FRESULT f_expand (FIL* fp, DWORD fsz, BYTE opt);					/* Allocate a contiguous block to the file */
 FRESULT f_sync (FIL* fp);											/* Flush cached data of a writing file */
 FRESULT f_opendir (DIR* dp, const TCHAR* path);						/* Open a directory */
 FRESULT f_closedir (DIR* dp);										/* Close an open directory */
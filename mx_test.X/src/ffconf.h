@@ -41,8 +41,30 @@
 /* To enable f_mkfs() function, set _USE_MKFS to 1 and set _FS_READONLY to 0 */
 
 
-#define	_USE_FASTSEEK	0	/* 0:Disable or 1:Enable */
-/* To enable fast seek feature, set _USE_FASTSEEK to 1. */
+#define	_USE_FASTSEEK	1	/* 0:Disable or 1:Enable */
+/* To enable fast seek feature, set _USE_FASTSEEK to 1. This also enables the
+/  f_expand() function to make contiguous files for the fast seek logger mode. */
+
+
+#ifndef _FS_FREEMAP
+#define	_FS_FREEMAP		256	/* 0:Disable or >=1:Number of free cluster map ranges */
+#endif
+/* When _FS_FREEMAP is set to 1 or more, the FAT is split into that many ranges
+/  and the file system object keeps one bit per range.
+/  A range is marked full when the cluster search walks all of it without a
+/  free cluster and unmarked when a cluster in it is freed. Later searches skip
+/  the full ranges without reading their FAT sectors. */
+
+
+#ifndef _FS_DIRCACHE
+#define	_FS_DIRCACHE	32	/* 0:Disable or >=1:Number of directory cache slots */
+#endif
+/* When _FS_DIRCACHE is set to 1 or more, the file system object keeps a hash
+/  of the names found in directories with the index of their entries (8 bytes
+/  a slot, a name goes to the slot of its hash or the next one). A lookup of a
+/  cached name checks that entry first instead of reading the directory from
+/  the top. Slots are dropped when the object is removed, a stale slot costs
+/  only the check of one object. New names still scan the whole directory. */
 
 
 #define _USE_LABEL		1	/* 0:Disable or 1:Enable */
@@ -89,6 +111,16 @@
 /   1    - ASCII (Valid for only non-LFN cfg.) */
 
 
+#define	_CP_TABLE	0	/* 0:Compact or 1:Page tables */
+/* The _CP_TABLE option selects the tables used by ff_convert() of the DBCS
+/  code pages (932, 936, 949 and 950) and by ff_wtoupper().
+/
+/   0: Sorted code pairs, binary search per character. Smallest ROM.
+/   1: Two-level page tables made by option/mkcctbl.c (ccNNNp.h, ccupper.h),
+/      one table read per character. ROM is about the same, CP932 +18KB,
+/      CP936 -52KB, CP949 +6KB, CP950 -9KB, ff_wtoupper() +3KB. */
+
+
 #define	_USE_LFN	0		/* 0 to 3 */
 #define	_MAX_LFN	255		/* Maximum LFN length to handle (12 to 255) */
 /* The _USE_LFN option switches the LFN feature.
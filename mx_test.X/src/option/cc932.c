@@ -13,6 +13,7 @@
 #endif
 
 
+#if !_CP_TABLE
 static
 const WCHAR uni2sjis[] = {
 /*  Unicode - Sjis, Unicode - Sjis, Unicode - Sjis, Unicode - Sjis, */
@@ -3720,8 +3721,35 @@ const WCHAR sjis2uni[] = {
 	0xFC4A, 0x9E19, 0xFC4B, 0x9ED1, 0, 0
 };
 #endif
+#endif
+
 
 
+#if _CP_TABLE
+#include "cc932p.h"		/* Page tables made by mkcctbl.c */
+#include "ccupper.h"
+
+WCHAR ff_convert (	/* Converted code, 0 means conversion error */
+	WCHAR	chr,	/* Character code to be converted */
+	UINT	dir		/* 0: Unicode to OEMCP, 1: OEMCP to Unicode */
+)
+{
+	if (dir)		/* OEMCP to unicode */
+		return oem2uni_tbl[oem2uni_pg[chr >> 8]][chr & 0xFF];
+
+	return uni2oem_tbl[uni2oem_pg[chr >> 8]][chr & 0xFF];	/* Unicode to OEMCP */
+}
+
+
+
+WCHAR ff_wtoupper (	/* Upper converted character */
+	WCHAR chr		/* Input character */
+)
+{
+	return (WCHAR)(chr + upper_tbl[upper_pg[chr >> 8]][chr & 0xFF]);
+}
+
+#else
 
 WCHAR ff_convert (	/* Converted code, 0 means conversion error */
 	WCHAR	chr,	/* Character code to be converted */
@@ -3796,3 +3824,4 @@ WCHAR ff_wtoupper (	/* Upper converted character */
 
 	return tbl_lower[i] ? tbl_upper[i] : chr;
 }
+#endif
@@ -11,6 +11,7 @@
 #error This file is not needed in current configuration. Remove from the project.
 #endif
 
+#if !_CP_TABLE
 static
 const WCHAR uni2oem[] = {
 /*  Unicode - OEM,  Unicode - OEM,  Unicode - OEM,  Unicode - OEM */
@@ -10918,8 +10919,35 @@ const WCHAR oem2uni[] = {
 	0xFE4C, 0xFA24, 0xFE4D, 0xFA27, 0xFE4E, 0xFA28, 0xFE4F, 0xFA29,
 	0, 0
 };
+#endif
+
+
+
+#if _CP_TABLE
+#include "cc936p.h"		/* Page tables made by mkcctbl.c */
+#include "ccupper.h"
+
+WCHAR ff_convert (	/* Converted code, 0 means conversion error */
+	WCHAR	chr,	/* Character code to be converted */
+	UINT	dir		/* 0: Unicode to OEMCP, 1: OEMCP to Unicode */
+)
+{
+	if (dir)		/* OEMCP to unicode */
+		return oem2uni_tbl[oem2uni_pg[chr >> 8]][chr & 0xFF];
 
+	return uni2oem_tbl[uni2oem_pg[chr >> 8]][chr & 0xFF];	/* Unicode to OEMCP */
+}
+
+
+
+WCHAR ff_wtoupper (	/* Upper converted character */
+	WCHAR chr		/* Input character */
+)
+{
+	return (WCHAR)(chr + upper_tbl[upper_pg[chr >> 8]][chr & 0xFF]);
+}
 
+#else
 
 WCHAR ff_convert (	/* Converted code, 0 means conversion error */
 	WCHAR	chr,	/* Character code to be converted */
@@ -10971,3 +10999,4 @@ WCHAR ff_wtoupper (	/* Upper converted character */
 
 	return tbl_lower[i] ? tbl_upper[i] : chr;
 }
+#endif
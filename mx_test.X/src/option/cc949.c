@@ -12,6 +12,7 @@
 #endif
 
 
+#if !_CP_TABLE
 static
 const WCHAR uni2oem[] = {
 /*  Unicode - OEM,  Unicode - OEM,  Unicode - OEM,  Unicode - OEM */
@@ -8547,8 +8548,35 @@ const WCHAR oem2uni[] = {
 	0xFDFB, 0x79A7, 0xFDFC, 0x7A00, 0xFDFD, 0x7FB2, 0xFDFE, 0x8A70,
 	0, 0
 };
+#endif
+
+
+
+#if _CP_TABLE
+#include "cc949p.h"		/* Page tables made by mkcctbl.c */
+#include "ccupper.h"
+
+WCHAR ff_convert (	/* Converted code, 0 means conversion error */
+	WCHAR	chr,	/* Character code to be converted */
+	UINT	dir		/* 0: Unicode to OEMCP, 1: OEMCP to Unicode */
+)
+{
+	if (dir)		/* OEMCP to unicode */
+		return oem2uni_tbl[oem2uni_pg[chr >> 8]][chr & 0xFF];
 
+	return uni2oem_tbl[uni2oem_pg[chr >> 8]][chr & 0xFF];	/* Unicode to OEMCP */
+}
+
+
+
+WCHAR ff_wtoupper (	/* Upper converted character */
+	WCHAR chr		/* Input character */
+)
+{
+	return (WCHAR)(chr + upper_tbl[upper_pg[chr >> 8]][chr & 0xFF]);
+}
 
+#else
 
 WCHAR ff_convert (	/* Converted code, 0 means conversion error */
 	WCHAR	chr,	/* Character code to be converted */
@@ -8601,3 +8629,4 @@ WCHAR ff_wtoupper (	/* Upper converted character */
 
 	return tbl_lower[i] ? tbl_upper[i] : chr;
 }
+#endif
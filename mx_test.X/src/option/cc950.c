@@ -12,6 +12,7 @@
 #endif
 
 
+#if !_CP_TABLE
 static
 const WCHAR uni2oem[] = {
 /*  Unicode - OEM,  Unicode - OEM,  Unicode - OEM,  Unicode - OEM */
@@ -6773,8 +6774,35 @@ const WCHAR oem2uni[] = {
 	0xF9F8, 0x2551, 0xF9F9, 0x2550, 0xF9FA, 0x256D, 0xF9FB, 0x256E,
 	0xF9FC, 0x2570, 0xF9FD, 0x256F, 0xF9FE, 0x2593, 0, 0
 };
+#endif
+
+
+
+#if _CP_TABLE
+#include "cc950p.h"		/* Page tables made by mkcctbl.c */
+#include "ccupper.h"
+
+WCHAR ff_convert (	/* Converted code, 0 means conversion error */
+	WCHAR	chr,	/* Character code to be converted */
+	UINT	dir		/* 0: Unicode to OEMCP, 1: OEMCP to Unicode */
+)
+{
+	if (dir)		/* OEMCP to unicode */
+		return oem2uni_tbl[oem2uni_pg[chr >> 8]][chr & 0xFF];
 
+	return uni2oem_tbl[uni2oem_pg[chr >> 8]][chr & 0xFF];	/* Unicode to OEMCP */
+}
+
+
+
+WCHAR ff_wtoupper (	/* Upper converted character */
+	WCHAR chr		/* Input character */
+)
+{
+	return (WCHAR)(chr + upper_tbl[upper_pg[chr >> 8]][chr & 0xFF]);
+}
 
+#else
 
 WCHAR ff_convert (	/* Converted code, 0 means conversion error */
 	WCHAR	chr,	/* Character code to be converted */
@@ -6827,3 +6855,4 @@ WCHAR ff_wtoupper (	/* Upper converted character */
 
 	return tbl_lower[i] ? tbl_upper[i] : chr;
 }
+#endif
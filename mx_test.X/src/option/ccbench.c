@@ -0,0 +1,143 @@
+/*------------------------------------------------------------------------*/
+/* Code converter check and benchmark, compact layout against page tables */
+/*------------------------------------------------------------------------*/
+/* Host tool, both _CP_TABLE layouts of one DBCS code page in one build:
+/
+/    cc -O2 -DCP=936 -o ccbench ccbench.c
+/    ./ccbench
+/
+/  Every code 0x0000-0xFFFF is run through ff_convert() in both directions
+/  and through ff_wtoupper() of both layouts, any difference is printed and
+/  fails the run. Then it prints the ns per character of
+/    u2o, o2u      ff_convert() on all the codes that convert (non-ASCII)
+/    upper ascii   ff_wtoupper() on LFN style ASCII names
+/    upper cjk     ff_wtoupper() on the Unicode codes of the code page
+/  and the ROM bytes of the tables. The compact ff_wtoupper() tables are
+/  local to the function, their size is counted from the codes it changes. */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define _FATFS	0			/* Skip ../ff.h, the converters need only these */
+typedef unsigned char	BYTE;
+typedef unsigned short	WCHAR;
+typedef unsigned int	UINT;
+#define _USE_LFN	1
+#define _CODE_PAGE	CP
+
+#define _CP_TABLE	0
+#define ff_convert	cmp_convert
+#define ff_wtoupper	cmp_wtoupper
+#if   CP == 932
+#include "cc932.c"
+#define CMP_ROM	(sizeof uni2sjis + sizeof sjis2uni)
+#elif CP == 936
+#include "cc936.c"
+#elif CP == 949
+#include "cc949.c"
+#elif CP == 950
+#include "cc950.c"
+#else
+#error Set CP to 932, 936, 949 or 950
+#endif
+#ifndef CMP_ROM
+#define CMP_ROM	(sizeof uni2oem + sizeof oem2uni)
+#endif
+
+#undef _CP_TABLE
+#undef ff_convert
+#undef ff_wtoupper
+#define _CP_TABLE	1
+#define ff_convert	pg_convert
+#define ff_wtoupper	pg_wtoupper
+#if   CP == 932
+#include "cc932.c"
+#elif CP == 936
+#include "cc936.c"
+#elif CP == 949
+#include "cc949.c"
+#else
+#include "cc950.c"
+#endif
+#define PG_ROM	(sizeof uni2oem_pg + sizeof uni2oem_tbl + sizeof oem2uni_pg + sizeof oem2uni_tbl)
+#define UP_ROM	(sizeof upper_pg + sizeof upper_tbl)
+
+#define RUNS	20
+
+
+static WCHAR Uni[65536], Oem[65536], Asc[4096];
+static int Nu, No;
+static volatile UINT Sum;
+
+
+static
+double now_ns (void)
+{
+	struct timespec ts;
+
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static
+int check (void)
+{
+	UINT c;
+	int bad = 0;
+
+
+	for (c = 0; c < 0x10000; c++) {
+		if (cmp_convert((WCHAR)c, 0) != pg_convert((WCHAR)c, 0)
+			|| cmp_convert((WCHAR)c, 1) != pg_convert((WCHAR)c, 1)
+			|| cmp_wtoupper((WCHAR)c) != pg_wtoupper((WCHAR)c)) {
+			if (bad++ < 10) printf("code %04X differs\n", c);
+		}
+	}
+	return bad;
+}
+
+
+/* ns per character of expr on codes[0..n-1], the code is in c_ */
+#define TIME(expr, codes, n, t) do { \
+	int r_, i_; UINT s_ = 0; WCHAR c_; double t_ = now_ns(); \
+	for (r_ = 0; r_ < RUNS; r_++) for (i_ = 0; i_ < (n); i_++) { c_ = (codes)[i_]; s_ += (expr); } \
+	(t) = (now_ns() - t_) / ((double)RUNS * (n)); Sum += s_; } while (0)
+
+
+int main (void)
+{
+	double t[2][4];
+	UINT c, nup = 0;
+	int i, bad;
+
+
+	for (c = 0x80; c < 0x10000; c++) {
+		WCHAR o = cmp_convert((WCHAR)c, 0);
+		if (o) { Uni[Nu++] = (WCHAR)c; Oem[No++] = o; }
+	}
+	for (c = 0; c < 0x10000; c++)
+		if (cmp_wtoupper((WCHAR)c) != c) nup++;
+	for (i = 0; i < 4096; i++) Asc[i] = "log_2016-10-03_moonlight~1.txt"[i % 30];
+
+	bad = check();
+	printf("CP%d, %d codes convert, 65536 codes checked: %s\n", CP, Nu, bad ? "DIFFER" : "same");
+
+	TIME(cmp_convert(c_, 0), Uni, Nu, t[0][0]);
+	TIME(cmp_convert(c_, 1), Oem, No, t[0][1]);
+	TIME(cmp_wtoupper(c_), Asc, 4096, t[0][2]);
+	TIME(cmp_wtoupper(c_), Uni, Nu, t[0][3]);
+	TIME(pg_convert(c_, 0), Uni, Nu, t[1][0]);
+	TIME(pg_convert(c_, 1), Oem, No, t[1][1]);
+	TIME(pg_wtoupper(c_), Asc, 4096, t[1][2]);
+	TIME(pg_wtoupper(c_), Uni, Nu, t[1][3]);
+
+	printf("  %-8s %8s %8s %12s %12s %10s %10s\n", "layout", "u2o ns", "o2u ns", "upper ascii", "upper cjk", "conv ROM", "upper ROM");
+	for (i = 0; i < 2; i++)
+		printf("  %-8s %8.1f %8.1f %12.1f %12.1f %10lu %10lu\n", i ? "pages" : "compact",
+			t[i][0], t[i][1], t[i][2], t[i][3],
+			(unsigned long)(i ? PG_ROM : CMP_ROM), (unsigned long)(i ? UP_ROM : 2 * 2 * (nup + 1)));
+	return bad;
+}
@@ -525,6 +525,18 @@ WCHAR ff_convert (	/* Converted character, Returns zero on error */
 }
 
 
+#if _CP_TABLE
+#include "ccupper.h"		/* Page table made by mkcctbl.c */
+
+WCHAR ff_wtoupper (	/* Upper converted character */
+	WCHAR chr		/* Input character */
+)
+{
+	return (WCHAR)(chr + upper_tbl[upper_pg[chr >> 8]][chr & 0xFF]);
+}
+
+#else
+
 WCHAR ff_wtoupper (	/* Upper converted character */
 	WCHAR chr		/* Input character */
 )
@@ -538,3 +550,4 @@ WCHAR ff_wtoupper (	/* Upper converted character */
 
 	return tbl_lower[i] ? tbl_upper[i] : chr;
 }
+#endif
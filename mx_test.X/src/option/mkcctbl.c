@@ -0,0 +1,117 @@
+/*------------------------------------------------------------------------*/
+/* Page table generator for the Unicode - OEM code converters             */
+/*------------------------------------------------------------------------*/
+/* Host tool, makes the _CP_TABLE = 1 tables from the compact converters:
+/
+/    cc -DCP=936 -o mkcctbl mkcctbl.c
+/    ./mkcctbl > cc936p.h
+/    ./mkcctbl -u > ccupper.h
+/
+/  Every code 0x0000-0xFFFF is run through ff_convert() and ff_wtoupper()
+/  of ccNNN.c, so the page tables return the same code for any input.
+/  A table is a 256 entry page index on the upper byte of the code and the
+/  unique 256 entry pages, page 0 is all zero. The case table holds the
+/  difference to the upper case code. */
+
+#include <stdio.h>
+#include <string.h>
+
+#define _FATFS	0			/* Skip ../ff.h, the converters need only these */
+typedef unsigned short	WCHAR;
+typedef unsigned int	UINT;
+#define _USE_LFN	1
+#define _CODE_PAGE	CP
+#define _CP_TABLE	0
+
+#if   CP == 932
+#include "cc932.c"
+#elif CP == 936
+#include "cc936.c"
+#elif CP == 949
+#include "cc949.c"
+#elif CP == 950
+#include "cc950.c"
+#else
+#error Set CP to 932, 936, 949 or 950
+#endif
+
+
+static WCHAR Pages[256][256];	/* Unique pages */
+static int Npages;
+static int Index[256];			/* Page of each upper byte */
+
+
+static
+WCHAR map (int mode, WCHAR c)
+{
+	switch (mode) {
+	case 0: return ff_convert(c, 0);			/* Unicode to OEMCP */
+	case 1: return ff_convert(c, 1);			/* OEMCP to Unicode */
+	default: return (WCHAR)(ff_wtoupper(c) - c);	/* Case fold difference */
+	}
+}
+
+
+static
+int build (int mode)
+{
+	WCHAR page[256];
+	int h, l, i;
+
+
+	memset(Pages[0], 0, sizeof Pages[0]);
+	Npages = 1;
+	for (h = 0; h < 256; h++) {
+		for (l = 0; l < 256; l++) page[l] = map(mode, (WCHAR)(h << 8 | l));
+		for (i = 0; i < Npages && memcmp(Pages[i], page, sizeof page); i++) ;
+		if (i == Npages) {
+			if (Npages == 256) return -1;	/* Does not fit a BYTE index */
+			memcpy(Pages[Npages++], page, sizeof page);
+		}
+		Index[h] = i;
+	}
+	return 0;
+}
+
+
+static
+void put (const char* name, const char* desc)
+{
+	int i, j;
+
+
+	printf("static\r\nconst BYTE %s_pg[256] = {\t/* %s, code >> 8 to page */\r\n", name, desc);
+	for (i = 0; i < 256; i++)
+		printf("%s0x%02X,%s", (i % 16) ? " " : "\t", Index[i], (i % 16 == 15) ? "\r\n" : "");
+	printf("};\r\n\r\n");
+	printf("static\r\nconst WCHAR %s_tbl[%d][256] = {\t/* %u bytes */\r\n", name, Npages, (unsigned)(Npages * 512 + 256));
+	for (j = 0; j < Npages; j++) {
+		printf("\t{\t/* Page %d */\r\n", j);
+		for (i = 0; i < 256; i++)
+			printf("%s0x%04X,%s", (i % 8) ? " " : "\t\t", Pages[j][i], (i % 8 == 7) ? "\r\n" : "");
+		printf("\t},\r\n");
+	}
+	printf("};\r\n\r\n");
+}
+
+
+int main (int argc, char* argv[])
+{
+	if (argc > 1 && !strcmp(argv[1], "-u")) {
+		printf("/*------------------------------------------------------------------------*/\r\n");
+		printf("/* Case fold page table for ff_wtoupper(), made by mkcctbl.c            */\r\n");
+		printf("/*------------------------------------------------------------------------*/\r\n\r\n");
+		if (build(2)) return 1;
+		put("upper", "Upper case code - code");
+		return 0;
+	}
+
+	printf("/*------------------------------------------------------------------------*/\r\n");
+	printf("/* CP%d page tables for ff_convert(), made by mkcctbl.c from cc%d.c     */\r\n", CP, CP);
+	printf("/*------------------------------------------------------------------------*/\r\n\r\n");
+	if (build(0)) return 1;
+	put("uni2oem", "Unicode to OEMCP");
+	if (build(1)) return 1;
+	put("oem2uni", "OEMCP to Unicode");
+	return 0;
+}
@@ -77,17 +77,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 
 #include "mx_test_defs.h"
 #include "mx_test_types.h"
 #include "sdspi.h"
 #include "src/ff.h"
 #include "blinker.h"
+#include "sdlog.h"
 
 #define	ADSCALE		4095	// for unsigned conversion 12 sig bits
-#define	ADREF		2.048	// internal voltage ref on 45K80
-#define	ADOFFSET	0.0015	// correct for zero shift
-#define ADGAIN		0.983	// correct for voltage offset from calibration value 2.000 volts
+#define	ADREF		2048	// internal voltage ref on 45K80, mV
+#define	ADOFFSET	15	// correct for zero shift, 100 uV
+#define ADGAIN		983	// correct for voltage offset from calibration value 2.000 volts, 1/1000
+#define LOG_SIZE	(64UL * 1024UL * 1024UL)	// contiguous fast seek log file, 0 = grow as needed
 
 /*
  * SDCARD variable
@@ -102,6 +105,7 @@ volatile struct V_data V;
  */
 FATFS FatFs; /* File system object */
 FIL File[2]; /* File objects */
+SDLOG Log; /* Write-behind record buffer for File[0] */
 
 
 
@@ -122,6 +126,27 @@ void DelayMs(WORD delay)
 	mCTClearIntFlag();
 }
 
+/*
+ * log time stamp in ms from the Timer5 RTC, tv_usec counts ms there
+ */
+static DWORD log_time_ms(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (DWORD) tv.tv_sec * 1000 + tv.tv_usec;
+}
+
+/*
+ * create the log file on the card, buffered records go first
+ */
+static FRESULT log_open(void)
+{
+	if (LOG_SIZE)
+		return sdlog_open_contig(&Log, &File[0], "0:logfile.txt", LOG_SIZE);
+	return sdlog_open(&Log, &File[0], "0:logfile.txt");
+}
+
 void Show_MMC_Info(void)
 {
 	char comm_buffer[128];
@@ -160,7 +185,7 @@ int main(void)
 	char comm_buffer[MAXSTRLEN];
 	int update_rate = 4;
 	int file_result = 0, records = 0, file_errors = 0, io_result;
-	double Vval, Vcal0;
+	unsigned long Vcal0; // 100 uV, no floating point printf is linked
 
 	// Init remote device data
 	S1.obits.out_byte = 0xff;
@@ -220,6 +245,7 @@ int main(void)
 	// send some text to clean the buffers
 	SpiStringWrite("\r\n                                                                              \n\r");
 
+	sdlog_init(&Log, SDLOG_SYNC_REC, SDLOG_SYNC_MS);
 	file_result = f_mount(&FatFs, "0:", 1);
 	if (file_result) {
 		sprintf(comm_buffer, "\r\n Mount error %i ", file_result);
@@ -233,7 +259,7 @@ int main(void)
 	}
 
 	/* Create destination file on the drive 1 */
-	file_result = f_open(&File[0], "0:logfile.txt", FA_CREATE_ALWAYS | FA_WRITE);
+	file_result = log_open();
 
 	while (1) { // loop and move data
 
@@ -258,6 +284,10 @@ int main(void)
 		if (S1_p->ibits.in_bits.card_detect) {
 			S1_p->obits.out_bits.eject_led = OFF;
 			MM_state(STA_NOINIT);
+			if (Log.online) { // card pulled without eject, hold records until the next mount
+				sdlog_eject(&Log);
+				file_result = 1;
+			}
 		} else {
 			S1_p->obits.out_bits.eject_led = ~S1_p->obits.out_bits.eject_led;
 		}
@@ -267,15 +297,14 @@ int main(void)
 		a = 0;
 
 		if (((records % 100)) == 0 && !file_result) {
-			Vval = S1_p->adc_data[0];
-			Vcal0 = ((Vval / ADSCALE * ADREF) + ADOFFSET) * ADGAIN;
+			Vcal0 = (S1_p->adc_data[0] * (ADREF * ADGAIN * 10ULL) + ADOFFSET * ADGAIN * ADSCALE + ADSCALE * 500)
+				/ (ADSCALE * 1000);
 			if (S1_p->char_ready) {
-				snprintf(comm_buffer, 64, "\r\n  R data %x , %i, %x , %i , %i , %i , %i , %2.4f volts                                         ", S1_p->rec_data, records, S1_p->ibits.in_byte, S1_p->adc_data[0], S1_p->adc_data[1], S1_p->adc_data[2], S1_p->adc_data[3], Vcal0);
+				snprintf(comm_buffer, 64, "\r\n  R data %x , %i, %x , %i , %i , %i , %i , %lu.%04lu volts                                         ", S1_p->rec_data, records, S1_p->ibits.in_byte, S1_p->adc_data[0], S1_p->adc_data[1], S1_p->adc_data[2], S1_p->adc_data[3], Vcal0 / 10000, Vcal0 % 10000);
 			} else {
-				snprintf(comm_buffer, 64, "\r\n  B data %x , %i , %i , %i , %i , %i  , %2.4f volts                                             ", S1_p->ibits.in_byte, records, S1_p->adc_data[0], S1_p->adc_data[1], S1_p->adc_data[2], S1_p->adc_data[3], Vcal0);
+				snprintf(comm_buffer, 64, "\r\n  B data %x , %i , %i , %i , %i , %i  , %lu.%04lu volts                                             ", S1_p->ibits.in_byte, records, S1_p->adc_data[0], S1_p->adc_data[1], S1_p->adc_data[2], S1_p->adc_data[3], Vcal0 / 10000, Vcal0 % 10000);
 			}
 			S1_p->rec_tmp = SpiStringWrite(comm_buffer);
-			f_sync(&File[0]);
 		}
 		if (SpiSerialReadOk() || !S1_p->ibits.in_bits.eject) {
 			S1_p->char_ready = TRUE;
@@ -304,7 +333,7 @@ int main(void)
 							blink_led(GREEN_LED, LED_ON, TRUE);
 						}
 						/* Create destination file on the drive 1 */
-						file_result = f_open(&File[0], "0:logfile.txt", FA_CREATE_ALWAYS | FA_WRITE);
+						file_result = log_open();
 						SpiStringWrite("\r\n Mount Complete ");
 
 						S1_p->ibits.in_byte = SpiPortWrite(S1_p->obits.out_byte);
@@ -314,7 +343,7 @@ int main(void)
 					blink_led(0, LED_ON, FALSE);
 					S1_p->obits.out_bits.eject_led = OFF;
 					S1_p->ibits.in_byte = SpiPortWrite(S1_p->obits.out_byte);
-					f_close(&File[0]);
+					sdlog_close(&Log);
 					SpiStringWrite("\r\n Eject Disk? y/n ");
 					while (!SpiSerialReadReady() && !S1_p->ibits.in_bits.card_detect) S1_p->ibits.in_byte = SpiPortWrite(S1_p->obits.out_byte);
 					V.Timer1 = update_rate;
@@ -348,12 +377,13 @@ int main(void)
 		}
 
 		if (!file_result) {
-			f_sync(&File[0]);
-			a = f_puts(comm_buffer, &File[0]);
+			a = sdlog_put(&Log, comm_buffer, log_time_ms()); // syncs on the record or time budget
+			if (!Log.online) file_result = Log.err;
 			blink_led(RED_LED, LED_OFF, FALSE);
 			blink_led(GREEN_LED, LED_ON, TRUE);
 			records++;
 		} else {
+			sdlog_put(&Log, comm_buffer, log_time_ms()); // buffer while the card is out
 			file_errors++;
 			if ((file_errors % 100) == 0) {
 				//				SpiStringWrite("\r\n not logged ");
@@ -372,7 +372,9 @@ void InterruptHandlerHigh(void)
 	if (PIE3bits.TX2IE && PIR3bits.TX2IF) {
 		SRQ = HIGH;
 
-		if (TXSTA2bits.TRMT) {
+		if (!RB_EMPTY(spi_comm.tx1)) { // send the next byte from the bounce buffer
+			RB_GET(spi_comm.tx1, TXREG2);
+		} else if (TXSTA2bits.TRMT) {
 			PIE3bits.TX2IE = LOW;
 			SRQ = LOW;
 			spi_stat.tx_int++;
@@ -425,7 +427,14 @@ void InterruptHandlerHigh(void)
 
 		DLED0 = HIGH; // rx data led off
 		if (PIR3bits.RC2IF) { // we need to read the buffer in sync with the *_CHAR_* commands so it's polled
-			char_rxtmp = RCREG2;
+			if (!RB_FULL(spi_comm.rx1)) {
+				RB_PUT(spi_comm.rx1, RCREG2); // bytes wait in the bounce buffer until the master reads them
+			} else {
+				b_dummy = RCREG2; // bounce buffer overrun
+			}
+		}
+		if (!spi_comm.CHAR_DATA && !RB_EMPTY(spi_comm.rx1)) { // the master took the last one
+			RB_GET(spi_comm.rx1, char_rxtmp);
 			cmd_dummy |= UART_DUMMY_MASK; // We have real USART data waiting
 			spi_comm.CHAR_DATA = TRUE;
 		}
@@ -500,10 +509,10 @@ void InterruptHandlerHigh(void)
 			}
 
 			if (command == CMD_CHAR_DATA) { // get upper 4 bits send bits and send the data
-				if (TXSTA2bits.TRMT) { // The USART send buffer is ready
-					TXREG2 = ((data_in2 & LO_NIBBLE) << 4) | char_txtmp; // send data to RS-232 #2 output
-					PIE3bits.TX2IE = HIGH; // enable the serial interrupt
+				if (!RB_FULL(spi_comm.tx1)) { // queue it for the TX2 interrupt, don't drop it on a busy USART
+					RB_PUT(spi_comm.tx1, ((data_in2 & LO_NIBBLE) << 4) | char_txtmp); // send data to RS-232 #2 output
 				}
+				PIE3bits.TX2IE = HIGH; // enable the serial interrupt
 				SSPBUF = cmd_dummy; // send rx status first, the next SPI transfer will contain it.
 				cmd_dummy = CMD_DUMMY; // clear rx bit
 				spi_comm.CHAR_DATA = FALSE;
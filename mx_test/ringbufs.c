@@ -2,23 +2,8 @@
 #include  "ringbufs.h"
 
 /*
- * general ring buffer fuctions from the internet
+ * byte ring for the serial links, one side may be an ISR
  */
-uint8_t modulo_inc(const uint8_t value, const uint8_t modulus)
-{
-	uint8_t my_value = value + 1;
-	if (my_value >= modulus) {
-		my_value = 0;
-	}
-	return my_value;
-}
-
-uint8_t modulo_dec(const uint8_t value, const uint8_t modulus)
-{
-	uint8_t my_value = (0 == value) ? (modulus - 1) : (value - 1);
-	return my_value;
-}
-
 void ringBufS_init(ringBufS_t *_this)
 {
 	/*****
@@ -26,7 +11,6 @@ void ringBufS_init(ringBufS_t *_this)
 	    -> buf
 	    -> head
 	    -> tail
-	    -> count
 	  and sets head = tail
 	 ***/
 	memset(_this, 0, sizeof(*_this));
@@ -34,43 +18,86 @@ void ringBufS_init(ringBufS_t *_this)
 
 int8_t ringBufS_empty(ringBufS_t *_this)
 {
-	return(0 == _this->count);
+	return RB_EMPTY(_this);
 }
 
 int8_t ringBufS_full(ringBufS_t *_this)
 {
-	return(_this->count >= RBUF_SIZE);
+	return RB_FULL(_this);
 }
 
-uint16_t ringBufS_get(ringBufS_t *_this)
+uint8_t ringBufS_get(ringBufS_t *_this)
 {
-	uint16_t c;
-	if (_this->count > 0) {
-		c = _this->buf[_this->tail];
-		_this->tail = modulo_inc(_this->tail, RBUF_SIZE);
-		--_this->count;
+	uint8_t c;
+	if (!RB_EMPTY(_this)) {
+		RB_GET(_this, c);
 	} else {
 		c = 0; // return null with empty buffer
 	}
 	return(c);
 }
 
-void ringBufS_put(ringBufS_t *_this, const uint16_t c)
+void ringBufS_put(ringBufS_t *_this, const uint8_t c)
 {
-	if (_this->count < RBUF_SIZE) {
-		_this->buf[_this->head] = c;
-		_this->head = modulo_inc(_this->head, RBUF_SIZE);
-		++_this->count;
+	if (!RB_FULL(_this)) {
+		RB_PUT(_this, c);
 	}
 }
 
+/*
+ * consumer side only, the producer may keep adding while the ring is
+ * flushed; clearBuffer also zeroes the storage, only with the producer
+ * stopped, the memset would wipe bytes it is putting in
+ */
 void ringBufS_flush(ringBufS_t *_this, const int8_t clearBuffer)
 {
-	_this->count = 0;
-	_this->head = 0;
-	_this->tail = 0;
+	RB_FLUSH(_this);
 	if (clearBuffer) {
 		memset(_this->buf, 0, sizeof(_this->buf));
 	}
 }
 
+/*
+ * copy up to n bytes into the ring in at most two spans, returns the bytes taken
+ */
+uint16_t ringBufS_write(ringBufS_t *_this, const uint8_t *src, uint16_t n)
+{
+	uint16_t span, done = 0;
+
+	while (n) {
+		RB_WSPAN(_this, span);
+		if (!span)
+			break;
+		if (span > n)
+			span = n;
+		memcpy(RB_WPTR(_this), src, span);
+		RB_COMMIT(_this, span);
+		src += span;
+		done += span;
+		n -= span;
+	}
+	return done;
+}
+
+/*
+ * copy up to n bytes out of the ring, returns the bytes copied
+ */
+uint16_t ringBufS_read(ringBufS_t *_this, uint8_t *dst, uint16_t n)
+{
+	uint16_t span, done = 0;
+
+	while (n) {
+		RB_RSPAN(_this, span);
+		if (!span)
+			break;
+		if (span > n)
+			span = n;
+		RB_ACQUIRE();
+		memcpy(dst, RB_RPTR(_this), span);
+		RB_CONSUME(_this, span);
+		dst += span;
+		done += span;
+		n -= span;
+	}
+	return done;
+}
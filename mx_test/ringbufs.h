@@ -1,8 +1,11 @@
-/* 
+/*
  * File:   ringbufs.h
  * Author: rootswitcDC circuit breakerh debounce icdebounce icfuse type T
  *
  * Created on July 25, 2015, 2:03 PM
+ *
+ * byte ring for the serial links on the RB_ template of ../ringbuf.h,
+ * shared with the pic24 UART and the hosted tools
  */
 
 #ifndef RINGBUFS_H
@@ -12,33 +15,20 @@
 extern "C" {
 #endif
 
-/*unsigned types*/
-typedef unsigned char uint8_t;
-typedef unsigned int uint16_t;
-typedef unsigned long uint32_t;
-typedef unsigned long long uint64_t;
-/*signed types*/
-typedef signed char int8_t;
-typedef signed int int16_t;
-typedef signed long int32_t;
-typedef signed long long int64_t;
-
-	
+#include "../ringbuf.h"
+
 #define RBUF_SIZE    32
 
-	typedef struct ringBufS_t {
-		uint8_t buf[RBUF_SIZE];
-		int8_t head;
-		int8_t tail;
-		int8_t count;
-	} ringBufS_t;
+	RB_TYPE(ringBufS_t, uint8_t, RBUF_SIZE, uint8_t);
 
 	void ringBufS_init(ringBufS_t *_this);
 	int8_t ringBufS_empty(ringBufS_t *_this);
 	int8_t ringBufS_full(ringBufS_t *_this);
-	uint16_t ringBufS_get(ringBufS_t *_this);
-	void ringBufS_put(ringBufS_t *_this, const uint16_t c);
+	uint8_t ringBufS_get(ringBufS_t *_this);
+	void ringBufS_put(ringBufS_t *_this, const uint8_t c);
 	void ringBufS_flush(ringBufS_t *_this, const int8_t clearBuffer);
+	uint16_t ringBufS_write(ringBufS_t *_this, const uint8_t *src, uint16_t n);
+	uint16_t ringBufS_read(ringBufS_t *_this, uint8_t *dst, uint16_t n);
 
 
 #ifdef	__cplusplus
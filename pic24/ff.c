@@ -736,6 +736,116 @@ void clear_lock (	/* Clear lock entries of the volume */
 
 
 
+/*-----------------------------------------------------------------------*/
+/* Window cache - LRU cache of the sectors that left the window          */
+/*-----------------------------------------------------------------------*/
+/* Only FAT sectors are kept dirty in the cache. Any other dirty sector is
+/  written when it leaves the window and the dirty FAT sectors go out first,
+/  so a directory entry never reaches the disk before its cluster chain. */
+#if _FS_WINCACHE
+#define	WC_DIRTY	0x01
+#define	WC_VALID	0x02
+
+static
+int wc_find (	/* Cache entry index, -1:Not in the cache */
+	FATFS* fs,		/* File system object */
+	DWORD sect		/* Sector number to find */
+)
+{
+	int i;
+
+
+	for (i = 0; i < _FS_WINCACHE; i++) {
+		if ((fs->wc_flag[i] & WC_VALID) && fs->wc_sect[i] == sect) return i;
+	}
+	return -1;
+}
+
+
+static
+int wc_slot (	/* Index of a free or the least recently used cache entry */
+	FATFS* fs		/* File system object */
+)
+{
+	int i, n = 0;
+	WORD age = 0;
+
+
+	for (i = 0; i < _FS_WINCACHE; i++) {
+		if (!(fs->wc_flag[i] & WC_VALID)) return i;
+		if ((WORD)(fs->wc_tick - fs->wc_used[i]) >= age) {
+			age = fs->wc_tick - fs->wc_used[i];
+			n = i;
+		}
+	}
+	return n;
+}
+#endif
+
+
+#if !_FS_READONLY
+static
+FRESULT write_sect (	/* Write a sector, FAT sectors go to all FAT copies */
+	FATFS* fs,		/* File system object */
+	const BYTE* buf,	/* Sector data */
+	DWORD sect		/* Sector number */
+)
+{
+	UINT nf;
+
+
+	if (disk_write(fs->drv, buf, sect, 1))
+		return FR_DISK_ERR;
+	if (sect - fs->fatbase < fs->fsize) {		/* Is it in the FAT area? */
+		for (nf = fs->n_fats; nf >= 2; nf--) {	/* Reflect the change to all FAT copies */
+			sect += fs->fsize;
+			disk_write(fs->drv, buf, sect, 1);
+		}
+	}
+	return FR_OK;
+}
+
+
+#if _FS_WINCACHE
+static
+FRESULT wc_flush (	/* Write back the dirty FAT sectors in the cache */
+	FATFS* fs		/* File system object */
+)
+{
+	int i;
+
+
+	for (i = 0; i < _FS_WINCACHE; i++) {
+		if (fs->wc_flag[i] & WC_DIRTY) {
+			if (write_sect(fs, fs->wc_buf[i], fs->wc_sect[i]) != FR_OK)
+				return FR_DISK_ERR;
+			fs->wc_flag[i] &= ~WC_DIRTY;
+		}
+	}
+	return FR_OK;
+}
+
+
+static
+void wc_inval (	/* Drop cached copies of sectors that are rewritten or freed */
+	FATFS* fs,		/* File system object */
+	DWORD sect,		/* First sector */
+	UINT n			/* Number of sectors */
+)
+{
+	int i;
+
+
+	for (i = 0; i < _FS_WINCACHE; i++) {
+		if (fs->wc_sect[i] - sect < n) fs->wc_flag[i] = 0;
+	}
+}
+#endif
+#endif
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Move/Flush disk access window in the file system object               */
 /*-----------------------------------------------------------------------*/
@@ -746,20 +856,18 @@ FRESULT sync_window (
 )
 {
 	DWORD wsect;
-	UINT nf;
 
 
 	if (fs->wflag) {	/* Write back the sector if it is dirty */
 		wsect = fs->winsect;	/* Current sector number */
-		if (disk_write(fs->drv, fs->win, wsect, 1))
+#if _FS_WINCACHE
+		if (wsect - fs->fatbase >= fs->fsize && wc_flush(fs) != FR_OK)	/* FAT first */
+			return FR_DISK_ERR;
+		wc_inval(fs, wsect, 1);	/* Drop an older copy left by a direct window assignment */
+#endif
+		if (write_sect(fs, fs->win, wsect) != FR_OK)
 			return FR_DISK_ERR;
 		fs->wflag = 0;
-		if (wsect - fs->fatbase < fs->fsize) {		/* Is it in the FAT area? */
-			for (nf = fs->n_fats; nf >= 2; nf--) {	/* Reflect the change to all FAT copies */
-				wsect += fs->fsize;
-				disk_write(fs->drv, fs->win, wsect, 1);
-			}
-		}
 	}
 	return FR_OK;
 }
@@ -772,10 +880,58 @@ FRESULT move_window (
 	DWORD sector	/* Sector number to make appearance in the fs->win[] */
 )
 {
+#if _FS_WINCACHE
+	int i, n;
+	UINT b;
+	BYTE d;
+#endif
+
+
 	if (sector != fs->winsect) {	/* Changed current window */
+#if _FS_WINCACHE
+#if !_FS_READONLY
+		if (fs->winsect - fs->fatbase >= fs->fsize && sync_window(fs) != FR_OK)	/* Only FAT sectors stay dirty in the cache */
+			return FR_DISK_ERR;
+#endif
+		n = wc_find(fs, sector);
+		if (fs->winsect != 0xFFFFFFFF) {	/* Keep the outgoing sector in the cache */
+			i = wc_find(fs, fs->winsect);
+			if (i >= 0) fs->wc_flag[i] = 0;	/* Drop an older copy of it */
+			if (n >= 0) {		/* Hit, swap the window and the cache entry */
+				for (b = 0; b < SS(fs); b++) {
+					d = fs->win[b]; fs->win[b] = fs->wc_buf[n][b]; fs->wc_buf[n][b] = d;
+				}
+				d = fs->wc_flag[n] & WC_DIRTY;
+				fs->wc_flag[n] = WC_VALID | fs->wflag;
+				fs->wc_sect[n] = fs->winsect;
+				fs->wc_used[n] = ++fs->wc_tick;
+				fs->wflag = d;
+				fs->winsect = sector;
+				return FR_OK;
+			}
+			i = wc_slot(fs);
+#if !_FS_READONLY
+			if ((fs->wc_flag[i] & WC_DIRTY) && write_sect(fs, fs->wc_buf[i], fs->wc_sect[i]) != FR_OK)
+				return FR_DISK_ERR;
+#endif
+			mem_cpy(fs->wc_buf[i], fs->win, SS(fs));
+			fs->wc_flag[i] = WC_VALID | fs->wflag;
+			fs->wc_sect[i] = fs->winsect;
+			fs->wc_used[i] = ++fs->wc_tick;
+			fs->wflag = 0;
+		} else if (n >= 0) {	/* Hit with no valid window */
+			mem_cpy(fs->win, fs->wc_buf[n], SS(fs));
+			fs->wflag = fs->wc_flag[n] & WC_DIRTY;
+			fs->wc_flag[n] = 0;
+			fs->winsect = sector;
+			return FR_OK;
+		}
+		fs->winsect = 0xFFFFFFFF;		/* The window is invalid if the read fails */
+#else
 #if !_FS_READONLY
 		if (sync_window(fs) != FR_OK)
 			return FR_DISK_ERR;
+#endif
 #endif
 		if (disk_read(fs->drv, fs->win, sector, 1))
 			return FR_DISK_ERR;
@@ -800,7 +956,13 @@ FRESULT sync_fs (	/* FR_OK: successful, FR_DISK_ERR: failed */
 	FRESULT res;
 
 
+#if _FS_WINCACHE
+	res = wc_flush(fs);
+	if (res == FR_OK)
+		res = sync_window(fs);
+#else
 	res = sync_window(fs);
+#endif
 	if (res == FR_OK) {
 		/* Update FSINFO sector if needed */
 		if (fs->fs_type == FS_FAT32 && fs->fsi_flag == 1) {
@@ -980,6 +1142,9 @@ FRESULT remove_chain (
 			if (nxt == 0xFFFFFFFF) { res = FR_DISK_ERR; break; }	/* Disk error? */
 			res = put_fat(fs, clst, 0);			/* Mark the cluster "empty" */
 			if (res != FR_OK) break;
+#if _FS_WINCACHE
+			wc_inval(fs, clust2sect(fs, clst), fs->csize);	/* Forget the freed sectors */
+#endif
 			if (fs->free_clust != 0xFFFFFFFF) {	/* Update FSINFO */
 				fs->free_clust++;
 				fs->fsi_flag |= 1;
@@ -2083,6 +2248,9 @@ BYTE check_fs (	/* 0:FAT boor sector, 1:Valid boor sector but not FAT, 2:Not a b
 )
 {
 	fs->wflag = 0; fs->winsect = 0xFFFFFFFF;	/* Invaidate window */
+#if _FS_WINCACHE
+	mem_set(fs->wc_flag, 0, _FS_WINCACHE);		/* and the window cache */
+#endif
 	if (move_window(fs, sect) != FR_OK)			/* Load boot record */
 		return 3;
 
@@ -2653,6 +2821,9 @@ FRESULT f_write (
 					cc = fp->fs->csize - csect;
 				if (disk_write(fp->fs->drv, wbuff, sect, cc))
 					ABORT(fp->fs, FR_DISK_ERR);
+#if _FS_WINCACHE
+				wc_inval(fp->fs, sect, cc);	/* Cached copies are stale now */
+#endif
 #if _FS_MINIMIZE <= 2
 #if _FS_TINY
 				if (fp->fs->winsect - sect < cc) {	/* Refill sector cache if it gets invalidated by the direct write */
@@ -3213,6 +3384,127 @@ FRESULT f_readdir (
 
 
 
+#if _FS_WALK
+/*-----------------------------------------------------------------------*/
+/* Open a Directory Tree Walk                                            */
+/*-----------------------------------------------------------------------*/
+
+FRESULT f_walkopen (
+	DIRWALK* wk,		/* Pointer to the walk object to create */
+	TCHAR* path,		/* Pointer to the top directory path in the working buffer */
+	UINT size			/* Size of the path name working buffer in TCHAR (0:No path) */
+)
+{
+	if (!wk) return FR_INVALID_OBJECT;
+
+	wk->path = size ? path : 0;
+	wk->size = size;
+	wk->next = 0;
+	wk->depth = 0;
+	return f_opendir(&wk->dir, path);
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Read Directory Tree Items in Sequence                                 */
+/*-----------------------------------------------------------------------*/
+/* Items come parent first, fname[0] == 0 at the end of the tree. The path
+/  name working buffer holds the directory of the returned item. */
+
+FRESULT f_walk (
+	DIRWALK* wk,		/* Pointer to the open walk object */
+	FILINFO* fno		/* Pointer to file information to return */
+)
+{
+	FRESULT res;
+	DIR *dp = &wk->dir;
+	TCHAR *fn;
+	UINT i, n;
+	BYTE d;
+	DEF_NAMEBUF;
+
+
+	res = validate(dp);						/* Check validity of the object */
+	if (res == FR_OK) {
+		INIT_BUF(*dp);
+		if (wk->next) {							/* Enter the sub-directory returned last time */
+			if (wk->next == 1) {
+				res = FR_NOT_ENOUGH_CORE;		/* Too deep or too long path, skip it */
+			} else {
+				d = wk->depth++;
+				wk->sclust[d] = dp->sclust; wk->clust[d] = dp->clust;
+				wk->sect[d] = dp->sect; wk->index[d] = dp->index;
+				if (wk->path) {
+					for (i = 0; wk->path[i]; i++) ;
+					wk->path[i] = '/';			/* Its name is already behind the terminator */
+				}
+				dp->sclust = wk->next;
+				res = dir_sdi(dp, 0);
+			}
+			wk->next = 0;
+		}
+
+		while (res == FR_OK) {
+			res = dir_read(dp, 0);				/* Read an item */
+			if (res == FR_NO_FILE) {			/* End of this directory */
+				dp->sect = 0;
+				res = FR_OK;
+				if (!wk->depth) {				/* End of the tree */
+					fno->fname[0] = 0;
+					break;
+				}
+				d = --wk->depth;				/* Back to the parent directory */
+				dp->sclust = wk->sclust[d]; dp->clust = wk->clust[d];
+				dp->sect = wk->sect[d]; dp->index = wk->index[d];
+				dp->dir = dp->fs->win + (dp->index % (SS(dp->fs) / SZ_DIR)) * SZ_DIR;
+				if (wk->path) {
+					for (i = 0; wk->path[i]; i++) ;
+					while (i && wk->path[i] != '/') i--;
+					wk->path[i] = 0;
+				}
+				continue;
+			}
+			if (res != FR_OK) break;
+			if (dp->dir[DIR_Name] == '.') {		/* Skip dot entries */
+				res = dir_next(dp, 0);
+				if (res == FR_NO_FILE) { dp->sect = 0; res = FR_OK; }
+				continue;
+			}
+			get_fileinfo(dp, fno);				/* Get the object information */
+			if (fno->fattrib & AM_DIR) {		/* Enter it at next call */
+				wk->next = ld_clust(dp->fs, dp->dir);
+				if (wk->next && wk->path) {		/* Put its name behind the terminator */
+					fn = fno->fname;
+#if _USE_LFN
+					if (fno->lfname && *fno->lfname) fn = fno->lfname;
+#endif
+					for (i = 0; wk->path[i]; i++) ;
+					for (n = 0; fn[n]; n++) ;
+					if (i + n + 2 > wk->size)
+						wk->next = 1;
+					else
+						mem_cpy(&wk->path[i + 1], fn, (n + 1) * sizeof (TCHAR));
+				}
+				if (wk->depth >= _FS_WALK && wk->next) wk->next = 1;
+			}
+			res = dir_next(dp, 0);				/* Increment index for next */
+			if (res == FR_NO_FILE) {
+				dp->sect = 0;
+				res = FR_OK;
+			}
+			break;
+		}
+		FREE_BUF();
+	}
+
+	LEAVE_FF(dp->fs, res);
+}
+#endif
+
+
+
 #if _FS_MINIMIZE == 0
 /*-----------------------------------------------------------------------*/
 /* Get File Status                                                       */
@@ -3494,6 +3786,9 @@ FRESULT f_mkdir (
 					if (res != FR_OK) break;
 					mem_set(dir, 0, SS(dj.fs));
 				}
+#if _FS_WINCACHE
+				dj.fs->winsect = 0xFFFFFFFF;	/* The cleared window is not the dot entry sector at 1 sector/cluster */
+#endif
 			}
 			if (res == FR_OK) res = dir_register(&dj);	/* Register the object to the directoy */
 			if (res != FR_OK) {
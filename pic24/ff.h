@@ -104,6 +104,13 @@ typedef struct {
 	DWORD	database;		/* Data start sector */
 	DWORD	winsect;		/* Current sector appearing in the win[] */
 	BYTE	win[_MAX_SS];	/* Disk access window for Directory, FAT (and file data at tiny cfg) */
+#if _FS_WINCACHE
+	WORD	wc_tick;		/* Window cache LRU clock */
+	WORD	wc_used[_FS_WINCACHE];	/* Last use of each cache entry */
+	BYTE	wc_flag[_FS_WINCACHE];	/* Cache entry flags (b1:valid, b0:dirty) */
+	DWORD	wc_sect[_FS_WINCACHE];	/* Sector held in each cache entry */
+	BYTE	wc_buf[_FS_WINCACHE][_MAX_SS];	/* Cached sectors */
+#endif
 } FATFS;
 
 
@@ -159,6 +166,24 @@ typedef struct {
 
 
 
+#if _FS_WALK
+/* Directory tree walk object structure (DIRWALK) */
+
+typedef struct {
+	DIR		dir;			/* Directory object of the current level */
+	TCHAR*	path;			/* Pointer to the path name working buffer (0:No path) */
+	UINT	size;			/* Size of the path name working buffer in TCHAR */
+	DWORD	next;			/* Sub-directory to enter at next call (0:None, 1:Cannot enter) */
+	BYTE	depth;			/* Current level (0:Top directory) */
+	DWORD	sclust[_FS_WALK];	/* Read position of the parent directories */
+	DWORD	clust[_FS_WALK];
+	DWORD	sect[_FS_WALK];
+	WORD	index[_FS_WALK];
+} DIRWALK;
+#endif
+
+
+
 /* File status structure (FILINFO) */
 
 typedef struct {
@@ -216,6 +241,10 @@ FRESULT f_sync (FIL* fp);											/* Flush cached data of a writing file */
 FRESULT f_opendir (DIR* dp, const TCHAR* path);						/* Open a directory */
 FRESULT f_closedir (DIR* dp);										/* Close an open directory */
 FRESULT f_readdir (DIR* dp, FILINFO* fno);							/* Read a directory item */
+#if _FS_WALK
+FRESULT f_walkopen (DIRWALK* wk, TCHAR* path, UINT size);			/* Open a directory tree walk */
+FRESULT f_walk (DIRWALK* wk, FILINFO* fno);							/* Read a directory tree item */
+#endif
 FRESULT f_mkdir (const TCHAR* path);								/* Create a sub directory */
 FRESULT f_unlink (const TCHAR* path);								/* Delete an existing file or directory */
 FRESULT f_rename (const TCHAR* path_old, const TCHAR* path_new);	/* Rename/Move a file or directory */
@@ -0,0 +1,185 @@
+/* FatFs window cache check and disk access counts per operation
+ *
+ * cc -O2 -I. -I../mx_test.X/src -D_FS_WINCACHE=4 -o ff_bench ff_bench.c ff.c ccsbcs.c ../mx_test.X/src/diskio_img.c
+ * ./ff_bench [fat32] [image file]
+ *
+ * Build it with _FS_WINCACHE 0 and with the cache sizes to compare, the
+ * counting disk is the mx_test.X hosted diskio_img. On a new FAT16 volume
+ * (FAT32 with the fat32 argument) it runs a logger day in steps
+ *   create        a directory and three log files in it
+ *   append        RECORDS records round robin to the three files, f_sync on
+ *                 each file every 30 of its records
+ *   small files   one file closed and deleted, one truncated, then 200 new
+ *                 612 byte files
+ *   append more   4000 records to each of the two files left, f_sync every 50
+ *   close         both files
+ * and prints the disk_read and disk_write calls of each step and per record
+ * or file. Then it mounts the volume again, so nothing comes from the cache,
+ * and reads every file back against what was written, the free cluster count
+ * must match the one before the remount.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ff.h"
+#include "diskio_img.h"
+
+#define RECORDS	20000
+#define MORE	4000
+#define SMALL	200
+
+static FATFS fs;
+static FIL f[3];
+static FILINFO fno;
+static BYTE buf[1024];
+
+#define CK(x)	do { FRESULT r_ = (x); if (r_) { printf("line %d: %s = %d\n", __LINE__, #x, r_); return 1; } } while (0)
+
+static const char *record(UINT i)
+{
+	static char rec[48];
+
+	sprintf(rec, "%6u,%6u,%08x,adc data\r\n", i, i % 3, i * 2654435761u);
+	return rec;
+}
+
+static const char *more(UINT i)
+{
+	static char rec[48];
+
+	sprintf(rec, "%6u,after the delete\r\n", i);
+	return rec;
+}
+
+static void show(const char *what, UINT n, const char *per)
+{
+	printf("  %-12s %7lu %7lu %9.3f %9.3f  per %s\n", what, (unsigned long) disk_img_stat.reads,
+		(unsigned long) disk_img_stat.writes, (double) disk_img_stat.reads / n,
+		(double) disk_img_stat.writes / n, per);
+	disk_img_clear();
+}
+
+/* compare len bytes of the open file with s, 0 if they match */
+static int expect(FIL *fp, const char *s, UINT len)
+{
+	UINT br;
+
+	return f_read(fp, buf, len, &br) != FR_OK || br != len || memcmp(buf, s, len);
+}
+
+/* the files after a remount */
+static int check(DWORD nfree)
+{
+	char name[16], head[1000 + 48];
+	DWORD n;
+	FATFS *p;
+	UINT i, len = 0, br;
+
+	CK(f_getfree("0:", &n, &p));
+	if (n != nfree)
+		return printf("free clusters %lu, %lu before the remount\n", (unsigned long) n, (unsigned long) nfree), 1;
+	CK(f_open(&f[0], "logs/l0.txt", FA_READ));
+	for (i = 0; i < RECORDS; i += 3)
+		if (expect(&f[0], record(i), strlen(record(i))))
+			return printf("l0.txt record %u\n", i), 1;
+	for (i = 0; i < MORE; i++)
+		if (expect(&f[0], more(i), strlen(more(i))))
+			return printf("l0.txt more %u\n", i), 1;
+	CK(f_read(&f[0], buf, 1, &br));
+	CK(f_close(&f[0]));
+	if (br)
+		return printf("l0.txt is too long\n"), 1;
+
+	for (i = 2; len < 1000; i += 3) {
+		strcpy(&head[len], record(i));
+		len += strlen(record(i));
+	}
+	CK(f_open(&f[2], "logs/l2.txt", FA_READ));
+	if (expect(&f[2], head, 1000))
+		return printf("l2.txt head\n"), 1;
+	for (i = 0; i < MORE; i++)
+		if (expect(&f[2], more(i), strlen(more(i))))
+			return printf("l2.txt more %u\n", i), 1;
+	CK(f_close(&f[2]));
+	if (f_stat("logs/l1.txt", &fno) != FR_NO_FILE)
+		return printf("l1.txt is still there\n"), 1;
+
+	for (i = 0; i < SMALL; i++) {
+		sprintf(name, "d%u.bin", i);
+		memset(head, i, 612);
+		CK(f_open(&f[1], name, FA_READ));
+		if (expect(&f[1], head, 612) || f_size(&f[1]) != 612)
+			return printf("%s\n", name), 1;
+		CK(f_close(&f[1]));
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *rec;
+	char name[16];
+	DWORD nfree;
+	FATFS *p;
+	UINT bw, i, k;
+	int fat32 = argc > 1 && !strcmp(argv[1], "fat32");
+
+	if (argc > 2)
+		disk_img_path = argv[2];
+	disk_img_sectors = fat32 ? 600000 : 131072;
+	CK(f_mount(&fs, "0:", 0));
+	CK(f_mkfs("0:", 0, fat32 ? 512 : 1024));
+	CK(f_mount(&fs, "0:", 1));
+	printf("%s, _FS_WINCACHE %d, reads and writes\n", fat32 ? "FAT32" : "FAT16", _FS_WINCACHE);
+	printf("  %-12s %7s %7s %9s %9s\n", "step", "reads", "writes", "r/op", "w/op");
+	disk_img_clear();
+
+	CK(f_mkdir("logs"));
+	for (k = 0; k < 3; k++) {
+		sprintf(name, "logs/l%u.txt", k);
+		CK(f_open(&f[k], name, FA_CREATE_ALWAYS | FA_WRITE));
+	}
+	show("create", 4, "item");
+	for (i = 0; i < RECORDS; i++) {
+		k = i % 3;
+		rec = record(i);
+		CK(f_write(&f[k], rec, strlen(rec), &bw));
+		if (i % 90 >= 87) // every 30th record of file k
+			CK(f_sync(&f[k]));
+	}
+	show("append", RECORDS, "record");
+	CK(f_close(&f[1]));
+	CK(f_unlink("logs/l1.txt"));
+	CK(f_lseek(&f[2], 1000));
+	CK(f_truncate(&f[2]));
+	for (i = 0; i < SMALL; i++) {
+		sprintf(name, "d%u.bin", i);
+		memset(buf, i, 612);
+		CK(f_open(&f[1], name, FA_CREATE_ALWAYS | FA_WRITE));
+		CK(f_write(&f[1], buf, 512, &bw));
+		CK(f_write(&f[1], buf + 512, 100, &bw));
+		CK(f_close(&f[1]));
+	}
+	show("small files", SMALL, "file");
+	for (i = 0; i < MORE; i++) {
+		rec = more(i);
+		CK(f_write(&f[0], rec, strlen(rec), &bw));
+		CK(f_write(&f[2], rec, strlen(rec), &bw));
+		if (i % 50 == 49) {
+			CK(f_sync(&f[0]));
+			CK(f_sync(&f[2]));
+		}
+	}
+	show("append more", 2 * MORE, "record");
+	CK(f_close(&f[0]));
+	CK(f_close(&f[2]));
+	show("close", 2, "file");
+	CK(f_getfree("0:", &nfree, &p));
+
+	CK(f_mount(NULL, "0:", 0));
+	CK(f_mount(&fs, "0:", 1));
+	printf("read back %s\n", check(nfree) ? "FAILED" : "ok");
+	f_mount(NULL, "0:", 0);
+	disk_img_close();
+	return 0;
+}
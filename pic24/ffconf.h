@@ -20,6 +20,17 @@
 /  data transfer. This reduces memory consumption 512 bytes each file object. */
 
 
+#ifndef _FS_WINCACHE
+#define	_FS_WINCACHE	0	/* 0:Disable or >=1:Number of cached sectors */
+#endif
+/* When _FS_WINCACHE is set to 1 or more, sectors that leave the sector buffer
+/  in the file system object are kept in an LRU cache of that many entries, so
+/  the FAT, directory and file data accesses of an append do not read the same
+/  sectors again. Each entry adds _MAX_SS + 7 bytes to the file system object.
+/  Dirty FAT sectors stay in the cache until they are evicted or the volume is
+/  synced, other sectors are written when they leave the buffer. */
+
+
 #define _FS_READONLY	0	/* 0:Read/Write or 1:Read only */
 /* Setting _FS_READONLY to 1 defines read only configuration. This removes
 /  writing functions, f_write(), f_sync(), f_unlink(), f_mkdir(), f_chmod(),
@@ -36,6 +47,14 @@
 /   3: f_lseek() function is removed in addition to 2. */
 
 
+#define	_FS_WALK	8	/* 0:Disable or >=1:Sub-directory levels f_walk() can enter */
+/* When _FS_WALK is set to 1 or more, f_walkopen() and f_walk() are enabled.
+/  They read a directory tree an item a call without recursion. The walk object
+/  keeps the read position of each parent directory (14 bytes a level), so a
+/  return to the parent does not follow its cluster chain again. This option
+/  needs _FS_MINIMIZE <= 1. */
+
+
 #define	_USE_STRFUNC	2	/* 0:Disable or 1-2:Enable */
 /* To enable string functions, set _USE_STRFUNC to 1 or 2. */
 
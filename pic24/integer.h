@@ -10,6 +10,19 @@
 #include <windows.h>
 #include <tchar.h>
 
+#elif defined(__linux__)	/* Hosted test builds, long is 64 bit on LP64 */
+
+#include <stdint.h>
+
+typedef uint8_t			BYTE;
+typedef int16_t			SHORT;
+typedef uint16_t		WORD;
+typedef uint16_t		WCHAR;
+typedef int				INT;
+typedef unsigned int	UINT;
+typedef int32_t			LONG;
+typedef uint32_t		DWORD;
+
 #else			/* Embedded platform */
 
 /* This type MUST be 8 bit */
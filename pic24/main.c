@@ -24,13 +24,14 @@ TCHAR Lfname[256];
 #endif
 
 char Line[256];			/* Console input buffer */
+BYTE Obuf[64];			/* Console output buffer */
 
 FATFS FatFs;			/* File system object */
 FIL File[2];			/* File objects */
 BYTE Buff[4096];		/* Working buffer */
 
 
-volatile UINT Timer;	/* 1kHz increment timer */
+volatile DWORD Timer;	/* 1kHz increment timer, read it with get_timer() */
 
 volatile BYTE rtcYear = 2013-1980, rtcMon = 7, rtcMday = 6, rtcHour, rtcMin, rtcSec;
 
@@ -107,6 +108,36 @@ DWORD get_fattime (void)
 
 
 
+/*---------------------------------------------------------*/
+/* Performance counter, 32 bits wrap after 49 days         */
+/*---------------------------------------------------------*/
+/* The ISR may change Timer between the two word accesses  */
+/* of a read or a clear, so both run with interrupts off.  */
+
+static
+DWORD get_timer (void)
+{
+	DWORD tmr;
+
+
+	_DI();
+	tmr = Timer;
+	_EI();
+
+	return tmr;
+}
+
+
+static
+void clr_timer (void)
+{
+	_DI();
+	Timer = 0;
+	_EI();
+}
+
+
+
 
 /*--------------------------------------------------------------------------*/
 /* Monitor                                                                  */
@@ -132,36 +163,37 @@ void put_rc (FRESULT rc)
 
 static
 FRESULT scan_files (
-	char* path		/* Pointer to the path name working buffer */
+	char* path,		/* Pointer to the path name working buffer */
+	UINT size		/* Size of the working buffer */
 )
 {
-	DIR dirs;
+	DIRWALK wk;
 	FRESULT res;
-	int i;
-	char *fn;
 
 
-	if ((res = f_opendir(&dirs, path)) == FR_OK) {
-		i = strlen(path);
-		while (((res = f_readdir(&dirs, &Finfo)) == FR_OK) && Finfo.fname[0]) {
-			if (_FS_RPATH && Finfo.fname[0] == '.') continue;
-#if _USE_LFN
-			fn = *Finfo.lfname ? Finfo.lfname : Finfo.fname;
-#else
-			fn = Finfo.fname;
-#endif
-			if (Finfo.fattrib & AM_DIR) {
-				AccDirs++;
-				path[i] = '/'; strcpy(&path[i+1], fn);
-				res = scan_files(path);
-				path[i] = 0;
-				if (res != FR_OK) break;
-			} else {
+	res = f_walkopen(&wk, path, size);
+	while (res == FR_OK) {
+		res = f_walk(&wk, &Finfo);
+		if (res == FR_NOT_ENOUGH_CORE) {	/* Too deep or too long path name, it is not counted */
+			xprintf("\n%s: sub-directory skipped\n", path);
+			res = FR_OK;
+			continue;
+		}
+		if (res != FR_OK || !Finfo.fname[0]) break;
+		if (Finfo.fattrib & AM_DIR) {
+			AccDirs++;
+		} else {
 #if 0
-				xprintf("%s/%s\n", path, fn);
+			xprintf("%s/%s\n", path, Finfo.fname);
 #endif
-				AccFiles++;
-				AccSize += Finfo.fsize;
+			AccFiles++;
+			AccSize += Finfo.fsize;
+		}
+		if (!((AccFiles + AccDirs) & 0xFF)) {	/* Show progress */
+			xprintf("\r%u", AccFiles + AccDirs);
+			if (uart_test()) {	/* Abort by any key */
+				uart_getc();
+				res = FR_TIMEOUT;
 			}
 		}
 	}
@@ -218,7 +250,7 @@ int main (void)
 	BYTE b, drv = 0;
 	const BYTE ft[] = {0,12,16,32};
 	UINT s1, s2, cnt;
-	DWORD ofs = 0, sect = 0;
+	DWORD ofs = 0, sect = 0, ms;
 	FRESULT res;
 	FATFS *fs;				/* Pointer to file system object */
 	DIR dir;				/* Directory object */
@@ -228,6 +260,7 @@ int main (void)
 
 	xdev_in(uart_getc);		/* Join UART and console */
 	xdev_out(uart_putc);
+	xdev_blk(uart_write, Obuf, sizeof Obuf);	/* Formatted output goes to the UART in blocks */
 	xputs("\nFatFs module test monitor for PIC24F\n");
 	xputs(_USE_LFN ? "LFN Enabled" : "LFN Disabled");
 	xprintf(", Code page: %u\n", _CODE_PAGE);
@@ -353,13 +386,16 @@ int main (void)
 						fs->volbase, fs->fatbase, fs->dirbase, fs->database
 				);
 				AccSize = AccFiles = AccDirs = 0;
-				res = scan_files(ptr);
+				clr_timer();
+				res = scan_files(ptr, sizeof Line - (ptr - Line));
+				ms = get_timer();
 				if (res) { put_rc(res); break; }
 				xprintf("\r%u files, %lu bytes.\n%u folders.\n"
 						"%lu KiB total disk space.\n%lu KiB available.\n",
 						AccFiles, AccSize, AccDirs,
 						(fs->n_fatent - 2) * (fs->csize / 2), p2 * (fs->csize / 2)
 				);
+				if (ms) xprintf("%lu items/sec.\n", (AccFiles + AccDirs) * 1000UL / ms);
 				break;
 
 			case 'l' :	/* fl [<path>] - Directory listing */
@@ -415,7 +451,7 @@ int main (void)
 			case 'r' :	/* fr <len> - read file */
 				if (!xatoi(&ptr, &p1)) break;
 				p2 = 0;
-				Timer = 0;
+				clr_timer();
 				while (p1) {
 					if ((DWORD)p1 >= sizeof Buff) {
 						cnt = sizeof Buff; p1 -= sizeof Buff;
@@ -427,7 +463,8 @@ int main (void)
 					p2 += s2;
 					if (cnt != s2) break;
 				}
-				xprintf("%lu bytes read with %lu kB/sec.\n", p2, Timer ? (p2 / Timer) : 0);
+				ms = get_timer();
+				xprintf("%lu bytes read with %lu kB/sec.\n", p2, ms ? (p2 / ms) : 0);
 				break;
 
 			case 'd' :	/* fd <len> - read and dump file from current fp */
@@ -448,7 +485,7 @@ int main (void)
 				if (!xatoi(&ptr, &p1) || !xatoi(&ptr, &p2)) break;
 				memset(Buff, (int)p2, sizeof Buff);
 				p2 = 0;
-				Timer = 0;
+				clr_timer();
 				while (p1) {
 					if ((DWORD)p1 >= sizeof Buff) {
 						cnt = sizeof Buff; p1 -= sizeof Buff;
@@ -460,7 +497,8 @@ int main (void)
 					p2 += s2;
 					if (cnt != s2) break;
 				}
-				xprintf("%lu bytes written with %lu kB/sec.\n", p2, Timer ? (p2 / Timer) : 0);
+				ms = get_timer();
+				xprintf("%lu bytes written with %lu kB/sec.\n", p2, ms ? (p2 / ms) : 0);
 				break;
 
 			case 'n' :	/* fn <old_name> <new_name> - Change file/dir name */
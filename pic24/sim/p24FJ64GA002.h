@@ -0,0 +1,26 @@
+/*------------------------------------------------------------------------*/
+/* UART1 of the PIC24FJ64GA002 for the uart_sim.c host simulation         */
+/*------------------------------------------------------------------------*/
+/* Stands in for the device header when uart.c is built on a Linux host,  */
+/* the register bits are plain variables and the data registers go        */
+/* through the simulated 4 level Tx and Rx buffers.                       */
+
+#ifndef _SIM_P24FJ64GA002
+#define _SIM_P24FJ64GA002
+
+#define interrupt		/* The ISRs are plain functions, called by the simulation */
+#define auto_psv
+
+extern volatile unsigned U1BRG;
+extern volatile int _U1RXIF, _U1TXIF, _U1RXIE, _U1TXIE;
+extern volatile int _UARTEN, _UTXEN, _UTXISEL0, _UTXISEL1, _OERR, _URXDA;
+
+volatile unsigned* sim_txreg (void);	/* U1TXREG write latch */
+unsigned sim_rxreg (void);				/* U1RXREG read, pops the Rx buffer */
+int sim_utxbf (void);					/* Tx buffer full */
+
+#define U1TXREG	(*sim_txreg())
+#define U1RXREG	(sim_rxreg())
+#define _UTXBF	(sim_utxbf())
+
+#endif
@@ -11,18 +11,19 @@
 /
 /-------------------------------------------------------------------------*/
 
+#include <string.h>
 #include <p24FJ64GA002.h>
 #include "pic24f.h"
 #include "uart.h"
+#include "../ringbuf.h"
 
-#define BUFFER_SIZE 128
+#define BUFFER_SIZE 128		/* Power of 2 */
 
 
-static volatile int TxRun;		/* Tx running flag */
-static volatile struct {
-	int		ri, wi, ct;			/* Read index, Write index, Data counter */
-	BYTE	buff[BUFFER_SIZE];	/* FIFO buffer */
-} TxFifo, RxFifo;
+/* The ISR and the main context each own one index of a FIFO, no counter
+   is shared and no interrupt has to be disabled */
+RB_TYPE(FIFO, BYTE, BUFFER_SIZE, WORD);
+static FIFO TxFifo, RxFifo;
 
 
 
@@ -32,18 +33,15 @@ static volatile struct {
 void __attribute__((interrupt, auto_psv)) _U1RXInterrupt (void)
 {
 	BYTE d;
-	int i;
 
 
-	d = (BYTE)U1RXREG;			/* Get received data */
 	_U1RXIF = 0;				/* Clear Rx interrupt flag */
-	i = RxFifo.ct;				/* Number of bytes in the FIFO */
-	if (i < BUFFER_SIZE) {		/* Skip if FIFO is full */
-		RxFifo.ct = ++i;
-		i = RxFifo.wi;
-		RxFifo.buff[i++] = d;	/* Store data into the FIFO */
-		RxFifo.wi = i % BUFFER_SIZE;	/* Next write ptr */
+	while (_URXDA) {			/* Take all bytes in the Rx buffer */
+		d = (BYTE)U1RXREG;		/* Get received data */
+		if (!RB_FULL(&RxFifo))	/* Skip if FIFO is full */
+			RB_PUT(&RxFifo, d);	/* Store data into the FIFO */
 	}
+	if (_OERR) _OERR = 0;		/* Restart the receiver after an overrun */
 }
 
 
@@ -52,19 +50,17 @@ void __attribute__((interrupt, auto_psv)) _U1RXInterrupt (void)
 
 void __attribute__((interrupt, auto_psv)) _U1TXInterrupt (void)
 {
-	int i;
-
+	BYTE d;
 
-	_U1TXIF = 0;		/* Clear Tx interrupt flag */
 
-	i = TxFifo.ct;		/* Number of data in the FIFO */
-	if (i) {			/* If any data is available, pop a byte and send it. */
-		TxFifo.ct = --i;
-		i = TxFifo.ri;
-		U1TXREG = TxFifo.buff[i++];		/* Send a byte */
-		TxFifo.ri = i % BUFFER_SIZE;	/* Next read ptr */
+	if (!RB_EMPTY(&TxFifo)) {	/* If any data is available, fill the Tx buffer. */
+		_U1TXIF = 0;		/* Clear Tx interrupt flag */
+		do {
+			RB_GET(&TxFifo, d);
+			U1TXREG = d;	/* Send a byte */
+		} while (!_UTXBF && !RB_EMPTY(&TxFifo));
 	} else {			/* No data in the Tx FIFO */
-		TxRun = 0;		/* Stop transmission sequense */
+		_U1TXIE = 0;	/* Stop transmission sequense, the flag stays set for uart_putc */
 	}
 }
 
@@ -74,7 +70,7 @@ void __attribute__((interrupt, auto_psv)) _U1TXInterrupt (void)
 
 int uart_test (void)
 {
-	return RxFifo.ct;	/* Returns number of bytes in the Rx FIFO */
+	return RB_COUNT(&RxFifo);	/* Returns number of bytes in the Rx FIFO */
 }
 
 
@@ -84,17 +80,11 @@ int uart_test (void)
 BYTE uart_getc (void)
 {
 	BYTE d;
-	int i;
 
 
-	while (!RxFifo.ct) ;		/* Wait while Rx FIFO empty */
+	while (RB_EMPTY(&RxFifo)) ;	/* Wait while Rx FIFO empty */
 
-	i = RxFifo.ri;				/* Get a byte from Rx FIFO */
-	d = RxFifo.buff[i++];
-	RxFifo.ri = i % BUFFER_SIZE;
-	_DI();
-	RxFifo.ct--;
-	_EI();
+	RB_GET(&RxFifo, d);			/* Get a byte from Rx FIFO */
 
 	return d;
 }
@@ -105,21 +95,55 @@ BYTE uart_getc (void)
 
 void uart_putc (BYTE d)
 {
-	int i;
+	while (RB_FULL(&TxFifo)) ;	/* Wait while Tx FIFO is full */
+
+	RB_PUT(&TxFifo, d);	/* Put a data into the Tx FIFO */
+	_U1TXIE = 1;		/* Start the tx sequense if it is not running (single bit set) */
+}
+
+
+
+/* Put a block into Tx FIFO, returns when all bytes are in the FIFO */
+
+void uart_write (const BYTE* buf, UINT n)
+{
+	UINT span;
+
+
+	while (n) {
+		RB_WSPAN(&TxFifo, span);	/* Free space up to the end of the buffer */
+		if (!span) {				/* Wait while Tx FIFO is full */
+			_U1TXIE = 1;
+			continue;
+		}
+		if (span > n) span = n;
+		memcpy(RB_WPTR(&TxFifo), buf, span);
+		RB_COMMIT(&TxFifo, span);
+		_U1TXIE = 1;
+		buf += span; n -= span;
+	}
+}
+
 
 
-	while (TxFifo.ct >= BUFFER_SIZE) ;	/* Wait while Tx FIFO is full */
+/* Get a block from Rx FIFO without waiting, returns number of bytes read */
 
-	i = TxFifo.wi;		/* Put a data into the Tx FIFO */
-	TxFifo.buff[i++] = d;
-	TxFifo.wi = i % BUFFER_SIZE;
-	_DI();
-	TxFifo.ct++;
-	if (!TxRun) {		/* If transmission sequense is not running, start the tx sequense */
-		TxRun = 1;
-		_U1TXIF = 1;	/* Force trigger Tx interrupt */
+UINT uart_read (BYTE* buf, UINT n)
+{
+	UINT span, rd = 0;
+
+
+	while (n) {
+		RB_RSPAN(&RxFifo, span);	/* Data up to the end of the buffer */
+		if (!span) break;
+		if (span > n) span = n;
+		RB_ACQUIRE();
+		memcpy(buf, RB_RPTR(&RxFifo), span);
+		RB_CONSUME(&RxFifo, span);
+		buf += span; n -= span; rd += span;
 	}
-	_EI();
+
+	return rd;
 }
 
 
@@ -134,13 +158,15 @@ void uart_init (DWORD bps)
 
 	/* Initialize UART1 */
 	U1BRG = FCY / 16 / bps - 1;
+	_UTXISEL1 = 1;	/* Tx interrupt when the Tx buffer is empty, the ISR refills all 4 levels */
+	_UTXISEL0 = 0;
 	_UARTEN = 1;
 	_UTXEN = 1;
 
 	/* Clear Tx/Rx FIFOs */
-	TxFifo.ri = 0; TxFifo.wi = 0; TxFifo.ct = 0;
-	RxFifo.ri = 0; RxFifo.wi = 0; RxFifo.ct = 0;
-	TxRun = 0;
+	RB_INIT(&TxFifo);
+	RB_INIT(&RxFifo);
+	_U1TXIF = 1;	/* Tx buffer is empty, Tx ISR stops at the empty FIFO */
 
 	/* Enable UART Tx/Rx interruptrs */
 	_U1RXIE = 1;
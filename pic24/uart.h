@@ -7,6 +7,8 @@ void uart_init (DWORD bps);
 int uart_test (void);
 void uart_putc (BYTE d);
 BYTE uart_getc (void);
+void uart_write (const BYTE* buf, UINT n);
+UINT uart_read (BYTE* buf, UINT n);
 
 #endif
 
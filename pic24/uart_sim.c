@@ -0,0 +1,187 @@
+/* UART1 peripheral simulation for the pic24 uart.c driver
+ *
+ * cc -O2 -Isim -o uart_sim uart_sim.c uart.c
+ * ./uart_sim [rx latency]
+ *
+ * Runs uart.c against a model of UART1 on the host: a SIGALRM character
+ * clock (one 115200 baud character every 100 us of host time), the 4 level
+ * Tx buffer and shift register with the UTXISEL interrupt modes, the 4 level
+ * Rx buffer with OERR on overflow. The ISRs run from the clock like the
+ * interrupts would, the Rx ISR only every rx latency character times (1 if
+ * not given) for an interrupt held off by a higher priority one.
+ * It sends KB kilobytes and then receives KB kilobytes with
+ *   byte   uart_putc and uart_getc
+ *   block  uart_write and uart_read
+ * and prints the line use, the bytes/s at 115200 baud, the Tx or Rx
+ * interrupts per KB, the Rx overruns and the bytes out of order, which must
+ * be 0.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "integer.h"
+#include "uart.h"
+
+#define KB		20
+#define CHARS	11520.0	// characters/s at 115200 baud, 10 bits each
+
+volatile unsigned U1BRG;
+volatile int _U1RXIF, _U1TXIF, _U1RXIE, _U1TXIE;
+volatile int _UARTEN, _UTXEN, _UTXISEL0, _UTXISEL1, _OERR, _URXDA;
+
+void _U1RXInterrupt (void);
+void _U1TXInterrupt (void);
+
+static volatile unsigned txw;		/* U1TXREG */
+static int pending;					/* txw written, not latched yet */
+static BYTE txb[4], rxb[4];			/* Hardware buffers */
+static int txn, rxn, tsr_busy;
+static volatile unsigned long sent, ticks, txirq, rxirq, overruns, badtx;
+static BYTE tx_next, rx_next;
+static int rx_on;
+static unsigned rx_lat = 1;
+
+
+/* next character from the Tx buffer to the shift register */
+static void tsr_load (void)
+{
+	BYTE c;
+
+	if (tsr_busy || !txn) return;
+	c = txb[0];
+	memmove(txb, txb + 1, --txn);
+	tsr_busy = 1;
+	if (c != tx_next++) badtx++;
+	if (!_UTXISEL1 || !txn) _U1TXIF = 1;	/* 00: a character went to the TSR, 10: buffer empty */
+}
+
+static void latch (void)
+{
+	if (!pending) return;
+	pending = 0;
+	if (txn < 4) txb[txn++] = (BYTE)txw;
+	else badtx++;		/* Written while UTXBF */
+	tsr_load();
+}
+
+volatile unsigned* sim_txreg (void)
+{
+	latch();
+	pending = 1;
+	return &txw;
+}
+
+int sim_utxbf (void)
+{
+	latch();
+	return txn == 4;
+}
+
+unsigned sim_rxreg (void)
+{
+	BYTE c = rxb[0];
+
+	if (rxn) memmove(rxb, rxb + 1, --rxn);
+	_URXDA = rxn > 0;
+	return c;
+}
+
+/* one character time */
+static void tick (int sig)
+{
+	(void)sig;
+	ticks++;
+	if (tsr_busy) {
+		tsr_busy = 0;
+		sent++;
+	}
+	tsr_load();
+	if (rx_on) {
+		if (rxn < 4) {
+			rxb[rxn++] = rx_next++;
+		} else {
+			rx_next++;		/* Lost */
+			overruns++;
+			_OERR = 1;
+		}
+		_URXDA = 1;
+		_U1RXIF = 1;
+	}
+	if (_U1TXIE && _U1TXIF) {
+		txirq++;
+		_U1TXInterrupt();
+		latch();
+	}
+	if (_U1RXIE && _U1RXIF && !(ticks % rx_lat)) {
+		rxirq++;
+		_U1RXInterrupt();
+	}
+}
+
+static void tx (int block)
+{
+	static BYTE blk[1024];
+	unsigned long n, k, t0;
+
+	for (k = 0; k < sizeof blk; k++) blk[k] = (BYTE)k;
+	sent = txirq = 0;
+	t0 = ticks;
+	for (n = 0; n < KB * 1024UL; n += sizeof blk) {
+		if (block) uart_write(blk, sizeof blk);
+		else for (k = 0; k < sizeof blk; k++) uart_putc(blk[k]);
+	}
+	while (sent < KB * 1024UL) pause();
+	printf("  %-6s tx %5.1f%% %9.0f %9.1f %9s %6lu\n", block ? "block" : "byte", 100.0 * sent / (ticks - t0),
+		CHARS * sent / (ticks - t0), txirq * 1024.0 / sent, "-", badtx);
+}
+
+static void rx (int block)
+{
+	static BYTE in[1024];
+	unsigned long n, k, rd, bad = 0, t0;
+	BYTE e = rx_next;
+
+	rxirq = overruns = 0;
+	t0 = ticks;
+	rx_on = 1;
+	for (n = 0; n < KB * 1024UL; n += rd) {
+		if (block) {
+			rd = uart_read(in, sizeof in);
+			if (!rd) pause();
+		} else {
+			in[0] = uart_getc();
+			rd = 1;
+		}
+		for (k = 0; k < rd; k++)
+			if (in[k] != e++) {
+				bad++;
+				e = in[k] + 1;	/* Lost characters, count the gap once */
+			}
+	}
+	rx_on = 0;
+	for (k = 0; k <= rx_lat; k++) pause();	/* Let the ISR take the bytes after the last one read */
+	while (uart_test()) uart_getc();
+	printf("  %-6s rx %5.1f%% %9.0f %9.1f %9lu %6lu\n", block ? "block" : "byte", 100.0 * n / (ticks - t0),
+		CHARS * n / (ticks - t0), rxirq * 1024.0 / n, overruns, bad);
+}
+
+int main (int argc, char* argv[])
+{
+	struct itimerval it = {{0, 100}, {0, 100}};
+
+	if (argc > 1 && atoi(argv[1]) > 0) rx_lat = atoi(argv[1]);
+	signal(SIGALRM, tick);
+	uart_init(115200);
+	setitimer(ITIMER_REAL, &it, NULL);
+
+	printf("%d KB each way, Rx ISR every %u character times\n", KB, rx_lat);
+	printf("  %-9s %6s %9s %9s %9s %6s\n", "api", "line", "bytes/s", "irq/KB", "overruns", "bad");
+	tx(0);
+	tx(1);
+	rx(0);
+	rx(1);
+	return badtx != 0;
+}
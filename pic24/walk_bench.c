@@ -0,0 +1,205 @@
+/* f_walk directory tree walk check and benchmark
+ *
+ * cc -O2 -I. -I../mx_test.X/src -o walk_bench walk_bench.c ff.c ccsbcs.c ../mx_test.X/src/diskio_img.c
+ * ./walk_bench [depth [branches [files]]]
+ *
+ * Builds a tree on a FAT32 RAM disk (diskio_img, 2K clusters): under top,
+ * each directory holds files long name files and branches sub-directories,
+ * depth levels down (7, 3 and 5 if not given, the _FS_WALK 8 limit keeps
+ * depth + 1 under it). Then it lists the tree from the root with
+ *   recursive    the old main.c scan_files, f_opendir on the full path for
+ *                every directory, one DIR and one frame a level
+ *   f_walk       the scan_files loop of now
+ *   f_walk+io    f_walk with a file read between every two items, the main
+ *                loop doing other work while the walk is parked
+ * and prints the items, the sub-directories left out for being more than
+ * _FS_WALK levels down (the recursive scan stops there too), the sector
+ * reads a pass and items/s. All three must give the same items in the same
+ * order, path, name and size each, or the run fails.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ff.h"
+#include "diskio_img.h"
+
+#define RUNS	20
+
+static FATFS fs;
+static FIL fil;
+static FILINFO fno;
+static TCHAR lfn[_MAX_LFN + 1];
+static char path[256];
+static BYTE buf[512];
+static DWORD items, skipped, sum, hash, ref_items, ref_hash;
+
+#define CK(x)	do { FRESULT r_ = (x); if (r_) { printf("line %d: %s = %d\n", __LINE__, #x, r_); exit(1); } } while (0)
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* FNV-1a over the text, the item order is part of the hash */
+static void add(const char *s)
+{
+	while (*s)
+		hash = (hash ^ (BYTE) *s++) * 16777619u;
+	hash = (hash ^ '|') * 16777619u;
+}
+
+/* one listed item, dir is the directory it is in */
+static void item(const char *dir)
+{
+	add(dir);
+	add(*fno.lfname ? fno.lfname : fno.fname);
+	hash = (hash ^ fno.fsize) * 16777619u;
+	items++;
+	sum += fno.fsize;
+}
+
+static void mk(int d, int br, int nf)
+{
+	int i, n = strlen(path);
+	UINT bw;
+
+	for (i = 0; i < nf; i++) {
+		sprintf(path + n, "/data file %02d of level %d.log", i, d);
+		CK(f_open(&fil, path, FA_CREATE_NEW | FA_WRITE));
+		CK(f_write(&fil, path, n + i, &bw));
+		CK(f_close(&fil));
+	}
+	if (d)
+		for (i = 0; i < br; i++) {
+			sprintf(path + n, "/sub dir %d", i);
+			CK(f_mkdir(path));
+			mk(d - 1, br, nf);
+		}
+	path[n] = 0;
+}
+
+/* the recursive scan_files of main.c before f_walk, it stops at the
+ * _FS_WALK level too so the listings can be compared */
+static FRESULT scan_rec(char *p, int level)
+{
+	DIR dirs;
+	FRESULT res;
+	int i;
+	char *fn;
+
+	if ((res = f_opendir(&dirs, p)) == FR_OK) {
+		i = strlen(p);
+		while ((res = f_readdir(&dirs, &fno)) == FR_OK && fno.fname[0]) {
+			if (_FS_RPATH && fno.fname[0] == '.')
+				continue;
+			item(p);
+			if ((fno.fattrib & AM_DIR) && level >= _FS_WALK) {
+				skipped++;
+			} else if (fno.fattrib & AM_DIR) {
+				fn = *fno.lfname ? fno.lfname : fno.fname;
+				p[i] = '/';
+				strcpy(&p[i + 1], fn);
+				res = scan_rec(p, level + 1);
+				p[i] = 0;
+				if (res != FR_OK)
+					break;
+			}
+		}
+	}
+	return res;
+}
+
+static FRESULT scan_walk(int io)
+{
+	DIRWALK wk;
+	FRESULT res;
+	UINT br;
+
+	res = f_walkopen(&wk, path, sizeof(path));
+	while (res == FR_OK) {
+		res = f_walk(&wk, &fno);
+		if (res == FR_NOT_ENOUGH_CORE) {
+			skipped++;
+			res = FR_OK;
+			continue;
+		}
+		if (res != FR_OK || !fno.fname[0])
+			break;
+		item(path);
+		if (io && (items & 1)) { // other work between the items
+			CK(f_lseek(&fil, (items * 97) % (fil.fsize - sizeof(buf))));
+			CK(f_read(&fil, buf, sizeof(buf), &br));
+		}
+	}
+	return res;
+}
+
+/* 0 if the listing matches the first one */
+static int run(const char *name, int mode)
+{
+	double t;
+	DWORD r;
+	int k;
+
+	disk_img_clear();
+	t = now_s();
+	for (k = 0; k < RUNS; k++) {
+		items = skipped = sum = 0;
+		hash = 2166136261u;
+		path[0] = 0;
+		CK(mode ? scan_walk(mode == 2) : scan_rec(path, 0));
+	}
+	t = now_s() - t;
+	r = disk_img_stat.rsect / RUNS;
+	if (mode == 2)
+		r -= items / 2; // the file reads
+	printf("  %-12s %8lu %8lu %8lu %10.0f\n", name, (unsigned long) items, (unsigned long) skipped,
+		(unsigned long) r, items * RUNS / t);
+	if (!mode) {
+		ref_items = items + skipped;
+		ref_hash = hash;
+		return 0;
+	}
+	return items + skipped != ref_items || hash != ref_hash;
+}
+
+int main(int argc, char *argv[])
+{
+	int depth = argc > 1 ? atoi(argv[1]) : 7;
+	int br = argc > 2 ? atoi(argv[2]) : 3;
+	int nf = argc > 3 ? atoi(argv[3]) : 5;
+	UINT bw, k;
+	int bad;
+
+	fno.lfname = lfn;
+	fno.lfsize = sizeof(lfn);
+	disk_img_sectors = 400000;
+	CK(f_mount(&fs, "", 0));
+	CK(f_mkfs("", 0, 2048));
+	CK(f_mount(&fs, "", 1));
+	strcpy(path, "top");
+	CK(f_mkdir(path));
+	mk(depth, br, nf);
+	CK(f_open(&fil, "other.dat", FA_CREATE_NEW | FA_WRITE));
+	for (k = 0; k < 64; k++)
+		CK(f_write(&fil, buf, sizeof(buf), &bw));
+	CK(f_close(&fil));
+	CK(f_mount(NULL, "", 0));
+	CK(f_mount(&fs, "", 1));
+	CK(f_open(&fil, "other.dat", FA_READ));
+
+	printf("tree depth %d, %d sub-dirs and %d files a dir, _FS_WALK %d\n", depth, br, nf, _FS_WALK);
+	printf("  %-12s %8s %8s %8s %10s\n", "scan", "items", "skipped", "rsect", "items/s");
+	bad = run("recursive", 0);
+	bad |= run("f_walk", 1);
+	bad |= run("f_walk+io", 2);
+	printf("%lu bytes in the files, listings %s\n", (unsigned long) sum, bad ? "DIFFER" : "match");
+	f_close(&fil);
+	f_mount(NULL, "", 0);
+	disk_img_close();
+	return bad;
+}
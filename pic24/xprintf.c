@@ -19,23 +19,82 @@
 void (*xfunc_out)(unsigned char);	/* Pointer to the output stream */
 static char *outptr;
 
+#if _USE_XFUNC_BLK
+static void (*xfunc_blk)(const unsigned char*, unsigned int);	/* Pointer to the block output stream */
+static unsigned char *blkbuf;		/* Output buffer (0:Not used) */
+static unsigned int blksize, blkcnt;
+static int blkhold;					/* Nesting count of functions that flush at their end */
+#define	HOLD()		blkhold++
+#define	RELEASE()	if (!--blkhold) xflush()
+#else
+#define	HOLD()
+#define	RELEASE()
+#define	xflush()
+#endif
+
 /*----------------------------------------------*/
 /* Put a character                              */
 /*----------------------------------------------*/
 
-void xputc (char c)
+static
+void xputc_b (char c)	/* Put a character into the buffer or the device */
 {
-	if (_CR_CRLF && c == '\n') xputc('\r');		/* CR -> CRLF */
+	if (_CR_CRLF && c == '\n') xputc_b('\r');	/* CR -> CRLF */
 
 	if (outptr) {
 		*outptr++ = (unsigned char)c;
 		return;
 	}
 
+#if _USE_XFUNC_BLK
+	if (blkbuf) {
+		blkbuf[blkcnt++] = (unsigned char)c;
+		if (blkcnt >= blksize) xflush();
+		return;
+	}
+#endif
+
 	if (xfunc_out) xfunc_out((unsigned char)c);
 }
 
 
+void xputc (char c)
+{
+	HOLD();
+	xputc_b(c);
+	RELEASE();
+}
+
+
+
+#if _USE_XFUNC_BLK
+/*----------------------------------------------*/
+/* Block output buffer                          */
+/*----------------------------------------------*/
+
+void xblk_init (	/* Set the block output device (func = 0: Back to xfunc_out) */
+	void (*func)(const unsigned char*, unsigned int),	/* Pointer to the block output function */
+	unsigned char* buff,	/* Pointer to the output buffer */
+	unsigned int size		/* Size of the buffer */
+)
+{
+	xflush();
+	xfunc_blk = func;
+	blkbuf = (func && size) ? buff : 0;
+	blksize = size;
+}
+
+
+void xflush (void)	/* Put the buffered characters to the block device */
+{
+	if (blkcnt) {
+		xfunc_blk(blkbuf, blkcnt);
+		blkcnt = 0;
+	}
+}
+#endif
+
+
 
 /*----------------------------------------------*/
 /* Put a null-terminated string                 */
@@ -45,8 +104,10 @@ void xputs (					/* Put a string to the default device */
 	const char* str				/* Pointer to the string */
 )
 {
+	HOLD();
 	while (*str)
-		xputc(*str++);
+		xputc_b(*str++);
+	RELEASE();
 }
 
 
@@ -56,13 +117,22 @@ void xfputs (					/* Put a string to the specified device */
 )
 {
 	void (*pf)(unsigned char);
+#if _USE_XFUNC_BLK
+	unsigned char *pb;
+
+	xflush();
+	pb = blkbuf; blkbuf = 0;	/* Bypass the output buffer */
+#endif
 
 
 	pf = xfunc_out;		/* Save current output device */
 	xfunc_out = func;	/* Switch output to specified device */
 	while (*str)		/* Put the string */
-		xputc(*str++);
+		xputc_b(*str++);
 	xfunc_out = pf;		/* Restore output device */
+#if _USE_XFUNC_BLK
+	blkbuf = pb;
+#endif
 }
 
 
@@ -81,25 +151,76 @@ void xfputs (					/* Put a string to the specified device */
     xprintf("%-4s", "abc");			"abc "
     xprintf("%4s", "abc");			" abc"
     xprintf("%c", 'a');				"a"
+    xprintf("%.3d V", 4096);		"4.096 V"
+    xprintf("%7.2ld", -5L);			"  -0.05"
     xprintf("%f", 10.0);            <xprintf lacks floating point support>
 */
 
+static const char Dec2[] =	/* Two digit table for the decimal conversion */
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+#define	PUT2(s, i, n)	{ s[i++] = Dec2[(n) * 2 + 1]; s[i++] = Dec2[(n) * 2]; }
+#define	DIV100(n)		((unsigned int)(((unsigned long)(n) * 5243) >> 19))	/* n / 100 (n < 43699) */
+
+static
+unsigned int put_dec (	/* Number of digits put */
+	char* s,			/* Digit buffer, least significant digit first */
+	unsigned long v		/* Value */
+)
+{
+	unsigned long q;
+	unsigned int i = 0, n, m;
+
+
+	while (v > 0xFFFF) {	/* Take 4 digits per long divide */
+		q = v / 10000;
+		n = (unsigned int)(v - q * 10000);
+		v = q;
+		m = DIV100(n);
+		PUT2(s, i, n - m * 100);
+		PUT2(s, i, m);
+	}
+	n = (unsigned int)v;	/* The rest in native int */
+	if (n >= 10000) {
+		for (q = 0; n >= 10000; q++) n -= 10000;
+		m = DIV100(n);
+		PUT2(s, i, n - m * 100);
+		PUT2(s, i, m);
+		n = (unsigned int)q;
+	}
+	while (n >= 100) {
+		m = DIV100(n);
+		PUT2(s, i, n - m * 100);
+		n = m;
+	}
+	if (n >= 10) {
+		PUT2(s, i, n);
+	} else {
+		s[i++] = (char)('0' + n);
+	}
+
+	return i;
+}
+
+
 static
 void xvprintf (
 	const char*	fmt,	/* Pointer to the format string */
 	va_list arp			/* Pointer to arguments */
 )
 {
-	unsigned int r, i, j, w, f;
+	unsigned int r, i, j, w, f, p;
 	unsigned long v;
-	char s[16], c, d, *p;
+	char s[16], c, d, *q;
 
 
 	for (;;) {
 		c = *fmt++;					/* Get a char */
 		if (!c) break;				/* End of format? */
 		if (c != '%') {				/* Pass through it if not a % sequense */
-			xputc(c); continue;
+			xputc_b(c); continue;
 		}
 		f = 0;
 		c = *fmt++;					/* Get first char of the sequense */
@@ -112,6 +233,12 @@ void xvprintf (
 		}
 		for (w = 0; c >= '0' && c <= '9'; c = *fmt++)	/* Minimum width */
 			w = w * 10 + c - '0';
+		p = 0;
+		if (c == '.') {				/* Digits after the decimal point (fixed point decimal) */
+			for (c = *fmt++; c >= '0' && c <= '9'; c = *fmt++)
+				p = p * 10 + c - '0';
+			if (p > 9) p = 9;
+		}
 		if (c == 'l' || c == 'L') {	/* Prefix: Size is long int */
 			f |= 4; c = *fmt++;
 		}
@@ -120,14 +247,14 @@ void xvprintf (
 		if (d >= 'a') d -= 0x20;
 		switch (d) {				/* Type is... */
 		case 'S' :					/* String */
-			p = va_arg(arp, char*);
-			for (j = 0; p[j]; j++) ;
-			while (!(f & 2) && j++ < w) xputc(' ');
-			xputs(p);
-			while (j++ < w) xputc(' ');
+			q = va_arg(arp, char*);
+			for (j = 0; q[j]; j++) ;
+			while (!(f & 2) && j++ < w) xputc_b(' ');
+			while (*q) xputc_b(*q++);
+			while (j++ < w) xputc_b(' ');
 			continue;
 		case 'C' :					/* Character */
-			xputc((char)va_arg(arp, int)); continue;
+			xputc_b((char)va_arg(arp, int)); continue;
 		case 'B' :					/* Binary */
 			r = 2; break;
 		case 'O' :					/* Octal */
@@ -138,7 +265,7 @@ void xvprintf (
 		case 'X' :					/* Hexdecimal */
 			r = 16; break;
 		default:					/* Unknown type (passthrough) */
-			xputc(c); continue;
+			xputc_b(c); continue;
 		}
 
 		/* Get an argument and put it in numeral */
@@ -147,17 +274,27 @@ void xvprintf (
 			v = 0 - v;
 			f |= 8;
 		}
-		i = 0;
-		do {
-			d = (char)(v % r); v /= r;
-			if (d > 9) d += (c == 'x') ? 0x27 : 0x07;
-			s[i++] = d + '0';
-		} while (v && i < sizeof(s));
+		if (r == 10) {
+			i = put_dec(s, v);
+			if (p) {				/* Fixed point, insert the decimal point */
+				while (i <= p) s[i++] = '0';
+				for (j = i++; j > p; j--) s[j] = s[j - 1];
+				s[p] = '.';
+			}
+		} else {					/* Radix 2, 8 and 16 need no divide */
+			r--; j = (r == 15) ? 4 : (r == 7) ? 3 : 1;
+			i = 0;
+			do {
+				d = (char)(v & r); v >>= j;
+				if (d > 9) d += (c == 'x') ? 0x27 : 0x07;
+				s[i++] = d + '0';
+			} while (v && i < sizeof(s));
+		}
 		if (f & 8) s[i++] = '-';
 		j = i; d = (f & 1) ? '0' : ' ';
-		while (!(f & 2) && j++ < w) xputc(d);
-		do xputc(s[--i]); while(i);
-		while (j++ < w) xputc(' ');
+		while (!(f & 2) && j++ < w) xputc_b(d);
+		do xputc_b(s[--i]); while(i);
+		while (j++ < w) xputc_b(' ');
 	}
 }
 
@@ -170,9 +307,11 @@ void xprintf (			/* Put a formatted string to the default device */
 	va_list arp;
 
 
+	HOLD();
 	va_start(arp, fmt);
 	xvprintf(fmt, arp);
 	va_end(arp);
+	RELEASE();
 }
 
 
@@ -204,6 +343,12 @@ void xfprintf (					/* Put a formatted string to the specified device */
 {
 	va_list arp;
 	void (*pf)(unsigned char);
+#if _USE_XFUNC_BLK
+	unsigned char *pb;
+
+	xflush();
+	pb = blkbuf; blkbuf = 0;	/* Bypass the output buffer */
+#endif
 
 
 	pf = xfunc_out;		/* Save current output device */
@@ -214,6 +359,9 @@ void xfprintf (					/* Put a formatted string to the specified device */
 	va_end(arp);
 
 	xfunc_out = pf;		/* Restore output device */
+#if _USE_XFUNC_BLK
+	blkbuf = pb;
+#endif
 }
 
 
@@ -235,6 +383,7 @@ void put_dump (
 	const unsigned long *lp;
 
 
+	HOLD();							/* Put the line in one go */
 	xprintf("%08lX:", addr);		/* address */
 
 	switch (width) {
@@ -244,7 +393,7 @@ void put_dump (
 			xprintf(" %02X", bp[i]);
 		xputc(' ');
 		for (i = 0; i < len; i++)		/* ASCII dump */
-			xputc((bp[i] >= ' ' && bp[i] <= '~') ? bp[i] : '.');
+			xputc_b((bp[i] >= ' ' && bp[i] <= '~') ? bp[i] : '.');
 		break;
 	case DW_SHORT:
 		sp = buff;
@@ -260,7 +409,8 @@ void put_dump (
 		break;
 	}
 
-	xputc('\n');
+	xputc_b('\n');
+	RELEASE();
 }
 
 #endif /* _USE_XFUNC_OUT */
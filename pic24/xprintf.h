@@ -7,6 +7,7 @@
 
 #define _USE_XFUNC_OUT	1	/* 1: Use output functions */
 #define	_CR_CRLF		1	/* 1: Convert \n ==> \r\n in the output char */
+#define _USE_XFUNC_BLK	1	/* 1: Use block output through a buffer */
 
 #define _USE_XFUNC_IN	1	/* 1: Use input function */
 #define	_LINE_ECHO		1	/* 1: Echo back input chars in xgets function */
@@ -27,6 +28,12 @@ void put_dump (const void* buff, unsigned long addr, int len, int width);
 #define DW_LONG		sizeof(long)
 #endif
 
+#if _USE_XFUNC_OUT && _USE_XFUNC_BLK
+#define xdev_blk(func, buff, size) xblk_init((void(*)(const unsigned char*,unsigned int))(func), buff, size)
+void xblk_init (void (*func)(const unsigned char*, unsigned int), unsigned char* buff, unsigned int size);
+void xflush (void);
+#endif
+
 #if _USE_XFUNC_IN
 #define xdev_in(func) xfunc_in = (unsigned char(*)(void))(func)
 extern unsigned char (*xfunc_in)(void);
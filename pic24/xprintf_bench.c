@@ -0,0 +1,301 @@
+/* xprintf output engine, old against new on a Linux host
+ *
+ * cc -O2 -o xprintf_bench xprintf_bench.c
+ * ./xprintf_bench [lines]
+ *
+ * Builds xprintf.c into this file with a 32 bit long as on the PIC24, next
+ * to a copy of the engine it replaced (one long divide and modulo per digit
+ * in every radix, every character through xfunc_out). For the console lines
+ * of main.c
+ *   rc       put_rc        "rc=%u FR_%s"
+ *   dir      the fl listing line
+ *   stats    the fs summary
+ *   speed    "%lu bytes read with %lu kB/sec."
+ *   volts    "%.3d V", a fixed point millivolt value
+ *   dump     a 16 byte put_dump line
+ * it checks that both give the same text (volts only with the new engine)
+ * and prints per line
+ *   chars    characters put out
+ *   calls    sink calls, xfunc_out per character for the old engine,
+ *            uart_write per buffer for the new one
+ *   ldiv     32 bit library divides (__udivsi3, __umodsi3)
+ *   est cyc  a PIC24 cycle estimate from those counts, CYC_LDIV per divide,
+ *            CYC_CALL per sink call and CYC_CHAR per character
+ *   host cyc x86 TSC cycles, which divides in hardware, so the divide
+ *            saving does not show up here
+ * The CYC_ values are estimates of the XC16 library routines and of the
+ * uart_putc/uart_write calls, not simulator measurements.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <x86intrin.h>
+
+#define long int	/* 32 bit long like on the PIC24 */
+#include "xprintf.c"
+
+#define CYC_LDIV	350	// one 32/32 bit library divide or modulo
+#define CYC_CALL	30	// sink call, uart_putc or uart_write entry and FIFO update
+#define CYC_CHAR	12	// formatting loop and FIFO store per character
+
+static unsigned char sink[4096], obuf[64];	/* obuf: the main.c Obuf */
+static unsigned int sn, calls;
+static unsigned long old_ldiv;
+
+
+static void cout (unsigned char c)
+{
+	sink[sn++ % sizeof sink] = c;
+	calls++;
+}
+
+static void bout (const unsigned char* p, unsigned int n)
+{
+	while (n--) sink[sn++ % sizeof sink] = *p++;
+	calls++;
+}
+
+
+/*----------------------------------------------*/
+/* The engine before, divides counted          */
+/*----------------------------------------------*/
+
+static void old_xputc (char c)
+{
+	if (_CR_CRLF && c == '\n') old_xputc('\r');
+	if (xfunc_out) xfunc_out((unsigned char)c);
+}
+
+static void old_xvprintf (const char* fmt, va_list arp)
+{
+	unsigned int r, i, j, w, f;
+	unsigned long v;
+	char s[16], c, d, *p;
+
+
+	for (;;) {
+		c = *fmt++;
+		if (!c) break;
+		if (c != '%') {
+			old_xputc(c); continue;
+		}
+		f = 0;
+		c = *fmt++;
+		if (c == '0') {
+			f = 1; c = *fmt++;
+		} else {
+			if (c == '-') {
+				f = 2; c = *fmt++;
+			}
+		}
+		for (w = 0; c >= '0' && c <= '9'; c = *fmt++)
+			w = w * 10 + c - '0';
+		if (c == 'l' || c == 'L') {
+			f |= 4; c = *fmt++;
+		}
+		if (!c) break;
+		d = c;
+		if (d >= 'a') d -= 0x20;
+		switch (d) {
+		case 'S' :
+			p = va_arg(arp, char*);
+			for (j = 0; p[j]; j++) ;
+			while (!(f & 2) && j++ < w) old_xputc(' ');
+			while (*p) old_xputc(*p++);
+			while (j++ < w) old_xputc(' ');
+			continue;
+		case 'C' :
+			old_xputc((char)va_arg(arp, int)); continue;
+		case 'B' :
+			r = 2; break;
+		case 'O' :
+			r = 8; break;
+		case 'D' :
+		case 'U' :
+			r = 10; break;
+		case 'X' :
+			r = 16; break;
+		default:
+			old_xputc(c); continue;
+		}
+		v = (f & 4) ? va_arg(arp, long) : ((d == 'D') ? (long)va_arg(arp, int) : (long)va_arg(arp, unsigned int));
+		if (d == 'D' && (v & 0x80000000)) {
+			v = 0 - v;
+			f |= 8;
+		}
+		i = 0;
+		do {
+			d = (char)(v % r); v /= r;
+			old_ldiv += 2;		/* __umodsi3 and __udivsi3 on the PIC24 */
+			if (d > 9) d += (c == 'x') ? 0x27 : 0x07;
+			s[i++] = d + '0';
+		} while (v && i < sizeof(s));
+		if (f & 8) s[i++] = '-';
+		j = i; d = (f & 1) ? '0' : ' ';
+		while (!(f & 2) && j++ < w) old_xputc(d);
+		do old_xputc(s[--i]); while(i);
+		while (j++ < w) old_xputc(' ');
+	}
+}
+
+static void old_xprintf (const char* fmt, ...)
+{
+	va_list arp;
+
+	va_start(arp, fmt);
+	old_xvprintf(fmt, arp);
+	va_end(arp);
+}
+
+static void old_put_dump (const unsigned char* bp, unsigned long addr, int len)
+{
+	int i;
+
+	old_xprintf("%08lX:", addr);
+	for (i = 0; i < len; i++) old_xprintf(" %02X", bp[i]);
+	old_xputc(' ');
+	for (i = 0; i < len; i++) old_xputc((bp[i] >= ' ' && bp[i] <= '~') ? bp[i] : '.');
+	old_xputc('\n');
+}
+
+
+/*----------------------------------------------*/
+/* Long divides of the new engine               */
+/*----------------------------------------------*/
+
+/* put_dec takes 4 digits per long divide while the value is over 16 bits,
+   the radix 2, 8 and 16 conversions and the rest need none */
+static unsigned int new_ldiv (unsigned long v)
+{
+	unsigned int n = 0;
+
+	while (v > 0xFFFF) {
+		v /= 10000;
+		n++;
+	}
+	return n;
+}
+
+
+/*----------------------------------------------*/
+/* Workload                                     */
+/*----------------------------------------------*/
+
+typedef struct {
+	const char* name;
+	const char* fmt;
+	long a[11];			/* Numeric arguments, the strings are added by put_line */
+	unsigned int dec;	/* Bit n set: argument n is a decimal conversion */
+	int old;			/* The old engine has the conversion */
+} LINE;
+
+static const LINE Lines[] = {
+	{ "rc",    "rc=%u FR_%s\n", { 3 }, 0x01, 1 },
+	{ "dir",   "%c%c%c%c%c %u/%02u/%02u %02u:%02u %9lu  %-12s  %s\n",
+	           { '-', 'A', '-', '-', '-', 2011, 3, 17, 14, 8, 1234567 }, 0x7E0, 1 },
+	{ "stats", "\r%u files, %lu bytes.\n%u folders.\n", { 581, 148225817, 37 }, 0x07, 1 },
+	{ "speed", "%lu bytes read with %lu kB/sec.\n", { 1048576, 412 }, 0x03, 1 },
+	{ "volts", "%.3d V\n", { 3297 }, 0x01, 0 },
+};
+#define N_LINES	(int)(sizeof Lines / sizeof Lines[0])
+
+
+static void put_line (int old, int i)
+{
+	const long* a = Lines[i].a;
+	void (*pf)(const char*, ...) = old ? old_xprintf : xprintf;
+
+	switch (i) {
+	case 0:
+		pf(Lines[i].fmt, a[0], "NOT_READY"); break;
+	case 1:
+		pf(Lines[i].fmt, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], "FATFS.TXT", "longer file name.txt");
+		break;
+	default:
+		pf(Lines[i].fmt, a[0], a[1], a[2]);
+	}
+}
+
+
+/* Sink, old: xfunc_out per character, new: uart_write per buffer */
+static void connect (int old)
+{
+	xdev_out(cout);
+	if (old) xdev_blk(0, 0, 0);
+	else xdev_blk(bout, obuf, sizeof obuf);
+}
+
+
+static void report (const char* name, const char* eng, unsigned int chars, double nc, double ldiv, double host)
+{
+	printf("  %-6s %-4s %6u %6.1f %6.1f %8.0f %9.0f\n", name, eng, chars, nc, ldiv,
+		ldiv * CYC_LDIV + nc * CYC_CALL + chars * CYC_CHAR, host);
+}
+
+
+int main (int argc, char* argv[])
+{
+	static unsigned char text[4096];
+	int n = argc > 1 ? atoi(argv[1]) : 200000;
+	unsigned char mem[16];
+	uint64_t t;
+	unsigned int k, j, len, nd, bad = 0;
+	int i, old;
+
+
+	if (n < 1) n = 1;
+	for (k = 0; k < sizeof mem; k++) mem[k] = (unsigned char)(k * 37 + 20);
+	printf("%d lines each, est cyc = %d/ldiv + %d/call + %d/char\n", n, CYC_LDIV, CYC_CALL, CYC_CHAR);
+	printf("  %-6s %-4s %6s %6s %6s %8s %9s\n", "line", "eng", "chars", "calls", "ldiv", "est cyc", "host cyc");
+
+	for (i = 0; i <= N_LINES; i++) {	/* The lines and the put_dump line */
+		for (old = 1; old >= 0; old--) {
+			if (old && i < N_LINES && !Lines[i].old) continue;
+			connect(old);
+			sn = 0;
+			if (i < N_LINES) put_line(old, i);
+			else if (old) old_put_dump(mem, 0x1F0, 16);
+			else put_dump(mem, 0x1F0, 16, DW_CHAR);
+			xdev_blk(0, 0, 0);
+			if (old) {
+				len = sn;
+				memcpy(text, sink, sn);
+			} else if (i == N_LINES || Lines[i].old) {
+				if (sn != len || memcmp(text, sink, sn)) {
+					printf("%s: the engines differ\n", i < N_LINES ? Lines[i].name : "dump");
+					bad++;
+				}
+			}
+			len = sn;
+
+			connect(old);
+			old_ldiv = 0; calls = 0;
+			t = __rdtsc();
+			for (k = 0; k < (unsigned int)n; k++) {
+				if (i < N_LINES) put_line(old, i);
+				else if (old) old_put_dump(mem, k, 16);
+				else put_dump(mem, k, 16, DW_CHAR);
+			}
+			t = __rdtsc() - t;
+			xdev_blk(0, 0, 0);
+			nd = 0;
+			if (old) {
+				nd = old_ldiv / n;
+			} else if (i < N_LINES) {
+				for (j = 0; j < 11; j++)
+					if (Lines[i].dec & (1 << j)) nd += new_ldiv(Lines[i].a[j] < 0 ? -Lines[i].a[j] : Lines[i].a[j]);
+			}
+			report(i < N_LINES ? Lines[i].name : "dump", old ? "old" : "new", len, (double)calls / n, nd, (double)t / n);
+		}
+	}
+
+	xsprintf((char*)text, "%.3d V", 4096);
+	if (strcmp((char*)text, "4.096 V")) {
+		printf("fixed point: \"%s\"\n", text);
+		bad++;
+	}
+	printf("text %s\n", bad ? "DIFFERS" : "same");
+	return bad != 0;
+}
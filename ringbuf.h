@@ -0,0 +1,96 @@
+/*
+ * File:   ringbuf.h
+ * Author: root
+ *
+ * Single producer, single consumer ring buffers, shared by the PIC18
+ * SlaveO bounce buffers (mx_test), the PIC24 UART FIFOs (pic24) and the
+ * Linux bmc client queue (supermoon/bmc/bmc_x86).
+ * head is only written by the producer and tail only by the consumer, both
+ * run free and are masked with size - 1, so one side can be an ISR and the
+ * other the main loop without disabling interrupts or a shared count.
+ * The size must be a power of two and at most half the index type range,
+ * the index type must be written in one instruction (uint8_t on the PIC18,
+ * uint16_t on the PIC24 and up).
+ *
+ * RB_TYPE(name, type, size, itype) declares a ring of size elements of type,
+ * the RB_ macros work on any of them, the span macros give the contiguous
+ * part of the buffer for bulk memcpy work.
+ *
+ * ringbuf_bench.c is the threaded stress test and throughput benchmark.
+ */
+
+#ifndef RINGBUF_H
+#define	RINGBUF_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#ifdef __18CXX
+/*unsigned types*/
+typedef unsigned char uint8_t;
+typedef unsigned int uint16_t;
+typedef unsigned long uint32_t;
+typedef unsigned long long uint64_t;
+/*signed types*/
+typedef signed char int8_t;
+typedef signed int int16_t;
+typedef signed long int32_t;
+typedef signed long long int64_t;
+#else
+#include <stdint.h>
+#endif
+
+	/* order the buffer data against the index stores on SMP hosts */
+#if defined(__ATOMIC_ACQUIRE) && defined(__linux__)
+#define RB_ACQUIRE()	__atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define RB_RELEASE()	__atomic_thread_fence(__ATOMIC_RELEASE)
+#elif defined(__GNUC__)
+#define RB_ACQUIRE()	__asm__ __volatile__("" ::: "memory")
+#define RB_RELEASE()	__asm__ __volatile__("" ::: "memory")
+#else
+#define RB_ACQUIRE()
+#define RB_RELEASE()
+#endif
+
+#define RB_TYPE(name, type, size, itype)	\
+	typedef struct name {			\
+		volatile itype head;		\
+		volatile itype tail;		\
+		type buf[size];			\
+	} name
+
+#define RB_SIZE(rb)	(sizeof((rb)->buf) / sizeof((rb)->buf[0]))
+#define RB_MASK(rb)	(RB_SIZE(rb) - 1)
+#define RB_INIT(rb)	((rb)->head = (rb)->tail = 0)
+	/* the index range is a multiple of 2 * size, so this is exact after wraps */
+#define RB_COUNT(rb)	((unsigned) ((rb)->head - (rb)->tail) & (2 * RB_SIZE(rb) - 1))
+#define RB_FREE(rb)	(RB_SIZE(rb) - RB_COUNT(rb))
+#define RB_EMPTY(rb)	((rb)->head == (rb)->tail)
+#define RB_FULL(rb)	(RB_COUNT(rb) == RB_SIZE(rb))
+
+	/* producer side, check RB_FULL first */
+#define RB_PUT(rb, v)	do { (rb)->buf[(rb)->head & RB_MASK(rb)] = (v); RB_RELEASE(); (rb)->head++; } while (0)
+	/* consumer side, check RB_EMPTY first */
+#define RB_GET(rb, v)	do { RB_ACQUIRE(); (v) = (rb)->buf[(rb)->tail & RB_MASK(rb)]; RB_RELEASE(); (rb)->tail++; } while (0)
+	/* consumer drops everything in the ring */
+#define RB_FLUSH(rb)	((rb)->tail = (rb)->head)
+
+	/* contiguous free elements at the head and contiguous data at the tail into n,
+	 * the other side's index is read once */
+#define RB_WSPAN(rb, n)	do { unsigned f_ = RB_FREE(rb), e_ = RB_SIZE(rb) - ((rb)->head & RB_MASK(rb)); \
+				(n) = f_ < e_ ? f_ : e_; } while (0)
+#define RB_RSPAN(rb, n)	do { unsigned c_ = RB_COUNT(rb), e_ = RB_SIZE(rb) - ((rb)->tail & RB_MASK(rb)); \
+				(n) = c_ < e_ ? c_ : e_; } while (0)
+#define RB_WPTR(rb)	(&(rb)->buf[(rb)->head & RB_MASK(rb)])
+#define RB_RPTR(rb)	(&(rb)->buf[(rb)->tail & RB_MASK(rb)])
+	/* publish n elements written at RB_WPTR, release n elements read at RB_RPTR,
+	 * a consumer calls RB_ACQUIRE() between RB_RSPAN and reading the data */
+#define RB_COMMIT(rb, n)	do { RB_RELEASE(); (rb)->head += (n); } while (0)
+#define RB_CONSUME(rb, n)	do { RB_RELEASE(); (rb)->tail += (n); } while (0)
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* RINGBUF_H */
@@ -0,0 +1,391 @@
+/*
+ * ringbuf.h stress test and throughput benchmark on a Linux host
+ *
+ * cc -O2 -o ringbuf_bench ringbuf_bench.c mx_test/ringbufs.c -lpthread
+ * ./ringbuf_bench [million elements per stress run]
+ *
+ * Stress: a producer and a consumer thread, on different cpus when there
+ * are two, move a known sequence through
+ *   ringBufS     the 32 byte uint8_t index ring of mx_test, the ringBufS_
+ *                calls and their span copies
+ *   RB words     a 4096 entry ring of uint16_t with uint16_t indexes
+ *   RB tiny      an 8 entry ring of uint32_t with uint8_t indexes, every
+ *                few elements wrap the buffer and the 8 bit indexes
+ *   old count    the ringBufS of before, a count written by both sides
+ * each side picks single put/get or spans of 1 to 24 at random and yields
+ * when it is full or empty. It prints the elements moved, those out of
+ * sequence, those never seen and the time. On the old ring one lost count
+ * update shifts the rest of the run, so every element after it is bad, and
+ * it is given a time limit as a drifted count can leave it full for good.
+ *
+ * Benchmark, one thread, bursts of 16 put then 16 get: the old ring, the new
+ * ringBufS_put/get (both called across translation units like on the PIC),
+ * the RB_PUT/RB_GET macros inline, ringBufS_write/read of 24 byte spans and
+ * the RB words ring between two threads with spans, in M elements/s.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "mx_test/ringbufs.h"
+
+#define SPAN_MAX	24
+#define BURST		16
+#define OLD_LIMIT_S	10.0
+
+RB_TYPE(word_ring, uint16_t, 4096, uint16_t);
+RB_TYPE(tiny_ring, uint32_t, 8, uint8_t);
+
+/* the count ring of mx_test/ringbufs.c before ringbuf.h */
+typedef struct old_ring {
+	uint8_t buf[RBUF_SIZE];
+	volatile int8_t head;
+	volatile int8_t tail;
+	volatile int8_t count;
+} old_ring;
+
+static __attribute__((noinline)) uint8_t modulo_inc(const uint8_t value, const uint8_t modulus)
+{
+	uint8_t my_value = value + 1;
+	if (my_value >= modulus) {
+		my_value = 0;
+	}
+	return my_value;
+}
+
+static __attribute__((noinline)) uint16_t old_get(old_ring *_this)
+{
+	uint16_t c;
+	if (_this->count > 0) {
+		c = _this->buf[_this->tail];
+		_this->tail = modulo_inc(_this->tail, RBUF_SIZE);
+		--_this->count;
+	} else {
+		c = 0; // return null with empty buffer
+	}
+	return(c);
+}
+
+static __attribute__((noinline)) void old_put(old_ring *_this, const uint16_t c)
+{
+	if (_this->count < RBUF_SIZE) {
+		_this->buf[_this->head] = c;
+		_this->head = modulo_inc(_this->head, RBUF_SIZE);
+		++_this->count;
+	}
+}
+
+enum ring_kind { K_BYTES, K_WORDS, K_TINY, K_OLD };
+
+struct run {
+	enum ring_kind kind;
+	unsigned long n, moved, bad;
+	volatile int stop;
+	double limit;
+	int cpus;
+	ringBufS_t bytes;
+	word_ring words;
+	tiny_ring tiny;
+	old_ring old;
+};
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned xorshift(unsigned *s)
+{
+	*s ^= *s << 13;
+	*s ^= *s >> 17;
+	*s ^= *s << 5;
+	return *s;
+}
+
+/* element i of the sequence, cut to the element width */
+static uint32_t seq(unsigned long i)
+{
+	return (uint32_t) (i * 2654435761u) ^ (uint32_t) (i >> 7);
+}
+
+static void pin(int cpu, int cpus)
+{
+	cpu_set_t set;
+
+	if (cpus < 2)
+		return;
+	CPU_ZERO(&set);
+	CPU_SET(cpu % cpus, &set);
+	sched_setaffinity(0, sizeof(set), &set);
+}
+
+/* put up to n elements from i on, returns how many went in */
+static unsigned put_some(struct run *r, unsigned long i, unsigned n, int span)
+{
+	uint8_t b[SPAN_MAX];
+	unsigned k, got;
+
+	switch (r->kind) {
+	case K_BYTES:
+		if (!span) {
+			if (ringBufS_full(&r->bytes))
+				return 0;
+			ringBufS_put(&r->bytes, (uint8_t) seq(i));
+			return 1;
+		}
+		for (k = 0; k < n; k++)
+			b[k] = (uint8_t) seq(i + k);
+		return ringBufS_write(&r->bytes, b, n);
+	case K_WORDS:
+		if (!span) {
+			if (RB_FULL(&r->words))
+				return 0;
+			RB_PUT(&r->words, (uint16_t) seq(i));
+			return 1;
+		}
+		RB_WSPAN(&r->words, got);
+		got = got < n ? got : n;
+		for (k = 0; k < got; k++)
+			RB_WPTR(&r->words)[k] = (uint16_t) seq(i + k);
+		RB_COMMIT(&r->words, got);
+		return got;
+	case K_TINY:
+		if (RB_FULL(&r->tiny))
+			return 0;
+		RB_PUT(&r->tiny, seq(i));
+		return 1;
+	default:
+		if (r->old.count >= RBUF_SIZE)
+			return 0;
+		old_put(&r->old, (uint8_t) seq(i));
+		return 1;
+	}
+}
+
+/* get up to n elements and check them against i on, returns how many came */
+static unsigned get_some(struct run *r, unsigned long i, unsigned n, int span)
+{
+	uint8_t b[SPAN_MAX];
+	uint32_t v = 0;
+	unsigned k, got;
+
+	switch (r->kind) {
+	case K_BYTES:
+		if (!span) {
+			if (ringBufS_empty(&r->bytes))
+				return 0;
+			b[0] = ringBufS_get(&r->bytes);
+			got = 1;
+		} else {
+			got = ringBufS_read(&r->bytes, b, n);
+		}
+		for (k = 0; k < got; k++)
+			r->bad += b[k] != (uint8_t) seq(i + k);
+		return got;
+	case K_WORDS:
+		if (!span) {
+			if (RB_EMPTY(&r->words))
+				return 0;
+			RB_GET(&r->words, v);
+			r->bad += v != (uint16_t) seq(i);
+			return 1;
+		}
+		RB_RSPAN(&r->words, got);
+		got = got < n ? got : n;
+		RB_ACQUIRE();
+		for (k = 0; k < got; k++)
+			r->bad += RB_RPTR(&r->words)[k] != (uint16_t) seq(i + k);
+		RB_CONSUME(&r->words, got);
+		return got;
+	case K_TINY:
+		if (RB_EMPTY(&r->tiny))
+			return 0;
+		RB_GET(&r->tiny, v);
+		r->bad += v != seq(i);
+		return 1;
+	default:
+		if (r->old.count <= 0)
+			return 0;
+		r->bad += old_get(&r->old) != (uint8_t) seq(i);
+		return 1;
+	}
+}
+
+static void *producer(void *arg)
+{
+	struct run *r = arg;
+	unsigned long i = 0;
+	unsigned s = 0x1234567, x, n;
+
+	pin(0, r->cpus);
+	while (i < r->n && !r->stop) {
+		x = xorshift(&s);
+		n = 1 + x % SPAN_MAX;
+		if (n > r->n - i)
+			n = r->n - i;
+		n = put_some(r, i, n, x & 0x100);
+		if (!n)
+			sched_yield();
+		i += n;
+	}
+	return NULL;
+}
+
+static void *consumer(void *arg)
+{
+	struct run *r = arg;
+	unsigned s = 0x7654321, x, n;
+
+	pin(1, r->cpus);
+	while (r->moved < r->n && !r->stop) {
+		x = xorshift(&s);
+		n = 1 + x % SPAN_MAX;
+		if (n > r->n - r->moved)
+			n = r->n - r->moved;
+		n = get_some(r, r->moved, n, x & 0x100);
+		if (!n)
+			sched_yield();
+		r->moved += n;
+	}
+	return NULL;
+}
+
+static void stress(const char *name, enum ring_kind kind, unsigned long n, double limit, int cpus)
+{
+	static struct run r;
+	pthread_t p, c;
+	double t;
+
+	memset(&r, 0, sizeof(r));
+	r.kind = kind;
+	r.n = n;
+	r.limit = limit;
+	r.cpus = cpus;
+	ringBufS_init(&r.bytes);
+	RB_INIT(&r.words);
+	RB_INIT(&r.tiny);
+	t = now_s();
+	pthread_create(&p, NULL, producer, &r);
+	pthread_create(&c, NULL, consumer, &r);
+	while (r.moved < r.n && (!limit || now_s() - t < limit))
+		usleep(10000);
+	r.stop = 1;
+	pthread_join(p, NULL);
+	pthread_join(c, NULL);
+	t = now_s() - t;
+	printf("  %-10s %12lu %12lu %12lu %8.2f %s\n", name, r.moved, r.bad, r.n - r.moved, t,
+		r.moved < r.n ? "stuck" : "");
+}
+
+static double bench_old(unsigned long n)
+{
+	static old_ring o;
+	double t = now_s();
+	unsigned long i;
+	int k;
+
+	for (i = 0; i < n; i += BURST) {
+		for (k = 0; k < BURST; k++)
+			old_put(&o, (uint8_t) k);
+		for (k = 0; k < BURST; k++)
+			o.buf[0] ^= old_get(&o);
+	}
+	return n / (now_s() - t) / 1e6;
+}
+
+static double bench_new(unsigned long n)
+{
+	static ringBufS_t b;
+	double t = now_s();
+	unsigned long i;
+	int k;
+
+	ringBufS_init(&b);
+	for (i = 0; i < n; i += BURST) {
+		for (k = 0; k < BURST; k++)
+			ringBufS_put(&b, (uint8_t) k);
+		for (k = 0; k < BURST; k++)
+			b.buf[0] ^= ringBufS_get(&b);
+	}
+	return n / (now_s() - t) / 1e6;
+}
+
+static double bench_macro(unsigned long n)
+{
+	static ringBufS_t b;
+	double t = now_s();
+	unsigned long i;
+	uint8_t v;
+	int k;
+
+	RB_INIT(&b);
+	for (i = 0; i < n; i += BURST) {
+		for (k = 0; k < BURST; k++)
+			if (!RB_FULL(&b))
+				RB_PUT(&b, (uint8_t) k);
+		for (k = 0; k < BURST; k++)
+			if (!RB_EMPTY(&b)) {
+				RB_GET(&b, v);
+				b.buf[0] ^= v;
+			}
+	}
+	return n / (now_s() - t) / 1e6;
+}
+
+static double bench_span(unsigned long n)
+{
+	static ringBufS_t b;
+	uint8_t in[SPAN_MAX], out[SPAN_MAX];
+	double t = now_s();
+	unsigned long i;
+
+	memset(in, 0x5a, sizeof(in));
+	ringBufS_init(&b);
+	for (i = 0; i < n; i += SPAN_MAX) {
+		ringBufS_write(&b, in, SPAN_MAX);
+		ringBufS_read(&b, out, SPAN_MAX);
+		in[0] ^= out[1];
+	}
+	return n / (now_s() - t) / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long n = (argc > 1 ? atol(argv[1]) : 20) * 1000000UL;
+	int cpus = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	struct run r;
+	pthread_t p, c;
+	double t;
+
+	printf("%d cpus, %lu elements per run\n", cpus, n);
+	printf("  %-10s %12s %12s %12s %8s\n", "ring", "moved", "bad", "lost", "s");
+	stress("ringBufS", K_BYTES, n, 0.0, cpus);
+	stress("RB words", K_WORDS, n, 0.0, cpus);
+	stress("RB tiny", K_TINY, n, 0.0, cpus);
+	stress("old count", K_OLD, n, OLD_LIMIT_S, cpus);
+
+	printf("one thread, M elements/s\n");
+	printf("  %-24s %8.1f\n", "old ringBufS_put/get", bench_old(n * 4));
+	printf("  %-24s %8.1f\n", "ringBufS_put/get", bench_new(n * 4));
+	printf("  %-24s %8.1f\n", "RB_PUT/RB_GET", bench_macro(n * 4));
+	printf("  %-24s %8.1f\n", "ringBufS_write/read 24", bench_span(n * 4));
+
+	memset(&r, 0, sizeof(r));
+	r.kind = K_WORDS;
+	r.n = n * 4;
+	r.cpus = cpus;
+	t = now_s();
+	pthread_create(&p, NULL, producer, &r);
+	pthread_create(&c, NULL, consumer, &r);
+	pthread_join(p, NULL);
+	pthread_join(c, NULL);
+	printf("  %-24s %8.1f  (two threads, %lu bad)\n", "RB words spans", r.n / (now_s() - t) / 1e6, r.bad);
+	return 0;
+}
@@ -28,7 +28,6 @@
 #define MDB	TRUE
 #define MDB1	FALSE
 
-#define ADOFFSET	-0.0000025
 #define ADRES		4998.0 // OHM
 
 struct bmcdata bmc;
@@ -38,8 +37,7 @@ String fallback_resources[] = {"*Label.Label:    BMC", NULL};
 
 // bmcnet server information
 char hostip[32] = "10.1.1.41";
-int hostport = 9760;
-double gain_adj = ADGAIN1;
+int hostport = BMC_PORT;
 struct timeval start, end;
 
 void quit(w, client, call)
@@ -62,6 +60,7 @@ int main(int argc, char *argv[])
 	void quit();
 	Arg wargs[10];
 	int n, update = 0, update_num = 0, raw_data = 0, update_rate = 59;
+	long readings = 0;
 	char net_message[256], solar_data[256];
 	time_t rawtime, firsttime;
 	struct tm * timeinfo;
@@ -100,6 +99,11 @@ int main(int argc, char *argv[])
 	XtAddCallback(command, XtNcallback, quit, NULL);
 	XtRealizeWidget(toplevel);
 
+	/*
+	 * conversions per reading from the command line, 1 if not given, the
+	 * ADS1220 takes ~25 ms a conversion so 16 is about 2 readings a second
+	 */
+	if (argc > 1) over_sample = atoi(argv[1]);
 	if (init_daq() < 0) HAVE_AI = FALSE;
 	if (init_dio() < 0) HAVE_DIO = FALSE;
 	printf("\r\n Remote DAQ Client running        \r\n");
@@ -116,6 +120,7 @@ int main(int argc, char *argv[])
 	gettimeofday(&start, NULL);
 	while (HAVE_AI && HAVE_DIO) {
 		get_data_sample();
+		readings++;
 		gettimeofday(&end, NULL);
 		if (++update >= update_rate || RAW_DATA) {
 			if (MDB) {
@@ -125,11 +130,12 @@ int main(int argc, char *argv[])
 				/*
 				 * update the console
 				 */
-				PVcal = (bmc.pv_voltage - bmc.pv_voltage_null + ADOFFSET) * gain_adj;
+				PVcal = bmc.pv_voltage - bmc.pv_voltage_null; // ADOFFSET and ADGAIN are in daq_conv
 				PVi = PVcal / ADRES;
 				PVp = PVcal*PVi;
-				printf(" \r\n PV Voltage %2.6fV, PV Power %0.9fW, Raw data %x, PV Null %2.6fV, Raw Null %x, Raw time %ld, %3.6f",
-				PVcal, PVp, bmc.raw[PVV_C], bmc.pv_voltage_null, bmc.raw[PVV_NULL], rawtime, sigtime);
+				printf(" \r\n PV Voltage %2.6fV, PV Power %0.9fW, Raw data %x, PV Null %2.6fV, Raw Null %x, Raw time %ld, %3.6f, %2.1f bits, %2.1f SPS",
+				PVcal, PVp, bmc.raw[PVV_C], bmc.pv_voltage_null, bmc.raw[PVV_NULL], rawtime, sigtime, get_adc_bits(PVV_C),
+				sigtime > 0.0 ? readings / sigtime : 0.0);
 				/*
 				 * update the log file
 				 */
@@ -156,6 +162,7 @@ int main(int argc, char *argv[])
 			sprintf(net_message, "%i,%i,%i,%i,X", (int) (bmc.pv_voltage * V_SCALE), (int) (bmc.cm_amps * C_SCALE), update_num, STATION);
 			if (!RAW_DATA) bmc_client(net_message);
 		}
+		if (!RAW_DATA) bmc_client_poll(); // sends what lingered past BMC_LINGER_MS
 		//        XtMainLoop(); // X-windows stuff for later...
 		if (RAW_DATA && raw_data++ > 30000) {
 			fclose(fp);
@@ -163,6 +170,7 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	if (!RAW_DATA) bmc_client_flush(1000); // last queued samples
 	printf("\r\n Remote DAQ Client exiting        \r\n");
 	return 0;
 }
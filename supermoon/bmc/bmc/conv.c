@@ -0,0 +1,207 @@
+/*
+ * Raw AI code to volts conversion table
+ *
+ * conv_init asks comedi once for the conversion of every channel and range
+ * of the AI subdevice: the software calibration polynomial when there is a
+ * calibration file for the board, the hardware calibrated converter if not,
+ * the plain comedi_range as the last resort. A per entry trim (offset then
+ * gain, ADOFFSET and ADGAIN for the PV input) is folded into the
+ * coefficients, so conv_one is one Horner run with no comedi_get_range or
+ * comedi_to_phys behind it.
+ * conv_block converts a block of codes of one channel and range to volts,
+ * get_adc_volts runs it on the burst of a curved calibration. The loop has
+ * no branches in it and vectorizes.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>	/* NAN */
+#include "conv.h"
+
+static const struct conv_entry *conv_entry(const struct conv_table *ct, int chan, int range)
+{
+	if (chan < 0 || chan >= ct->chans || range < 0 || range >= ct->ranges)
+		return NULL;
+	if (!ct->e[chan][range].order)
+		return NULL;
+	return &ct->e[chan][range];
+}
+
+/* the trim into the coefficients and the order 1 form from them */
+static void conv_fuse(struct conv_entry *e)
+{
+	int i;
+
+	for (i = 0; i < CONV_TERMS; i++)
+		e->c[i] = e->cal[i] * e->gain;
+	e->c[0] += e->offset * e->gain;
+	e->s = e->c[1];
+	e->a = e->c[0] - e->c[1] * e->origin;
+}
+
+/* set an entry from a comedi polynomial, the trim stays */
+int conv_poly(struct conv_table *ct, int chan, int range, const comedi_polynomial_t *p, int src)
+{
+	struct conv_entry *e;
+	int i;
+
+	if (chan < 0 || chan >= CONV_CHANS || range < 0 || range >= CONV_RANGES)
+		return -1;
+	if (p->order < 1 || p->order >= CONV_TERMS)
+		return -1;
+	if (chan >= ct->chans)
+		ct->chans = chan + 1;
+	if (range >= ct->ranges)
+		ct->ranges = range + 1;
+	e = &ct->e[chan][range];
+	if (!e->order) {
+		e->offset = 0.0;
+		e->gain = 1.0;
+	}
+	e->src = src;
+	e->order = p->order;
+	e->origin = p->expansion_origin;
+	for (i = 0; i < CONV_TERMS; i++)
+		e->cal[i] = i <= (int) p->order ? p->coefficients[i] : 0.0;
+	conv_fuse(e);
+	return 0;
+}
+
+/*
+ * fill the table for subdev, calfile NULL uses the default calibration file
+ * when the subdevice is soft calibrated, returns the calibrated entries
+ */
+int conv_init(struct conv_table *ct, comedi_t *it, int subdev, const char *calfile)
+{
+	comedi_calibration_t *cal = NULL;
+	comedi_polynomial_t p;
+	comedi_range *rng;
+	lsampl_t maxdata;
+	char *path = NULL;
+	int chan, range, chans, ranges, n = 0;
+
+	memset(ct, 0, sizeof(struct conv_table));
+	chans = comedi_get_n_channels(it, subdev);
+	if (chans < 1)
+		return -1;
+	if (chans > CONV_CHANS)
+		chans = CONV_CHANS;
+
+	if (!calfile && comedi_get_subdevice_flags(it, subdev) & SDF_SOFT_CALIBRATED)
+		calfile = path = comedi_get_default_calibration_path(it);
+	if (calfile)
+		cal = comedi_parse_calibration_file(calfile);
+
+	for (chan = 0; chan < chans; chan++) {
+		ranges = comedi_get_n_ranges(it, subdev, chan);
+		if (ranges > CONV_RANGES)
+			ranges = CONV_RANGES;
+		for (range = 0; range < ranges; range++) {
+			if (cal && !comedi_get_softcal_converter(subdev, chan, range,
+				COMEDI_TO_PHYSICAL, cal, &p) && !conv_poly(ct, chan, range, &p, CONV_SOFTCAL)) {
+				n++;
+				continue;
+			}
+			if (!comedi_get_hardcal_converter(it, subdev, chan, range, COMEDI_TO_PHYSICAL, &p)
+				&& !conv_poly(ct, chan, range, &p, CONV_HARDCAL))
+				continue;
+			rng = comedi_get_range(it, subdev, chan, range);
+			maxdata = comedi_get_maxdata(it, subdev, chan);
+			if (!rng || !maxdata)
+				continue;
+			// what comedi_to_phys does
+			memset(&p, 0, sizeof(p));
+			p.order = 1;
+			p.coefficients[0] = rng->min;
+			p.coefficients[1] = (rng->max - rng->min) / maxdata;
+			conv_poly(ct, chan, range, &p, CONV_RANGE);
+		}
+	}
+	if (cal)
+		comedi_cleanup_calibration(cal);
+	free(path);
+	return n;
+}
+
+/* volts = (volts + offset) * gain on chan and range, -1 is all of them */
+int conv_trim(struct conv_table *ct, int chan, int range, double offset, double gain)
+{
+	int c, r, c_end = chan < 0 ? ct->chans : chan + 1, r_end = range < 0 ? ct->ranges : range + 1;
+	int n = 0;
+
+	if (c_end > ct->chans || r_end > ct->ranges)
+		return -1;
+	for (c = chan < 0 ? 0 : chan; c < c_end; c++) {
+		for (r = range < 0 ? 0 : range; r < r_end; r++) {
+			if (!ct->e[c][r].order)
+				continue;
+			ct->e[c][r].offset = offset;
+			ct->e[c][r].gain = gain;
+			conv_fuse(&ct->e[c][r]);
+			n++;
+		}
+	}
+	return n ? 0 : -1;
+}
+
+/* one code with a fraction, from a decimator, NAN for no entry */
+double conv_one(const struct conv_table *ct, int chan, int range, double code)
+{
+	const struct conv_entry *e = conv_entry(ct, chan, range);
+	double x, v;
+	int i;
+
+	if (!e)
+		return NAN;
+	if (e->order == 1)
+		return e->a + e->s * code;
+	x = code - e->origin;
+	v = e->c[e->order];
+	for (i = e->order - 1; i >= 0; i--)
+		v = v * x + e->c[i];
+	return v;
+}
+
+/* n codes of chan and range to volts, returns n or -1 for no entry */
+int conv_block(const struct conv_table *ct, int chan, int range, const lsampl_t *in, double *out, int n)
+{
+	const struct conv_entry *e = conv_entry(ct, chan, range);
+	double a, s, o, c0, c1, c2, c3, x;
+	int i;
+
+	if (!e)
+		return -1;
+	if (e->order == 1) {
+		a = e->a;
+		s = e->s;
+		for (i = 0; i < n; i++)
+			out[i] = a + s * (int) in[i]; // codes are under 2^31, int converts in SIMD
+		return n;
+	}
+	o = e->origin;
+	c0 = e->c[0];
+	c1 = e->c[1];
+	c2 = e->c[2];
+	c3 = e->c[3]; // 0.0 for order 2
+	for (i = 0; i < n; i++) {
+		x = (int) in[i] - o;
+		out[i] = ((c3 * x + c2) * x + c1) * x + c0;
+	}
+	return n;
+}
+
+/* polynomial order of the entry, 1 is linear, 0 for no entry */
+int conv_order(const struct conv_table *ct, int chan, int range)
+{
+	const struct conv_entry *e = conv_entry(ct, chan, range);
+
+	return e ? e->order : 0;
+}
+
+/* where the entry came from */
+const char *conv_src(const struct conv_table *ct, int chan, int range)
+{
+	static const char *names[] = {"none", "range", "hardcal", "softcal"};
+	const struct conv_entry *e = conv_entry(ct, chan, range);
+
+	return e ? names[e->src] : names[CONV_NONE];
+}
@@ -0,0 +1,58 @@
+/*
+ * File:   conv.h
+ * Author: root
+ *
+ * Per channel and range conversion of raw AI codes to volts
+ */
+
+#ifndef CONV_H
+#define	CONV_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <comedilib.h>
+
+#define CONV_CHANS	16	// channels in one table
+#define CONV_RANGES	8	// ranges per channel
+#define CONV_TERMS	4	// COMEDI_MAX_NUM_POLYNOMIAL_COEFFICIENTS
+
+#define CONV_NONE	0
+#define CONV_RANGE	1	// linear from comedi_get_range and maxdata
+#define CONV_HARDCAL	2	// comedi_get_hardcal_converter
+#define CONV_SOFTCAL	3	// a polynomial from the calibration file
+
+	/*
+	 * the comedi polynomial of the code and the trim fused into one set of
+	 * coefficients, worked out once so a sample costs a multiply and an add
+	 * (or a Horner step per order) with no range lookup
+	 */
+	struct conv_entry {
+		int src, order;
+		double origin; // the polynomial is in code - origin
+		double cal[CONV_TERMS]; // volts from the range or calibration
+		double offset, gain; // trim, volts = (cal + offset) * gain
+		double c[CONV_TERMS]; // cal with the trim
+		double a, s; // order 1 from code 0: volts = a + s * code
+	};
+
+	struct conv_table {
+		int chans, ranges;
+		struct conv_entry e[CONV_CHANS][CONV_RANGES];
+	};
+
+	int conv_init(struct conv_table *, comedi_t *, int, const char *);
+	int conv_poly(struct conv_table *, int, int, const comedi_polynomial_t *, int);
+	int conv_trim(struct conv_table *, int, int, double, double);
+	double conv_one(const struct conv_table *, int, int, double);
+	int conv_block(const struct conv_table *, int, int, const lsampl_t *, double *, int);
+	int conv_order(const struct conv_table *, int, int);
+	const char *conv_src(const struct conv_table *, int, int);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* CONV_H */
+
@@ -0,0 +1,211 @@
+/*
+ * code to volts conversion check and benchmark
+ *
+ * cc -O3 -I.. -o conv_bench conv_bench.c conv.c ../comedi_mock.c -lm
+ * ./conv_bench [moonlight log]
+ *
+ * Takes the PVcal and null columns of a moonlight log (../../moonlight_sept28.txt
+ * if none is given) back to the raw 24 bit PV and null codes of the ADS1220
+ * on the range the client picks for them, undoing ADOFFSET and ADGAIN, and
+ * cycles them out to N samples. The table comes from conv_init on the mock
+ * ads1220 board with the trims init_daq sets. Then it converts the codes
+ * and forms PVcal = PV - null with
+ *   comedi_to_phys  comedi_to_phys on both codes and the bmc.c math, as
+ *                   before daq_conv, the range looked up once per block
+ *   conv_one        the table one code at a time, as get_adc_volts does
+ *   conv_block      the table on blocks of one range, then PV - null
+ * and prints the M samples/s and the largest difference from comedi_to_phys
+ * in uV. Last it times conv_block on a cubic softcal polynomial against
+ * comedi_to_physical.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "daq.h"
+
+#define N	(1 << 20)	// samples per run
+#define RUNS	8
+#define BLOCK	1024	// codes per conv_block call, a comedi buffer read
+
+static lsampl_t pv[N], null[N];
+static int rng_of[N];
+static double ref[N], out[N], v_pv[BLOCK], v_null[BLOCK];
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static lsampl_t to_code(double v, const comedi_range *r, lsampl_t maxdata)
+{
+	double x = (v - r->min) / (r->max - r->min) * maxdata + 0.5;
+
+	return x < 0.0 ? 0 : x > maxdata ? maxdata : (lsampl_t) x;
+}
+
+/* PV and null codes of each log line, n lines */
+static int load(const char *name, comedi_range **r, lsampl_t maxdata)
+{
+	double pvcal, pvp, nullv, volts, gain;
+	char line[256];
+	long t;
+	int n = 0, range;
+	FILE *f = fopen(name, "r");
+
+	if (!f)
+		return -1;
+	while (n < N && fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "%lf, %lf, %lf, %ld", &pvcal, &pvp, &nullv, &t) != 4)
+			continue;
+		// get_data_sample picks the range on the last PV voltage
+		range = pvcal < 0.5 ? RANGE_0_512 : RANGE_2_048;
+		gain = range == RANGE_0_512 ? ADGAIN2 : ADGAIN1;
+		volts = pvcal / gain - ADOFFSET + nullv;
+		pv[n] = to_code(volts, r[range], maxdata);
+		null[n] = to_code(nullv, r[range], maxdata);
+		rng_of[n++] = range;
+	}
+	fclose(f);
+	return n;
+}
+
+/* PVcal as bmc.c had it */
+static void run_phys(comedi_range **r, lsampl_t maxdata)
+{
+	comedi_range *ad_range;
+	double gain_adj;
+	int i, j, end;
+
+	for (i = 0; i < N; i = end) {
+		ad_range = r[rng_of[i]];
+		gain_adj = rng_of[i] == RANGE_0_512 ? ADGAIN2 : ADGAIN1;
+		for (end = i; end < N && end < i + BLOCK && rng_of[end] == rng_of[i]; end++)
+			;
+		for (j = i; j < end; j++)
+			ref[j] = (comedi_to_phys(pv[j], ad_range, maxdata)
+				- comedi_to_phys(null[j], ad_range, maxdata) + ADOFFSET) * gain_adj;
+	}
+}
+
+static void run_one(const struct conv_table *ct)
+{
+	int i;
+
+	for (i = 0; i < N; i++)
+		out[i] = conv_one(ct, PVV_C, rng_of[i], pv[i]) - conv_one(ct, PVV_NULL, rng_of[i], null[i]);
+}
+
+static void run_block(const struct conv_table *ct)
+{
+	int i, j, end;
+
+	for (i = 0; i < N; i = end) {
+		for (end = i; end < N && end < i + BLOCK && rng_of[end] == rng_of[i]; end++)
+			;
+		conv_block(ct, PVV_C, rng_of[i], pv + i, v_pv, end - i);
+		conv_block(ct, PVV_NULL, rng_of[i], null + i, v_null, end - i);
+		for (j = i; j < end; j++)
+			out[j] = v_pv[j - i] - v_null[j - i];
+	}
+}
+
+static void report(const char *name, double t)
+{
+	double e, err = 0.0;
+	int i;
+
+	for (i = 0; i < N; i++) {
+		e = fabs(out[i] - ref[i]);
+		if (e > err)
+			err = e;
+	}
+	printf("  %-16s %10.1f %12.6f\n", name, N * RUNS / t / 1e6, err * 1e6);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *log = argc > 1 ? argv[1] : "../../moonlight_sept28.txt";
+	struct conv_table ct, cal;
+	comedi_polynomial_t p = {{0.0}, 0.0, 3};
+	comedi_range *r[3];
+	comedi_t *dev;
+	lsampl_t maxdata;
+	double t, e, err = 0.0;
+	int i, k, n, ai;
+
+	setenv("COMEDI_MOCK", "ads1220", 0);
+	setenv("COMEDI_MOCK_STATS", "0", 0);
+	dev = comedi_open("/dev/comedi0");
+	ai = dev ? comedi_find_subdevice_by_type(dev, COMEDI_SUBD_AI, 0) : -1;
+	if (ai < 0 || conv_init(&ct, dev, ai, NULL) < 0) {
+		comedi_perror("conv_bench");
+		return 1;
+	}
+	conv_trim(&ct, PVV_C, RANGE_2_048, ADOFFSET, ADGAIN1);
+	conv_trim(&ct, PVV_C, RANGE_0_512, ADOFFSET, ADGAIN2);
+	conv_trim(&ct, PVV_NULL, RANGE_2_048, 0.0, ADGAIN1);
+	conv_trim(&ct, PVV_NULL, RANGE_0_512, 0.0, ADGAIN2);
+	maxdata = comedi_get_maxdata(dev, ai, PVV_C);
+	for (i = 0; i < 3; i++)
+		r[i] = comedi_get_range(dev, ai, PVV_C, i);
+
+	n = load(log, r, maxdata);
+	if (n < 1) {
+		fprintf(stderr, "%s: no PVcal, PVp, null, time lines\n", log);
+		return 1;
+	}
+	for (i = n; i < N; i++) {
+		pv[i] = pv[i % n];
+		null[i] = null[i % n];
+		rng_of[i] = rng_of[i % n];
+	}
+	printf("%s: %d lines to %d samples, %s table\n", log, n, N, conv_src(&ct, PVV_C, RANGE_2_048));
+	printf("  %-16s %10s %12s\n", "path", "M samp/s", "max err uV");
+
+	t = now_s();
+	for (k = 0; k < RUNS; k++)
+		run_phys(r, maxdata);
+	t = now_s() - t;
+	printf("  %-16s %10.1f %12s\n", "comedi_to_phys", N * RUNS / t / 1e6, "-");
+	t = now_s();
+	for (k = 0; k < RUNS; k++)
+		run_one(&ct);
+	report("conv_one", now_s() - t);
+	t = now_s();
+	for (k = 0; k < RUNS; k++)
+		run_block(&ct);
+	report("conv_block", now_s() - t);
+
+	// a softcal cubic about mid scale on the 2.048 V range
+	p.expansion_origin = maxdata / 2.0;
+	p.coefficients[0] = 0.0012;
+	p.coefficients[1] = 4.096 / maxdata * 1.0007;
+	p.coefficients[2] = 3e-18;
+	p.coefficients[3] = -2e-25;
+	memset(&cal, 0, sizeof(cal));
+	conv_poly(&cal, 0, 0, &p, CONV_SOFTCAL);
+	t = now_s();
+	for (k = 0; k < RUNS; k++)
+		for (i = 0; i < N; i++)
+			ref[i] = comedi_to_physical(pv[i], &p);
+	t = now_s() - t;
+	printf("  %-16s %10.1f %12s\n", "to_physical", N * RUNS / t / 1e6, "-");
+	t = now_s();
+	for (k = 0; k < RUNS; k++)
+		for (i = 0; i < N; i += BLOCK)
+			conv_block(&cal, 0, 0, pv + i, out + i, BLOCK);
+	t = now_s() - t;
+	for (i = 0; i < N; i++) {
+		e = fabs(out[i] - ref[i]);
+		if (e > err)
+			err = e;
+	}
+	printf("  %-16s %10.1f %12.6f\n", "softcal block", N * RUNS / t / 1e6, err * 1e6);
+	comedi_close(dev);
+	return 0;
+}
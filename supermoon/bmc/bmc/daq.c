@@ -4,13 +4,14 @@
 #include <stdint.h>
 #include "daq.h"
 
-#define OVER_SAMPLE		1
+#define DEC_ORDER		1	// CIC order, 1 is the mean of the burst
 
 int subdev_ai = 0; /* change this to your input subdevice */
 int chan_ai = 0; /* change this to your channel */
 int range_ai = 0; /* more on this later */
 int aref_ai = AREF_GROUND; /* more on this later */
 int maxdata_ai, ranges_ai, channels_ai;
+int over_sample = 1; /* conversions per result, set before init_daq */
 
 int subdev_dio = 0; /* change this to your input subdevice */
 int chan_dio = 0; /* change this to your channel */
@@ -20,12 +21,19 @@ int maxdata_dio, ranges_dio, channels_dio, datain_dio;
 comedi_t *it;
 int8_t ADC_OPEN = FALSE, DIO_OPEN = FALSE, ADC_ERROR = FALSE, DEV_OPEN = FALSE, DIO_ERROR = FALSE;
 int8_t comedi_dev[] = "/dev/comedi0";
+struct filter_bank daq_filter;
+struct decimator daq_dec[LPCHANC];
+struct conv_table daq_conv;
+static int dec_range[LPCHANC];
 
 int init_daq(void)
 {
-	int i = 0, range_index = 0;
+	int i = 0, range_index = 0, bits, chan;
 	comedi_range *ad_range;
 
+	fb_init(&daq_filter, LPCHANC);
+	fb_pole(&daq_filter, 0, -1, LP_FAST);
+
 	if (!DEV_OPEN) {
 		it = comedi_open(comedi_dev);
 		if (it == NULL) {
@@ -50,6 +58,17 @@ int init_daq(void)
 	printf("Analog  Channels %i ", channels_ai);
 	maxdata_ai = comedi_get_maxdata(it, subdev_ai, i);
 	printf("Maxdata %i ", maxdata_ai);
+	for (bits = 1; bits < 32 && (1u << bits) - 1 < (unsigned) maxdata_ai; bits++)
+		;
+	if (over_sample < 1)
+		over_sample = 1;
+	if (over_sample > OVER_SAMPLE_MAX)
+		over_sample = OVER_SAMPLE_MAX;
+	for (chan = 0; chan < LPCHANC; chan++) {
+		dec_cic(&daq_dec[chan], over_sample, DEC_ORDER, bits);
+		dec_range[chan] = -1;
+	}
+	printf("Oversample %i ", over_sample);
 	ranges_ai = comedi_get_n_ranges(it, subdev_ai, i);
 	printf("Ranges %i ", ranges_ai);
 
@@ -58,7 +77,18 @@ int init_daq(void)
 		printf(": range %i, min = %.4f, max = %.4f ", range_index,
 		ad_range->min, ad_range->max);
 	}
+	if (conv_init(&daq_conv, it, subdev_ai, NULL) < 0)
+		return -1;
+	printf("Conversion %s ", conv_src(&daq_conv, 0, 0));
 	printf("\n");
+	/*
+	 * PVcal is PV - null, (PV - null + ADOFFSET) * ADGAIN with ADOFFSET on
+	 * the PV input and the gain of the range on both
+	 */
+	conv_trim(&daq_conv, PVV_C, RANGE_2_048, ADOFFSET, ADGAIN1);
+	conv_trim(&daq_conv, PVV_C, RANGE_0_512, ADOFFSET, ADGAIN2);
+	conv_trim(&daq_conv, PVV_NULL, RANGE_2_048, 0.0, ADGAIN1);
+	conv_trim(&daq_conv, PVV_NULL, RANGE_0_512, 0.0, ADGAIN2);
 
 	ADC_OPEN = TRUE;
 	comedi_set_global_oor_behavior(COMEDI_OOR_NUMBER);
@@ -78,13 +108,18 @@ int adc_range(double min_range, double max_range)
 
 double get_adc_volts(int chan, int diff, int range)
 {
-	lsampl_t data[OVER_SAMPLE]; // adc burst data buffer
-	int retval;
-	comedi_range *ad_range;
+	lsampl_t data[OVER_SAMPLE_MAX]; // adc burst data buffer
+	double volts[OVER_SAMPLE_MAX], code = 0.0, v;
+	int retval, i, order;
 	comedi_insn daq_insn;
 
 	ADC_ERROR = FALSE; // global fault flag
 
+	if (chan < 0 || chan >= LPCHANC) { // no raw slot or decimator for it
+		ADC_ERROR = TRUE;
+		return 0.0;
+	}
+
 	if (diff == TRUE) {
 		aref_ai = AREF_DIFF;
 	} else {
@@ -95,7 +130,7 @@ double get_adc_volts(int chan, int diff, int range)
 	daq_insn.subdev = subdev_ai;
 	daq_insn.chanspec = CR_PACK(chan, range, aref_ai);
 	daq_insn.insn = INSN_READ;
-	daq_insn.n = OVER_SAMPLE;
+	daq_insn.n = over_sample;
 	daq_insn.data = data;
 
 	retval = comedi_do_insn(it, &daq_insn); // send one instruction to the driver
@@ -106,9 +141,34 @@ double get_adc_volts(int chan, int diff, int range)
 		return 0.0;
 	}
 
-	ad_range = comedi_get_range(it, subdev_ai, chan, range);
-	bmc.raw[chan] = data[0];
-	return comedi_to_phys(data[0], ad_range, maxdata_ai); // return the double result
+	if (dec_range[chan] != range) { // codes of another range don't mix
+		dec_reset(&daq_dec[chan]);
+		dec_range[chan] = range;
+	}
+	if (dec_run(&daq_dec[chan], data, over_sample, &code) < 1)
+		code = data[over_sample - 1]; // no decimator set up
+	bmc.raw[chan] = (lsampl_t) (code + 0.5);
+	order = conv_order(&daq_conv, chan, range);
+	if (!order) { // no table entry, conv_one would give NAN
+		ADC_ERROR = TRUE;
+		return 0.0;
+	}
+	// a curved calibration of the mean code is not the mean voltage, convert the burst
+	if (order > 1 && conv_block(&daq_conv, chan, range, data, volts, over_sample) == over_sample) {
+		for (v = 0.0, i = 0; i < over_sample; i++)
+			v += volts[i];
+		return v / over_sample;
+	}
+	// comedi_to_phys takes whole codes, the table keeps the fraction
+	return conv_one(&daq_conv, chan, range, code);
+}
+
+/* effective bits of the oversampled chan, 0 when not running */
+double get_adc_bits(int chan)
+{
+	if (chan < 0 || chan >= LPCHANC)
+		return 0.0;
+	return dec_bits(&daq_dec[chan]);
 }
 
 int get_dio_bit(int chan)
@@ -182,10 +242,8 @@ int get_data_sample(void)
 	if (HAVE_AI) {
 		if (bmc.pv_voltage < 0.5) {
 			set_range = RANGE_0_512;
-			gain_adj = ADGAIN2;
 		} else {
 			set_range = RANGE_2_048;
-			gain_adj = ADGAIN1;
 		}
 		if (bmc.pv_voltage < 0.0) bmc.pv_voltage = 0.0;
 
@@ -194,13 +252,13 @@ int get_data_sample(void)
 			if (RAW_DATA) {
 				if (pv_stable > PVV_NULL_TIME_RAW) first_run = FALSE;
 			}
-			bmc.pv_voltage_null = lp_filter(get_adc_volts(PVV_NULL, TRUE, set_range), PVV_NULL, FALSE);
+			bmc.pv_voltage_null = fb_put(&daq_filter, PVV_NULL, get_adc_volts(PVV_NULL, TRUE, set_range));
 			;
 		} else {
 			if (RAW_DATA_NOFIL) {
 				bmc.pv_voltage = get_adc_volts(PVV_C, TRUE, set_range); // read PV voltage on DIFF channels, no filter
 			} else {
-				bmc.pv_voltage = lp_filter(get_adc_volts(PVV_C, TRUE, set_range), PVV_C, FALSE); // read PV voltage on DIFF channels
+				bmc.pv_voltage = fb_put(&daq_filter, PVV_C, get_adc_volts(PVV_C, TRUE, set_range)); // read PV voltage on DIFF channels
 			}
 		}
 	} else {
@@ -230,24 +288,3 @@ int get_data_sample(void)
 	}
 	return 0;
 }
-
-double lp_filter(double new, int bn, int slow) // low pass filter, slow rate of change for new, LPCHANC channels, slow/fast select (-1) to zero channel
-{
-	static double smooth[LPCHANC] = {0};
-	double lp_speed, lp_x;
-
-	if ((bn >= LPCHANC) || (bn < 0)) // check for proper array position
-		return new;
-	if (slow) {
-		lp_speed = 0.050;
-	} else {
-		lp_speed = 0.125;
-	}
-	lp_x = ((smooth[bn]*100.0) + (((new * 100.0)-(smooth[bn]*100.0)) * lp_speed)) / 100.0;
-	smooth[bn] = lp_x;
-	if (slow == (-1)) { // reset and return zero
-		lp_x = 0.0;
-		smooth[bn] = 0.0;
-	}
-	return lp_x;
-}
\ No newline at end of file
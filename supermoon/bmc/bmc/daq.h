@@ -29,15 +29,21 @@ extern "C" {
 
 
 #define LPCHANC        16
+#define LP_FAST		0.125	// single pole filter coefficients
+#define LP_SLOW		0.050
 
 #define RANGE_2_048   0
 #define RANGE_1_024   1
 #define RANGE_0_512   2
 #define ADGAIN1		1.0002
 #define ADGAIN2		1.0003   
+#define ADOFFSET	-0.0000025
+#define OVER_SAMPLE_MAX	64	// most conversions in one comedi burst
 
 #include <comedilib.h>
 #include "bmc.h"
+#include "filter.h"
+#include "conv.h"
 
     int subdev_ai; /* change this to your input subdevice */
     int chan_ai; /* change this to your channel */
@@ -59,15 +65,19 @@ extern "C" {
     extern struct didata datain;
     extern struct dodata dataout;
     extern unsigned char HAVE_DIO, HAVE_AI;
+    extern struct filter_bank daq_filter; // LPCHANC channels, a LP_FAST pole
+    extern struct decimator daq_dec[LPCHANC]; // oversampling of each AI channel
+    extern struct conv_table daq_conv; // codes to volts, ADOFFSET and ADGAIN in
+    extern int over_sample; // conversions per result, the driver paces them on the ADS1220
 
     int init_daq(void);
     int init_dio(void);
     int adc_range(double, double);
     double get_adc_volts(int, int, int);
+    double get_adc_bits(int);
     int get_dio_bit(int);
     int put_dio_bit(int, int);
     int get_data_sample(void);
-    double lp_filter(double, int, int), gain_adj;
 #ifdef	__cplusplus
 }
 #endif
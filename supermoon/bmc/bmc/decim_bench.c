@@ -0,0 +1,98 @@
+/*
+ * oversampling decimator check and benchmark
+ *
+ * cc -O3 -o decim_bench decim_bench.c filter.c -lm
+ * ./decim_bench [input rate]
+ *
+ * Makes 24 bit ADC codes of a DC level that steps to a new fraction of an
+ * LSB every SEG conversions, adds gaussian noise and rounds, then decimates
+ * them in blocks like the comedi bursts. For each noise level, filter and
+ * ratio it prints the output rate, the effective bits dec_bits reports, the
+ * bits measured from the output error against the true level (24 plus the
+ * log2 of the quantization rms over the error rms) and the samples/s.
+ * Outputs within the settling time after a step are not counted.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "filter.h"
+
+#define BITS	24
+#define N	(1 << 22)	// conversions per run
+#define SEG	8192	// conversions per DC level
+#define BURST	16
+
+static unsigned int code[N];
+static double level[N], out[N];
+
+static double gauss(void)
+{
+	double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+	return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void run(const char *name, struct decimator *d, int settle, double rate)
+{
+	int i, n = 0, k;
+	long m = 0;
+	double t, e, err = 0.0;
+
+	t = now_s();
+	for (i = 0; i < N; i += BURST)
+		n += dec_run(d, code + i, BURST, out + n);
+	t = now_s() - t;
+	for (k = 0; k < n; k++) {
+		i = (k + 1) * d->ratio - 1; // last input of output k
+		if (i % SEG < settle) // within a step
+			continue;
+		e = out[k] - level[i];
+		err += e * e;
+		m++;
+	}
+	err = sqrt(err / m);
+	printf("  %-10s ratio %4d  %9.1f S/s  reported %5.2f bits  measured %5.2f bits  %7.1f M samples/s\n",
+		name, d->ratio, rate / d->ratio, dec_bits(d), BITS + log2(sqrt(1.0 / 12.0) / err), N / t / 1e6);
+}
+
+int main(int argc, char *argv[])
+{
+	static const double noise[] = {0.1, 0.5, 2.0};
+	static const int ratio[] = {4, 16, 64, 256};
+	double rate = argc > 1 ? atof(argv[1]) : 2000.0, h[DEC_TAPS_MAX];
+	struct decimator d;
+	int i, j, r, k;
+
+	srand(1);
+	for (j = 0; j < 3; j++) {
+		for (i = 0; i < N; i++) {
+			if (i % SEG == 0)
+				level[i] = (1 << 20) + rand() / (RAND_MAX + 1.0);
+			else
+				level[i] = level[i - 1];
+			code[i] = (unsigned int) floor(level[i] + noise[j] * gauss() + 0.5);
+		}
+		printf("noise %.1f LSB rms, %.0f S/s in\n", noise[j], rate);
+		for (r = 0; r < 4; r++) {
+			dec_cic(&d, ratio[r], 1, BITS);
+			run("CIC 1", &d, ratio[r], rate);
+			dec_cic(&d, ratio[r], 3, BITS);
+			run("CIC 3", &d, 4 * ratio[r], rate);
+			k = 2 * ratio[r] < DEC_TAPS_MAX ? 2 * ratio[r] : DEC_TAPS_MAX;
+			for (i = 0; i < k; i++) // Hann window
+				h[i] = 0.5 - 0.5 * cos(2.0 * M_PI * (i + 1) / (k + 1));
+			dec_fir(&d, ratio[r], h, k, BITS);
+			run("FIR hann", &d, k + ratio[r], rate);
+		}
+	}
+	return 0;
+}
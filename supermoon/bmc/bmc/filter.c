@@ -0,0 +1,420 @@
+/*
+ * Multi-channel filter bank for the DAQ samples
+ *
+ * A bank runs up to FB_STAGES stages on each of its channels, a stage is a
+ * single pole low pass, a biquad or a moving average with its own
+ * coefficients per channel. All state is in the struct, so banks for
+ * different sample streams don't share anything.
+ * fb_run takes blocks of interleaved frames (chan 0, 1 .. chans-1, chan 0 ..)
+ * and runs each frame through the stages with the channel loop innermost.
+ * There are no intrinsics, the pole and biquad loops are left to the
+ * compiler's auto-vectorizer (gcc -O3, -fopt-info-vec lists them), the
+ * moving average is scalar. fb_put filters one sample of one
+ * channel for code that reads the channels one at a time.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "filter.h"
+
+int fb_init(struct filter_bank *fb, int chans)
+{
+	memset(fb, 0, sizeof(struct filter_bank));
+	if (chans < 1 || chans > FB_CHANS)
+		return -1;
+	fb->chans = chans;
+	return 0;
+}
+
+/* stage s as type, stages are used in order from 0 without gaps */
+static struct fb_stage *fb_stage(struct filter_bank *fb, int s, int type)
+{
+	struct fb_stage *st;
+
+	if (s < 0 || s >= FB_STAGES || s > fb->stages)
+		return NULL;
+	if (s == fb->stages)
+		fb->stages++;
+	st = &fb->st[s];
+	if (st->type != type) {
+		memset(st, 0, sizeof(struct fb_stage));
+		st->type = type;
+	}
+	return st;
+}
+
+/* channel range for chan, -1 is all channels */
+static int fb_chans(struct filter_bank *fb, int chan, int *first)
+{
+	if (chan < 0) {
+		*first = 0;
+		return fb->chans;
+	}
+	*first = chan;
+	return chan < fb->chans ? chan + 1 : -1;
+}
+
+/* single pole low pass y += k * (x - y), k 0.0 to 1.0, lp_filter used 0.125 */
+int fb_pole(struct filter_bank *fb, int s, int chan, double k)
+{
+	struct fb_stage *st = fb_stage(fb, s, FB_POLE);
+	int c, end = fb_chans(fb, chan, &c);
+
+	if (!st || end < 0)
+		return -1;
+	for (; c < end; c++)
+		st->b0[c] = k;
+	return 0;
+}
+
+/* y = b0 x + b1 x[-1] + b2 x[-2] - a1 y[-1] - a2 y[-2], a0 normalized to 1 */
+int fb_biquad(struct filter_bank *fb, int s, int chan, double b0, double b1, double b2, double a1, double a2)
+{
+	struct fb_stage *st = fb_stage(fb, s, FB_BIQUAD);
+	int c, end = fb_chans(fb, chan, &c);
+
+	if (!st || end < 0)
+		return -1;
+	for (; c < end; c++) {
+		st->b0[c] = b0;
+		st->b1[c] = b1;
+		st->b2[c] = b2;
+		st->a1[c] = a1;
+		st->a2[c] = a2;
+	}
+	return 0;
+}
+
+/* mean of the last len samples on all channels, the mean of fewer until len came in */
+int fb_mavg(struct filter_bank *fb, int s, int len)
+{
+	struct fb_stage *st;
+
+	if (len < 1 || len > FB_MAVG_MAX || !(st = fb_stage(fb, s, FB_MAVG)))
+		return -1;
+	memset(st, 0, sizeof(struct fb_stage));
+	st->type = FB_MAVG;
+	st->len = len;
+	return 0;
+}
+
+/* set the state of chan (-1 all) as if value had been the input for a long time */
+void fb_reset(struct filter_bank *fb, int chan, double value)
+{
+	struct fb_stage *st;
+	int s, c, i, first, end = fb_chans(fb, chan, &first);
+	double x, y, g;
+
+	for (c = first; c < end; c++) {
+		x = value; // the input of each stage is the steady output of the one before
+		for (s = 0; s < fb->stages; s++) {
+			st = &fb->st[s];
+			switch (st->type) {
+			case FB_POLE:
+				st->z1[c] = x;
+				break;
+			case FB_BIQUAD:
+				g = 1.0 + st->a1[c] + st->a2[c];
+				y = g != 0.0 ? x * (st->b0[c] + st->b1[c] + st->b2[c]) / g : 0.0;
+				st->z1[c] = y - st->b0[c] * x;
+				st->z2[c] = st->b2[c] * x - st->a2[c] * y;
+				x = y;
+				break;
+			case FB_MAVG: // a full history of x, the mean is x from the first sample
+				for (i = 0; i < st->len; i++)
+					st->hist[c][i] = x;
+				st->z1[c] = x * st->len;
+				st->pos[c] = 0;
+				st->fill[c] = st->len;
+				break;
+			}
+		}
+	}
+}
+
+static double fb_mavg_put(struct fb_stage *st, int c, double x)
+{
+	double *h = st->hist[c];
+	int p = st->pos[c], i;
+
+	if (st->fill[c] < st->len) {
+		st->fill[c]++;
+		st->z1[c] += x;
+	} else {
+		st->z1[c] += x - h[p];
+	}
+	h[p] = x;
+	if (++p == st->len) {
+		p = 0;
+		if (st->fill[c] == st->len) { // new sum each round, no rounding drift
+			for (st->z1[c] = 0.0, i = 0; i < st->len; i++)
+				st->z1[c] += h[i];
+		}
+	}
+	st->pos[c] = p;
+	return st->z1[c] / st->fill[c];
+}
+
+/* one frame of ch channels through stage st, in place */
+static void fb_frame(struct fb_stage *st, double *restrict x, int ch)
+{
+	int c;
+	double y;
+
+	switch (st->type) {
+	case FB_POLE:
+		for (c = 0; c < ch; c++)
+			x[c] = st->z1[c] += st->b0[c] * (x[c] - st->z1[c]);
+		break;
+	case FB_BIQUAD:
+		for (c = 0; c < ch; c++) {
+			y = st->b0[c] * x[c] + st->z1[c];
+			st->z1[c] = st->b1[c] * x[c] - st->a1[c] * y + st->z2[c];
+			st->z2[c] = st->b2[c] * x[c] - st->a2[c] * y;
+			x[c] = y;
+		}
+		break;
+	case FB_MAVG:
+		for (c = 0; c < ch; c++)
+			x[c] = fb_mavg_put(st, c, x[c]);
+		break;
+	}
+}
+
+/* filter n frames of interleaved samples, out may be in */
+void fb_run(struct filter_bank *fb, const double *in, double *out, int n)
+{
+	int i, s, ch = fb->chans;
+
+	for (i = 0; i < n; i++, in += ch, out += ch) {
+		if (out != in)
+			memcpy(out, in, ch * sizeof(double));
+		for (s = 0; s < fb->stages; s++)
+			fb_frame(&fb->st[s], out, ch);
+	}
+}
+
+/* filter one sample of chan, an out of range chan returns x */
+double fb_put(struct filter_bank *fb, int chan, double x)
+{
+	struct fb_stage *st;
+	int s;
+	double y;
+
+	if (chan < 0 || chan >= fb->chans)
+		return x;
+	for (s = 0; s < fb->stages; s++) {
+		st = &fb->st[s];
+		switch (st->type) {
+		case FB_POLE:
+			x = st->z1[chan] += st->b0[chan] * (x - st->z1[chan]);
+			break;
+		case FB_BIQUAD:
+			y = st->b0[chan] * x + st->z1[chan];
+			st->z1[chan] = st->b1[chan] * x - st->a1[chan] * y + st->z2[chan];
+			st->z2[chan] = st->b2[chan] * x - st->a2[chan] * y;
+			x = y;
+			break;
+		case FB_MAVG:
+			x = fb_mavg_put(st, chan, x);
+			break;
+		}
+	}
+	return x;
+}
+
+/*
+ * Oversampling decimator
+ *
+ * dec_run takes raw codes and gives one output code per ratio input codes,
+ * keeping its state between calls so bursts of any length can be fed in.
+ * A CIC of order M is M integrators at the input rate and M combs at the
+ * output rate on 64 bit integers, exact for any input, ratio^order wide
+ * words must fit so bits + order * log2(ratio) stays under 63.
+ * Order 1 is the plain mean of each ratio codes and has no settling, higher
+ * orders reject more of the aliases but need order outputs to settle after
+ * a reset. DEC_FIR runs the given taps (DC gain is normalized to 1) once
+ * per output over the last taps codes.
+ * Averaging only adds resolution when the input moves by about an LSB or
+ * more between conversions, from ADC noise or added dither. dec_run keeps
+ * the unbiased variance of the codes behind each output, averaged over about
+ * the last DEC_VAR_DOF codes as the few codes of one output give too rough
+ * an estimate. Below half an LSB rms
+ * dec_bits gives the plain ADC bits, else the noise limited input bits
+ * (ADC bits less log2 of the rms over the quantization rms) plus the noise
+ * gain of the filter, 0.5 * log2(ratio) for order 1. Signal movement within
+ * the codes of one output counts as noise.
+ */
+
+/* log2 for x >= 1 without libm, to about 1e-6 */
+static double dec_log2(double x)
+{
+	double r = 0.0, f = 1.0;
+	int i;
+
+	while (x >= 2.0) {
+		x /= 2.0;
+		r += 1.0;
+	}
+	for (i = 0; i < 20; i++) { // square until it doubles, one bit each
+		f /= 2.0;
+		x *= x;
+		if (x >= 2.0) {
+			x /= 2.0;
+			r += f;
+		}
+	}
+	return r;
+}
+
+/* resolution gain of taps h[0..n-1] on white noise, 0.5 * log2(sum(h)^2 / sum(h^2)) */
+static double dec_gain_bits(const double *h, int n)
+{
+	double s = 0.0, s2 = 0.0;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		s += h[i];
+		s2 += h[i] * h[i];
+	}
+	return s2 > 0.0 && s * s >= s2 ? 0.5 * dec_log2(s * s / s2) : 0.0;
+}
+
+void dec_reset(struct decimator *d)
+{
+	memset(d->integ, 0, sizeof(d->integ));
+	memset(d->comb, 0, sizeof(d->comb));
+	memset(d->x, 0, sizeof(d->x));
+	d->phase = 0;
+	d->pos = 0;
+	d->sum = d->sum2 = d->var = 0.0;
+	d->outputs = 0;
+	d->dof = 0;
+}
+
+/* CIC of order 1 to DEC_ORDER_MAX decimating by ratio, bits is the ADC resolution */
+int dec_cic(struct decimator *d, int ratio, int order, int bits)
+{
+	double *h;
+	int i, k, n;
+
+	memset(d, 0, sizeof(struct decimator));
+	if (ratio < 1 || order < 1 || order > DEC_ORDER_MAX || bits < 1)
+		return -1;
+	for (i = 0, n = 1; n < ratio; i++)
+		n *= 2;
+	if (bits + order * i > 63 || order * (ratio - 1) + 1 > DEC_ORDER_MAX * 1024)
+		return -1;
+	h = malloc((order * (ratio - 1) + 1) * sizeof(double)); // per call, decimators set up at once don't share it
+	if (!h)
+		return -1;
+	d->type = DEC_CIC;
+	d->ratio = ratio;
+	d->order = order;
+	d->bits = bits;
+	d->scale = 1.0;
+	for (i = 0; i < order; i++)
+		d->scale /= ratio;
+
+	/*
+	 * impulse response, the box of ratio ones convolved order times, in
+	 * place: the running sum, then each point less the sum ratio back
+	 */
+	for (n = 1, h[0] = 1.0, k = 0; k < order; k++) {
+		for (i = 1; i < n; i++)
+			h[i] += h[i - 1];
+		for (i = n; i < n + ratio - 1; i++)
+			h[i] = h[n - 1];
+		n += ratio - 1;
+		for (i = n - 1; i >= ratio; i--)
+			h[i] -= h[i - ratio];
+	}
+	d->gain_bits = dec_gain_bits(h, n);
+	free(h);
+	return 0;
+}
+
+/* FIR with taps h[0..taps-1], h[0] on the newest code, decimating by ratio */
+int dec_fir(struct decimator *d, int ratio, const double *h, int taps, int bits)
+{
+	double s = 0.0;
+	int i;
+
+	memset(d, 0, sizeof(struct decimator));
+	if (ratio < 1 || taps < 1 || taps > DEC_TAPS_MAX || bits < 1)
+		return -1;
+	for (i = 0; i < taps; i++)
+		s += h[i];
+	if (s == 0.0)
+		return -1;
+	d->type = DEC_FIR;
+	d->ratio = ratio;
+	d->taps = taps;
+	d->bits = bits;
+	for (i = 0; i < taps; i++)
+		d->h[i] = h[i] / s;
+	d->gain_bits = dec_gain_bits(d->h, taps);
+	return 0;
+}
+
+/* decimate n codes, out gets up to n / ratio + 1 codes, returns how many */
+int dec_run(struct decimator *d, const unsigned int *in, int n, double *out)
+{
+	unsigned long long v, t;
+	double x, y, m, v2;
+	int i, k, j, cnt = 0;
+
+	if (!d->type)
+		return 0;
+	for (i = 0; i < n; i++) {
+		x = in[i];
+		d->sum += x;
+		d->sum2 += x * x;
+		if (d->type == DEC_CIC) {
+			d->integ[0] += in[i];
+			for (k = 1; k < d->order; k++)
+				d->integ[k] += d->integ[k - 1];
+		} else {
+			d->x[d->pos] = x;
+			if (++d->pos == d->taps)
+				d->pos = 0;
+		}
+		if (++d->phase < d->ratio)
+			continue;
+		d->phase = 0;
+		if (d->type == DEC_CIC) {
+			v = d->integ[d->order - 1];
+			for (k = 0; k < d->order; k++) {
+				t = v;
+				v -= d->comb[k];
+				d->comb[k] = t;
+			}
+			y = (double) v * d->scale;
+		} else {
+			for (y = 0.0, k = 0, j = d->pos; k < d->taps; k++) {
+				j = j ? j - 1 : d->taps - 1;
+				y += d->h[k] * d->x[j];
+			}
+		}
+		// unbiased variance of this output's codes, weighted by its ratio - 1
+		m = d->sum / d->ratio;
+		v2 = d->ratio > 1 ? (d->sum2 - m * d->sum) / (d->ratio - 1) : 0.0;
+		v2 = v2 > 0.0 ? v2 : 0.0;
+		d->sum = d->sum2 = 0.0;
+		d->outputs++;
+		d->dof += d->ratio - 1;
+		if (d->dof > DEC_VAR_DOF)
+			d->dof = DEC_VAR_DOF;
+		if (d->dof)
+			d->var += (v2 - d->var) * (d->ratio - 1) / d->dof;
+		out[cnt++] = y;
+	}
+	return cnt;
+}
+
+/* effective bits of the outputs, see above */
+double dec_bits(struct decimator *d)
+{
+	if (!d->outputs || d->var < 0.25) // half an LSB rms
+		return d->bits;
+	return d->bits - 0.5 * dec_log2(d->var * 12.0) + d->gain_bits;
+}
@@ -0,0 +1,80 @@
+/*
+ * File:   filter.h
+ * Author: root
+ *
+ * Multi-channel filter bank and oversampling decimator for the DAQ samples
+ */
+
+#ifndef FILTER_H
+#define	FILTER_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define FB_CHANS	16	// channels in one bank
+#define FB_STAGES	4	// stages per channel, run in order
+#define FB_MAVG_MAX	64	// longest moving average
+
+#define FB_NONE		0
+#define FB_POLE		1	// y += k * (x - y)
+#define FB_BIQUAD	2	// direct form II transposed
+#define FB_MAVG		3	// mean of the last len samples
+
+	/*
+	 * coefficients and state are arrays over the channels so a frame of
+	 * interleaved samples runs through a stage as one loop the compiler can
+	 * vectorize
+	 */
+	struct fb_stage {
+		int type, len;
+		double b0[FB_CHANS], b1[FB_CHANS], b2[FB_CHANS], a1[FB_CHANS], a2[FB_CHANS];
+		double z1[FB_CHANS], z2[FB_CHANS];
+		int pos[FB_CHANS], fill[FB_CHANS];
+		double hist[FB_CHANS][FB_MAVG_MAX];
+	};
+
+	struct filter_bank {
+		int chans, stages;
+		struct fb_stage st[FB_STAGES];
+	};
+
+#define DEC_CIC		1	// cascaded integrator comb, order 1 is the block mean
+#define DEC_FIR		2	// FIR taps computed once per output
+#define DEC_ORDER_MAX	4
+#define DEC_TAPS_MAX	64
+#define DEC_VAR_DOF	1024	// codes the input variance is averaged over
+
+	/*
+	 * one channel of raw ADC codes in, one code (with fraction) out for every
+	 * ratio codes, run on blocks of any length
+	 */
+	struct decimator {
+		int type, ratio, order, taps, phase, pos, bits, dof;
+		unsigned long long integ[DEC_ORDER_MAX], comb[DEC_ORDER_MAX]; // wrap around is fine
+		double scale, gain_bits; // 1/ratio^order, resolution gain with dither
+		double h[DEC_TAPS_MAX], x[DEC_TAPS_MAX];
+		double sum, sum2, var; // input variance over the last codes, codes^2
+		unsigned long outputs;
+	};
+
+	int fb_init(struct filter_bank *, int);
+	int fb_pole(struct filter_bank *, int, int, double);
+	int fb_biquad(struct filter_bank *, int, int, double, double, double, double, double);
+	int fb_mavg(struct filter_bank *, int, int);
+	void fb_reset(struct filter_bank *, int, double);
+	void fb_run(struct filter_bank *, const double *, double *, int);
+	double fb_put(struct filter_bank *, int, double);
+
+	int dec_cic(struct decimator *, int, int, int);
+	int dec_fir(struct decimator *, int, const double *, int, int);
+	void dec_reset(struct decimator *);
+	int dec_run(struct decimator *, const unsigned int *, int, double *);
+	double dec_bits(struct decimator *);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* FILTER_H */
+
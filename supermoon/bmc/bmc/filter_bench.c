@@ -0,0 +1,134 @@
+/*
+ * filter bank check and benchmark
+ *
+ * cc -O3 -march=native -o filter_bench filter_bench.c filter.c
+ * ./filter_bench [frames]
+ *
+ * Runs random samples on LPCHANC channels through the lp_filter() daq.c had
+ * and through a filter bank with the same pole, one sample at a time with
+ * fb_put and as interleaved blocks with fb_run, and prints the largest
+ * difference and samples/s of each. The old filter scaled by 100.0 and back,
+ * so the results agree to rounding, not bit for bit.
+ * Then a biquad, pole and moving average bank is reset to a level and fed
+ * that level, every output must be the biquad DC gain times the level from
+ * the first frame on.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "filter.h"
+
+#define LPCHANC		16
+#define BLOCK		256	// frames per fb_run call
+
+/* the daq.c filter, kept here as the reference */
+static double lp_filter(double new, int bn, int slow)
+{
+	static double smooth[LPCHANC] = {0};
+	double lp_speed, lp_x;
+
+	if ((bn >= LPCHANC) || (bn < 0)) // check for proper array position
+		return new;
+	if (slow) {
+		lp_speed = 0.050;
+	} else {
+		lp_speed = 0.125;
+	}
+	lp_x = ((smooth[bn]*100.0) + (((new * 100.0)-(smooth[bn]*100.0)) * lp_speed)) / 100.0;
+	smooth[bn] = lp_x;
+	if (slow == (-1)) { // reset and return zero
+		lp_x = 0.0;
+		smooth[bn] = 0.0;
+	}
+	return lp_x;
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+	static struct filter_bank put, run;
+	int frames = argc > 1 ? atoi(argv[1]) : 1000000, i, c, n;
+	double *in, *ref, *out, d, err = 0.0, t, sink = 0.0;
+
+	frames = (frames + BLOCK - 1) / BLOCK * BLOCK;
+	in = malloc(frames * LPCHANC * sizeof(double));
+	ref = malloc(frames * LPCHANC * sizeof(double));
+	out = malloc(frames * LPCHANC * sizeof(double));
+	if (!in || !ref || !out)
+		return 1;
+	srand(1);
+	for (i = 0; i < frames * LPCHANC; i++) // 0 to 2.048 V with noise, like the PV channels
+		in[i] = 2.048 * rand() / RAND_MAX;
+
+	fb_init(&put, LPCHANC);
+	fb_pole(&put, 0, -1, 0.125);
+	fb_init(&run, LPCHANC);
+	fb_pole(&run, 0, -1, 0.125);
+
+	t = now_s();
+	for (i = 0; i < frames; i++)
+		for (c = 0; c < LPCHANC; c++)
+			ref[i * LPCHANC + c] = lp_filter(in[i * LPCHANC + c], c, 0);
+	t = now_s() - t;
+	printf("lp_filter  %8.1f M samples/s\n", frames * LPCHANC / t / 1e6);
+
+	t = now_s();
+	for (i = 0; i < frames; i++)
+		for (c = 0; c < LPCHANC; c++)
+			out[i * LPCHANC + c] = fb_put(&put, c, in[i * LPCHANC + c]);
+	t = now_s() - t;
+	for (i = 0; i < frames * LPCHANC; i++)
+		if ((d = fabs(out[i] - ref[i])) > err)
+			err = d;
+	printf("fb_put     %8.1f M samples/s, max difference %.3g\n", frames * LPCHANC / t / 1e6, err);
+
+	t = now_s();
+	for (i = 0; i < frames; i += BLOCK)
+		fb_run(&run, in + i * LPCHANC, out + i * LPCHANC, BLOCK);
+	t = now_s() - t;
+	for (err = 0.0, i = 0; i < frames * LPCHANC; i++)
+		if ((d = fabs(out[i] - ref[i])) > err)
+			err = d;
+	printf("fb_run     %8.1f M samples/s, max difference %.3g\n", frames * LPCHANC / t / 1e6, err);
+
+	/* fb_reset gives the steady state of every stage type */
+	fb_init(&run, LPCHANC);
+	fb_biquad(&run, 0, -1, 0.0675, 0.135, 0.0675, -1.143, 0.4128);
+	fb_pole(&run, 1, -1, 0.125);
+	fb_mavg(&run, 2, 16);
+	fb_reset(&run, -1, 1.5);
+	for (i = 0; i < BLOCK * LPCHANC; i++)
+		in[i] = 1.5;
+	fb_run(&run, in, out, BLOCK);
+	t = 1.5 * (0.0675 + 0.135 + 0.0675) / (1.0 - 1.143 + 0.4128);
+	for (err = 0.0, i = 0; i < BLOCK * LPCHANC; i++)
+		if ((d = fabs(out[i] - t)) > err)
+			err = d;
+	printf("fb_reset   max step from the level %.3g\n", err);
+
+	/* the other stages, for speed only */
+	for (n = 1; n <= 3; n++) {
+		fb_init(&run, LPCHANC);
+		fb_biquad(&run, 0, -1, 0.0675, 0.135, 0.0675, -1.143, 0.4128); // 0.1 fs low pass
+		if (n > 1)
+			fb_pole(&run, 1, -1, 0.125);
+		if (n > 2)
+			fb_mavg(&run, 2, 16);
+		t = now_s();
+		for (i = 0; i < frames; i += BLOCK)
+			fb_run(&run, in + i * LPCHANC, out + i * LPCHANC, BLOCK);
+		t = now_s() - t;
+		sink += out[frames * LPCHANC - 1];
+		printf("%-10s %8.1f M samples/s\n", n == 1 ? "biquad" : n == 2 ? "+pole" : "+mavg 16",
+			frames * LPCHANC / t / 1e6);
+	}
+	return sink != sink || err > 1e-9;
+}
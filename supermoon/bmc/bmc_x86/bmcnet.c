@@ -1,58 +1,268 @@
-
 /*
     Remote DAQ client example using sockets
+
+    One TCP connection is kept open to the server. bmc_client only queues
+    the message and sends what the socket takes without waiting, so a slow
+    or missing server never stalls the acquisition loop.
+    Messages go out newline terminated, batched into one send when
+    BMC_BATCH bytes are queued or the oldest message waited BMC_LINGER_MS.
+    A lost connection is retried after BMC_RETRY_MS, doubling up to
+    BMC_RETRY_MAX_MS, messages keep queueing meanwhile and new ones are
+    dropped when the queue is full. Server replies are read and dropped.
+    The queue is an RB_ ring from the shared ringbuf.h, a send takes both
+    spans of it in one sendmsg and nothing is moved afterwards.
  */
 #include<stdio.h> //printf
 #include<string.h>    //strlen
+#include<errno.h>
+#include<time.h>
+#include<unistd.h>    //close
+#include<poll.h>
+#include<sys/uio.h>
 #include<sys/socket.h>    //socket
+#include<netinet/in.h>
+#include<netinet/tcp.h>   //TCP_NODELAY
 #include<arpa/inet.h> //inet_addr
 #include "bmcnet.h"
+#include "../../../ringbuf.h"
+
+#ifndef TRUE
+#define TRUE	1
+#define FALSE	0
+#endif
 
-extern char hostip;
+extern char hostip[];
 extern int hostport;
 
-int bmc_client(char * net_message)
+struct bmcnet_stats bmcnet_stats;
+
+RB_TYPE(bmc_queue, char, BMC_QSIZE, uint32_t);
+
+static struct {
+	int sock, connected, partial, warned, backoff;
+	long long first, retry_at;
+	bmc_queue q;
+} net = {.sock = -1, .backoff = BMC_RETRY_MS};
+
+static long long now_ms(void)
 {
-	int sock, n;
-	struct sockaddr_in server;
-	char message[1000], server_reply[2000];
-	char MDB = 0; // debug stuff
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
 
-	//Create socket
-	sock = socket(AF_INET, SOCK_STREAM, 0);
-	if (sock == -1) {
-		printf("Could not create socket");
+/* copy n bytes in at the head, the caller checked the room */
+static void bmc_put(const char *s, unsigned n)
+{
+	unsigned span;
+
+	while (n) {
+		RB_WSPAN(&net.q, span);
+		if (span > n)
+			span = n;
+		memcpy(RB_WPTR(&net.q), s, span);
+		RB_COMMIT(&net.q, span);
+		s += span;
+		n -= span;
 	}
+}
+
+/* consume up to and including the next newline */
+static void bmc_skip_line(void)
+{
+	unsigned span;
+	char *e;
+
+	while (!RB_EMPTY(&net.q)) {
+		RB_RSPAN(&net.q, span);
+		if ((e = memchr(RB_RPTR(&net.q), '\n', span))) {
+			RB_CONSUME(&net.q, e + 1 - RB_RPTR(&net.q));
+			return;
+		}
+		RB_CONSUME(&net.q, span);
+	}
+}
+
+/*
+ * close the connection and set the next retry time, the rest of a half
+ * sent message is dropped so the next connection starts on a message
+ */
+static void bmc_drop(void)
+{
+	if (net.sock >= 0)
+		close(net.sock);
+	net.sock = -1;
+	net.connected = FALSE;
+	if (net.partial) {
+		bmc_skip_line();
+		bmcnet_stats.dropped++;
+	}
+	net.partial = FALSE;
+	net.retry_at = now_ms() + net.backoff;
+	net.backoff = net.backoff * 2 > BMC_RETRY_MAX_MS ? BMC_RETRY_MAX_MS : net.backoff * 2;
+}
+
+/* start a non-blocking connect, bmc_client_poll sees it finish */
+static int bmc_connect(void)
+{
+	struct sockaddr_in server;
+	int one = 1;
 
-	server.sin_addr.s_addr = inet_addr((char*) &hostip);
+	net.sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (net.sock == -1) {
+		perror("Could not create socket");
+		bmc_drop();
+		return -1;
+	}
+	setsockopt(net.sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // we do the batching
+	memset(&server, 0, sizeof(server));
+	server.sin_addr.s_addr = inet_addr(hostip);
 	server.sin_family = AF_INET;
 	server.sin_port = htons(hostport);
+	bmcnet_stats.connects++;
+	if (connect(net.sock, (struct sockaddr *) &server, sizeof(server)) < 0 && errno != EINPROGRESS) {
+		if (!net.warned++)
+			perror("connect failed. Error");
+		bmc_drop();
+		return -1;
+	}
+	return 0;
+}
 
-	//Connect to remote server
-	if (connect(sock, (struct sockaddr *) &server, sizeof(server)) < 0) {
-		perror("connect failed. Error");
-		return 1;
+/* send as much of the queue as the socket takes in one call, both spans */
+static int bmc_send(void)
+{
+	struct msghdr msg;
+	struct iovec iov[2];
+	unsigned len = RB_COUNT(&net.q), span;
+	size_t left, k;
+	ssize_t n;
+	char *p, *e;
+	int i;
+
+	if (!len)
+		return 0;
+	RB_RSPAN(&net.q, span);
+	iov[0].iov_base = RB_RPTR(&net.q);
+	iov[0].iov_len = span;
+	iov[1].iov_base = net.q.buf;
+	iov[1].iov_len = len - span;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = len > span ? 2 : 1;
+	n = sendmsg(net.sock, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+	if (n < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			return 0;
+		bmc_drop();
+		return -1;
 	}
+	if (!n)
+		return 0; // nothing taken, the queue and partial stay as they are
+	for (i = 0, left = n; i < 2 && left; i++) { // the whole messages that went out
+		k = left < iov[i].iov_len ? left : iov[i].iov_len;
+		for (p = iov[i].iov_base, e = p + k; (p = memchr(p, '\n', e - p)); p++)
+			bmcnet_stats.sent++;
+		left -= k;
+	}
+	net.partial = n < len && net.q.buf[(net.q.tail + n - 1) & RB_MASK(&net.q)] != '\n';
+	RB_CONSUME(&net.q, n);
+	net.first = now_ms();
+	bmcnet_stats.batches++;
+	bmcnet_stats.bytes += n;
+	return 0;
+}
 
-	//Send some data
-	if (send(sock, net_message, strlen(net_message), 0) < 0) {
-		puts("Send failed");
-		return 1;
+static int bmc_poll(int force)
+{
+	struct pollfd pfd;
+	char reply[256];
+	ssize_t n;
+	int err = 0;
+	socklen_t len = sizeof(err);
+	long long now = now_ms();
+
+	if (net.sock < 0 && (now < net.retry_at || bmc_connect() < 0))
+		return -1;
+	if (!net.connected) {
+		pfd.fd = net.sock;
+		pfd.events = POLLOUT;
+		if (poll(&pfd, 1, 0) <= 0)
+			return -1; // still connecting
+		if (getsockopt(net.sock, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err) {
+			if (!net.warned++)
+				fprintf(stderr, "connect failed. Error: %s\n", strerror(err ? err : errno));
+			bmc_drop();
+			return -1;
+		}
+		net.connected = TRUE;
+		net.warned = 0;
+		net.backoff = BMC_RETRY_MS;
+	}
+	while ((n = recv(net.sock, reply, sizeof(reply), MSG_DONTWAIT)) > 0)
+		; // the replies are not used
+	if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+		bmc_drop(); // server closed or reset
+		return -1;
 	}
+	if (!RB_EMPTY(&net.q) && (force || RB_COUNT(&net.q) >= BMC_BATCH
+		|| now - net.first >= BMC_LINGER_MS))
+		return bmc_send();
+	return 0;
+}
+
+/* queue a message for the server, returns 1 if it was dropped */
+int bmc_client(char * net_message)
+{
+	unsigned n = strlen(net_message);
 
-	//Receive a reply from the server
-	if ((n = recv(sock, server_reply, 2000, 0)) < 0) {
-		puts("recv failed");
-		close(sock);
+	if (n + 1 > RB_FREE(&net.q)) {
+		bmcnet_stats.dropped++; // no room, keep the older messages
+		bmc_poll(FALSE);
 		return 1;
 	}
+	if (RB_EMPTY(&net.q))
+		net.first = now_ms();
+	bmc_put(net_message, n);
+	bmc_put("\n", 1);
+	bmcnet_stats.queued++;
+	bmc_poll(FALSE);
+	return 0;
+}
 
-	server_reply[n] = 0;
-	if (MDB) {
-		puts("Server reply :");
-		puts(server_reply);
+/* call from the main loop when no messages are coming, returns the queued bytes */
+int bmc_client_poll(void)
+{
+	bmc_poll(FALSE);
+	return RB_COUNT(&net.q);
+}
+
+/* send everything queued, waiting up to ms, returns the bytes left */
+int bmc_client_flush(int ms)
+{
+	struct pollfd pfd;
+	long long end = now_ms() + ms;
+
+	while (!RB_EMPTY(&net.q) && now_ms() < end) {
+		if (bmc_poll(TRUE) == 0 && RB_EMPTY(&net.q))
+			break;
+		pfd.fd = net.sock;
+		pfd.events = POLLOUT;
+		if (net.sock < 0 || poll(&pfd, 1, 10) < 0)
+			usleep(10000);
 	}
+	return RB_COUNT(&net.q);
+}
 
-	close(sock);
-	return 0;
-}
\ No newline at end of file
+void bmc_client_close(void)
+{
+	if (net.sock >= 0)
+		close(net.sock);
+	net.sock = -1;
+	net.connected = FALSE;
+	net.partial = FALSE;
+	RB_INIT(&net.q);
+	net.backoff = BMC_RETRY_MS;
+	net.retry_at = 0;
+}
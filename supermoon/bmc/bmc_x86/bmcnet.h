@@ -12,7 +12,24 @@
 extern "C" {
 #endif
 
+#define BMC_PORT	9760	// bmcnetd default
+#define BMC_QSIZE	65536	// bytes of messages waiting for the server
+#define BMC_BATCH	1400	// send when this much is queued
+#define BMC_LINGER_MS	100	// or when the oldest message waited this long
+#define BMC_RETRY_MS	100	// first reconnect delay, doubles on each failure
+#define BMC_RETRY_MAX_MS	5000
+
+    struct bmcnet_stats {
+        unsigned long queued, sent, dropped, batches, connects;
+        unsigned long long bytes;
+    };
+
+    extern struct bmcnet_stats bmcnet_stats;
+
     int bmc_client(char *);
+    int bmc_client_poll(void);
+    int bmc_client_flush(int);
+    void bmc_client_close(void);
 
 
 #ifdef	__cplusplus
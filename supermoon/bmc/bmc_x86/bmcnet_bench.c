@@ -0,0 +1,170 @@
+/*
+    bmcnet loopback benchmark
+
+    cc -O2 -o bmcnet_bench bmcnet_bench.c bmcnet.c -lpthread
+    ./bmcnet_bench [messages] [rate/s] [-o]
+
+    A stand-in server thread on 127.0.0.1 counts the newline framed messages
+    (or one per connection for -o) and answers every read like the real
+    server. The client sends bmc.c style CSV messages through bmc_client,
+    or with -o through the old connect, send, wait reply, close sequence,
+    and reports messages/s to the server and the bmc_client call latency.
+    rate 0 is as fast as possible, the queue drops when the server lags.
+ */
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<errno.h>
+#include<time.h>
+#include<unistd.h>
+#include<poll.h>
+#include<pthread.h>
+#include<sys/socket.h>
+#include<netinet/in.h>
+#include<arpa/inet.h>
+#include "bmcnet.h"
+
+#define MAXCONN	64
+
+char hostip[32] = "127.0.0.1";
+int hostport;
+
+static int lsock, old_mode;
+static volatile unsigned long rx_msgs, rx_conns;
+static volatile int done;
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *server(void *arg)
+{
+	struct pollfd pfd[MAXCONN];
+	char buf[65536], *p;
+	int i, nfd = 1, n;
+
+	pfd[0].fd = lsock;
+	pfd[0].events = POLLIN;
+	while (!done) {
+		if (poll(pfd, nfd, 100) <= 0)
+			continue;
+		if (pfd[0].revents & POLLIN && nfd < MAXCONN) {
+			pfd[nfd].fd = accept(lsock, NULL, NULL);
+			pfd[nfd++].events = POLLIN;
+			rx_conns++;
+		}
+		for (i = 1; i < nfd; i++) {
+			if (!pfd[i].revents)
+				continue;
+			n = recv(pfd[i].fd, buf, sizeof(buf), 0);
+			if (n <= 0) {
+				close(pfd[i].fd);
+				pfd[i--] = pfd[--nfd];
+				continue;
+			}
+			if (old_mode)
+				rx_msgs++;
+			else
+				for (p = buf; (p = memchr(p, '\n', buf + n - p)); p++)
+					rx_msgs++;
+			send(pfd[i].fd, "OK\n", 3, MSG_NOSIGNAL);
+		}
+	}
+	return arg;
+}
+
+/* the per message client bmcnet.c had before the persistent connection */
+static int old_client(char * net_message)
+{
+	int sock, n;
+	struct sockaddr_in server;
+	char server_reply[2000];
+
+	sock = socket(AF_INET, SOCK_STREAM, 0);
+	server.sin_addr.s_addr = inet_addr(hostip);
+	server.sin_family = AF_INET;
+	server.sin_port = htons(hostport);
+	if (connect(sock, (struct sockaddr *) &server, sizeof(server)) < 0) {
+		close(sock);
+		return 1;
+	}
+	if (send(sock, net_message, strlen(net_message), 0) < 0 ||
+		(n = recv(sock, server_reply, 2000, 0)) < 0) {
+		close(sock);
+		return 1;
+	}
+	close(sock);
+	return 0;
+}
+
+static int cmp(const void *a, const void *b)
+{
+	double x = *(const double *) a, y = *(const double *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+int main(int argc, char *argv[])
+{
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	pthread_t tid;
+	char net_message[256];
+	int i, count = argc > 1 ? atoi(argv[1]) : 100000;
+	double rate = argc > 2 ? atof(argv[2]) : 0.0, t0, t1, next, *lat;
+
+	old_mode = argc > 3 && !strcmp(argv[3], "-o");
+	lat = malloc(count * sizeof(double));
+	lsock = socket(AF_INET, SOCK_STREAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = inet_addr(hostip);
+	if (!lat || bind(lsock, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(lsock, 128) < 0) {
+		perror("server");
+		return 1;
+	}
+	getsockname(lsock, (struct sockaddr *) &addr, &len);
+	hostport = ntohs(addr.sin_port);
+	pthread_create(&tid, NULL, server, NULL);
+
+	t0 = next = now_s();
+	for (i = 0; i < count; i++) {
+		if (rate > 0.0) {
+			next += 1.0 / rate;
+			while (now_s() < next) {
+				if (!old_mode)
+					bmc_client_poll();
+				usleep(100);
+			}
+		}
+		sprintf(net_message, "%i,%i,%i,%i,X", 1234 + i % 100, 56 + i % 10, i, 1);
+		t1 = now_s();
+		if (old_mode)
+			old_client(net_message);
+		else
+			bmc_client(net_message);
+		lat[i] = now_s() - t1;
+	}
+	if (!old_mode)
+		bmc_client_flush(5000);
+	for (i = 0; i < 500 && rx_msgs < count - bmcnet_stats.dropped; i++)
+		usleep(10000);
+	t1 = now_s() - t0;
+	done = 1;
+	pthread_join(tid, NULL);
+
+	qsort(lat, count, sizeof(double), cmp);
+	printf("%s: %d messages, %lu received on %lu connections in %.3f s, %.0f messages/s\n",
+		old_mode ? "connect per message" : "persistent", count, rx_msgs, rx_conns, t1, rx_msgs / t1);
+	printf("bmc_client latency us: p50 %.1f p99 %.1f max %.1f\n",
+		lat[count / 2] * 1e6, lat[count * 99 / 100] * 1e6, lat[count - 1] * 1e6);
+	if (!old_mode)
+		printf("batches %lu, %.1f messages/batch, dropped %lu, connects %lu\n",
+			bmcnet_stats.batches, (double) bmcnet_stats.sent / (bmcnet_stats.batches ? bmcnet_stats.batches : 1),
+			bmcnet_stats.dropped, bmcnet_stats.connects);
+	return 0;
+}
@@ -0,0 +1,174 @@
+/*
+    bmcnet load generator
+
+    cc -O2 -o bmcnet_load bmcnet_load.c -lpthread
+    ./bmcnet_load [stations] [seconds] [batch] [host] [port] [threads]
+
+    Opens one persistent connection per simulated station to bmcnetd, each
+    sends batch station messages, waits for the "OK", and sends again.
+    Reports the messages/s the server took and the round trip latency of
+    the writes, so the server load is set by the number of stations.
+    Thousands of stations need ulimit -n above the station count.
+ */
+#define _GNU_SOURCE
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<errno.h>
+#include<time.h>
+#include<unistd.h>
+#include<pthread.h>
+#include<sys/epoll.h>
+#include<sys/socket.h>
+#include<netinet/in.h>
+#include<netinet/tcp.h>
+#include<arpa/inet.h>
+#include "bmcnet.h"
+
+#define MAXLAT	(1 << 20)	// latency samples per thread
+
+struct station {
+	int fd, id, update;
+	long long sent;
+};
+
+struct load {
+	int first, count;
+	unsigned long long msgs, nlat;
+	float *lat; // us
+};
+
+static char hostip[32] = "127.0.0.1";
+static int hostport = BMC_PORT, batch = 1;
+static volatile int running = 1;
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int station_send(struct station *st)
+{
+	char msg[64 * 64];
+	int n = 0, i;
+
+	for (i = 0; i < batch; i++) // bmc.c message with the volts in mV and amps * 10
+		n += sprintf(msg + n, "%i,%i,%i,%i,X\n", 12000 + st->update % 500, 30 + st->update % 7,
+			st->update, st->id), st->update++;
+	st->sent = now_ns();
+	return send(st->fd, msg, n, MSG_NOSIGNAL) == n ? 0 : -1;
+}
+
+static void *loader(void *arg)
+{
+	struct load *ld = arg;
+	struct station *sts;
+	struct sockaddr_in server;
+	struct epoll_event ev, evs[256];
+	char buf[256];
+	int ep, i, n, one = 1;
+	long long t;
+
+	sts = calloc(ld->count, sizeof(*sts));
+	ep = epoll_create1(0);
+	memset(&server, 0, sizeof(server));
+	server.sin_addr.s_addr = inet_addr(hostip);
+	server.sin_family = AF_INET;
+	server.sin_port = htons(hostport);
+	for (i = 0; i < ld->count; i++) {
+		sts[i].id = ld->first + i;
+		sts[i].fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (connect(sts[i].fd, (struct sockaddr *) &server, sizeof(server)) < 0) {
+			perror("connect failed. Error");
+			exit(1);
+		}
+		setsockopt(sts[i].fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		ev.events = EPOLLIN;
+		ev.data.ptr = &sts[i];
+		epoll_ctl(ep, EPOLL_CTL_ADD, sts[i].fd, &ev);
+		station_send(&sts[i]);
+	}
+	while (running) {
+		n = epoll_wait(ep, evs, 256, 100);
+		t = now_ns();
+		for (i = 0; i < n; i++) {
+			struct station *st = evs[i].data.ptr;
+
+			if (recv(st->fd, buf, sizeof(buf), MSG_DONTWAIT) <= 0) {
+				fprintf(stderr, "station %d: server closed\n", st->id);
+				exit(1);
+			}
+			ld->msgs += batch;
+			if (ld->nlat < MAXLAT)
+				ld->lat[ld->nlat++] = (t - st->sent) / 1000.0f;
+			station_send(st);
+		}
+	}
+	for (i = 0; i < ld->count; i++)
+		close(sts[i].fd);
+	free(sts);
+	return NULL;
+}
+
+static int cmp(const void *a, const void *b)
+{
+	float x = *(const float *) a, y = *(const float *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+int main(int argc, char *argv[])
+{
+	int stations = argc > 1 ? atoi(argv[1]) : 1000, secs = argc > 2 ? atoi(argv[2]) : 10;
+	int threads = sysconf(_SC_NPROCESSORS_ONLN), i;
+	struct load *ld;
+	pthread_t *tid;
+	unsigned long long msgs = 0, nlat = 0;
+	float *lat;
+	long long t0, t1;
+
+	if (argc > 3)
+		batch = atoi(argv[3]);
+	if (argc > 4)
+		snprintf(hostip, sizeof(hostip), "%s", argv[4]);
+	if (argc > 5)
+		hostport = atoi(argv[5]);
+	if (argc > 6)
+		threads = atoi(argv[6]);
+	if (batch < 1 || batch > 64)
+		batch = 1;
+	if (threads > stations)
+		threads = stations;
+	ld = calloc(threads, sizeof(*ld));
+	tid = calloc(threads, sizeof(*tid));
+	lat = malloc((size_t) threads * MAXLAT * sizeof(float));
+	if (!ld || !tid || !lat)
+		return 1;
+
+	t0 = now_ns();
+	for (i = 0; i < threads; i++) {
+		ld[i].first = stations * i / threads;
+		ld[i].count = stations * (i + 1) / threads - ld[i].first;
+		ld[i].lat = lat + (size_t) i * MAXLAT;
+		pthread_create(&tid[i], NULL, loader, &ld[i]);
+	}
+	sleep(secs);
+	running = 0;
+	for (i = 0; i < threads; i++) {
+		pthread_join(tid[i], NULL);
+		msgs += ld[i].msgs;
+		memmove(lat + nlat, ld[i].lat, ld[i].nlat * sizeof(float));
+		nlat += ld[i].nlat;
+	}
+	t1 = now_ns();
+	qsort(lat, nlat, sizeof(float), cmp);
+	printf("%d stations, %d threads, batch %d: %llu messages in %.2f s, %.0f messages/s\n",
+		stations, threads, batch, msgs, (t1 - t0) / 1e9, msgs / ((t1 - t0) / 1e9));
+	if (nlat)
+		printf("round trip us: p50 %.0f p99 %.0f p99.9 %.0f max %.0f\n", lat[nlat / 2],
+			lat[nlat * 99 / 100], lat[nlat * 999 / 1000], lat[nlat - 1]);
+	return 0;
+}
@@ -0,0 +1,368 @@
+/*
+    bmcnet aggregation server
+
+    cc -O2 -o bmcnetd bmcnetd.c -lpthread
+    ./bmcnetd [port] [threads]
+
+    Takes the station messages of bmc_client, "volts,amps,update,station,X",
+    newline terminated from the persistent client or one per connection
+    without the newline from the old client, and answers each read with
+    "OK\n" as the clients expect. A line "?" returns every station seen and
+    "?station" one station, as "station,volts,amps,update,count,vmin,vmax,
+    vavg,cavg\n" lines ended by ".\n", vavg and cavg are moving averages.
+    Replies and OKs are queued per connection in the order they are due and
+    sent as the socket takes them, so queries can be pipelined; a client
+    that lets more than OUT_MAX bytes of them pile up is dropped.
+
+    There is one thread per cpu, each with its own SO_REUSEPORT listen socket
+    and edge triggered epoll set, so the kernel spreads the connections and
+    the threads share nothing but the station table. Lines are parsed where
+    they sit in the connection's receive buffer, only a partial line at the
+    end of a read is moved to the front.
+    The station table is one array of cache line sized entries indexed by
+    station id, each with its own spin lock, two threads only meet on it
+    when the same station has two connections.
+ */
+#define _GNU_SOURCE
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<limits.h>
+#include<errno.h>
+#include<time.h>
+#include<unistd.h>
+#include<pthread.h>
+#include<sched.h>
+#include<sys/epoll.h>
+#include<sys/socket.h>
+#include<netinet/in.h>
+#include<netinet/tcp.h>
+#include<arpa/inet.h>
+#include "bmcnet.h"
+
+#define STATIONS	4096	// station ids 0 to STATIONS-1
+#define RXBUF	4096	// per connection, longer lines are dropped
+#define EVENTS	256
+#define EWMA_SHIFT	4	// moving average over about 16 messages
+#define STATION_LINE	(9 * 12)	// a station line of 9 ints at 11 chars and a separator
+#define OUT_MAX	(4 * STATIONS * STATION_LINE)	// unsent output of a connection, 4 full replies
+
+struct station {
+	volatile char lock;
+	unsigned count;
+	int v, c, update, vmin, vmax;
+	long long vavg, cavg; // * 256
+	long long stamp; // CLOCK_MONOTONIC ns of the last message
+} __attribute__((aligned(64)));
+
+struct conn {
+	int fd;
+	unsigned len, olen, opos, osize;
+	char *out; // replies and OKs not sent yet, opos to olen
+	char buf[RXBUF];
+};
+
+static struct station table[STATIONS];
+static volatile unsigned long long msgs, bad, conns;
+static int port = BMC_PORT;
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void st_lock(struct station *s)
+{
+	while (__atomic_test_and_set(&s->lock, __ATOMIC_ACQUIRE))
+		while (s->lock)
+			sched_yield();
+}
+
+static void st_unlock(struct station *s)
+{
+	__atomic_clear(&s->lock, __ATOMIC_RELEASE);
+}
+
+/*
+ * decimal int at p, end is past the last char, returns the char after it or
+ * NULL, also for a value outside an int
+ */
+static const char *get_int(const char *p, const char *end, int *val)
+{
+	int neg = 0, n = 0, d;
+	const char *s;
+
+	if (p < end && (*p == '-' || *p == '+'))
+		neg = *p++ == '-';
+	for (s = p; p < end && *p >= '0' && *p <= '9'; p++) {
+		d = *p - '0';
+		if (n > (INT_MAX - d) / 10)
+			return NULL;
+		n = n * 10 + d;
+	}
+	if (p == s)
+		return NULL;
+	*val = neg ? -n : n;
+	return p;
+}
+
+/* one station message "v,c,update,station,X" */
+static int put_sample(const char *p, const char *end, long long now)
+{
+	int f[4], i;
+	struct station *s;
+
+	for (i = 0; i < 4; i++) {
+		if (!(p = get_int(p, end, &f[i])) || p == end || *p++ != ',')
+			return -1;
+	}
+	if (p == end || *p != 'X' || f[3] < 0 || f[3] >= STATIONS)
+		return -1;
+	s = &table[f[3]];
+	st_lock(s);
+	if (!s->count++) {
+		s->vmin = s->vmax = f[0];
+		s->vavg = f[0] * 256LL;
+		s->cavg = f[1] * 256LL;
+	}
+	s->v = f[0];
+	s->c = f[1];
+	s->update = f[2];
+	if (f[0] < s->vmin)
+		s->vmin = f[0];
+	if (f[0] > s->vmax)
+		s->vmax = f[0];
+	s->vavg += (f[0] * 256LL - s->vavg) >> EWMA_SHIFT;
+	s->cavg += (f[1] * 256LL - s->cavg) >> EWMA_SHIFT;
+	s->stamp = now;
+	st_unlock(s);
+	return 0;
+}
+
+/* the line of station id into room chars at o, -1 when it does not fit */
+static int put_station(char *o, int room, int id)
+{
+	struct station *s = &table[id], c;
+	int n;
+
+	st_lock(s);
+	c = *s;
+	st_unlock(s);
+	if (!c.count)
+		return 0;
+	n = snprintf(o, room, "%d,%d,%d,%d,%u,%d,%d,%d,%d\n", id, c.v, c.c, c.update, c.count,
+		c.vmin, c.vmax, (int) (c.vavg >> 8), (int) (c.cavg >> 8));
+	return n < 0 || n >= room ? -1 : n;
+}
+
+/* room for n more chars after the queued output, NULL past OUT_MAX */
+static char *out_room(struct conn *cn, unsigned n)
+{
+	unsigned size;
+	char *o;
+
+	if (cn->olen - cn->opos + n > OUT_MAX)
+		return NULL;
+	if (cn->olen + n > cn->osize) {
+		if (cn->opos) { // the sent part first
+			memmove(cn->out, cn->out + cn->opos, cn->olen - cn->opos);
+			cn->olen -= cn->opos;
+			cn->opos = 0;
+		}
+		for (size = cn->osize ? cn->osize : 256; size < cn->olen + n; size *= 2)
+			;
+		if (size != cn->osize) {
+			if (!(o = realloc(cn->out, size)))
+				return NULL;
+			cn->out = o;
+			cn->osize = size;
+		}
+	}
+	return cn->out + cn->olen;
+}
+
+/* queue the query reply, -1 when there is no room for it */
+static int query(struct conn *cn, const char *p, const char *end)
+{
+	int id, n = 0, i, l, size;
+	char *o;
+
+	if (get_int(p + 1, end, &id)) {
+		size = STATION_LINE;
+		if (!(o = out_room(cn, size + 2)))
+			return -1;
+		if (id >= 0 && id < STATIONS && (l = put_station(o, size, id)) > 0)
+			n = l;
+	} else {
+		size = STATIONS * STATION_LINE;
+		if (!(o = out_room(cn, size + 2)))
+			return -1;
+		// the ".\n" has its own 2 bytes, a line that does not fit ends the reply
+		for (i = 0; i < STATIONS && (l = put_station(o + n, size - n, i)) >= 0; i++)
+			n += l;
+	}
+	memcpy(o + n, ".\n", 2);
+	cn->olen += n + 2;
+	return 0;
+}
+
+/* send the queued output until the socket is full */
+static int flush_out(struct conn *cn)
+{
+	ssize_t n;
+
+	while (cn->opos < cn->olen) {
+		n = send(cn->fd, cn->out + cn->opos, cn->olen - cn->opos, MSG_NOSIGNAL);
+		if (n < 0)
+			return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+		cn->opos += n;
+	}
+	cn->opos = cn->olen = 0;
+	if (cn->osize > RXBUF) { // a full reply went out, don't keep its room
+		free(cn->out);
+		cn->out = NULL;
+		cn->osize = 0;
+	}
+	return 0;
+}
+
+/* read until EAGAIN, split the lines in place, 0 keeps the connection */
+static int conn_read(struct conn *cn)
+{
+	char *p, *e, *end, *o;
+	ssize_t n;
+	int got;
+	long long now;
+
+	for (;;) {
+		n = recv(cn->fd, cn->buf + cn->len, RXBUF - cn->len, 0);
+		if (n == 0)
+			return -1;
+		if (n < 0)
+			return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : errno == EINTR ? 0 : -1;
+		now = now_ns();
+		got = 0;
+		end = cn->buf + cn->len + n;
+		for (p = cn->buf; p < end; p = e + 1) {
+			if (!(e = memchr(p, '\n', end - p))) {
+				if (end[-1] != 'X') // partial line, old clients end on the X
+					break;
+				e = end;
+			}
+			if (e == p)
+				continue;
+			if (*p == '?') {
+				if (query(cn, p, e) < 0)
+					return -1;
+			} else if (put_sample(p, e, now) < 0) {
+				__atomic_fetch_add(&bad, 1, __ATOMIC_RELAXED);
+			} else {
+				got++;
+			}
+		}
+		if (got) {
+			__atomic_fetch_add(&msgs, got, __ATOMIC_RELAXED);
+			if (!(o = out_room(cn, 3))) // after any reply due before it
+				return -1;
+			memcpy(o, "OK\n", 3);
+			cn->olen += 3;
+		}
+		cn->len = p < end ? end - p : 0;
+		if (cn->len == RXBUF) {
+			cn->len = 0; // no newline in a full buffer
+			__atomic_fetch_add(&bad, 1, __ATOMIC_RELAXED);
+		}
+		memmove(cn->buf, p, cn->len);
+		if (flush_out(cn) < 0)
+			return -1;
+	}
+}
+
+static void conn_close(struct conn *cn)
+{
+	close(cn->fd);
+	free(cn->out);
+	free(cn);
+}
+
+static void *worker(void *arg)
+{
+	struct epoll_event ev, evs[EVENTS];
+	struct sockaddr_in addr;
+	struct conn *cn;
+	int ls, ep, one = 1, n, i, fd;
+
+	ls = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	setsockopt(ls, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	setsockopt(ls, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+	if (bind(ls, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(ls, 1024) < 0) {
+		perror("bind failed. Error");
+		exit(1);
+	}
+	ep = epoll_create1(0);
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL; // the listen socket
+	epoll_ctl(ep, EPOLL_CTL_ADD, ls, &ev);
+
+	for (;;) {
+		n = epoll_wait(ep, evs, EVENTS, -1);
+		for (i = 0; i < n; i++) {
+			cn = evs[i].data.ptr;
+			if (!cn) {
+				while ((fd = accept4(ls, NULL, NULL, SOCK_NONBLOCK)) >= 0) {
+					if (!(cn = malloc(sizeof(*cn)))) {
+						close(fd);
+						continue;
+					}
+					setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+					cn->fd = fd;
+					cn->len = 0;
+					cn->olen = cn->opos = cn->osize = 0;
+					cn->out = NULL;
+					ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+					ev.data.ptr = cn;
+					epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+					__atomic_fetch_add(&conns, 1, __ATOMIC_RELAXED);
+				}
+				continue;
+			}
+			if ((evs[i].events & EPOLLOUT && flush_out(cn) < 0) ||
+				(evs[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR) && conn_read(cn) < 0))
+				conn_close(cn); // closing the fd takes it out of the epoll set
+		}
+	}
+	return arg;
+}
+
+int main(int argc, char *argv[])
+{
+	pthread_t tid;
+	int i, threads = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned long long last = 0, m;
+
+	if (argc > 1)
+		port = atoi(argv[1]);
+	if (argc > 2)
+		threads = atoi(argv[2]);
+	if (threads < 1)
+		threads = 1;
+	for (i = 0; i < threads; i++)
+		pthread_create(&tid, NULL, worker, NULL);
+	printf("\r\n bmcnet server on port %d, %d threads\r\n", port, threads);
+	for (;;) {
+		sleep(10);
+		m = msgs;
+		printf(" %llu messages/s, %llu total, %llu bad, %llu connections\r\n",
+			(m - last) / 10, m, bad, conns);
+		fflush(stdout);
+		last = m;
+	}
+	return 0;
+}
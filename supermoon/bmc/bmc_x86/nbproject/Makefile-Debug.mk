@@ -37,6 +37,8 @@ OBJECTDIR=${CND_BUILDDIR}/${CND_CONF}/${CND_PLATFORM}
 OBJECTFILES= \
 	${OBJECTDIR}/_ext/1472/bmc.o \
 	${OBJECTDIR}/_ext/1360920745/daq.o \
+	${OBJECTDIR}/_ext/1360920745/filter.o \
+	${OBJECTDIR}/_ext/1360920745/conv.o \
 	${OBJECTDIR}/bmcnet.o
 
 
@@ -74,6 +76,16 @@ ${OBJECTDIR}/_ext/1360920745/daq.o: ../bmc/daq.c
 	${RM} "$@.d"
 	$(COMPILE.c) -g `pkg-config --cflags comedilib` `pkg-config --cflags xaw7`   -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/_ext/1360920745/daq.o ../bmc/daq.c
 
+${OBJECTDIR}/_ext/1360920745/filter.o: ../bmc/filter.c 
+	${MKDIR} -p ${OBJECTDIR}/_ext/1360920745
+	${RM} "$@.d"
+	$(COMPILE.c) -g `pkg-config --cflags comedilib` `pkg-config --cflags xaw7`   -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/_ext/1360920745/filter.o ../bmc/filter.c
+
+${OBJECTDIR}/_ext/1360920745/conv.o: ../bmc/conv.c 
+	${MKDIR} -p ${OBJECTDIR}/_ext/1360920745
+	${RM} "$@.d"
+	$(COMPILE.c) -g `pkg-config --cflags comedilib` `pkg-config --cflags xaw7`   -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/_ext/1360920745/conv.o ../bmc/conv.c
+
 ${OBJECTDIR}/bmcnet.o: bmcnet.c 
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
@@ -0,0 +1,1323 @@
+/*
+ * libcomedi stand-in with simulated boards, for running and timing the
+ * comedi clients (bmc, supermoon/bmc, moonlight) without a DAQ device
+ *
+ * needs comedi.h from libcomedi-dev for comedilib.h, no device or driver
+ * cc -O2 -fPIC -shared -o libcomedi_mock.so comedi_mock.c -lm
+ * LD_PRELOAD=./libcomedi_mock.so COMEDI_MOCK=gertboard ./bmc
+ * or link comedi_mock.c -lm into a client in place of -lcomedi
+ *
+ * COMEDI_MOCK          board profile for /dev/comedi0, a comma list for
+ *                      comedi0, comedi1 ...: gertboard (daq_gert with the
+ *                      MCP3202 ADC and 12 bit DAC), ads1220 (daq_gert with
+ *                      the ADS1220) or daq700 (ni_daq_700), gertboard if unset
+ * COMEDI_MOCK_WAVE     sine, square, triangle, ramp, dc or noise on each AI
+ *                      channel, channel c runs at (c + 1) * COMEDI_MOCK_HZ
+ * COMEDI_MOCK_HZ       wave frequency, 1.0
+ * COMEDI_MOCK_NOISE    gaussian noise in LSB rms added to the wave, 0.5
+ * COMEDI_MOCK_REALTIME 1 makes insn reads take the profile conversion time
+ * COMEDI_MOCK_SYSCALL_NS  spin this long for each syscall the real library
+ *                      would make, a Raspberry Pi ioctl is a few us
+ * COMEDI_MOCK_STATS    where the per call report goes at exit, stderr if
+ *                      unset, 0 for none
+ *
+ * AI, AO with readback and DIO subdevices answer the insn, data, dio and
+ * query calls with the channel counts, ranges and maxdata of the real
+ * drivers. An AI command on the profiles that have one fills the comedi
+ * buffer from the wall clock at the command rate: comedi_fileno gives a
+ * memfd that mmap()s like the device, comedi_get_buffer_contents,
+ * comedi_get_buffer_offset and comedi_mark_buffer_read work on it and
+ * read() on that fd streams it, EPIPE after an overrun and EINVAL for less
+ * than one sample like the driver.
+ * There are no calibration files: comedi_get_hardcal_converter gives the
+ * linear polynomial of the range, comedi_get_softcal_converter works on a
+ * comedi_calibration_t the client fills in itself.
+ *
+ * Every call is counted with its time in the shim and the syscalls
+ * libcomedi makes for it, so a client change shows up as fewer or cheaper
+ * calls. comedi_mock_report(FILE *) prints the table on demand.
+ * Not thread safe, one thread per comedi_t like most clients.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "comedilib.h"
+
+#define MOCK_DEVS	4
+#define MOCK_SUBDS	3
+#define MOCK_BUFSZ	65536	/* the comedi default buffer */
+#define MOCK_BUFMAX	(1 << 24)
+#define MOCK_CHANLIST	32
+
+struct mock_subd {
+	int type;
+	int flags;
+	int n_chan;
+	int len_chanlist;
+	lsampl_t maxdata;
+	int n_ranges;
+	comedi_range range[3];
+	unsigned int conv_ns; /* fastest conversion, the cmdtest minimum */
+};
+
+struct mock_profile {
+	const char *name, *driver, *board;
+	int n_subd;
+	int read_subd;
+	struct mock_subd subd[MOCK_SUBDS];
+};
+
+/* the subdevices as daq_gert and ni_daq_700 attach them */
+static const struct mock_profile profiles[] = {
+	{"gertboard", "daq_gert", "Gertboard", 3, 1, {
+		{COMEDI_SUBD_DIO, SDF_READABLE | SDF_WRITABLE, 17, 17, 1, 1,
+			{{0.0, 1.0, UNIT_volt}}, 0},
+		{COMEDI_SUBD_AI, SDF_READABLE | SDF_GROUND | SDF_CMD_READ | SDF_COMMON, 2, 2,
+			0xfff, 1, {{0.0, 3.3, UNIT_volt}}, 50000},
+		{COMEDI_SUBD_AO, SDF_WRITABLE | SDF_GROUND, 2, 2, 0xfff, 1,
+			{{0.0, 2.048, UNIT_volt}}, 5000},
+	}},
+	{"ads1220", "daq_gert", "Gertboard", 3, 1, {
+		{COMEDI_SUBD_DIO, SDF_READABLE | SDF_WRITABLE, 17, 17, 1, 1,
+			{{0.0, 1.0, UNIT_volt}}, 0},
+		/* 24 bit codes take 32 bit buffer samples */
+		{COMEDI_SUBD_AI, SDF_READABLE | SDF_DIFF | SDF_GROUND | SDF_CMD_READ | SDF_COMMON
+			| SDF_LSAMPL, 5, 1, 0xffffff, 3,
+			{{-2.048, 2.048, UNIT_volt}, {-1.024, 1.024, UNIT_volt},
+			{-0.512, 0.512, UNIT_volt}}, 25000000}, /* 20 SPS turbo mode */
+		{COMEDI_SUBD_AO, SDF_WRITABLE | SDF_GROUND, 2, 2, 0xfff, 1,
+			{{0.0, 2.048, UNIT_volt}}, 5000},
+	}},
+	{"daq700", "ni_daq_700", "daqcard-700", 2, -1, {
+		{COMEDI_SUBD_DIO, SDF_READABLE | SDF_WRITABLE, 16, 16, 1, 1,
+			{{0.0, 1.0, UNIT_volt}}, 0},
+		{COMEDI_SUBD_AI, SDF_READABLE | SDF_GROUND | SDF_DIFF, 16, 16, 0xfff, 3,
+			{{-10.0, 10.0, UNIT_volt}, {-5.0, 5.0, UNIT_volt}, {-2.5, 2.5, UNIT_volt}},
+			10000},
+	}},
+};
+
+enum wave { SINE, SQUARE, TRIANGLE, RAMP, DC, NOISE };
+
+struct comedi_t_struct {
+	const struct mock_profile *p;
+	int fd; /* memfd that stands in for the device node */
+	double t0; /* open time, the waves start here */
+	lsampl_t ao[MOCK_CHANLIST]; /* AO readback */
+	unsigned int dio, dio_out; /* DIO levels and output bits */
+	int locked;
+	/* the AI command */
+	int running, armed, overrun;
+	comedi_cmd cmd;
+	unsigned int chanlist[MOCK_CHANLIST];
+	double start, sample_ns;
+	uint64_t made, total; /* samples made, samples the command wants */
+	uint64_t head, tail; /* buffer bytes written and read */
+	uint8_t *buf;
+	unsigned int bufsz, bps;
+};
+
+/* the calls counted, with the syscalls libcomedi makes for each */
+enum mock_call {
+	C_OPEN, C_CLOSE, C_QUERY, C_DO_INSN, C_DO_INSNLIST, C_DATA_READ, C_DATA_READ_N,
+	C_DATA_READ_DELAYED, C_DATA_READ_HINT, C_DATA_WRITE, C_DIO_CONFIG, C_DIO_READ,
+	C_DIO_WRITE, C_DIO_BITFIELD, C_COMMAND, C_COMMAND_TEST, C_CANCEL, C_POLL,
+	C_BUF_CONTENTS, C_BUF_READ, C_BUF_OFFSET, C_BUF_SIZE, C_READ, C_OTHER, C_CALLS
+};
+
+static const struct {
+	const char *name;
+	int syscalls;
+} calls[C_CALLS] = {
+	{"comedi_open", 0}, /* open and the info ioctls, counted at open */
+	{"comedi_close", 1},
+	{"queries (cached)", 0},
+	{"comedi_do_insn", 1},
+	{"comedi_do_insnlist", 1},
+	{"comedi_data_read", 1},
+	{"comedi_data_read_n", 1},
+	{"comedi_data_read_delayed", 1},
+	{"comedi_data_read_hint", 1},
+	{"comedi_data_write", 1},
+	{"comedi_dio_config", 1},
+	{"comedi_dio_read", 1},
+	{"comedi_dio_write", 1},
+	{"comedi_dio_bitfield", 1},
+	{"comedi_command", 1},
+	{"comedi_command_test", 1},
+	{"comedi_cancel", 1},
+	{"comedi_poll", 1},
+	{"comedi_get_buffer_contents", 1},
+	{"comedi_mark_buffer_read", 1},
+	{"comedi_get_buffer_offset", 1},
+	{"buffer size", 1},
+	{"read", 1},
+	{"other", 1},
+};
+
+static struct {
+	uint64_t n, syscalls, samples;
+	double ns, max_ns;
+} stat[C_CALLS];
+
+static comedi_t *devs[MOCK_DEVS];
+static int mock_errno, mock_ready, realtime, syscall_ns;
+static enum comedi_oor_behavior oor = COMEDI_OOR_NUMBER;
+static enum wave wave = SINE;
+static double wave_hz = 1.0, noise_lsb = 0.5;
+static FILE *report_to;
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* busy wait, the emulated costs are too short for a sleep */
+static void spin_ns(double ns)
+{
+	double end = now_ns() + ns;
+
+	while (now_ns() < end)
+		;
+}
+
+static double begin(enum mock_call c)
+{
+	double t = now_ns();
+
+	if (syscall_ns && calls[c].syscalls)
+		spin_ns((double) syscall_ns * calls[c].syscalls);
+	return t;
+}
+
+static void done(enum mock_call c, double t, int syscalls, unsigned int samples)
+{
+	double ns = now_ns() - t;
+
+	stat[c].n++;
+	stat[c].syscalls += syscalls;
+	stat[c].samples += samples;
+	stat[c].ns += ns;
+	if (ns > stat[c].max_ns)
+		stat[c].max_ns = ns;
+}
+
+/* the usual ending: count the call and pass the return value through */
+static int ret(enum mock_call c, double t, int r, unsigned int samples)
+{
+	done(c, t, calls[c].syscalls, samples);
+	return r;
+}
+
+static int fail(enum mock_call c, double t, int err)
+{
+	mock_errno = err;
+	errno = err;
+	return ret(c, t, -1, 0);
+}
+
+void comedi_mock_report(FILE *f)
+{
+	uint64_t n = 0, sys = 0;
+	double ns = 0.0;
+	int i;
+
+	fprintf(f, "%-28s %10s %10s %10s %12s %10s %10s\n", "comedi mock call", "calls",
+		"syscalls", "samples", "total us", "mean ns", "max ns");
+	for (i = 0; i < C_CALLS; i++) {
+		if (!stat[i].n)
+			continue;
+		fprintf(f, "%-28s %10llu %10llu %10llu %12.1f %10.0f %10.0f\n", calls[i].name,
+			(unsigned long long) stat[i].n, (unsigned long long) stat[i].syscalls,
+			(unsigned long long) stat[i].samples, stat[i].ns / 1000.0,
+			stat[i].ns / stat[i].n, stat[i].max_ns);
+		n += stat[i].n;
+		sys += stat[i].syscalls;
+		ns += stat[i].ns;
+	}
+	fprintf(f, "%-28s %10llu %10llu %10s %12.1f\n", "total", (unsigned long long) n,
+		(unsigned long long) sys, "", ns / 1000.0);
+}
+
+static void mock_exit(void)
+{
+	if (report_to)
+		comedi_mock_report(report_to);
+}
+
+static void mock_init(void)
+{
+	const char *s;
+
+	if (mock_ready)
+		return;
+	mock_ready = 1;
+	s = getenv("COMEDI_MOCK_WAVE");
+	if (s) {
+		static const char *names[] = {"sine", "square", "triangle", "ramp", "dc", "noise"};
+		unsigned int i;
+
+		for (i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+			if (!strcmp(s, names[i]))
+				wave = i;
+	}
+	if ((s = getenv("COMEDI_MOCK_HZ")))
+		wave_hz = atof(s);
+	if ((s = getenv("COMEDI_MOCK_NOISE")))
+		noise_lsb = atof(s);
+	if ((s = getenv("COMEDI_MOCK_REALTIME")))
+		realtime = atoi(s);
+	if ((s = getenv("COMEDI_MOCK_SYSCALL_NS")))
+		syscall_ns = atoi(s);
+	s = getenv("COMEDI_MOCK_STATS");
+	if (!s)
+		report_to = stderr;
+	else if (strcmp(s, "0"))
+		report_to = fopen(s, "w");
+	srand48(1);
+	atexit(mock_exit);
+}
+
+static double gauss(void)
+{
+	double u = 1.0 - drand48(), v = drand48();
+
+	return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+/* the AI code on chan at t ns after open, 80% of full scale around the middle */
+static lsampl_t ai_code(comedi_t *it, unsigned int chan, double t)
+{
+	const struct mock_subd *s = &it->p->subd[1];
+	double ph = fmod(t * 1e-9 * wave_hz * (chan + 1), 1.0), v, mid = s->maxdata / 2.0;
+
+	switch (wave) {
+	case SQUARE:
+		v = ph < 0.5 ? 1.0 : -1.0;
+		break;
+	case TRIANGLE:
+		v = ph < 0.5 ? 4.0 * ph - 1.0 : 3.0 - 4.0 * ph;
+		break;
+	case RAMP:
+		v = 2.0 * ph - 1.0;
+		break;
+	case DC:
+		v = (chan % 8) / 4.0 - 0.875;
+		break;
+	case NOISE:
+		v = 0.0;
+		break;
+	default:
+		v = sin(2.0 * M_PI * ph);
+	}
+	v = mid + 0.8 * mid * v + noise_lsb * gauss();
+	if (v < 0.0)
+		return 0;
+	if (v > s->maxdata)
+		return s->maxdata;
+	return (lsampl_t) (v + 0.5);
+}
+
+static const struct mock_subd *find_subd(comedi_t *it, unsigned int n)
+{
+	if (!it || n >= (unsigned int) it->p->n_subd)
+		return NULL;
+	return &it->p->subd[n];
+}
+
+/* the data an insn on a subdevice reads or writes */
+static int insn_data(comedi_t *it, comedi_insn *insn)
+{
+	const struct mock_subd *s = find_subd(it, insn->subdev);
+	unsigned int chan = CR_CHAN(insn->chanspec), i, mask, bits;
+	double t;
+
+	if (!s)
+		return -EINVAL;
+	if (insn->insn == INSN_WAIT) {
+		if (realtime)
+			spin_ns(insn->data[0]);
+		return insn->n;
+	}
+	if (insn->insn == INSN_GTOD) {
+		struct timespec ts;
+
+		clock_gettime(CLOCK_REALTIME, &ts);
+		insn->data[0] = ts.tv_sec;
+		insn->data[1] = ts.tv_nsec / 1000;
+		return insn->n;
+	}
+	if (s->type == COMEDI_SUBD_DIO) {
+		if (insn->insn == INSN_BITS) {
+			mask = insn->data[0] << chan;
+			bits = insn->data[1] << chan;
+			it->dio = (it->dio & ~mask) | (bits & mask);
+			insn->data[1] = it->dio >> chan;
+			return insn->n;
+		}
+		if (insn->insn == INSN_CONFIG) {
+			if (chan >= (unsigned int) s->n_chan)
+				return -EINVAL;
+			if (insn->data[0] == INSN_CONFIG_DIO_QUERY)
+				insn->data[1] = it->dio_out & (1u << chan) ? COMEDI_OUTPUT : COMEDI_INPUT;
+			else if (insn->data[0] == INSN_CONFIG_DIO_OUTPUT)
+				it->dio_out |= 1u << chan;
+			else if (insn->data[0] == INSN_CONFIG_DIO_INPUT)
+				it->dio_out &= ~(1u << chan);
+			else
+				return -EINVAL;
+			return insn->n;
+		}
+	}
+	if (chan >= (unsigned int) s->n_chan || CR_RANGE(insn->chanspec) >= (unsigned int) s->n_ranges)
+		return -EINVAL;
+	for (i = 0; i < insn->n; i++) {
+		if (insn->insn == INSN_READ) {
+			if (s->type == COMEDI_SUBD_AI) {
+				if (realtime)
+					spin_ns(s->conv_ns);
+				t = now_ns() - it->t0;
+				insn->data[i] = ai_code(it, chan, t);
+			} else if (s->type == COMEDI_SUBD_AO) {
+				insn->data[i] = it->ao[chan];
+			} else {
+				insn->data[i] = (it->dio >> chan) & 1;
+			}
+		} else if (insn->insn == INSN_WRITE) {
+			if (s->type == COMEDI_SUBD_AO) {
+				if (realtime)
+					spin_ns(s->conv_ns);
+				it->ao[chan] = insn->data[i] & s->maxdata;
+			} else if (s->type == COMEDI_SUBD_DIO) {
+				it->dio = (it->dio & ~(1u << chan)) | ((insn->data[i] & 1) << chan);
+			} else {
+				return -EINVAL;
+			}
+		} else {
+			return -EINVAL;
+		}
+	}
+	return insn->n;
+}
+
+comedi_t *comedi_open(const char *fn)
+{
+	const char *list, *name;
+	comedi_t *it;
+	double t;
+	size_t len;
+	int minor, i;
+
+	mock_init();
+	t = begin(C_OPEN);
+	if (!fn || sscanf(fn, "/dev/comedi%d", &minor) != 1 || minor < 0 || minor >= MOCK_DEVS) {
+		fail(C_OPEN, t, ENOENT);
+		return NULL;
+	}
+	/* the minor'th name of the comma list */
+	list = getenv("COMEDI_MOCK");
+	if (!list)
+		list = "gertboard";
+	for (name = list, i = 0; i < minor && name; i++)
+		name = (name = strchr(name, ',')) ? name + 1 : NULL;
+	it = calloc(1, sizeof(*it));
+	if (!name || !it) {
+		free(it);
+		fail(C_OPEN, t, ENODEV);
+		return NULL;
+	}
+	len = strcspn(name, ",");
+	for (i = 0; i < (int) (sizeof(profiles) / sizeof(profiles[0])); i++)
+		if (strlen(profiles[i].name) == len && !strncmp(name, profiles[i].name, len))
+			it->p = &profiles[i];
+	it->bufsz = MOCK_BUFSZ;
+	it->fd = memfd_create("comedi_mock", 0);
+	if (!it->p || it->fd < 0 || ftruncate(it->fd, it->bufsz)
+		|| (it->buf = mmap(NULL, it->bufsz, PROT_READ | PROT_WRITE, MAP_SHARED,
+		it->fd, 0)) == MAP_FAILED) {
+		if (it->fd >= 0)
+			close(it->fd);
+		free(it);
+		fail(C_OPEN, t, ENODEV);
+		return NULL;
+	}
+	it->t0 = now_ns();
+	devs[minor] = it;
+	/* open, DEVINFO, SUBDINFO and CHANINFO and RANGEINFO per subdevice */
+	if (syscall_ns)
+		spin_ns((double) syscall_ns * (3 + 2 * it->p->n_subd));
+	done(C_OPEN, t, 3 + 2 * it->p->n_subd, 0);
+	return it;
+}
+
+int comedi_close(comedi_t *it)
+{
+	double t = begin(C_CLOSE);
+	int i;
+
+	if (!it)
+		return fail(C_CLOSE, t, EINVAL);
+	for (i = 0; i < MOCK_DEVS; i++)
+		if (devs[i] == it)
+			devs[i] = NULL;
+	munmap(it->buf, it->bufsz);
+	close(it->fd);
+	free(it);
+	return ret(C_CLOSE, t, 0, 0);
+}
+
+int comedi_loglevel(int loglevel)
+{
+	(void) loglevel;
+	return 1;
+}
+
+const char *comedi_strerror(int errnum)
+{
+	return strerror(errnum);
+}
+
+void comedi_perror(const char *s)
+{
+	fprintf(stderr, "%s: %s\n", s, strerror(mock_errno));
+}
+
+int comedi_errno(void)
+{
+	return mock_errno;
+}
+
+int comedi_fileno(comedi_t *it)
+{
+	return it ? it->fd : -1;
+}
+
+enum comedi_oor_behavior comedi_set_global_oor_behavior(enum comedi_oor_behavior behavior)
+{
+	enum comedi_oor_behavior old = oor;
+
+	oor = behavior;
+	return old;
+}
+
+/* queries libcomedi answers from what comedi_open read */
+int comedi_get_n_subdevices(comedi_t *it)
+{
+	double t = begin(C_QUERY);
+
+	return it ? ret(C_QUERY, t, it->p->n_subd, 0) : fail(C_QUERY, t, EINVAL);
+}
+
+int comedi_get_version_code(comedi_t *it)
+{
+	(void) it;
+	return COMEDI_VERSION_CODE(0, 7, 76);
+}
+
+const char *comedi_get_driver_name(comedi_t *it)
+{
+	return it ? it->p->driver : NULL;
+}
+
+const char *comedi_get_board_name(comedi_t *it)
+{
+	return it ? it->p->board : NULL;
+}
+
+int comedi_get_read_subdevice(comedi_t *it)
+{
+	return it ? it->p->read_subd : -1;
+}
+
+int comedi_get_write_subdevice(comedi_t *it)
+{
+	(void) it;
+	return -1;
+}
+
+int comedi_get_subdevice_type(comedi_t *it, unsigned int subdevice)
+{
+	double t = begin(C_QUERY);
+	const struct mock_subd *s = find_subd(it, subdevice);
+
+	return s ? ret(C_QUERY, t, s->type, 0) : fail(C_QUERY, t, EINVAL);
+}
+
+int comedi_find_subdevice_by_type(comedi_t *it, int type, unsigned int start)
+{
+	double t = begin(C_QUERY);
+	unsigned int i;
+
+	for (i = start; it && i < (unsigned int) it->p->n_subd; i++)
+		if (it->p->subd[i].type == type)
+			return ret(C_QUERY, t, i, 0);
+	return fail(C_QUERY, t, ENODEV);
+}
+
+int comedi_get_subdevice_flags(comedi_t *it, unsigned int subdevice)
+{
+	double t = begin(C_QUERY);
+	const struct mock_subd *s = find_subd(it, subdevice);
+
+	if (!s)
+		return fail(C_QUERY, t, EINVAL);
+	return ret(C_QUERY, t, s->flags | (subdevice == (unsigned int) it->p->read_subd
+		&& it->running ? SDF_RUNNING | SDF_BUSY : 0), 0);
+}
+
+int comedi_get_n_channels(comedi_t *it, unsigned int subdevice)
+{
+	double t = begin(C_QUERY);
+	const struct mock_subd *s = find_subd(it, subdevice);
+
+	return s ? ret(C_QUERY, t, s->n_chan, 0) : fail(C_QUERY, t, EINVAL);
+}
+
+int comedi_range_is_chan_specific(comedi_t *it, unsigned int subdevice)
+{
+	(void) it;
+	(void) subdevice;
+	return 0;
+}
+
+int comedi_maxdata_is_chan_specific(comedi_t *it, unsigned int subdevice)
+{
+	(void) it;
+	(void) subdevice;
+	return 0;
+}
+
+lsampl_t comedi_get_maxdata(comedi_t *it, unsigned int subdevice, unsigned int chan)
+{
+	double t = begin(C_QUERY);
+	const struct mock_subd *s = find_subd(it, subdevice);
+
+	if (!s || chan >= (unsigned int) s->n_chan)
+		return fail(C_QUERY, t, EINVAL), 0;
+	return ret(C_QUERY, t, 0, 0), s->maxdata;
+}
+
+int comedi_get_n_ranges(comedi_t *it, unsigned int subdevice, unsigned int chan)
+{
+	double t = begin(C_QUERY);
+	const struct mock_subd *s = find_subd(it, subdevice);
+
+	if (!s || chan >= (unsigned int) s->n_chan)
+		return fail(C_QUERY, t, EINVAL);
+	return ret(C_QUERY, t, s->n_ranges, 0);
+}
+
+comedi_range *comedi_get_range(comedi_t *it, unsigned int subdevice, unsigned int chan,
+			       unsigned int range)
+{
+	double t = begin(C_QUERY);
+	const struct mock_subd *s = find_subd(it, subdevice);
+
+	if (!s || chan >= (unsigned int) s->n_chan || range >= (unsigned int) s->n_ranges) {
+		fail(C_QUERY, t, EINVAL);
+		return NULL;
+	}
+	ret(C_QUERY, t, 0, 0);
+	/* libcomedi hands out its own copy too, clients write through it */
+	return (comedi_range *) &s->range[range];
+}
+
+int comedi_find_range(comedi_t *it, unsigned int subd, unsigned int chan, unsigned int unit,
+		      double min, double max)
+{
+	double t = begin(C_QUERY);
+	const struct mock_subd *s = find_subd(it, subd);
+	int i, best = -1;
+
+	(void) chan;
+	/* the smallest range that holds min to max */
+	for (i = 0; s && i < s->n_ranges; i++)
+		if (s->range[i].unit == unit && s->range[i].min <= min && s->range[i].max >= max
+			&& (best < 0 || s->range[i].max - s->range[i].min
+			< s->range[best].max - s->range[best].min))
+			best = i;
+	return best < 0 ? fail(C_QUERY, t, EINVAL) : ret(C_QUERY, t, best, 0);
+}
+
+double comedi_to_phys(lsampl_t data, comedi_range *rng, lsampl_t maxdata)
+{
+	if (!rng)
+		return NAN;
+	if (oor == COMEDI_OOR_NAN && (data == 0 || data == maxdata))
+		return NAN;
+	return rng->min + (rng->max - rng->min) * data / maxdata;
+}
+
+lsampl_t comedi_from_phys(double data, comedi_range *rng, lsampl_t maxdata)
+{
+	double x;
+
+	if (!rng)
+		return 0;
+	x = (data - rng->min) / (rng->max - rng->min) * maxdata;
+	if (x < 0.0)
+		return 0;
+	if (x > maxdata)
+		return maxdata;
+	return (lsampl_t) (x + 0.5);
+}
+
+int comedi_sampl_to_phys(double *dest, int dst_stride, sampl_t *src, int src_stride,
+			 comedi_range *rng, lsampl_t maxdata, int n)
+{
+	int i, oor_n = 0;
+
+	for (i = 0; i < n; i++) {
+		sampl_t v = *(sampl_t *) ((char *) src + i * src_stride);
+
+		*(double *) ((char *) dest + i * dst_stride) = comedi_to_phys(v, rng, maxdata);
+		oor_n += v == 0 || v == maxdata;
+	}
+	return oor_n;
+}
+
+int comedi_sampl_from_phys(sampl_t *dest, int dst_stride, double *src, int src_stride,
+			   comedi_range *rng, lsampl_t maxdata, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		*(sampl_t *) ((char *) dest + i * dst_stride) =
+			comedi_from_phys(*(double *) ((char *) src + i * src_stride), rng, maxdata);
+	return 0;
+}
+
+/* the mock has no calibration files, boards come up hardware calibrated */
+char *comedi_get_default_calibration_path(comedi_t *it)
+{
+	(void) it;
+	mock_errno = errno = ENOENT;
+	return NULL;
+}
+
+comedi_calibration_t *comedi_parse_calibration_file(const char *cal_file_path)
+{
+	(void) cal_file_path;
+	mock_errno = errno = ENOENT;
+	return NULL;
+}
+
+void comedi_cleanup_calibration(comedi_calibration_t *calibration)
+{
+	(void) calibration;
+}
+
+static int in_list(const unsigned int *list, unsigned int n, unsigned int v)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		if (list[i] == v)
+			return 1;
+	return !n; /* an empty list is all of them */
+}
+
+/* the first setting of the calibration for subdevice, channel and range */
+int comedi_get_softcal_converter(unsigned subdevice, unsigned channel, unsigned range,
+				 enum comedi_conversion_direction direction,
+				 const comedi_calibration_t *calibration,
+				 comedi_polynomial_t *polynomial)
+{
+	const comedi_calibration_setting_t *cs;
+	const comedi_polynomial_t *p;
+	unsigned int i;
+
+	for (i = 0; calibration && i < calibration->num_settings; i++) {
+		cs = &calibration->settings[i];
+		p = direction == COMEDI_TO_PHYSICAL ? cs->soft_calibration.to_phys
+			: cs->soft_calibration.from_phys;
+		if (cs->subdevice != subdevice || !p || !in_list(cs->channels, cs->num_channels, channel)
+			|| !in_list(cs->ranges, cs->num_ranges, range))
+			continue;
+		*polynomial = *p;
+		return 0;
+	}
+	mock_errno = errno = EINVAL;
+	return -1;
+}
+
+/* linear from the range and maxdata like libcomedi without a calibration */
+int comedi_get_hardcal_converter(comedi_t *it, unsigned subdevice, unsigned channel,
+				 unsigned range, enum comedi_conversion_direction direction,
+				 comedi_polynomial_t *polynomial)
+{
+	double t = begin(C_QUERY);
+	const struct mock_subd *s = find_subd(it, subdevice);
+	const comedi_range *rng;
+
+	if (!s || channel >= (unsigned int) s->n_chan || range >= (unsigned int) s->n_ranges)
+		return fail(C_QUERY, t, EINVAL);
+	rng = &s->range[range];
+	memset(polynomial, 0, sizeof(*polynomial));
+	polynomial->order = 1;
+	if (direction == COMEDI_TO_PHYSICAL) {
+		polynomial->coefficients[0] = rng->min;
+		polynomial->coefficients[1] = (rng->max - rng->min) / s->maxdata;
+	} else {
+		polynomial->expansion_origin = rng->min;
+		polynomial->coefficients[1] = s->maxdata / (rng->max - rng->min);
+	}
+	return ret(C_QUERY, t, 0, 0);
+}
+
+static double poly(const comedi_polynomial_t *p, double x)
+{
+	double v = 0.0, term = 1.0;
+	unsigned int i;
+
+	x -= p->expansion_origin;
+	for (i = 0; i <= p->order && i < COMEDI_MAX_NUM_POLYNOMIAL_COEFFICIENTS; i++) {
+		v += p->coefficients[i] * term;
+		term *= x;
+	}
+	return v;
+}
+
+double comedi_to_physical(lsampl_t data, const comedi_polynomial_t *conversion_polynomial)
+{
+	return poly(conversion_polynomial, data);
+}
+
+lsampl_t comedi_from_physical(double data, const comedi_polynomial_t *conversion_polynomial)
+{
+	double x = poly(conversion_polynomial, data);
+
+	return x < 0.0 ? 0 : (lsampl_t) (x + 0.5);
+}
+
+int comedi_do_insn(comedi_t *it, comedi_insn *insn)
+{
+	double t = begin(C_DO_INSN);
+	int r = it && insn ? insn_data(it, insn) : -EINVAL;
+
+	return r < 0 ? fail(C_DO_INSN, t, -r) : ret(C_DO_INSN, t, r, insn->n);
+}
+
+int comedi_do_insnlist(comedi_t *it, comedi_insnlist *il)
+{
+	double t = begin(C_DO_INSNLIST);
+	unsigned int i, n = 0;
+	int r;
+
+	for (i = 0; it && il && i < il->n_insns; i++) {
+		r = insn_data(it, &il->insns[i]);
+		if (r < 0)
+			return i ? ret(C_DO_INSNLIST, t, i, n) : fail(C_DO_INSNLIST, t, -r);
+		n += il->insns[i].n;
+	}
+	return ret(C_DO_INSNLIST, t, i, n);
+}
+
+static int data_rw(enum mock_call c, comedi_t *it, unsigned int insn_type, unsigned int subd,
+		   unsigned int chan, unsigned int range, unsigned int aref, lsampl_t *data,
+		   unsigned int n)
+{
+	double t = begin(c);
+	comedi_insn insn = {
+		.insn = insn_type,
+		.n = n,
+		.data = data,
+		.subdev = subd,
+		.chanspec = CR_PACK(chan, range, aref),
+	};
+	int r = it ? insn_data(it, &insn) : -EINVAL;
+
+	return r < 0 ? fail(c, t, -r) : ret(c, t, c == C_DATA_READ_N ? r : 1, n);
+}
+
+int comedi_data_read(comedi_t *it, unsigned int subd, unsigned int chan, unsigned int range,
+		     unsigned int aref, lsampl_t *data)
+{
+	return data_rw(C_DATA_READ, it, INSN_READ, subd, chan, range, aref, data, 1);
+}
+
+int comedi_data_read_n(comedi_t *it, unsigned int subd, unsigned int chan, unsigned int range,
+		       unsigned int aref, lsampl_t *data, unsigned int n)
+{
+	return data_rw(C_DATA_READ_N, it, INSN_READ, subd, chan, range, aref, data, n);
+}
+
+int comedi_data_read_hint(comedi_t *it, unsigned int subd, unsigned int chan,
+			  unsigned int range, unsigned int aref)
+{
+	lsampl_t dummy;
+	double t = begin(C_DATA_READ_HINT);
+	comedi_insn insn = {
+		.insn = INSN_READ,
+		.n = 0,
+		.data = &dummy,
+		.subdev = subd,
+		.chanspec = CR_PACK(chan, range, aref),
+	};
+	int r = it ? insn_data(it, &insn) : -EINVAL;
+
+	return r < 0 ? fail(C_DATA_READ_HINT, t, -r) : ret(C_DATA_READ_HINT, t, 0, 0);
+}
+
+/* libcomedi sends the hint, an INSN_WAIT and the read as one insnlist */
+int comedi_data_read_delayed(comedi_t *it, unsigned int subd, unsigned int chan,
+			     unsigned int range, unsigned int aref, lsampl_t *data,
+			     unsigned int nano_sec)
+{
+	if (realtime)
+		spin_ns(nano_sec);
+	return data_rw(C_DATA_READ_DELAYED, it, INSN_READ, subd, chan, range, aref, data, 1);
+}
+
+int comedi_data_write(comedi_t *it, unsigned int subd, unsigned int chan, unsigned int range,
+		      unsigned int aref, lsampl_t data)
+{
+	return data_rw(C_DATA_WRITE, it, INSN_WRITE, subd, chan, range, aref, &data, 1);
+}
+
+static int dio_config(enum mock_call c, comedi_t *it, unsigned int subd, unsigned int chan,
+		      lsampl_t *data)
+{
+	double t = begin(c);
+	comedi_insn insn = {
+		.insn = INSN_CONFIG,
+		.n = 2,
+		.data = data,
+		.subdev = subd,
+		.chanspec = CR_PACK(chan, 0, 0),
+	};
+	int r = it ? insn_data(it, &insn) : -EINVAL;
+
+	return r < 0 ? fail(c, t, -r) : ret(c, t, 1, 0);
+}
+
+int comedi_dio_config(comedi_t *it, unsigned int subd, unsigned int chan, unsigned int dir)
+{
+	lsampl_t data[2] = {dir, 0};
+
+	return dio_config(C_DIO_CONFIG, it, subd, chan, data);
+}
+
+int comedi_dio_get_config(comedi_t *it, unsigned int subd, unsigned int chan, unsigned int *dir)
+{
+	lsampl_t data[2] = {INSN_CONFIG_DIO_QUERY, 0};
+	int r = dio_config(C_DIO_CONFIG, it, subd, chan, data);
+
+	if (r >= 0)
+		*dir = data[1];
+	return r;
+}
+
+int comedi_dio_read(comedi_t *it, unsigned int subd, unsigned int chan, unsigned int *bit)
+{
+	lsampl_t data;
+	int r = data_rw(C_DIO_READ, it, INSN_READ, subd, chan, 0, 0, &data, 1);
+
+	if (r >= 0)
+		*bit = data;
+	return r;
+}
+
+int comedi_dio_write(comedi_t *it, unsigned int subd, unsigned int chan, unsigned int bit)
+{
+	lsampl_t data = bit;
+
+	return data_rw(C_DIO_WRITE, it, INSN_WRITE, subd, chan, 0, 0, &data, 1);
+}
+
+int comedi_dio_bitfield2(comedi_t *it, unsigned int subd, unsigned int write_mask,
+			 unsigned int *bits, unsigned int base_channel)
+{
+	double t = begin(C_DIO_BITFIELD);
+	lsampl_t data[2] = {write_mask, *bits};
+	comedi_insn insn = {
+		.insn = INSN_BITS,
+		.n = 2,
+		.data = data,
+		.subdev = subd,
+		.chanspec = CR_PACK(base_channel, 0, 0),
+	};
+	int r = it ? insn_data(it, &insn) : -EINVAL;
+
+	if (r < 0)
+		return fail(C_DIO_BITFIELD, t, -r);
+	*bits = data[1];
+	return ret(C_DIO_BITFIELD, t, 0, 0);
+}
+
+int comedi_dio_bitfield(comedi_t *it, unsigned int subd, unsigned int write_mask,
+			unsigned int *bits)
+{
+	return comedi_dio_bitfield2(it, subd, write_mask, bits, 0);
+}
+
+int comedi_lock(comedi_t *it, unsigned int subdevice)
+{
+	double t = begin(C_OTHER);
+
+	if (!find_subd(it, subdevice))
+		return fail(C_OTHER, t, EINVAL);
+	if (it->locked & (1 << subdevice))
+		return fail(C_OTHER, t, EBUSY);
+	it->locked |= 1 << subdevice;
+	return ret(C_OTHER, t, 0, 0);
+}
+
+int comedi_unlock(comedi_t *it, unsigned int subdevice)
+{
+	double t = begin(C_OTHER);
+
+	if (!find_subd(it, subdevice))
+		return fail(C_OTHER, t, EINVAL);
+	it->locked &= ~(1 << subdevice);
+	return ret(C_OTHER, t, 0, 0);
+}
+
+/*
+ * the AI command, samples are made from the wall clock whenever the
+ * client looks at the buffer
+ */
+static void fill(comedi_t *it)
+{
+	uint64_t due, room, end;
+	unsigned int chan;
+	double t;
+
+	if (!it->running)
+		return;
+	due = (uint64_t) ((now_ns() - it->start) / it->sample_ns) + 1;
+	if (it->total && due > it->total)
+		due = it->total;
+	room = (it->bufsz - (it->head - it->tail)) / it->bps;
+	end = due;
+	if (due - it->made > room) {
+		end = it->made + room;
+		it->overrun = 1;
+	}
+	for (; it->made < end; it->made++) {
+		chan = CR_CHAN(it->chanlist[it->made % it->cmd.chanlist_len]);
+		t = it->start - it->t0 + it->made * it->sample_ns;
+		if (it->bps == 4)
+			*(uint32_t *) (it->buf + it->head % it->bufsz) = ai_code(it, chan, t);
+		else
+			*(uint16_t *) (it->buf + it->head % it->bufsz) = ai_code(it, chan, t);
+		it->head += it->bps;
+	}
+	if (it->overrun || (it->total && it->made == it->total))
+		it->running = 0;
+}
+
+int comedi_get_cmd_src_mask(comedi_t *it, unsigned int subdevice, comedi_cmd *cmd)
+{
+	double t = begin(C_OTHER);
+
+	if (!it || (int) subdevice != it->p->read_subd)
+		return fail(C_OTHER, t, EIO);
+	memset(cmd, 0, sizeof(*cmd));
+	cmd->subdev = subdevice;
+	cmd->start_src = TRIG_NOW | TRIG_INT;
+	cmd->scan_begin_src = TRIG_TIMER | TRIG_FOLLOW;
+	cmd->convert_src = TRIG_TIMER | TRIG_NOW;
+	cmd->scan_end_src = TRIG_COUNT;
+	cmd->stop_src = TRIG_COUNT | TRIG_NONE;
+	return ret(C_OTHER, t, 0, 0);
+}
+
+/* the driver cmdtest: 1 for sources it can't do, 3 when it moved an argument */
+static int cmdtest(comedi_t *it, comedi_cmd *cmd)
+{
+	const struct mock_subd *s;
+	unsigned int chans, min, err = 0;
+
+	if (!it || (int) cmd->subdev != it->p->read_subd)
+		return -EIO;
+	s = &it->p->subd[cmd->subdev];
+	if (!(cmd->start_src & (TRIG_NOW | TRIG_INT)) || (cmd->start_src & (cmd->start_src - 1))
+		|| !(cmd->scan_begin_src & (TRIG_TIMER | TRIG_FOLLOW))
+		|| !(cmd->convert_src & (TRIG_TIMER | TRIG_NOW))
+		|| cmd->scan_end_src != TRIG_COUNT
+		|| !(cmd->stop_src & (TRIG_COUNT | TRIG_NONE)))
+		return 1;
+	chans = cmd->chanlist_len;
+	if (!chans || chans > (unsigned int) s->len_chanlist || chans > MOCK_CHANLIST) {
+		cmd->chanlist_len = chans = chans ? s->len_chanlist : 1;
+		err++;
+	}
+	if (cmd->scan_end_arg != chans) {
+		cmd->scan_end_arg = chans;
+		err++;
+	}
+	min = s->conv_ns * chans;
+	if (cmd->scan_begin_src == TRIG_TIMER && cmd->scan_begin_arg < min) {
+		cmd->scan_begin_arg = min;
+		err++;
+	}
+	if (cmd->convert_src == TRIG_TIMER && cmd->convert_arg < s->conv_ns) {
+		cmd->convert_arg = s->conv_ns;
+		err++;
+	}
+	if (cmd->stop_src == TRIG_COUNT && !cmd->stop_arg) {
+		cmd->stop_arg = 1;
+		err++;
+	}
+	return err ? 3 : 0;
+}
+
+int comedi_command_test(comedi_t *it, comedi_cmd *cmd)
+{
+	double t = begin(C_COMMAND_TEST);
+	int r = cmdtest(it, cmd);
+
+	return r < 0 ? fail(C_COMMAND_TEST, t, -r) : ret(C_COMMAND_TEST, t, r, 0);
+}
+
+int comedi_get_cmd_generic_timed(comedi_t *it, unsigned int subdevice, comedi_cmd *cmd,
+				 unsigned chanlist_len, unsigned scan_period_ns)
+{
+	double t = begin(C_OTHER);
+	int r;
+
+	if (!it || (int) subdevice != it->p->read_subd)
+		return fail(C_OTHER, t, EIO);
+	memset(cmd, 0, sizeof(*cmd));
+	cmd->subdev = subdevice;
+	cmd->start_src = TRIG_NOW;
+	cmd->scan_begin_src = TRIG_TIMER;
+	cmd->scan_begin_arg = scan_period_ns;
+	cmd->convert_src = TRIG_TIMER;
+	cmd->convert_arg = chanlist_len ? scan_period_ns / chanlist_len : 0;
+	cmd->scan_end_src = TRIG_COUNT;
+	cmd->scan_end_arg = chanlist_len;
+	cmd->stop_src = TRIG_COUNT;
+	cmd->stop_arg = 2;
+	cmd->chanlist_len = chanlist_len;
+	r = cmdtest(it, cmd);
+	r = cmdtest(it, cmd); /* libcomedi tests twice, then the arguments settle */
+	return r ? fail(C_OTHER, t, EINVAL) : ret(C_OTHER, t, 0, 0);
+}
+
+int comedi_command(comedi_t *it, comedi_cmd *cmd)
+{
+	double t = begin(C_COMMAND);
+	double period;
+	unsigned int i;
+
+	if (!it || !cmd || !cmd->chanlist)
+		return fail(C_COMMAND, t, EINVAL);
+	if (it->running)
+		return fail(C_COMMAND, t, EBUSY);
+	if (cmdtest(it, cmd))
+		return fail(C_COMMAND, t, EINVAL);
+	it->cmd = *cmd;
+	for (i = 0; i < cmd->chanlist_len; i++)
+		it->chanlist[i] = cmd->chanlist[i];
+	/* the scan period spread over its conversions, or back to back */
+	if (cmd->scan_begin_src == TRIG_TIMER)
+		period = (double) cmd->scan_begin_arg / cmd->chanlist_len;
+	else if (cmd->convert_src == TRIG_TIMER)
+		period = cmd->convert_arg;
+	else
+		period = it->p->subd[cmd->subdev].conv_ns;
+	it->sample_ns = period;
+	it->bps = it->p->subd[cmd->subdev].flags & SDF_LSAMPL ? 4 : 2;
+	it->total = cmd->stop_src == TRIG_COUNT
+		? (uint64_t) cmd->stop_arg * cmd->chanlist_len : 0;
+	it->made = it->head = it->tail = 0;
+	it->overrun = 0;
+	it->armed = cmd->start_src == TRIG_INT;
+	it->running = !it->armed;
+	it->start = now_ns();
+	return ret(C_COMMAND, t, 0, 0);
+}
+
+int comedi_internal_trigger(comedi_t *it, unsigned subd, unsigned trignum)
+{
+	double t = begin(C_OTHER);
+
+	(void) trignum;
+	if (!it || !it->armed || (int) subd != it->p->read_subd)
+		return fail(C_OTHER, t, EINVAL);
+	it->armed = 0;
+	it->running = 1;
+	it->start = now_ns();
+	return ret(C_OTHER, t, 0, 0);
+}
+
+int comedi_cancel(comedi_t *it, unsigned int subdevice)
+{
+	double t = begin(C_CANCEL);
+
+	(void) subdevice;
+	if (!it)
+		return fail(C_CANCEL, t, EINVAL);
+	it->running = it->armed = it->overrun = 0;
+	it->head = it->tail = 0;
+	return ret(C_CANCEL, t, 0, 0);
+}
+
+int comedi_poll(comedi_t *it, unsigned int subdevice)
+{
+	double t = begin(C_POLL);
+
+	if (!it || (int) subdevice != it->p->read_subd)
+		return fail(C_POLL, t, EINVAL);
+	fill(it);
+	return ret(C_POLL, t, it->head - it->tail, 0);
+}
+
+int comedi_get_buffer_contents(comedi_t *it, unsigned int subdev)
+{
+	double t = begin(C_BUF_CONTENTS);
+
+	(void) subdev;
+	if (!it)
+		return fail(C_BUF_CONTENTS, t, EINVAL);
+	fill(it);
+	if (it->overrun && it->head == it->tail)
+		return fail(C_BUF_CONTENTS, t, EPIPE);
+	return ret(C_BUF_CONTENTS, t, it->head - it->tail, 0);
+}
+
+int comedi_mark_buffer_read(comedi_t *it, unsigned int subdev, unsigned int bytes)
+{
+	double t = begin(C_BUF_READ);
+
+	(void) subdev;
+	if (!it)
+		return fail(C_BUF_READ, t, EINVAL);
+	fill(it);
+	if (bytes > it->head - it->tail)
+		bytes = it->head - it->tail;
+	it->tail += bytes;
+	return ret(C_BUF_READ, t, bytes, bytes / (it->bps ? it->bps : 2));
+}
+
+int comedi_mark_buffer_written(comedi_t *it, unsigned int subdev, unsigned int bytes)
+{
+	double t = begin(C_OTHER);
+
+	(void) it;
+	(void) subdev;
+	(void) bytes;
+	return fail(C_OTHER, t, EINVAL); /* no AO commands */
+}
+
+int comedi_get_buffer_offset(comedi_t *it, unsigned int subdev)
+{
+	double t = begin(C_BUF_OFFSET);
+
+	(void) subdev;
+	if (!it)
+		return fail(C_BUF_OFFSET, t, EINVAL);
+	return ret(C_BUF_OFFSET, t, it->tail % it->bufsz, 0);
+}
+
+int comedi_get_buffer_size(comedi_t *it, unsigned int subdev)
+{
+	double t = begin(C_BUF_SIZE);
+
+	(void) subdev;
+	return it ? ret(C_BUF_SIZE, t, it->bufsz, 0) : fail(C_BUF_SIZE, t, EINVAL);
+}
+
+int comedi_get_max_buffer_size(comedi_t *it, unsigned int subdev)
+{
+	double t = begin(C_BUF_SIZE);
+
+	(void) subdev;
+	return it ? ret(C_BUF_SIZE, t, MOCK_BUFMAX, 0) : fail(C_BUF_SIZE, t, EINVAL);
+}
+
+int comedi_set_max_buffer_size(comedi_t *it, unsigned int subdev, unsigned int max_size)
+{
+	double t = begin(C_BUF_SIZE);
+
+	(void) subdev;
+	(void) max_size;
+	return it ? ret(C_BUF_SIZE, t, MOCK_BUFMAX, 0) : fail(C_BUF_SIZE, t, EINVAL);
+}
+
+/* page multiples like the driver, not while a command runs */
+int comedi_set_buffer_size(comedi_t *it, unsigned int subdev, unsigned int len)
+{
+	double t = begin(C_BUF_SIZE);
+	uint8_t *buf;
+	long page = sysconf(_SC_PAGESIZE);
+
+	(void) subdev;
+	if (!it)
+		return fail(C_BUF_SIZE, t, EINVAL);
+	if (it->running || it->armed)
+		return fail(C_BUF_SIZE, t, EBUSY);
+	len = (len + page - 1) / page * page;
+	if (!len || len > MOCK_BUFMAX)
+		return fail(C_BUF_SIZE, t, EINVAL);
+	if (ftruncate(it->fd, len))
+		return fail(C_BUF_SIZE, t, errno);
+	buf = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, it->fd, 0);
+	if (buf == MAP_FAILED)
+		return fail(C_BUF_SIZE, t, errno);
+	munmap(it->buf, it->bufsz);
+	it->buf = buf;
+	it->bufsz = len;
+	it->head = it->tail = 0;
+	return ret(C_BUF_SIZE, t, len, 0);
+}
+
+/*
+ * read() on the mock fd streams the buffer like the device node: it
+ * blocks until samples are due, 0 at the end of the command and EPIPE
+ * after an overrun, other fds go to the kernel
+ */
+ssize_t read(int fd, void *dst, size_t count)
+{
+	comedi_t *it = NULL;
+	size_t n, off, first;
+	double t, wait;
+	int i;
+
+	for (i = 0; i < MOCK_DEVS; i++)
+		if (devs[i] && devs[i]->fd == fd)
+			it = devs[i];
+	if (!it)
+		return syscall(SYS_read, fd, dst, count);
+	t = begin(C_READ);
+	if (count < it->bps) // the driver moves whole samples, 0 would read as the end
+		return fail(C_READ, t, EINVAL);
+	for (;;) {
+		fill(it);
+		if (it->head != it->tail)
+			break;
+		if (it->overrun)
+			return fail(C_READ, t, EPIPE);
+		if (!it->running && !it->armed)
+			return ret(C_READ, t, 0, 0);
+		/* sleep to the next sample */
+		wait = it->start + it->made * it->sample_ns - now_ns();
+		if (wait > 0.0) {
+			struct timespec ts = {(time_t) (wait / 1e9), (long) fmod(wait, 1e9)};
+
+			nanosleep(&ts, NULL);
+		}
+	}
+	n = it->head - it->tail;
+	if (n > count)
+		n = count - count % it->bps;
+	off = it->tail % it->bufsz;
+	first = n < it->bufsz - off ? n : it->bufsz - off;
+	memcpy(dst, it->buf + off, first);
+	memcpy((uint8_t *) dst + first, it->buf, n - first);
+	it->tail += n;
+	return ret(C_READ, t, n, n / it->bps);
+}
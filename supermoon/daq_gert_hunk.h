@@ -0,0 +1,90 @@
+/*
+ * daq_gert hunk length arithmetic
+ *
+ * Included by the driver and by the daqgert_hunk host program, so the host
+ * runs the sizing and adapt code the driver runs. Only plain numbers go in,
+ * the driver takes them from the comedi_cmd and its subdevice.
+ */
+#ifndef DAQ_GERT_HUNK_H
+#define DAQ_GERT_HUNK_H
+
+#ifdef __KERNEL__
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#else
+#include <stdint.h>
+#define min_t(type, x, y)	((type) (x) < (type) (y) ? (type) (x) : (type) (y))
+#define max_t(type, x, y)	((type) (x) > (type) (y) ? (type) (x) : (type) (y))
+#define rounddown(x, y)		((x) - ((x) % (y)))
+
+static inline uint64_t div_u64(uint64_t dividend, uint32_t divisor)
+{
+	return dividend / divisor;
+}
+#endif
+
+/* what the hunk size of a command depends on */
+struct daqgert_hunk_cmd {
+	uint32_t hunk_len, hunk_cap; /* the hunk_len parameter and HUNK_LEN */
+	int32_t latency_us; /* hunk_latency_us */
+	uint32_t buf_samples; /* prealloc_bufsz in samples, 0 for no buffer */
+	uint32_t chans; /* chanlist_len */
+	int32_t counted; /* stop_src is TRIG_COUNT */
+	uint32_t stop_arg;
+	uint32_t scan_ns, convert_ns; /* scan_begin_arg and convert_arg for TRIG_TIMER, else 0 */
+	int32_t wake_eos; /* CMDF_WAKE_EOS */
+};
+
+/*
+ * transfers per hunk for a command, in whole scans: the largest is
+ * hunk_len, half the Comedi buffer or the whole command, the one to start
+ * with and return to is a hunk every latency_us at the asked period,
+ * or a scan for wake_eos
+ */
+static inline uint32_t daqgert_hunk_size(const struct daqgert_hunk_cmd *c,
+					 uint32_t *max_len)
+{
+	uint32_t len = min_t(uint32_t, c->hunk_len, c->hunk_cap), period = 0;
+	uint32_t chans = max_t(uint32_t, c->chans, 1);
+
+	if (c->buf_samples)
+		len = min_t(uint32_t, len, c->buf_samples / 2);
+	if (c->counted)
+		len = min_t(uint64_t, len, (uint64_t) chans * c->stop_arg);
+	len = max_t(uint32_t, rounddown(len, chans), chans);
+	if (max_len)
+		*max_len = len;
+
+	if (c->wake_eos) {
+		len = chans;
+		if (max_len)
+			*max_len = len;
+	} else if (c->latency_us > 0) {
+		if (c->scan_ns)
+			period = c->scan_ns / chans;
+		else if (c->convert_ns)
+			period = c->convert_ns;
+		if (period)
+			len = min_t(uint64_t, len, div_u64((uint64_t) c->latency_us
+				* 1000, period));
+	}
+	return max_t(uint32_t, rounddown(len, chans), chans);
+}
+
+/*
+ * double the hunk while the buffer of size bytes is over half full, halve
+ * it back to min once the reader has drained it below an eighth
+ */
+static inline uint32_t daqgert_hunk_adapt(uint32_t len, uint32_t fill,
+					  uint32_t size, uint32_t min_len,
+					  uint32_t max_len, uint32_t chans)
+{
+	chans = max_t(uint32_t, chans, 1);
+	if (fill > size / 2)
+		return min_t(uint32_t, len * 2, max_len);
+	if (fill < size / 8)
+		return max_t(uint32_t, rounddown(len / 2, chans), min_len);
+	return len;
+}
+
+#endif /* DAQ_GERT_HUNK_H */
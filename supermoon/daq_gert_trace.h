@@ -0,0 +1,139 @@
+/*
+ * tracepoints for the daq_gert sample pipeline
+ *
+ * echo 1 > /sys/kernel/debug/tracing/events/daq_gert/enable
+ * cat /sys/kernel/debug/tracing/trace_pipe > trace.txt
+ * daqgert_trace trace.txt
+ *
+ * This header goes next to daq_gert.c in drivers/staging/comedi/drivers,
+ * the Makefile needs CFLAGS_daq_gert.o := -I$(src) for define_trace.h to
+ * find it.
+ */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM daq_gert
+
+#if !defined(_DAQ_GERT_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _DAQ_GERT_TRACE_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(daqgert_cmd_start,
+	TP_PROTO(int minor, int hunk, int async, int scans, int chanlist_len),
+	TP_ARGS(minor, hunk, async, scans, chanlist_len),
+	TP_STRUCT__entry(
+		__field(int, minor)
+		__field(int, hunk)
+		__field(int, async)
+		__field(int, scans)
+		__field(int, chanlist_len)
+	),
+	TP_fast_assign(
+		__entry->minor = minor;
+		__entry->hunk = hunk;
+		__entry->async = async;
+		__entry->scans = scans;
+		__entry->chanlist_len = chanlist_len;
+	),
+	TP_printk("minor=%d hunk=%d async=%d scans=%d chans=%d",
+		__entry->minor, __entry->hunk, __entry->async,
+		__entry->scans, __entry->chanlist_len)
+);
+
+TRACE_EVENT(daqgert_cmd_cancel,
+	TP_PROTO(int minor, int ai_count, int hunk_count),
+	TP_ARGS(minor, ai_count, hunk_count),
+	TP_STRUCT__entry(
+		__field(int, minor)
+		__field(int, ai_count)
+		__field(int, hunk_count)
+	),
+	TP_fast_assign(
+		__entry->minor = minor;
+		__entry->ai_count = ai_count;
+		__entry->hunk_count = hunk_count;
+	),
+	TP_printk("minor=%d samples=%d hunks=%d",
+		__entry->minor, __entry->ai_count, __entry->hunk_count)
+);
+
+/* one hunk SPI message, id is the async ping-pong slot or 0 */
+DECLARE_EVENT_CLASS(daqgert_hunk,
+	TP_PROTO(int minor, int id, int len),
+	TP_ARGS(minor, id, len),
+	TP_STRUCT__entry(
+		__field(int, minor)
+		__field(int, id)
+		__field(int, len)
+	),
+	TP_fast_assign(
+		__entry->minor = minor;
+		__entry->id = id;
+		__entry->len = len;
+	),
+	TP_printk("minor=%d id=%d len=%d",
+		__entry->minor, __entry->id, __entry->len)
+);
+
+DEFINE_EVENT(daqgert_hunk, daqgert_hunk_submit,
+	TP_PROTO(int minor, int id, int len),
+	TP_ARGS(minor, id, len)
+);
+
+/* len is the message status here */
+DEFINE_EVENT(daqgert_hunk, daqgert_hunk_complete,
+	TP_PROTO(int minor, int id, int len),
+	TP_ARGS(minor, id, len)
+);
+
+DEFINE_EVENT(daqgert_hunk, daqgert_decode_begin,
+	TP_PROTO(int minor, int id, int len),
+	TP_ARGS(minor, id, len)
+);
+
+DEFINE_EVENT(daqgert_hunk, daqgert_decode_end,
+	TP_PROTO(int minor, int id, int len),
+	TP_ARGS(minor, id, len)
+);
+
+/* samples are in the comedi buffer, the ai count so far and the bytes ready */
+TRACE_EVENT(daqgert_buf_commit,
+	TP_PROTO(int minor, int total, unsigned int ready),
+	TP_ARGS(minor, total, ready),
+	TP_STRUCT__entry(
+		__field(int, minor)
+		__field(int, total)
+		__field(unsigned int, ready)
+	),
+	TP_fast_assign(
+		__entry->minor = minor;
+		__entry->total = total;
+		__entry->ready = ready;
+	),
+	TP_printk("minor=%d total=%d ready=%u",
+		__entry->minor, __entry->total, __entry->ready)
+);
+
+TRACE_EVENT(daqgert_ao_put,
+	TP_PROTO(int minor, int chan, unsigned int val),
+	TP_ARGS(minor, chan, val),
+	TP_STRUCT__entry(
+		__field(int, minor)
+		__field(int, chan)
+		__field(unsigned int, val)
+	),
+	TP_fast_assign(
+		__entry->minor = minor;
+		__entry->chan = chan;
+		__entry->val = val;
+	),
+	TP_printk("minor=%d chan=%d val=%u",
+		__entry->minor, __entry->chan, __entry->val)
+);
+
+#endif /* _DAQ_GERT_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE daq_gert_trace
+#include <trace/define_trace.h>
@@ -0,0 +1,457 @@
+/*
+ * daq_gert async hunk chain on one CPU with a mock SPI master
+ *
+ * cc -O2 -o daqgert_async daqgert_async.c -lpthread
+ * ./daqgert_async [seconds] [hunk_len] [conversion ns]
+ *
+ * Everything is pinned to CPU 0 like a Pi Zero. The mock master runs one
+ * message at a time for msg_ns plus conversion ns per transfer of wall time,
+ * as DMA would, and calls the completion from its own thread like the SPI
+ * message pump. Three AI engines are run, each for the given seconds:
+ *   thread   the bound AI thread: spi_sync of one hunk, decode, next hunk
+ *   poll     the spi_async chain of two hunks, the AI thread wakes every
+ *            750 to 1000 us while hunks are in flight, the old loop
+ *   async    the same chain, the AI thread sleeps on the chain completion
+ * The chain is daqgert_ai_async_submit, _complete and _work with the
+ * HUNK_DECODE and SPI_AI_STALL bits, decoding on an ordered work queue at
+ * decode ns per sample. A probe thread sleeps 1 ms at a time for the wakeup
+ * lateness other tasks see. At the end the command is canceled as
+ * daqgert_ai_cancel does: wait for the chain to end, flush the work queue.
+ * It prints per engine the samples/s, the bus use, the process CPU use, the
+ * AI thread wakeups/s, the context switches/s, the probe p99 lateness, the
+ * decode stalls, the cancel time and the samples out of sequence.
+ * The chain here is a hand written model of the driver's, it does not
+ * build or run supermoon.c and does not test it; a change to the driver's
+ * submit, completion or cancel has to be made here too to keep the numbers
+ * meaningful.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+#define HUNK_DECODE	1
+#define PROBES		100000
+
+enum { THREAD, POLL, ASYNC };
+static const char *names[] = {"thread", "poll", "async"};
+
+static double conv_ns = 30000.0, msg_ns = 14000.0, decode_ns = 200.0;
+static unsigned int hunk_len = 1000;
+
+/* a struct completion */
+struct completion {
+	pthread_mutex_t m;
+	pthread_cond_t c;
+	int done;
+};
+
+static void init_completion(struct completion *x)
+{
+	pthread_mutex_init(&x->m, NULL);
+	pthread_cond_init(&x->c, NULL);
+	x->done = 0;
+}
+
+static void reinit_completion(struct completion *x)
+{
+	pthread_mutex_lock(&x->m);
+	x->done = 0;
+	pthread_mutex_unlock(&x->m);
+}
+
+static void complete_all(struct completion *x)
+{
+	pthread_mutex_lock(&x->m);
+	x->done = 1;
+	pthread_cond_broadcast(&x->c);
+	pthread_mutex_unlock(&x->m);
+}
+
+/* 0 on timeout */
+static int wait_for_completion_timeout(struct completion *x, long ms)
+{
+	struct timespec ts;
+	int done;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += ms / 1000;
+	ts.tv_nsec += (ms % 1000) * 1000000L;
+	if (ts.tv_nsec >= 1000000000L) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+	pthread_mutex_lock(&x->m);
+	while (!x->done && !pthread_cond_timedwait(&x->c, &x->m, &ts))
+		;
+	done = x->done;
+	pthread_mutex_unlock(&x->m);
+	return done;
+}
+
+struct hunk {
+	unsigned int len, seq;	/* first sample number in the rx buffer */
+	int flags;
+	void (*complete)(struct hunk *);
+	struct completion sync;	/* spi_sync */
+};
+
+static struct hunk hunks[2];
+static int run, running, spi_run, stall;	/* devpriv->run, AI_CMD_RUNNING, SPI_AI_RUN, SPI_AI_STALL */
+static struct completion chain_done;
+static unsigned long long decoded, stalls, bad, wakeups, expect;
+static double bus_ns;
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void spin_ns(double ns)
+{
+	double end = now_ns() + ns;
+
+	while (now_ns() < end)
+		;
+}
+
+static void set_bit(int *b)
+{
+	__atomic_store_n(b, 1, __ATOMIC_SEQ_CST);
+}
+
+static void clear_bit(int *b)
+{
+	__atomic_store_n(b, 0, __ATOMIC_SEQ_CST);
+}
+
+static int test_bit(int *b)
+{
+	return __atomic_load_n(b, __ATOMIC_SEQ_CST);
+}
+
+static int test_and_clear_bit(int *b)
+{
+	return __atomic_exchange_n(b, 0, __ATOMIC_SEQ_CST);
+}
+
+/* mock master, one message queue entry at a time */
+static pthread_mutex_t mq_m = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t mq_c = PTHREAD_COND_INITIALIZER;
+static struct hunk *mq[2];
+static int mq_n, master_stop;
+static unsigned int seq;
+
+static void spi_async(struct hunk *h)
+{
+	pthread_mutex_lock(&mq_m);
+	mq[mq_n++] = h;
+	pthread_cond_signal(&mq_c);
+	pthread_mutex_unlock(&mq_m);
+}
+
+static void *master(void *arg)
+{
+	struct hunk *h;
+	struct timespec ts;
+	double t, ns;
+
+	(void) arg;
+	for (;;) {
+		pthread_mutex_lock(&mq_m);
+		while (!mq_n && !master_stop)
+			pthread_cond_wait(&mq_c, &mq_m);
+		if (!mq_n) {
+			pthread_mutex_unlock(&mq_m);
+			return NULL;
+		}
+		h = mq[0];
+		mq[0] = mq[1];
+		mq_n--;
+		pthread_mutex_unlock(&mq_m);
+
+		ns = msg_ns + h->len * conv_ns;
+		t = now_ns() + ns;
+		ts.tv_sec = t / 1e9;
+		ts.tv_nsec = t - ts.tv_sec * 1e9;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+		bus_ns += ns;
+		h->seq = seq;
+		seq += h->len;
+		h->complete(h);
+	}
+}
+
+/* ordered work queue with one worker */
+static pthread_mutex_t wq_m = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wq_c = PTHREAD_COND_INITIALIZER;
+static struct hunk *wq[4];
+static int wq_n, wq_busy, wq_stop;
+
+static void queue_work(struct hunk *h)
+{
+	pthread_mutex_lock(&wq_m);
+	wq[wq_n++] = h;
+	pthread_cond_broadcast(&wq_c);
+	pthread_mutex_unlock(&wq_m);
+}
+
+static void flush_workqueue(void)
+{
+	pthread_mutex_lock(&wq_m);
+	while (wq_n || wq_busy)
+		pthread_cond_wait(&wq_c, &wq_m);
+	pthread_mutex_unlock(&wq_m);
+}
+
+static void decode(struct hunk *h)
+{
+	if (h->seq != expect)
+		bad += h->len;
+	expect = h->seq + h->len;
+	spin_ns(h->len * decode_ns);
+	decoded += h->len;
+}
+
+static int async_submit(struct hunk *h);
+
+/* daqgert_ai_async_work */
+static void async_work(struct hunk *h)
+{
+	if (test_bit(&running))
+		decode(h);
+	__atomic_and_fetch(&h->flags, ~HUNK_DECODE, __ATOMIC_SEQ_CST);
+	if (test_and_clear_bit(&stall)) {
+		stalls++;
+		async_submit(h);
+	}
+}
+
+static void *worker(void *arg)
+{
+	struct hunk *h;
+
+	(void) arg;
+	for (;;) {
+		pthread_mutex_lock(&wq_m);
+		while (!wq_n && !wq_stop)
+			pthread_cond_wait(&wq_c, &wq_m);
+		if (!wq_n) {
+			pthread_mutex_unlock(&wq_m);
+			return NULL;
+		}
+		h = wq[0];
+		memmove(wq, wq + 1, --wq_n * sizeof(wq[0]));
+		wq_busy = 1;
+		pthread_mutex_unlock(&wq_m);
+		async_work(h);
+		pthread_mutex_lock(&wq_m);
+		wq_busy = 0;
+		pthread_cond_broadcast(&wq_c);
+		pthread_mutex_unlock(&wq_m);
+	}
+}
+
+/* daqgert_ai_async_submit, the chain ends on the first refused submit */
+static int async_submit(struct hunk *h)
+{
+	set_bit(&spi_run);
+	if (!test_bit(&run) || !test_bit(&running)) {
+		clear_bit(&spi_run);
+		complete_all(&chain_done);
+		return -1;
+	}
+	spi_async(h);
+	return 0;
+}
+
+/* daqgert_ai_async_complete */
+static void async_complete(struct hunk *h)
+{
+	struct hunk *next = h == &hunks[0] ? &hunks[1] : &hunks[0];
+
+	clear_bit(&spi_run);
+	if (!test_bit(&run) || !test_bit(&running)) {
+		complete_all(&chain_done);
+		return;
+	}
+	__atomic_or_fetch(&h->flags, HUNK_DECODE, __ATOMIC_SEQ_CST);
+	set_bit(&stall);
+	if (!(__atomic_load_n(&next->flags, __ATOMIC_SEQ_CST) & HUNK_DECODE) && test_and_clear_bit(&stall))
+		async_submit(next);
+	queue_work(h);
+}
+
+static void sync_complete(struct hunk *h)
+{
+	complete_all(&h->sync);
+}
+
+/* the AI kthread loop while the command runs */
+static int mode, thread_stop;
+
+static void *ai_thread(void *arg)
+{
+	struct hunk *h = &hunks[0];
+
+	(void) arg;
+	while (!test_bit(&thread_stop)) {
+		wakeups++;
+		if (mode == THREAD) {
+			if (!test_bit(&running)) {
+				usleep(750 + rand() % 250);
+				continue;
+			}
+			reinit_completion(&h->sync);
+			set_bit(&spi_run);
+			spi_async(h);
+			wait_for_completion_timeout(&h->sync, 1000);
+			clear_bit(&spi_run);
+			decode(h);
+		} else if (mode == POLL) {
+			usleep(750 + rand() % 250);
+		} else {
+			if (wait_for_completion_timeout(&chain_done, 100))
+				usleep(750 + rand() % 250); /* chain ended, wait for the cancel */
+		}
+	}
+	return NULL;
+}
+
+/* other tasks: 1 ms sleeps, lateness in us */
+static double probe[PROBES];
+static int nprobe, probe_stop;
+
+static void *prober(void *arg)
+{
+	double t;
+
+	(void) arg;
+	while (!test_bit(&probe_stop)) {
+		t = now_ns();
+		usleep(1000);
+		t = (now_ns() - t) / 1000.0 - 1000.0;
+		if (nprobe < PROBES)
+			probe[nprobe++] = t;
+	}
+	return NULL;
+}
+
+static int cmp(const void *a, const void *b)
+{
+	double x = *(const double *) a, y = *(const double *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void engine(int m, double secs)
+{
+	pthread_t tm, tw, ta, tp;
+	struct rusage r0, r1;
+	struct timespec c0, c1;
+	double t0, t, cpu, cancel;
+	long csw;
+	int i;
+
+	mode = m;
+	decoded = stalls = bad = wakeups = expect = 0;
+	seq = 0;
+	bus_ns = 0.0;
+	nprobe = 0;
+	master_stop = wq_stop = thread_stop = probe_stop = 0;
+	clear_bit(&stall);
+	for (i = 0; i < 2; i++) {
+		hunks[i].len = hunk_len;
+		hunks[i].flags = 0;
+		hunks[i].complete = m == THREAD ? sync_complete : async_complete;
+		init_completion(&hunks[i].sync);
+	}
+	init_completion(&chain_done);
+	complete_all(&chain_done); /* no chain yet */
+	pthread_create(&tm, NULL, master, NULL);
+	pthread_create(&tw, NULL, worker, NULL);
+	pthread_create(&ta, NULL, ai_thread, NULL);
+	pthread_create(&tp, NULL, prober, NULL);
+
+	getrusage(RUSAGE_SELF, &r0);
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &c0);
+	t0 = now_ns();
+	set_bit(&running);
+	set_bit(&run); /* the pacer timer */
+	if (m != THREAD) {
+		reinit_completion(&chain_done);
+		async_submit(&hunks[0]);
+	}
+	usleep(secs * 1e6);
+
+	/* daqgert_ai_cancel */
+	t = now_ns();
+	clear_bit(&run);
+	if (m == THREAD) {
+		clear_bit(&running);
+		while (test_bit(&spi_run))
+			usleep(750 + rand() % 250);
+	} else {
+		if (!wait_for_completion_timeout(&chain_done, 500))
+			printf("%s: the chain did not end\n", names[m]);
+		clear_bit(&running);
+		flush_workqueue();
+	}
+	cancel = (now_ns() - t) / 1e6;
+	t = (now_ns() - t0) / 1e9;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &c1);
+	getrusage(RUSAGE_SELF, &r1);
+	cpu = (c1.tv_sec - c0.tv_sec) + (c1.tv_nsec - c0.tv_nsec) / 1e9;
+	csw = (r1.ru_nvcsw - r0.ru_nvcsw) + (r1.ru_nivcsw - r0.ru_nivcsw);
+
+	set_bit(&thread_stop);
+	set_bit(&probe_stop);
+	pthread_join(ta, NULL);
+	pthread_join(tp, NULL);
+	pthread_mutex_lock(&mq_m);
+	master_stop = 1;
+	pthread_cond_signal(&mq_c);
+	pthread_mutex_unlock(&mq_m);
+	pthread_mutex_lock(&wq_m);
+	wq_stop = 1;
+	pthread_cond_broadcast(&wq_c);
+	pthread_mutex_unlock(&wq_m);
+	pthread_join(tm, NULL);
+	pthread_join(tw, NULL);
+
+	qsort(probe, nprobe, sizeof(probe[0]), cmp);
+	printf("  %-7s %9.0f %6.1f%% %6.2f%% %9.0f %9.0f %8.0f %7llu %8.2f %6llu\n", names[m],
+		decoded / t, 100.0 * bus_ns / (t * 1e9), 100.0 * cpu / t, wakeups / t, csw / t,
+		nprobe ? probe[nprobe * 99 / 100] : 0.0, stalls, cancel, bad);
+}
+
+int main(int argc, char *argv[])
+{
+	double secs = argc > 1 ? atof(argv[1]) : 5.0;
+	cpu_set_t set;
+	int m;
+
+	if (argc > 2 && atoi(argv[2]) > 0)
+		hunk_len = atoi(argv[2]);
+	if (argc > 3 && atof(argv[3]) > 0.0)
+		conv_ns = atof(argv[3]);
+	CPU_ZERO(&set);
+	CPU_SET(0, &set);
+	if (sched_setaffinity(0, sizeof(set), &set))
+		perror("sched_setaffinity");
+	printf("1 cpu, %.0f s, hunk_len %u, %.0f ns conversions, %.0f ns messages, %.0f ns decode\n",
+		secs, hunk_len, conv_ns, msg_ns, decode_ns);
+	printf("  %-7s %9s %7s %7s %9s %9s %8s %7s %8s %6s\n", "engine", "samples/s", "bus",
+		"cpu", "wakeup/s", "csw/s", "p99 us", "stalls", "cancel ms", "bad");
+	for (m = THREAD; m <= ASYNC; m++)
+		engine(m, secs);
+	return 0;
+}
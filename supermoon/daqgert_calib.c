@@ -0,0 +1,175 @@
+/*
+ * check the daq_gert AI calibration against a mock SPI master
+ *
+ * cc -O2 -o daqgert_calib daqgert_calib.c -lm
+ * ./daqgert_calib [msg ns] [transfer ns] [byte ns at 1MHz] [jitter ns] [wake ns]
+ *
+ * The mock times a message of n transfers of 3 bytes as msg + n * (transfer
+ * + 3 * byte * 1MHz / clock) plus exponential jitter, an EOC sample as one
+ * such message plus the spi_setup and the hrtimeout wakeup overshoot. For
+ * each SPI clock it runs the measurements of daqgert_ai_calibrate with more
+ * and more runs per point and prints the fitted costs against the true
+ * ones, then the periods daqgert_ai_cmdtest would report for some asked
+ * rates and the period the mock really gives with that spacing.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define HUNK_LEN	1000
+#define CAL_SHORT	16
+#define CAL_SINGLE	64
+#define CAL_SLEEP_NS	20000
+#define BYTES		3
+
+struct mock {
+	double msg_ns, xfer_ns, byte_ns, jitter_ns, setup_ns, wake_ns;
+	double hz;
+};
+
+struct calib {
+	double hunk_ns, hunk_msg_ns, single_ns, wake_ns, ns_min;
+};
+
+static double jitter(double mean)
+{
+	return mean > 0.0 ? -mean * log(1.0 - drand48()) : 0.0;
+}
+
+/* one spi_sync of n transfers with delay_us after each */
+static double spi_msg(const struct mock *m, int n, int delay_us)
+{
+	double per = m->xfer_ns + BYTES * m->byte_ns * 1e6 / m->hz + delay_us * 1000.0;
+
+	return m->msg_ns + n * per + jitter(m->jitter_ns);
+}
+
+static double eoc_sample(const struct mock *m)
+{
+	return m->setup_ns + spi_msg(m, 1, 0);
+}
+
+static double wakeup(const struct mock *m, double ns)
+{
+	return ns + m->wake_ns + jitter(m->jitter_ns);
+}
+
+/* daqgert_ai_cal_hunk */
+static double cal_hunk(const struct mock *m, int n, int runs)
+{
+	double total = 0.0;
+	int i;
+
+	for (i = 0; i <= runs; i++) {
+		double t = spi_msg(m, n, 0);
+
+		if (i)
+			total += t;
+	}
+	return total / runs;
+}
+
+/* daqgert_ai_calibrate */
+static void calibrate(const struct mock *m, int runs, struct calib *c)
+{
+	double ns = 0.0, t_short, t_long;
+	int i, n_long = HUNK_LEN;
+
+	for (i = 0; i <= CAL_SINGLE; i++) {
+		double t = eoc_sample(m);
+
+		if (i)
+			ns += t;
+	}
+	c->single_ns = ns / CAL_SINGLE;
+	for (ns = 0.0, i = 0; i < CAL_SINGLE; i++)
+		ns += wakeup(m, CAL_SLEEP_NS) - CAL_SLEEP_NS;
+	c->wake_ns = ns / CAL_SINGLE;
+	c->ns_min = c->single_ns + c->wake_ns;
+
+	t_short = cal_hunk(m, CAL_SHORT, runs);
+	t_long = cal_hunk(m, n_long, runs);
+	c->hunk_ns = c->hunk_msg_ns = 0.0;
+	if (t_long > t_short) {
+		c->hunk_ns = (t_long - t_short) / (n_long - CAL_SHORT);
+		c->hunk_msg_ns = fmax(t_short - c->hunk_ns * CAL_SHORT, 0.0);
+		c->ns_min = fmin(c->ns_min, c->hunk_ns + c->hunk_msg_ns / n_long);
+	}
+}
+
+/* daqgert_ai_cost and daqgert_ai_delay_rate as daqgert_ai_cmdtest uses them */
+static double cost(const struct calib *c, int hunk)
+{
+	return hunk ? c->hunk_ns + c->hunk_msg_ns / HUNK_LEN : c->single_ns + c->wake_ns;
+}
+
+static int spacing_us(double period_ns, double cost_ns)
+{
+	return period_ns > cost_ns ? (int) ((period_ns - cost_ns) / 1000.0 + 0.5) : 0;
+}
+
+/* the mean period a hunk or EOC command gives on the mock */
+static double run_cmd(const struct mock *m, int hunk, int delay_us)
+{
+	double t = 0.0;
+	int i, n = 20000;
+
+	if (hunk) {
+		for (i = 0; i < n / HUNK_LEN; i++)
+			t += spi_msg(m, HUNK_LEN, delay_us);
+	} else {
+		for (i = 0; i < n; i++)
+			t += eoc_sample(m) + wakeup(m, delay_us * 1000.0);
+	}
+	return t / n;
+}
+
+int main(int argc, char *argv[])
+{
+	static const double clocks[] = {500000.0, 1000000.0, 2000000.0};
+	static const int runs[] = {1, 4, 8, 32, 128};
+	static const double periods[] = {20000.0, 50000.0, 100000.0, 1000000.0};
+	struct mock m = {
+		.msg_ns = argc > 1 ? atof(argv[1]) : 12000.0,
+		.xfer_ns = argc > 2 ? atof(argv[2]) : 6000.0,
+		.byte_ns = argc > 3 ? atof(argv[3]) : 8000.0,
+		.jitter_ns = argc > 4 ? atof(argv[4]) : 2000.0,
+		.wake_ns = argc > 5 ? atof(argv[5]) : 15000.0,
+		.setup_ns = 4000.0,
+	};
+	struct calib c;
+	double hunk_true, single_true, want, got;
+	unsigned int k, r, p;
+	int hunk, d;
+
+	srand48(1);
+	for (k = 0; k < sizeof(clocks) / sizeof(clocks[0]); k++) {
+		m.hz = clocks[k];
+		hunk_true = m.xfer_ns + BYTES * m.byte_ns * 1e6 / m.hz;
+		single_true = m.setup_ns + m.msg_ns + hunk_true + m.jitter_ns;
+		printf("spi %.0f Hz: true hunk %.0f ns/conv + %.0f ns/msg, eoc %.0f + %.0f ns/sample\n",
+			m.hz, hunk_true, m.msg_ns + m.jitter_ns, single_true, m.wake_ns + m.jitter_ns);
+		printf("  %5s %12s %12s %12s %12s %10s\n", "runs", "hunk ns", "hunk msg ns",
+			"single ns", "wake ns", "min ns");
+		for (r = 0; r < sizeof(runs) / sizeof(runs[0]); r++) {
+			calibrate(&m, runs[r], &c);
+			printf("  %5d %12.0f %12.0f %12.0f %12.0f %10.0f\n", runs[r], c.hunk_ns,
+				c.hunk_msg_ns, c.single_ns, c.wake_ns, c.ns_min);
+		}
+		calibrate(&m, 8, &c); /* CAL_RUNS */
+		printf("  %8s %4s %12s %8s %12s %12s %8s\n", "asked ns", "mode", "cost ns",
+			"space us", "reported ns", "mock ns", "error");
+		for (p = 0; p < sizeof(periods) / sizeof(periods[0]); p++) {
+			for (hunk = 1; hunk >= 0; hunk--) {
+				want = fmax(periods[p], cost(&c, hunk));
+				d = spacing_us(want, cost(&c, hunk));
+				want = cost(&c, hunk) + d * 1000.0;
+				got = run_cmd(&m, hunk, d);
+				printf("  %8.0f %4s %12.0f %8d %12.0f %12.0f %7.2f%%\n", periods[p],
+					hunk ? "hunk" : "eoc", cost(&c, hunk), d, want, got,
+					(got - want) * 100.0 / want);
+			}
+		}
+	}
+	return 0;
+}
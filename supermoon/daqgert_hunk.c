@@ -0,0 +1,162 @@
+/*
+ * daq_gert hunk length choices on a mock SPI backend
+ *
+ * cc -O2 -o daqgert_hunk daqgert_hunk.c
+ * ./daqgert_hunk [hunk_len] [buffer bytes] [msg ns]
+ *
+ * Runs daqgert_hunk_size and daqgert_hunk_adapt from daq_gert_hunk.h, the
+ * code the driver runs, for a matrix of sample periods and hunk_latency_us
+ * targets on a continuous command and prints the starting hunk length,
+ * the age of the oldest sample when a hunk reaches the Comedi buffer, the
+ * wakeups per second and the share of bus time spent on message overhead.
+ * Then it runs 10 seconds of 50 us sampling against readers that drain the
+ * buffer every few ms, every second and with 1.2 s stalls, with and without
+ * hunk_adapt, for the mean hunk length, wakeups, worst buffer fill and the
+ * samples lost to overruns. Last it checks the TRIG_COUNT cap and the
+ * multi-channel period against values worked out by hand.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "daq_gert_hunk.h"
+
+#define HUNK_LEN	1000
+#define BPS		2	/* bytes per sample */
+
+static unsigned int hunk_len = HUNK_LEN, bufsz = 65536;
+static double msg_ns = 14000.0;
+
+/* daqgert_ai_hunk_size for a timed command, returns the latency target length */
+static unsigned int hunk_size(double period_ns, int latency_us, int wake_eos,
+			      unsigned int chans, unsigned int count, unsigned int *max_len)
+{
+	struct daqgert_hunk_cmd c = {
+		.hunk_len = hunk_len,
+		.hunk_cap = HUNK_LEN,
+		.latency_us = latency_us,
+		.buf_samples = bufsz / BPS,
+		.chans = chans,
+		.counted = count > 0,
+		.stop_arg = count,
+		.scan_ns = period_ns * chans,
+		.wake_eos = wake_eos,
+	};
+
+	return daqgert_hunk_size(&c, max_len);
+}
+
+/* a command and the lengths daqgert_ai_hunk_size must give it */
+struct sized {
+	double period_ns; /* per sample */
+	int latency_us, wake_eos;
+	unsigned int chans, count, len, max;
+};
+
+static const struct sized checks[] = {
+	{50000.0, 100000, 0, 1, 300, 300, 300}, /* the count caps both */
+	{100000.0, 1000, 0, 2, 100, 10, 200}, /* the period is per sample, not per scan */
+	{50000.0, 1000, 0, 3, 0, 18, 999}, /* whole scans */
+	{50000.0, 0, 0, 2, 1, 2, 2}, /* one scan */
+	{1000.0, 1000, 1, 4, 0, 4, 4}, /* WAKE_EOS */
+};
+
+struct reader {
+	const char *name;
+	double every_ms, stall_ms, stall_every_ms;
+};
+
+static void run(const struct reader *r, int use_adapt, double period_ns, int latency_us)
+{
+	unsigned int min, max, len, fill = 0, worst = 0, hunks = 0;
+	double t = 0.0, next_read = r->every_ms * 1e6, next_stall = r->stall_every_ms * 1e6;
+	double lost = 0.0, samples = 0.0, end = 10e9;
+
+	min = len = hunk_size(period_ns, latency_us, 0, 1, 0, &max);
+	while (t < end) {
+		t += msg_ns + len * period_ns;
+		/* the reader drains what is there each time it runs */
+		while (next_read <= t) {
+			fill = 0;
+			next_read += r->every_ms * 1e6;
+			if (r->stall_every_ms > 0.0 && next_read >= next_stall) {
+				next_read += r->stall_ms * 1e6;
+				next_stall += r->stall_every_ms * 1e6;
+			}
+		}
+		if (fill + len * BPS > bufsz) {
+			lost += (fill + len * BPS - bufsz) / BPS;
+			fill = bufsz;
+		} else {
+			fill += len * BPS;
+		}
+		if (fill > worst)
+			worst = fill;
+		samples += len;
+		hunks++;
+		if (use_adapt)
+			len = daqgert_hunk_adapt(len, fill, bufsz, min, max, 1);
+	}
+	printf("  %-22s %-5s %9.0f %9.0f %9.1f%% %10.0f\n", r->name, use_adapt ? "on" : "off",
+		samples / hunks, hunks / (t / 1e9), worst * 100.0 / bufsz, lost);
+}
+
+int main(int argc, char *argv[])
+{
+	static const double periods_us[] = {50.0, 200.0, 1000.0, 10000.0, 100000.0};
+	static const int latencies_us[] = {0, 1000, 10000, 100000, -1};
+	static const struct reader readers[] = {
+		{"every 5 ms", 5.0, 0.0, 0.0},
+		{"every 1 s", 1000.0, 0.0, 0.0},
+		{"5 ms, 1.2 s stalls", 5.0, 1200.0, 3000.0},
+	};
+	unsigned int p, l, r, len, max;
+	double p_ns, hunk_ns;
+	char target[16];
+
+	if (argc > 1)
+		hunk_len = atoi(argv[1]);
+	if (argc > 2)
+		bufsz = atoi(argv[2]);
+	if (argc > 3)
+		msg_ns = atof(argv[3]);
+
+	printf("hunk_len %u, buffer %u bytes, %.0f ns per message\n", hunk_len, bufsz, msg_ns);
+	printf("  %9s %10s %6s %6s %12s %10s %9s\n", "period us", "target us", "len", "max",
+		"oldest ms", "wakeups/s", "overhead");
+	for (p = 0; p < sizeof(periods_us) / sizeof(periods_us[0]); p++) {
+		p_ns = periods_us[p] * 1000.0;
+		for (l = 0; l < sizeof(latencies_us) / sizeof(latencies_us[0]); l++) {
+			len = hunk_size(p_ns, latencies_us[l], latencies_us[l] < 0, 1, 0, &max);
+			hunk_ns = msg_ns + len * p_ns;
+			if (latencies_us[l] < 0)
+				snprintf(target, sizeof(target), "WAKE_EOS");
+			else if (!latencies_us[l])
+				snprintf(target, sizeof(target), "off");
+			else
+				snprintf(target, sizeof(target), "%d", latencies_us[l]);
+			printf("  %9.0f %10s %6u %6u %12.3f %10.1f %8.2f%%\n", periods_us[p], target,
+				len, max, hunk_ns / 1e6, 1e9 / hunk_ns, msg_ns * 100.0 / hunk_ns);
+		}
+	}
+
+	printf("\n50 us sampling, hunk_latency_us 1000, 10 s\n");
+	printf("  %-22s %-5s %9s %9s %10s %10s\n", "reader", "adapt", "mean len", "wakeups/s",
+		"worst fill", "lost");
+	for (r = 0; r < sizeof(readers) / sizeof(readers[0]); r++) {
+		run(&readers[r], 0, 50000.0, 1000);
+		run(&readers[r], 1, 50000.0, 1000);
+	}
+
+	hunk_len = HUNK_LEN;
+	bufsz = 65536;
+	for (r = 0, l = 0; r < sizeof(checks) / sizeof(checks[0]); r++) {
+		len = hunk_size(checks[r].period_ns, checks[r].latency_us, checks[r].wake_eos,
+			checks[r].chans, checks[r].count, &max);
+		if (len != checks[r].len || max != checks[r].max) {
+			printf("check %u: len %u max %u, not %u and %u\n", r, len, max,
+				checks[r].len, checks[r].max);
+			l++;
+		}
+	}
+	printf("\nsizing checks %s\n", l ? "FAILED" : "ok");
+	return l != 0;
+}
@@ -0,0 +1,142 @@
+/*
+ * sample period jitter for daqgert thread placements
+ *
+ * cc -O2 -o daqgert_jitter daqgert_jitter.c -lpthread
+ * ./daqgert_jitter [period us] [spi us] [seconds] [load threads]
+ *
+ * Runs the loop of the daqgert_a thread in EOC mode: a busy SPI exchange of
+ * spi us, then a relative sleep of the remaining period, like the hrtimeout
+ * in daqgert_ai_thread_function. Load threads spin and sleep on every cpu
+ * to stand in for the rest of the system. For each placement (no affinity,
+ * the board table cpu, cpu 0 where the interrupts land) under SCHED_OTHER and
+ * SCHED_FIFO 50 it prints the mean period and its standard deviation, p99 and
+ * worst deviation in us. SCHED_FIFO needs root, those rows are skipped without.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define MAXS	(1 << 20)
+
+static volatile int loading = 1;
+static double dev_us[MAXS];
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void spin_ns(long long ns)
+{
+	long long end = now_ns() + ns;
+
+	while (now_ns() < end);
+}
+
+/* 2 ms busy, 1 ms asleep, roughly a loaded Pi */
+static void *load(void *arg)
+{
+	struct timespec ts = {0, 1000000};
+
+	(void) arg;
+	while (loading) {
+		spin_ns(2000000);
+		nanosleep(&ts, NULL);
+	}
+	return NULL;
+}
+
+static int cmp(const void *a, const void *b)
+{
+	double x = *(const double *) a, y = *(const double *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void run(const char *name, int cpu, int prio, int period, int spi, int secs)
+{
+	struct sched_param param = {.sched_priority = prio};
+	struct timespec ts;
+	cpu_set_t set;
+	long long t, last, end, sleep_ns;
+	double p, sum = 0.0, sum2 = 0.0, mean, worst = 0.0;
+	int n = 0, i;
+
+	CPU_ZERO(&set);
+	if (cpu < 0) {
+		for (i = 0; i < CPU_SETSIZE; i++)
+			CPU_SET(i, &set);
+	} else {
+		CPU_SET(cpu, &set);
+	}
+	if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+		printf("  %-10s %-12s skipped, no cpu %d\n", name, prio ? "SCHED_FIFO" : "SCHED_OTHER", cpu);
+		return;
+	}
+	if (sched_setscheduler(0, prio ? SCHED_FIFO : SCHED_OTHER, &param) < 0) {
+		printf("  %-10s %-12s skipped, needs root\n", name, prio ? "SCHED_FIFO" : "SCHED_OTHER");
+		return;
+	}
+
+	sleep_ns = (period - spi) * 1000LL;
+	last = now_ns();
+	end = last + secs * 1000000000LL;
+	while ((t = now_ns()) < end && n < MAXS) {
+		spin_ns(spi * 1000LL); // daqgert_handle_ai_eoc
+		ts.tv_sec = 0;
+		ts.tv_nsec = sleep_ns;
+		clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, NULL);
+		t = now_ns();
+		p = (t - last) / 1000.0;
+		last = t;
+		sum += p;
+		sum2 += p * p;
+		dev_us[n++] = p;
+	}
+	mean = sum / n;
+	for (i = 0; i < n; i++) {
+		dev_us[i] = fabs(dev_us[i] - mean);
+		if (dev_us[i] > worst)
+			worst = dev_us[i];
+	}
+	qsort(dev_us, n, sizeof(double), cmp);
+	printf("  %-10s %-12s %7d periods  mean %8.1f us  sd %7.1f  p99 %7.1f  max %8.1f\n",
+		name, prio ? "SCHED_FIFO" : "SCHED_OTHER", n, mean, sqrt(sum2 / n - mean * mean),
+		dev_us[n * 99 / 100], worst);
+
+	param.sched_priority = 0;
+	sched_setscheduler(0, SCHED_OTHER, &param);
+}
+
+int main(int argc, char *argv[])
+{
+	int period = argc > 1 ? atoi(argv[1]) : 1000, spi = argc > 2 ? atoi(argv[2]) : 50;
+	int secs = argc > 3 ? atoi(argv[3]) : 3, cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int loads = argc > 4 ? atoi(argv[4]) : cpus, i, prio;
+	pthread_t *tid;
+
+	if (spi >= period)
+		spi = period / 2;
+	tid = calloc(loads ? loads : 1, sizeof(*tid));
+	for (i = 0; i < loads; i++)
+		pthread_create(&tid[i], NULL, load, NULL);
+	printf("%d cpu(s), %d load threads, period %d us, spi %d us\n", cpus, loads, period, spi);
+	for (prio = 0; prio <= 50; prio += 50) {
+		run("any cpu", -1, prio, period, spi, secs);
+		run("board cpu", cpus > 3 ? 3 : cpus - 1, prio, period, spi, secs);
+		run("cpu 0", 0, prio, period, spi, secs);
+	}
+	loading = 0;
+	for (i = 0; i < loads; i++)
+		pthread_join(tid[i], NULL);
+	return 0;
+}
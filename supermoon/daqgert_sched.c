@@ -0,0 +1,179 @@
+/*
+ * AO deadlines against streaming AI hunks on a mock SPI master
+ *
+ * cc -O2 -o daqgert_sched daqgert_sched.c -lm
+ * ./daqgert_sched [seconds] [conversion ns] [message ns] [ao wake jitter ns]
+ *
+ * The mock master runs one message at a time and timestamps every transfer
+ * with its chip select, CS0 for the ADC and CS1 for the DAC. The AI thread
+ * sends hunks and decodes them, the AO thread sleeps to absolute deadlines
+ * with a wakeup jitter. Three ways of sharing the bus are run for some AO
+ * periods and hunk lengths:
+ *   mutex   AO waits for the whole hunk, the bus as it is without ao_sched
+ *   lockout AI drops to single EOC samples while AO runs, timing_lockout
+ *   sched   hunks go out in pieces ending at the AO deadlines and the AI
+ *           thread puts the AO sample, the AO thread steps in after half a
+ *           period, daqgert_ai_hunk_segments and daqgert_ao_service
+ * For each it prints the AO lateness from the CS1 timestamps (mean, p99,
+ * max and missed periods) and the CS0 conversions and messages per second.
+ * The three ways are hand written models of the driver code, this does not
+ * build or run supermoon.c and does not test it; a change to the driver's
+ * segment or AO service logic has to be made here too.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define MAXT	(1 << 22)
+
+enum { MUTEX, LOCKOUT, SCHED };
+static const char *names[] = {"mutex", "lockout", "sched"};
+
+static double conv_ns = 30000.0, msg_ns = 14000.0, ao_ns = 6000.0, jitter_ns = 20000.0;
+static double decode_ns = 200.0, eoc_ns = 65000.0; /* per sample */
+
+/* the mock master: per chip select transfer timestamps */
+static double *stamp[2];
+static int nstamp[2];
+
+/* the deadline each AO word was for */
+static double *slot;
+static int nslot, misses;
+
+static double jitter(void)
+{
+	return 10000.0 - jitter_ns * log(1.0 - drand48());
+}
+
+/* one message of n transfers starting at t, returns when it ends */
+static double spi_msg(int cs, double t, int n)
+{
+	double per = cs ? ao_ns : conv_ns;
+	int i;
+
+	t += msg_ns;
+	for (i = 0; i < n; i++) {
+		if (nstamp[cs] < MAXT)
+			stamp[cs][nstamp[cs]++] = t;
+		t += per;
+	}
+	return t;
+}
+
+/* the AO word for the deadline, the next one skips missed periods */
+static double ao_put(double t, double *deadline, double period)
+{
+	if (nslot < MAXT)
+		slot[nslot++] = *deadline;
+	t = spi_msg(1, t, 1);
+	*deadline += period;
+	while (*deadline <= t) {
+		*deadline += period;
+		misses++;
+	}
+	return t;
+}
+
+static int cmp(const void *a, const void *b)
+{
+	double x = *(const double *) a, y = *(const double *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void run(int policy, double period, int len, double secs)
+{
+	double end = secs * 1e9, t = 0.0, deadline = 0.0, ao_wake, left, *late;
+	double sum = 0.0;
+	int msgs = 0, n, seg, i;
+
+	nstamp[0] = nstamp[1] = nslot = misses = 0;
+	ao_wake = deadline + jitter();
+	while (t < end) {
+		if (policy == LOCKOUT) {
+			/* EOC samples and AO words take turns on the bus */
+			if (ao_wake <= t) {
+				t = ao_put(t, &deadline, period);
+				ao_wake = deadline + jitter();
+			}
+			t = spi_msg(0, t, 1) + eoc_ns - conv_ns - msg_ns;
+			msgs++;
+			continue;
+		}
+		for (n = 0; n < len;) {
+			if (policy == MUTEX) {
+				seg = len; /* the AO thread waits on drvdata_lock */
+			} else {
+				left = deadline - t - msg_ns;
+				if (left < conv_ns) {
+					t = fmax(t, deadline); /* cpu_relax to the slot */
+					t = ao_put(t, &deadline, period);
+					ao_wake = deadline + period / 2 + jitter();
+					left = deadline - t - msg_ns;
+				}
+				seg = left < conv_ns ? 1 : (int) (left / conv_ns);
+				if (seg > len - n)
+					seg = len - n;
+			}
+			t = spi_msg(0, t, seg);
+			msgs++;
+			n += seg;
+			/* the AO thread got the bus while the message ran */
+			if (policy == MUTEX && ao_wake <= t) {
+				t = ao_put(t, &deadline, period);
+				ao_wake = deadline + jitter();
+			}
+		}
+		t += decode_ns * len;
+		/* sched backstop: the AO thread wakes half a period late */
+		if (policy == SCHED && ao_wake <= t && deadline <= t) {
+			t = ao_put(fmax(t, ao_wake), &deadline, period);
+			ao_wake = deadline + period / 2 + jitter();
+		}
+	}
+
+	/* lateness of each AO word from its CS1 timestamp */
+	late = malloc(sizeof(double) * (nstamp[1] ? nstamp[1] : 1));
+	for (i = 0; i < nstamp[1]; i++) {
+		late[i] = (stamp[1][i] - msg_ns - slot[i]) / 1000.0;
+		sum += late[i];
+	}
+	qsort(late, i, sizeof(double), cmp);
+	if (i)
+		printf("  %-8s %8.0f %6d %9.1f %9.1f %9.1f %7d %10.0f %9.0f\n", names[policy],
+			period / 1000.0, policy == LOCKOUT ? 1 : len, sum / i, late[i * 99 / 100],
+			late[i - 1], misses, nstamp[0] / secs, msgs / secs);
+	free(late);
+}
+
+int main(int argc, char *argv[])
+{
+	static const double periods[] = {1e6, 2e6, 10e6};
+	static const int lens[] = {100, 1000};
+	double secs = argc > 1 ? atof(argv[1]) : 10.0;
+	unsigned int p, l;
+	int policy;
+
+	if (argc > 2)
+		conv_ns = atof(argv[2]);
+	if (argc > 3)
+		msg_ns = atof(argv[3]);
+	if (argc > 4)
+		jitter_ns = atof(argv[4]);
+	stamp[0] = malloc(sizeof(double) * MAXT);
+	stamp[1] = malloc(sizeof(double) * MAXT);
+	slot = malloc(sizeof(double) * MAXT);
+	srand48(1);
+
+	printf("%.0f s, %.0f ns conversions, %.0f ns messages, %.0f ns ao wake jitter\n", secs,
+		conv_ns, msg_ns, jitter_ns);
+	printf("  %-8s %8s %6s %9s %9s %9s %7s %10s %9s\n", "policy", "ao us", "hunk",
+		"late us", "p99 us", "max us", "missed", "ai conv/s", "ai msg/s");
+	for (p = 0; p < sizeof(periods) / sizeof(periods[0]); p++) {
+		for (l = 0; l < sizeof(lens) / sizeof(lens[0]); l++)
+			for (policy = MUTEX; policy <= SCHED; policy++)
+				if (policy != LOCKOUT || !l)
+					run(policy, periods[p], lens[l], secs);
+	}
+	return 0;
+}
@@ -0,0 +1,209 @@
+/*
+ * check daq_gert AI timestamp records, from the driver or a mock timer
+ *
+ * cc -O2 -o daqgert_stamps daqgert_stamps.c
+ * echo 1 > /sys/module/daq_gert/parameters/ai_stamps
+ * cat /sys/kernel/debug/daq_gert-comedi0/timestamps > stamps.bin &
+ * ./daqgert_stamps stamps.bin [sample period us]
+ * ./daqgert_stamps -s [sample period us] [seconds]
+ *
+ * Reads struct daqgert_stamp records and checks that the start and end
+ * stamps never go backwards and that each record starts at the sample after
+ * the last one (sample 0 starts a new command). It prints the records, gaps,
+ * the sample period from one record start to the next (mean, min, max) and
+ * the worst distance from the asked period.
+ *
+ * -s runs the driver code on a mock BCM2835 system timer that starts a
+ * second before the CLO carry into CHI and ticks while it is being read:
+ * daqgert_timer_us for hunks of 1000 and scans of 2 EOC samples with message
+ * overhead and jitter, checked the same way. Then it reads the mock timer
+ * at every ns across the carry, with daqgert_timer_us and with CHI read
+ * only once before CLO, and counts the values outside their read window,
+ * the 71 minute jumps the re-read of CHI avoids.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+struct daqgert_stamp {
+	uint64_t start;
+	uint64_t end;
+	uint32_t sample;
+	uint32_t len;
+};
+
+struct check {
+	long recs, samples, backwards, gaps, cmds, n;
+	struct daqgert_stamp last;
+	double sum, min, max, off;
+};
+
+static void check_rec(struct check *c, const struct daqgert_stamp *r, double period_us)
+{
+	double p;
+
+	if (!r->sample) {
+		c->cmds++;
+	} else if (r->sample != c->last.sample + c->last.len) {
+		c->gaps++;
+	} else if (c->last.len) {
+		/* sample period from this record start back to the last one */
+		p = ((double) r->start - (double) c->last.start) / c->last.len;
+		c->min = c->n && c->min < p ? c->min : p;
+		c->max = c->n && c->max > p ? c->max : p;
+		if (period_us > 0.0 && fabs(p - period_us) > c->off)
+			c->off = fabs(p - period_us);
+		c->sum += p;
+		c->n++;
+	}
+	if (r->end < r->start || (c->recs && r->sample && r->start < c->last.end))
+		c->backwards++;
+	c->last = *r;
+	c->samples += r->len;
+	c->recs++;
+}
+
+static void report(const char *name, const struct check *c, double period_us)
+{
+	printf("  %-18s %6ld %9ld %4ld %5ld %9ld", name, c->recs, c->samples, c->cmds, c->gaps,
+		c->backwards);
+	if (c->n)
+		printf(" %9.3f %9.3f %9.3f", c->sum / c->n, c->min, c->max);
+	if (c->n && period_us > 0.0)
+		printf(" %9.3f", c->off);
+	printf("\n");
+}
+
+static void header(void)
+{
+	printf("  %-18s %6s %9s %4s %5s %9s %9s %9s %9s %9s\n", "records", "recs", "samples",
+		"cmds", "gaps", "backwards", "us/sample", "min", "max", "worst off");
+}
+
+/* the mock timer: simulated ns since the start, each register read takes bus_ns */
+static double now_ns, bus_ns = 60.0;
+static const uint64_t base_us = 0xffffffffull - 1000000ull;
+
+static uint32_t ioread32(int reg)
+{
+	uint64_t us = base_us + (uint64_t) (now_ns / 1000.0);
+
+	now_ns += bus_ns;
+	return reg == 2 ? (uint32_t) (us >> 32) : (uint32_t) us;
+}
+
+/* daqgert_timer_us */
+static uint64_t timer_us(void)
+{
+	uint32_t hi, lo;
+
+	do {
+		hi = ioread32(2);
+		lo = ioread32(1);
+	} while (hi != ioread32(2));
+	return ((uint64_t) hi << 32) | lo;
+}
+
+static uint64_t timer_us_once(void)
+{
+	uint32_t hi = ioread32(2);
+
+	return ((uint64_t) hi << 32) | ioread32(1);
+}
+
+/* a read started every ns across the carry has to land inside its window */
+static void carry(const char *name, uint64_t (*rd)(void))
+{
+	double carry_ns = (0x100000000ull - base_us) * 1000.0, t0;
+	uint64_t v, lo, hi;
+	long i, wrong = 0, n = 0;
+
+	for (i = -5000; i < 5000; i++) {
+		now_ns = t0 = carry_ns + i;
+		v = rd();
+		lo = base_us + (uint64_t) (t0 / 1000.0);
+		hi = base_us + (uint64_t) (now_ns / 1000.0);
+		if (v < lo || v > hi)
+			wrong++;
+		n++;
+	}
+	printf("  %-18s %6ld reads across the CLO carry, %ld wrong\n", name, n, wrong);
+}
+
+static double jitter(double mean)
+{
+	return -mean * log(1.0 - drand48());
+}
+
+/* daqgert_ai_stamp on the sync hunk and EOC paths, into the checker */
+static void simulate(const char *name, uint64_t (*rd)(void), int hunk, double period_us,
+		     double secs)
+{
+	struct check c = {0};
+	struct daqgert_stamp r;
+	uint32_t pos = 0, len = hunk ? 1000 : 2;
+	double conv_ns = 30000.0;
+	double t_end;
+
+	now_ns = 0.0;
+	t_end = secs * 1e9;
+	while (now_ns < t_end) {
+		if (hunk) {
+			/* the hunk spacing is one period, message and decode come on top */
+			r.start = rd();
+			now_ns += 14000.0 + len * period_us * 1000.0;
+			r.end = rd();
+			now_ns += 200.0 * len + jitter(20000.0);
+		} else {
+			/* an EOC scan, each sample sleeps out the rest of its period */
+			r.start = rd();
+			now_ns += period_us * 1000.0 * (len - 1) + conv_ns;
+			r.end = rd();
+			now_ns += period_us * 1000.0 - conv_ns + jitter(5000.0);
+		}
+		r.sample = pos;
+		r.len = len;
+		pos += len;
+		check_rec(&c, &r, period_us);
+	}
+	report(name, &c, period_us);
+}
+
+int main(int argc, char *argv[])
+{
+	struct daqgert_stamp r;
+	struct check c = {0};
+	double period_us, secs;
+	FILE *f;
+
+	if (argc > 1 && argv[1][0] == '-' && argv[1][1] == 's') {
+		period_us = argc > 2 ? atof(argv[2]) : 50.0;
+		secs = argc > 3 ? atof(argv[3]) : 10.0;
+		srand48(1);
+		printf("mock timer from 0x%llx, %.0f ns reads, %.1f us hunk and %.1f us eoc samples\n",
+			(unsigned long long) base_us, bus_ns, period_us, period_us * 10.0);
+		header();
+		simulate("hunk", timer_us, 1, period_us, secs);
+		simulate("eoc", timer_us, 0, period_us * 10.0, secs);
+		carry("chi clo chi", timer_us);
+		carry("chi clo", timer_us_once);
+		return 0;
+	}
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s stamps.bin [period us] | -s [period us] [seconds]\n",
+			argv[0]);
+		return 1;
+	}
+	f = fopen(argv[1], "rb");
+	if (!f) {
+		perror(argv[1]);
+		return 1;
+	}
+	period_us = argc > 2 ? atof(argv[2]) : 0.0;
+	header();
+	while (fread(&r, sizeof(r), 1, f) == 1)
+		check_rec(&c, &r, period_us);
+	report(argv[1], &c, period_us);
+	return c.backwards || c.gaps;
+}
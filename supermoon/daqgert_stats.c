@@ -0,0 +1,150 @@
+/*
+ * show the daq_gert acquisition statistics from debugfs
+ *
+ * cc -O2 -o daqgert_stats daqgert_stats.c
+ * ./daqgert_stats [seconds] [stats file]
+ *
+ * Reads the stats file twice, seconds apart, and prints the sample, hunk and
+ * SPI message rates over that time, the counters, and the SPI message,
+ * thread wakeup and AO deadline lateness histograms with their p50, p99 and
+ * max buckets.
+ * The file is /sys/kernel/debug/daq_gert-comedi0/stats unless given,
+ * "echo 0 >" it to zero the counters.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define HIST	32
+#define NVAL	16
+
+static const char *names[NVAL] = {
+	"elapsed_ns", "samples", "hunks", "ao_samples", "overruns", "stalls",
+	"spi_msgs", "spi_setups", "buf_hwm", "hunk_len", "segments", "ao_misses",
+	"ao_late_max_ns",
+};
+
+struct stats {
+	unsigned long long val[NVAL];
+	unsigned long long spi_lat[HIST], wake_lat[HIST], ao_late[HIST];
+};
+
+static int read_stats(const char *path, struct stats *st)
+{
+	char line[1024], *p, *end;
+	unsigned long long *hist;
+	FILE *f;
+	int i;
+
+	memset(st, 0, sizeof(*st));
+	if (!(f = fopen(path, "r")))
+		return -1;
+	while (fgets(line, sizeof(line), f)) {
+		if (!(p = strchr(line, ' ')))
+			continue;
+		*p++ = 0;
+		hist = !strcmp(line, "spi_lat_ns") ? st->spi_lat : !strcmp(line, "wake_lat_ns") ? st->wake_lat :
+			!strcmp(line, "ao_late_ns") ? st->ao_late : NULL;
+		if (hist) {
+			for (i = 0; i < HIST; i++, p = end)
+				hist[i] = strtoull(p, &end, 10);
+			continue;
+		}
+		for (i = 0; i < NVAL && names[i]; i++)
+			if (!strcmp(line, names[i]))
+				st->val[i] = strtoull(p, NULL, 0);
+	}
+	fclose(f);
+	return 0;
+}
+
+/* bucket i is 2^(i-1) to 2^i - 1 ns */
+static const char *bucket_name(int i)
+{
+	static char buf[4][16];
+	static int n;
+	unsigned long long ns = i ? 1ULL << (i - 1) : 0;
+	char *b = buf[n++ & 3];
+
+	if (ns >= 1000000000ULL)
+		sprintf(b, "%llus", ns / 1000000000ULL);
+	else if (ns >= 1000000)
+		sprintf(b, "%llums", ns / 1000000);
+	else if (ns >= 1000)
+		sprintf(b, "%lluus", ns / 1000);
+	else
+		sprintf(b, "%lluns", ns);
+	return b;
+}
+
+static void show_hist(const char *name, const unsigned long long *h)
+{
+	unsigned long long total = 0, peak = 0, run = 0;
+	int i, first = -1, last = -1, p50 = -1, p99 = -1, bar;
+
+	for (i = 0; i < HIST; i++) {
+		total += h[i];
+		if (h[i] > peak)
+			peak = h[i];
+		if (h[i]) {
+			if (first < 0)
+				first = i;
+			last = i;
+		}
+	}
+	if (!total) {
+		printf("%s: no data\n", name);
+		return;
+	}
+	for (i = 0; i < HIST; i++) {
+		run += h[i];
+		if (p50 < 0 && run * 2 >= total)
+			p50 = i;
+		if (p99 < 0 && run * 100 >= total * 99)
+			p99 = i;
+	}
+	printf("%s: %llu, p50 < %s, p99 < %s, max < %s\n", name, total, bucket_name(p50 + 1),
+		bucket_name(p99 + 1), bucket_name(last + 1));
+	for (i = first; i <= last; i++) {
+		bar = (int) (h[i] * 50 / peak);
+		printf("  %6s %10llu %.*s\n", bucket_name(i), h[i], bar,
+			"##################################################");
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const char *path = argc > 2 ? argv[2] : "/sys/kernel/debug/daq_gert-comedi0/stats";
+	int secs = argc > 1 ? atoi(argv[1]) : 1, i;
+	struct stats a, b;
+	double t;
+
+	if (read_stats(path, &a) < 0) {
+		perror(path);
+		return 1;
+	}
+	sleep(secs);
+	if (read_stats(path, &b) < 0) {
+		perror(path);
+		return 1;
+	}
+	t = (b.val[0] - a.val[0]) / 1e9;
+	if (t <= 0.0) // zeroed in between
+		t = b.val[0] / 1e9, memset(&a, 0, sizeof(a));
+
+	printf("over %.2f s: %.0f samples/s, %.1f hunks/s, %.0f spi msgs/s, %.0f ao samples/s\n", t,
+		(b.val[1] - a.val[1]) / t, (b.val[2] - a.val[2]) / t, (b.val[6] - a.val[6]) / t,
+		(b.val[3] - a.val[3]) / t);
+	for (i = 1; i < NVAL && names[i]; i++)
+		printf("  %-11s %llu\n", names[i], b.val[i]);
+	for (i = 0; i < HIST; i++) {
+		b.spi_lat[i] -= a.spi_lat[i];
+		b.wake_lat[i] -= a.wake_lat[i];
+		b.ao_late[i] -= a.ao_late[i];
+	}
+	show_hist("spi message latency", b.spi_lat);
+	show_hist("thread wakeup latency", b.wake_lat);
+	show_hist("ao update past deadline", b.ao_late);
+	return 0;
+}
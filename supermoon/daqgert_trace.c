@@ -0,0 +1,170 @@
+/*
+ * latency breakdown from a daq_gert/ni_daq_700 ftrace capture
+ *
+ * cc -O2 -o daqgert_trace daqgert_trace.c
+ * echo 1 > /sys/kernel/debug/tracing/events/daq_gert/enable
+ * echo 1 > /sys/kernel/debug/tracing/events/ni_daq_700/enable
+ * cat /sys/kernel/debug/tracing/trace_pipe > trace.txt
+ * ./daqgert_trace trace.txt	(or trace-cmd report output, or stdin)
+ *
+ * Follows each hunk through submit, SPI completion, decode and the comedi
+ * buffer commit and prints count, mean, p50, p99 and max in us for each
+ * stage, the whole hunk and per sample. Single sample (EOC) commands, AO and
+ * the DAQCard-700 get the interval between samples and the conversion time.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MINORS	4
+#define IDS	2
+
+enum stage {
+	SPI, QUEUE, DECODE, COMMIT, HUNK, PER_SAMPLE, EOC_PERIOD, AO_PERIOD,
+	DAQ700_CONV, DAQ700_PERIOD, STAGES
+};
+
+static const char *stage_names[STAGES] = {
+	"hunk spi (submit to complete)", "decode queue (complete to begin)", "decode (begin to end)",
+	"commit (end to buffer)", "hunk (submit to buffer)", "per sample", "eoc sample period",
+	"ao put period", "daq700 conversion", "daq700 sample period",
+};
+
+struct series {
+	double *v;
+	int n, max;
+};
+
+static struct series st[STAGES];
+
+static void add(enum stage s, double us)
+{
+	struct series *p = &st[s];
+
+	if (us < 0.0)
+		return;
+	if (p->n == p->max) {
+		p->max = p->max ? p->max * 2 : 1024;
+		p->v = realloc(p->v, p->max * sizeof(double));
+		if (!p->v)
+			exit(1);
+	}
+	p->v[p->n++] = us;
+}
+
+static int field(const char *line, const char *key)
+{
+	const char *p = strstr(line, key);
+
+	return p ? atoi(p + strlen(key)) : 0;
+}
+
+static int cmp(const void *a, const void *b)
+{
+	double x = *(const double *) a, y = *(const double *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+int main(int argc, char *argv[])
+{
+	/* per minor and ping-pong slot, in seconds, < 0 when not pending */
+	double submit[MINORS][IDS], done[MINORS][IDS], begin[MINORS][IDS];
+	double end_t[MINORS], end_sub[MINORS], last_eoc[MINORS], last_ao[MINORS];
+	double conv[MINORS], last_conv[MINORS], t, sum;
+	int end_len[MINORS], hunk[MINORS], starts = 0, cancels = 0, events = 0;
+	char line[1024], *ev, *p;
+	FILE *f = argc > 1 ? fopen(argv[1], "r") : stdin;
+	int i, m, id;
+
+	if (!f) {
+		perror(argv[1]);
+		return 1;
+	}
+	for (m = 0; m < MINORS; m++) {
+		for (i = 0; i < IDS; i++)
+			submit[m][i] = done[m][i] = begin[m][i] = -1.0;
+		end_t[m] = last_eoc[m] = last_ao[m] = conv[m] = last_conv[m] = -1.0;
+		hunk[m] = 0;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		if (!(ev = strstr(line, ": daqgert_")) && !(ev = strstr(line, ": daq700_")))
+			continue;
+		/* the timestamp is the "1234.567890" before the event name */
+		for (p = ev; p > line && p[-1] != ' '; p--);
+		t = atof(p);
+		ev += 2;
+		m = field(ev, "minor=");
+		id = field(ev, "id=");
+		if (m < 0 || m >= MINORS || id < 0 || id >= IDS)
+			continue;
+		events++;
+
+		if (!strncmp(ev, "daqgert_cmd_start:", 18)) {
+			starts++;
+			hunk[m] = field(ev, "hunk=");
+			last_eoc[m] = end_t[m] = -1.0;
+			for (i = 0; i < IDS; i++)
+				submit[m][i] = done[m][i] = begin[m][i] = -1.0;
+		} else if (!strncmp(ev, "daqgert_cmd_cancel:", 19)) {
+			cancels++;
+		} else if (!strncmp(ev, "daqgert_hunk_submit:", 20)) {
+			submit[m][id] = t;
+		} else if (!strncmp(ev, "daqgert_hunk_complete:", 22)) {
+			if (submit[m][id] >= 0.0)
+				add(SPI, (t - submit[m][id]) * 1e6);
+			done[m][id] = t;
+		} else if (!strncmp(ev, "daqgert_decode_begin:", 21)) {
+			if (done[m][id] >= 0.0)
+				add(QUEUE, (t - done[m][id]) * 1e6);
+			begin[m][id] = t;
+		} else if (!strncmp(ev, "daqgert_decode_end:", 19)) {
+			if (begin[m][id] >= 0.0)
+				add(DECODE, (t - begin[m][id]) * 1e6);
+			end_t[m] = t;
+			end_sub[m] = submit[m][id];
+			end_len[m] = field(ev, "len=");
+			submit[m][id] = done[m][id] = begin[m][id] = -1.0;
+		} else if (!strncmp(ev, "daqgert_buf_commit:", 19)) {
+			if (end_t[m] >= 0.0) { /* the hunk decoded last */
+				add(COMMIT, (t - end_t[m]) * 1e6);
+				if (end_sub[m] >= 0.0) {
+					add(HUNK, (t - end_sub[m]) * 1e6);
+					if (end_len[m] > 0)
+						add(PER_SAMPLE, (t - end_sub[m]) * 1e6 / end_len[m]);
+				}
+				end_t[m] = -1.0;
+			} else if (!hunk[m]) {
+				if (last_eoc[m] >= 0.0)
+					add(EOC_PERIOD, (t - last_eoc[m]) * 1e6);
+				last_eoc[m] = t;
+			}
+		} else if (!strncmp(ev, "daqgert_ao_put:", 15)) {
+			if (last_ao[m] >= 0.0)
+				add(AO_PERIOD, (t - last_ao[m]) * 1e6);
+			last_ao[m] = t;
+		} else if (!strncmp(ev, "daq700_conv_start:", 18)) {
+			if (last_conv[m] >= 0.0)
+				add(DAQ700_PERIOD, (t - last_conv[m]) * 1e6);
+			conv[m] = last_conv[m] = t;
+		} else if (!strncmp(ev, "daq700_conv_done:", 17)) {
+			if (conv[m] >= 0.0 && !field(ev, "ret="))
+				add(DAQ700_CONV, (t - conv[m]) * 1e6);
+			conv[m] = -1.0;
+		}
+	}
+
+	printf("%d events, %d cmd starts, %d cancels\n", events, starts, cancels);
+	printf("%-34s %8s %10s %10s %10s %10s\n", "stage us", "count", "mean", "p50", "p99", "max");
+	for (i = 0; i < STAGES; i++) {
+		if (!st[i].n)
+			continue;
+		qsort(st[i].v, st[i].n, sizeof(double), cmp);
+		for (sum = 0.0, m = 0; m < st[i].n; m++)
+			sum += st[i].v[m];
+		printf("%-34s %8d %10.2f %10.2f %10.2f %10.2f\n", stage_names[i], st[i].n, sum / st[i].n,
+			st[i].v[st[i].n / 2], st[i].v[st[i].n * 99 / 100], st[i].v[st[i].n - 1]);
+	}
+	return 0;
+}
@@ -37,6 +37,8 @@ OBJECTDIR=${CND_BUILDDIR}/${CND_CONF}/${CND_PLATFORM}
 OBJECTFILES= \
 	${OBJECTDIR}/_ext/1360920745/bmc.o \
 	${OBJECTDIR}/_ext/1685954798/daq.o \
+	${OBJECTDIR}/_ext/1685954798/filter.o \
+	${OBJECTDIR}/_ext/1685954798/conv.o \
 	${OBJECTDIR}/_ext/1181056713/bmcnet.o
 
 
@@ -74,6 +76,16 @@ ${OBJECTDIR}/_ext/1685954798/daq.o: ../bmc/bmc/daq.c
 	${RM} "$@.d"
 	$(COMPILE.c) -O2 `pkg-config --cflags comedilib` `pkg-config --cflags xaw7`   -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/_ext/1685954798/daq.o ../bmc/bmc/daq.c
 
+${OBJECTDIR}/_ext/1685954798/filter.o: ../bmc/bmc/filter.c 
+	${MKDIR} -p ${OBJECTDIR}/_ext/1685954798
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 `pkg-config --cflags comedilib` `pkg-config --cflags xaw7`   -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/_ext/1685954798/filter.o ../bmc/bmc/filter.c
+
+${OBJECTDIR}/_ext/1685954798/conv.o: ../bmc/bmc/conv.c 
+	${MKDIR} -p ${OBJECTDIR}/_ext/1685954798
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 `pkg-config --cflags comedilib` `pkg-config --cflags xaw7`   -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/_ext/1685954798/conv.o ../bmc/bmc/conv.c
+
 ${OBJECTDIR}/_ext/1181056713/bmcnet.o: ../bmc/bmc_x86/bmcnet.c 
 	${MKDIR} -p ${OBJECTDIR}/_ext/1181056713
 	${RM} "$@.d"
@@ -53,6 +53,9 @@
 
 #include "../comedi_pcmcia.h"
 
+#define CREATE_TRACE_POINTS
+#include "ni_daq_700_trace.h"
+
 /* daqcard700 registers */
 #define DIO_W		0x04	/* WO 8bit */
 #define DIO_R		0x05	/* RO 8bit */
@@ -173,14 +176,18 @@ static int daq700_ai_rinsn(struct comedi_device *dev,
 		inw(dev->iobase + ADFIFO_R);
 		/* mode 1 out0 H, L to H, start conversion */
 		outb(0x32, dev->iobase + CMO_R);
+		trace_daq700_conv_start(dev->minor, chan, range);
 
 		/* wait for conversion to end */
 		ret = comedi_timeout(dev, s, insn, daq700_ai_eoc, 0);
-		if (ret)
+		if (ret) {
+			trace_daq700_conv_done(dev->minor, chan, 0, ret);
 			return ret;
+		}
 
 		/* read data */
 		d = inw(dev->iobase + ADFIFO_R);
+		trace_daq700_conv_done(dev->minor, chan, d, 0);
 		/* mangle the data as necessary */
 		/* Bipolar Offset Binary: 0 to 4095 for -10 to +10 */
 		d &= 0x0fff;
@@ -0,0 +1,59 @@
+/*
+ * tracepoints for the ni_daq_700 conversions
+ *
+ * This header goes next to ni_daq_700.c, the Makefile needs
+ * CFLAGS_ni_daq_700.o := -I$(src) for define_trace.h to find it.
+ */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM ni_daq_700
+
+#if !defined(_NI_DAQ_700_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _NI_DAQ_700_TRACE_H
+
+#include <linux/tracepoint.h>
+
+/* counter 0 output driven high, the ADC starts converting */
+TRACE_EVENT(daq700_conv_start,
+	TP_PROTO(int minor, unsigned int chan, unsigned int range),
+	TP_ARGS(minor, chan, range),
+	TP_STRUCT__entry(
+		__field(int, minor)
+		__field(unsigned int, chan)
+		__field(unsigned int, range)
+	),
+	TP_fast_assign(
+		__entry->minor = minor;
+		__entry->chan = chan;
+		__entry->range = range;
+	),
+	TP_printk("minor=%d chan=%u range=%u",
+		__entry->minor, __entry->chan, __entry->range)
+);
+
+/* FIFO read, ret is the comedi_timeout result */
+TRACE_EVENT(daq700_conv_done,
+	TP_PROTO(int minor, unsigned int chan, int data, int ret),
+	TP_ARGS(minor, chan, data, ret),
+	TP_STRUCT__entry(
+		__field(int, minor)
+		__field(unsigned int, chan)
+		__field(int, data)
+		__field(int, ret)
+	),
+	TP_fast_assign(
+		__entry->minor = minor;
+		__entry->chan = chan;
+		__entry->data = data;
+		__entry->ret = ret;
+	),
+	TP_printk("minor=%d chan=%u data=%d ret=%d",
+		__entry->minor, __entry->chan, __entry->data, __entry->ret)
+);
+
+#endif /* _NI_DAQ_700_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE ni_daq_700_trace
+#include <trace/define_trace.h>
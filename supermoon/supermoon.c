@@ -146,6 +146,18 @@ by the module option variable daqgert_conf in the /etc/modprobe.d directory
  * The output range is 0 to 4095 for 0.0 to 2.048 onboard devices (output resolution depends on the device)
  * In the async command mode transfers can be handled in HUNK mode by creating a SPI message
  * of many conversion sequences into one message, this allows for close to native driver wire-speed 
+ * With less than 4 cpus online there is no spare core for the hunk thread, so the
+ * hunk messages are chained with spi_async instead: each completion sends the
+ * next hunk and queues the finished one for decoding (module option use_async)
+ * The acquisition threads default to the board table cpus with normal scheduling,
+ * ai_cpus/ao_cpus (cpu lists like "3" or "2-3") and ai_prio/ao_prio (1..99 for
+ * SCHED_FIFO, 0 for normal) in the parameters directory can be changed at any time,
+ * the threads move when they are idle between commands. isolated=1 places them on
+ * nohz_full cpus when the kernel has any.
+ * Acquisition statistics are in /sys/kernel/debug/daq_gert-comedi0/stats, write to
+ * the file to zero them, daqgert_stats.c renders them as rates and histograms.
+ * The daq_gert trace events mark each pipeline stage, daqgert_trace.c turns a
+ * captured trace into a per stage latency breakdown.
  * An optimized DMA driver is in the works
  * https://github.com/msperl/spi-bcm2835/wiki
  * (the current interrupt driven kernel driver is limited to a 12 to 64 byte FIFO and no DMA) HUNK_LEN data samples
@@ -181,7 +193,20 @@ by the module option variable daqgert_conf in the /etc/modprobe.d directory
 #include <linux/device.h> 
 #include <linux/timer.h> 
 #include <linux/list.h>  
+#include <linux/workqueue.h>
+#include <linux/cpumask.h>
+#include <linux/tick.h>
+#include <linux/percpu.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/kfifo.h>
+#include <linux/wait.h>
+#include <linux/completion.h>
+#include <linux/version.h>
 #include "comedi_8254.h"  
+#define CREATE_TRACE_POINTS
+#include "daq_gert_trace.h"
+#include "daq_gert_hunk.h"
 #include <mach/platform.h> /* for GPIO_BASE and ST_BASE */
 
 /* Error Return Values */
@@ -351,6 +376,15 @@ enum daqgert_state_bits {
 	SPI_AO_RUN,
 	CMD_TIMER,
 	CMD_RUN,
+	SPI_AI_STALL,
+	AO_SERVE, /* an AO sample is being put by the AO or AI thread */
+};
+
+/*
+ * async hunk state bits
+ */
+enum daqgert_hunk_bits {
+	HUNK_DECODE = 0,
 };
 
 /* 
@@ -387,10 +421,10 @@ static const uint32_t PICSL12 = 0;
 static const uint32_t SPI_BUFF_SIZE = 3072;
 static const uint32_t SPI_BUFF_SIZE_NOHUNK = 64;
 static const uint32_t MAX_CHANLIST_LEN = 256;
-static const uint32_t CONV_SPEED = 5000; /* 10s of nsecs: the true rate is ~3000/5000 so we need a fixup,  two conversions per mix scan */
-static const uint32_t CONV_SPEED_FIX = 19; /* usecs: round it up to ~50usecs total with this */
-static const uint32_t CONV_SPEED_FIX_FREERUN = 1; /* usecs: round it up to ~50usecs total with this */
-static const uint32_t CONV_SPEED_FIX_FAST = 9; /* used for the MCP3002 ADC */
+static const uint32_t CAL_SHORT = 16; /* transfers in the short calibration hunk */
+static const uint32_t CAL_RUNS = 8; /* messages timed per calibration point */
+static const uint32_t CAL_SINGLE = 64; /* EOC samples timed */
+static const uint32_t CAL_SLEEP_NS = 20000; /* hrtimeout used to time the EOC wakeup */
 static const uint32_t MAX_BOARD_RATE = 1000000000;
 static const uint8_t CS_CHANGE_DELAY_USECS = 1;
 static const uint8_t CSnA = 0; /* GPIO 8  Gertboard ADC */
@@ -467,6 +501,14 @@ static int32_t hunk_count = 0;
 module_param(hunk_count, int, S_IRUGO);
 static int32_t hunk_len = HUNK_LEN;
 module_param(hunk_len, int, S_IRUGO);
+static int32_t hunk_latency_us = 100000; /* 0 for hunk_len hunks always */
+module_param(hunk_latency_us, int, S_IRUGO | S_IWUSR);
+static int32_t hunk_adapt = 1;
+module_param(hunk_adapt, int, S_IRUGO | S_IWUSR);
+static int32_t ao_sched = 1; /* AO samples go between AI hunk segments */
+module_param(ao_sched, int, S_IRUGO);
+static int32_t ai_stamps = 0; /* 1MHz timer stamps for each AI hunk or scan */
+module_param(ai_stamps, int, S_IRUGO | S_IWUSR);
 static int32_t gert_autoload = 1;
 module_param(gert_autoload, int, S_IRUGO);
 static int32_t gert_type = 0;
@@ -477,6 +519,82 @@ static int32_t wiringpi = 1;
 module_param(wiringpi, int, S_IRUGO);
 static int32_t use_hunking = 1;
 module_param(use_hunking, int, S_IRUGO);
+static int32_t use_async = 1;
+module_param(use_async, int, S_IRUGO);
+static int32_t isolated = 0;
+module_param(isolated, int, S_IRUGO);
+
+/*
+ * acquisition thread placement, writable at runtime
+ */
+static char ai_cpus[32];
+static char ao_cpus[32];
+static struct kparam_string ai_cpus_kps = {
+	.maxlen = sizeof(ai_cpus),
+	.string = ai_cpus,
+};
+static struct kparam_string ao_cpus_kps = {
+	.maxlen = sizeof(ao_cpus),
+	.string = ao_cpus,
+};
+static int32_t ai_prio = 0;
+static int32_t ao_prio = 0;
+static atomic_t placement_gen = ATOMIC_INIT(0);
+
+static int daqgert_param_set_cpus(const char *val,
+				  const struct kernel_param *kp)
+{
+	char buf[32], *list;
+	cpumask_var_t mask;
+	int32_t ret = 0;
+
+	if (strlcpy(buf, val, sizeof(buf)) >= sizeof(buf))
+		return -ENOSPC;
+	list = strim(buf);
+	if (*list) { /* empty is the board default */
+		if (!alloc_cpumask_var(&mask, GFP_KERNEL))
+			return -ENOMEM;
+		ret = cpulist_parse(list, mask);
+		if (!ret && !cpumask_intersects(mask, cpu_online_mask))
+			ret = -EINVAL;
+		free_cpumask_var(mask);
+		if (ret)
+			return ret;
+	}
+	strlcpy(kp->str->string, list, kp->str->maxlen);
+	atomic_inc(&placement_gen);
+	return 0;
+}
+
+static int daqgert_param_set_prio(const char *val,
+				  const struct kernel_param *kp)
+{
+	int32_t prio, ret;
+
+	ret = kstrtoint(val, 0, &prio);
+	if (ret)
+		return ret;
+	if (prio < 0 || prio >= MAX_USER_RT_PRIO)
+		return -EINVAL;
+	*(int32_t *) kp->arg = prio;
+	atomic_inc(&placement_gen);
+	return 0;
+}
+
+static const struct kernel_param_ops daqgert_cpus_ops = {
+	.set = daqgert_param_set_cpus,
+	.get = param_get_string,
+};
+
+static const struct kernel_param_ops daqgert_prio_ops = {
+	.set = daqgert_param_set_prio,
+	.get = param_get_int,
+};
+
+module_param_cb(ai_cpus, &daqgert_cpus_ops, &ai_cpus_kps, S_IRUGO | S_IWUSR);
+module_param_cb(ao_cpus, &daqgert_cpus_ops, &ao_cpus_kps, S_IRUGO | S_IWUSR);
+module_param_cb(ai_prio, &daqgert_prio_ops, &ai_prio, S_IRUGO | S_IWUSR);
+module_param_cb(ao_prio, &daqgert_prio_ops, &ao_prio, S_IRUGO | S_IWUSR);
 
 struct daqgert_board {
 	const char *name;
@@ -486,7 +604,6 @@ struct daqgert_board {
 	int32_t n_aochan;
 	uint8_t n_aochan_bits;
 	uint32_t ai_ns_min;
-	uint32_t ai_ns_min_calc;
 	uint32_t ai_rate_min;
 	uint32_t ao_ns_min;
 	uint32_t ao_ns_min_calc;
@@ -513,8 +630,7 @@ static const struct daqgert_board daqgert_boards[] = {
 		.n_aichan_bits = 12,
 		.n_aochan = 2,
 		.n_aochan_bits = 12,
-		.ai_ns_min = 50000, /* values plus software overhead */
-		.ai_ns_min_calc = 35000,
+		.ai_ns_min = 50000, /* until calibrated, values plus software overhead */
 		.ai_rate_min = 20000,
 		.ao_ns_min = 5000,
 		.ao_ns_min_calc = 4500,
@@ -538,7 +654,6 @@ static const struct daqgert_board daqgert_boards[] = {
 		.n_aichan = 8,
 		.n_aochan = 8,
 		.ai_ns_min = 50000,
-		.ai_ns_min_calc = 35000,
 		.ai_rate_min = 20000,
 		.ao_ns_min = 5000,
 		.ao_ns_min_calc = 4500,
@@ -609,6 +724,75 @@ struct comedi_spigert {
 	uint32_t delay_nsecs;
 };
 
+/*
+ * acquisition statistics, one copy per cpu so the hot paths never share a
+ * cache line, summed when debugfs reads them. The histograms count in log2
+ * nanosecond buckets, bucket i holds 2^(i-1) to 2^i - 1 ns.
+ */
+#define DAQGERT_HIST 32
+
+struct daqgert_stats {
+	u64 samples;
+	u64 hunks;
+	u64 ao_samples;
+	u64 overruns; /* samples the comedi buffer had no room for */
+	u64 stalls; /* async hunks that waited for a decode */
+	u64 spi_msgs;
+	u64 spi_setups;
+	u64 segments; /* AI hunk messages sent in pieces around AO samples */
+	u64 ao_misses; /* AO update periods skipped */
+	u64 stamp_drops; /* timestamp records the reader had no room for */
+	u32 buf_hwm; /* comedi buffer bytes ready, high-water mark */
+	u32 ao_late_max;
+	u32 spi_lat[DAQGERT_HIST]; /* message submit to completion */
+	u32 wake_lat[DAQGERT_HIST]; /* thread wakeup past its hrtimer */
+	u32 ao_late[DAQGERT_HIST]; /* AO sample put past its deadline */
+};
+
+/*
+ * one AI timestamp record, read from the debugfs timestamps file. The
+ * samples from sample to sample + len - 1 of the command were converted
+ * between start and end, in BCM2835 system timer microseconds: the SPI
+ * message(s) of a hunk, or the first to the last conversion of a scan
+ * without hunks. sample counts from 0 at each command start.
+ */
+#define STAMP_RECS 4096
+
+struct daqgert_stamp {
+	u64 start;
+	u64 end;
+	u32 sample;
+	u32 len;
+};
+
+/*
+ * one of the two hunk messages the async engine ping-pongs
+ */
+struct daqgert_hunk {
+	struct spi_message m;
+	ktime_t start;
+	u64 stamp[2]; /* 1MHz timer at submit and completion */
+	struct spi_transfer *t;
+	uint32_t len; /* transfers in m */
+	uint8_t *rx_buff;
+	unsigned long flags;
+	struct work_struct work;
+	struct comedi_device *dev;
+};
+
+/*
+ * measured AI conversion costs, the cmdtest timing comes from these
+ */
+struct daqgert_calib {
+	uint32_t hz; /* SPI clock they were measured at */
+	uint32_t hunk_ns; /* per conversion inside a hunk message */
+	uint32_t hunk_msg_ns; /* per hunk message */
+	uint32_t single_ns; /* one EOC sample with its message and setup */
+	uint32_t wake_ns; /* EOC thread hrtimeout overshoot */
+	uint32_t ns_min; /* fastest conversion period of any mode */
+	bool valid;
+};
+
 /* 
  * RPi board control state variables 
  */
@@ -621,12 +805,19 @@ struct daqgert_private {
 	int32_t num_subdev;
 	unsigned long state_bits;
 	uint32_t ai_rate_max, ao_rate_max, ao_timer, ao_counter;
-	uint32_t ai_conv_delay_usecs, ai_conv_delay_10nsecs, ai_cmd_delay_usecs;
+	uint32_t ai_conv_delay_usecs, ai_cmd_delay_usecs;
 	int32_t ai_chan, ao_chan, ai_count, ao_count, ai_range, hunk_count;
 	struct mutex drvdata_lock, cmd_lock;
 	uint32_t val;
 	uint16_t use_hunking : 1;
+	uint16_t ai_async : 1;
 	uint32_t ai_hunk;
+	uint32_t ai_hunk_len, ai_hunk_min, ai_hunk_max; /* transfers per hunk now, for the latency target and as built */
+	struct daqgert_hunk ai_hunks[2];
+	struct workqueue_struct *ai_wq;
+	struct task_struct *ai_wq_task; /* the worker while it decodes a hunk */
+	struct completion ai_async_done; /* the hunk chain has ended */
+	uint32_t ai_async_stalls;
 	uint16_t ai_mix : 1;
 	uint16_t ai_neverending : 1;
 	uint16_t ao_neverending : 1;
@@ -638,6 +829,9 @@ struct daqgert_private {
 	uint32_t ai_scans; /*  length of scanlist */
 	int32_t ai_scans_left; /*  number left to finish */
 	uint32_t ao_scans; /*  length of scanlist */
+	atomic64_t ao_deadline; /* next AO sample in ns, the AI thread reads it */
+	ktime_t ads1220_sync; /* start of the last ADS1220 conversion */
+	uint32_t ao_period_ns;
 	struct spi_param_type *ai_spi;
 	struct spi_param_type *ao_spi;
 	void (*pinMode) (struct comedi_device *dev, int32_t pin, int32_t mode);
@@ -650,8 +844,19 @@ struct daqgert_private {
 	int32_t ai_node;
 	int32_t ao_node;
 	uint32_t cpu_nodes;
+	int32_t ai_gen, ao_gen; /* placement_gen the threads last applied */
+	struct daqgert_stats __percpu *stats;
+	ktime_t stats_start;
+	struct dentry *debugfs;
+	struct daqgert_calib calib;
+	uint16_t ai_stamps : 1; /* ai_stamps when the command started */
+	u64 ai_stamp[2]; /* sync conversion start and end */
+	u64 ai_scan_stamp; /* first conversion of the scan */
+	uint32_t stamp_pos; /* sample index of the next record */
+	DECLARE_KFIFO_PTR(stamps, struct daqgert_stamp);
+	wait_queue_head_t stamp_wait;
+	struct mutex stamp_lock; /* one reader at a time */
 	bool smp;
-	struct comedi_8254 pacer;
 };
 
 static int32_t daqgert_spi_probe(struct comedi_device *,
@@ -666,6 +871,7 @@ static void daqgert_handle_ai_eoc(struct comedi_device *,
 				  struct comedi_subdevice *);
 static void daqgert_handle_ao_eoc(struct comedi_device *,
 				  struct comedi_subdevice *);
+static void daqgert_ao_service(struct comedi_device *);
 static void my_timer_ai_callback(unsigned long);
 static void daqgert_ai_set_chan_range(struct comedi_device *,
 				      uint32_t, char);
@@ -676,6 +882,121 @@ static void daqgert_ao_put_sample(struct comedi_device *,
 				  uint32_t);
 static void daqgert_handle_ai_hunk(struct comedi_device *,
 				   struct comedi_subdevice *);
+static int32_t daqgert_ai_async_submit(struct comedi_device *,
+				       struct daqgert_hunk *);
+
+static inline uint32_t daqgert_bucket(s64 ns)
+{
+	if (ns <= 0)
+		return 0;
+	return min_t(uint32_t, fls64(ns), DAQGERT_HIST - 1);
+}
+
+#define daqgert_hist(hist, ns)	this_cpu_inc((hist)[daqgert_bucket(ns)])
+
+/*
+ * count one SPI message that started at t0
+ */
+static inline void daqgert_stat_spi(struct daqgert_private *devpriv,
+				    ktime_t t0)
+{
+	this_cpu_inc(devpriv->stats->spi_msgs);
+	daqgert_hist(devpriv->stats->spi_lat,
+		ktime_to_ns(ktime_sub(ktime_get(), t0)));
+}
+
+static inline void daqgert_stat_buf(struct daqgert_private *devpriv,
+				    struct comedi_subdevice *s)
+{
+	uint32_t n = comedi_buf_n_bytes_ready(s);
+
+	if (n > this_cpu_read(devpriv->stats->buf_hwm))
+		this_cpu_write(devpriv->stats->buf_hwm, n);
+}
+
+/*
+ * an AO command shares the SPI bus with the AI hunks
+ */
+static bool daqgert_ao_sched(struct comedi_device *dev)
+{
+	struct daqgert_private *devpriv = dev->private;
+
+	return ao_sched && test_bit(AO_CMD_RUNNING, &devpriv->state_bits);
+}
+
+/*
+ * the AO deadline is kept by whichever thread puts the sample and read by
+ * the other, a plain ktime_t could tear on 32 bit ARM
+ */
+static inline ktime_t daqgert_ao_deadline(struct daqgert_private *devpriv)
+{
+	return ns_to_ktime(atomic64_read(&devpriv->ao_deadline));
+}
+
+static inline void daqgert_ao_set_deadline(struct daqgert_private *devpriv,
+					   ktime_t t)
+{
+	atomic64_set(&devpriv->ao_deadline, ktime_to_ns(t));
+}
+
+/*
+ * the AI thread is streaming hunks and puts the AO samples
+ */
+static bool daqgert_ai_sched(struct comedi_device *dev)
+{
+	struct daqgert_private *devpriv = dev->private;
+
+	return ao_sched && devpriv->ai_hunk && !devpriv->ai_async
+		&& test_bit(AI_CMD_RUNNING, &devpriv->state_bits);
+}
+
+/*
+ * the 64 bit BCM2835 system timer, CHI again after CLO catches a carry
+ * between the two reads
+ */
+static u64 daqgert_timer_us(struct daqgert_private *devpriv)
+{
+	uint32_t hi, lo;
+
+	do {
+		hi = ioread32(devpriv->timer_1mhz + 2);
+		lo = ioread32(devpriv->timer_1mhz + 1);
+	} while (hi != ioread32(devpriv->timer_1mhz + 2));
+	return ((u64) hi << 32) | lo;
+}
+
+static inline void daqgert_ai_stamp_at(struct daqgert_private *devpriv,
+				       int32_t i)
+{
+	if (devpriv->ai_stamps)
+		devpriv->ai_stamp[i] = daqgert_timer_us(devpriv);
+}
+
+/*
+ * queue a timestamp record for len samples in the Comedi buffer, from the
+ * one AI thread or the ordered decode workqueue so the fifo has a single
+ * producer
+ */
+static void daqgert_ai_stamp(struct comedi_device *dev,
+			     u64 start,
+			     u64 end,
+			     uint32_t len)
+{
+	struct daqgert_private *devpriv = dev->private;
+	struct daqgert_stamp rec = {
+		.start = start,
+		.end = end,
+		.sample = devpriv->stamp_pos,
+		.len = len,
+	};
+
+	if (!devpriv->ai_stamps || !len)
+		return;
+	devpriv->stamp_pos += len;
+	if (unlikely(!kfifo_put(&devpriv->stamps, rec)))
+		this_cpu_inc(devpriv->stats->stamp_drops);
+	wake_up_interruptible(&devpriv->stamp_wait);
+}
 
 /* 
  * pin exclude list 
@@ -1214,6 +1535,63 @@ static int32_t daqgert_device_offset(int32_t device_type)
 	return len;
 }
 
+/*
+ * move the calling acquisition thread to its cpus and scheduling policy,
+ * only called by the thread itself while no command is running
+ */
+static void daqgert_thread_place(struct comedi_device *dev,
+				 const char *cpus,
+				 int32_t node,
+				 int32_t prio,
+				 int32_t *gen)
+{
+	struct sched_param param = {.sched_priority = prio};
+	cpumask_var_t mask;
+	char list[32];
+
+	*gen = atomic_read(&placement_gen);
+	if (!alloc_cpumask_var(&mask, GFP_KERNEL))
+		return;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 2, 0)
+	kernel_param_lock(THIS_MODULE);
+	strlcpy(list, cpus, sizeof(list));
+	kernel_param_unlock(THIS_MODULE);
+#else
+	__kernel_param_lock(); /* 4.1 has the one global param lock */
+	strlcpy(list, cpus, sizeof(list));
+	__kernel_param_unlock();
+#endif
+	cpumask_clear(mask);
+	if (list[0])
+		cpulist_parse(list, mask);
+	else
+		cpumask_set_cpu(node, mask);
+	cpumask_and(mask, mask, cpu_online_mask);
+	if (cpumask_empty(mask))
+		cpumask_copy(mask, cpu_online_mask);
+
+	set_cpus_allowed_ptr(current, mask);
+	sched_setscheduler(current, prio ? SCHED_FIFO : SCHED_NORMAL, &param);
+	dev_info(dev->class_dev, "%s: cpus %*pbl, %s %i\n", current->comm,
+		cpumask_pr_args(mask), prio ? "SCHED_FIFO" : "SCHED_NORMAL",
+		prio);
+	free_cpumask_var(mask);
+}
+
+/*
+ * nth highest nohz_full cpu online, def if there are not that many
+ */
+static int32_t daqgert_isolated_cpu(int32_t nth, int32_t def)
+{
+	int32_t cpu;
+
+	for (cpu = nr_cpu_ids - 1; cpu >= 0; cpu--)
+		if (cpu_online(cpu) && tick_nohz_full_cpu(cpu) && !nth--)
+			return cpu;
+	return def;
+}
+
 /* 
  * A client must be connected with a valid comedi cmd 
  * and *data a pointer to that comedi structure
@@ -1227,22 +1605,35 @@ static int32_t daqgert_ai_thread_function(void *data)
 	struct spi_param_type *spi_data = s->private;
 	struct spi_device *spi = spi_data->spi;
 	struct comedi_spigert *pdata = spi->dev.platform_data;
+	ktime_t t0;
 
 	if (!devpriv)
 		return -EFAULT;
 
+	daqgert_thread_place(dev, ai_cpus, devpriv->ai_node, ai_prio,
+			&devpriv->ai_gen);
 	while (!kthread_should_stop()) {
 		while (unlikely(!devpriv->run)) {
-			if (devpriv->timer)
+			if (devpriv->timer && !devpriv->ai_async)
 				schedule();
 			else
 				usleep_range(750, 1000);
+			if (unlikely(devpriv->ai_gen != atomic_read(&placement_gen))
+				&& !test_bit(AI_CMD_RUNNING, &devpriv->state_bits))
+				daqgert_thread_place(dev, ai_cpus,
+						devpriv->ai_node, ai_prio,
+						&devpriv->ai_gen);
 
 			if (kthread_should_stop())
 				return 0;
 		}
 		if (likely(test_bit(AI_CMD_RUNNING, &devpriv->state_bits))) {
-			if (likely(devpriv->ai_hunk)) {
+			if (unlikely(devpriv->ai_hunk && devpriv->ai_async)) {
+				/* the SPI completions run the hunks, sleep until the chain ends */
+				if (wait_for_completion_timeout(&devpriv->ai_async_done,
+					HZ / 10))
+					usleep_range(750, 1000); /* ended, cancel is near */
+			} else if (likely(devpriv->ai_hunk)) {
 				smp_mb__before_atomic();
 				set_bit(SPI_AI_RUN, &devpriv->state_bits);
 				smp_mb__after_atomic();
@@ -1254,12 +1645,20 @@ static int32_t daqgert_ai_thread_function(void *data)
 				devpriv->ai_count++;
 				__set_current_state(TASK_UNINTERRUPTIBLE);
 				pdata->kmin = ktime_set(0, pdata->delay_nsecs);
+				t0 = ktime_get();
 				schedule_hrtimeout_range(&pdata->kmin, 0,
 							HRTIMER_MODE_REL_PINNED);
+				daqgert_hist(devpriv->stats->wake_lat,
+					ktime_to_ns(ktime_sub(ktime_get(), t0))
+					- pdata->delay_nsecs);
 			}
 		} else {
 			clear_bit(SPI_AI_RUN, &devpriv->state_bits);
 			smp_mb__after_atomic();
+			if (unlikely(devpriv->ai_gen != atomic_read(&placement_gen)))
+				daqgert_thread_place(dev, ai_cpus,
+						devpriv->ai_node, ai_prio,
+						&devpriv->ai_gen);
 			usleep_range(750, 1000);
 		}
 	}
@@ -1278,23 +1677,33 @@ static int32_t daqgert_ao_thread_function(void *data)
 	struct spi_param_type *spi_data = s->private;
 	struct spi_device *spi = spi_data->spi;
 	struct comedi_spigert *pdata = spi->dev.platform_data;
+	ktime_t t0;
 
 	if (!devpriv)
 		return -EFAULT;
 
+	daqgert_thread_place(dev, ao_cpus, devpriv->ao_node, ao_prio,
+			&devpriv->ao_gen);
 	while (!kthread_should_stop()) {
 		if (likely(test_bit(AO_CMD_RUNNING, &devpriv->state_bits))) {
-			smp_mb__before_atomic();
-			set_bit(SPI_AO_RUN, &devpriv->state_bits);
-			smp_mb__after_atomic();
-			daqgert_handle_ao_eoc(dev, s);
+			t0 = daqgert_ao_deadline(devpriv);
+			/* a streaming AI hunk puts the sample, step in if it is late */
+			if (daqgert_ai_sched(dev))
+				t0 = ktime_add_ns(t0, devpriv->ao_period_ns / 2);
 			__set_current_state(TASK_UNINTERRUPTIBLE);
-			pdata->kmin = ktime_set(0, pdata->delay_nsecs);
+			pdata->kmin = t0;
 			schedule_hrtimeout_range(&pdata->kmin, 0,
-						HRTIMER_MODE_REL_PINNED);
+						HRTIMER_MODE_ABS_PINNED);
+			daqgert_hist(devpriv->stats->wake_lat,
+				ktime_to_ns(ktime_sub(ktime_get(), t0)));
+			daqgert_ao_service(dev);
 		} else {
 			clear_bit(SPI_AO_RUN, &devpriv->state_bits);
 			smp_mb__after_atomic();
+			if (unlikely(devpriv->ao_gen != atomic_read(&placement_gen)))
+				daqgert_thread_place(dev, ao_cpus,
+						devpriv->ao_node, ao_prio,
+						&devpriv->ao_gen);
 			usleep_range(750, 1000);
 		}
 	}
@@ -1317,10 +1726,51 @@ static void daqgert_ai_start_pacer(struct comedi_device *dev,
 			+ msecs_to_jiffies(10));
 }
 
+/*
+ * The ADS1220 runs single shot, SYNC starts a conversion and RDATA reads the
+ * last finished one, so a read sooner than the conversion time after the
+ * SYNC returns the code before it again. Conversion time of ads1220_r1 in
+ * usecs, 10% for the internal oscillator tolerance and the SPI.
+ */
+static uint32_t daqgert_ads1220_conv_usecs(void)
+{
+	static const uint32_t sps[] = {20, 45, 90, 175, 330, 600, 1000, 1000};
+	uint32_t rate = sps[ads1220_r1 >> 5];
+
+	if ((ads1220_r1 & ADS1220_MODE_DCT) == ADS1220_MODE_TURBO)
+		rate *= 2;
+	else if ((ads1220_r1 & ADS1220_MODE_DCT) == ADS1220_MODE_DUTY)
+		rate /= 4;
+	return 1100000 / rate + 100;
+}
+
+static void daqgert_ads1220_sync(struct daqgert_private *devpriv,
+				 struct spi_device *spi)
+{
+	int32_t sync = ADS1220_CMD_SYNC;
+
+	spi_write(spi, &sync, 1);
+	devpriv->ads1220_sync = ktime_get();
+}
+
+/*
+ * sleep until the conversion started by the last SYNC is done, an insn
+ * burst is paced to the data rate
+ */
+static void daqgert_ads1220_wait(struct daqgert_private *devpriv)
+{
+	s64 usecs = daqgert_ads1220_conv_usecs()
+		- ktime_us_delta(ktime_get(), devpriv->ads1220_sync);
+
+	if (usecs > 0)
+		usleep_range(usecs, usecs + 100);
+}
+
 static void daqgert_ai_set_chan_range_ads1220(struct comedi_device *dev,
 					      struct comedi_subdevice *s,
 					      uint32_t chanspec)
 {
+	struct spi_param_type *spi_data = s->private;
 	struct daqgert_private *devpriv = dev->private;
 	uint32_t range = CR_RANGE(chanspec);
 	uint32_t chan = CR_CHAN(chanspec);
@@ -1354,6 +1804,8 @@ static void daqgert_ai_set_chan_range_ads1220(struct comedi_device *dev,
 		cMux |= ((range & 0x03) << 1); /* setup the gain bits for range with NO pga*/
 		cMux |= ads1220_r0_for_mux_gain;
 		ADS1220WriteRegister(ADS1220_0_REGISTER, 0x01, &cMux, s);
+		/* the pending conversion was on the old input */
+		daqgert_ads1220_sync(devpriv, spi_data->spi);
 	}
 
 	devpriv->ai_chan = CR_CHAN(chanspec);
@@ -1406,6 +1858,7 @@ static void daqgert_ao_put_sample(struct comedi_device *dev,
 	struct spi_device *spi = spi_data->spi;
 	struct comedi_spigert *pdata = spi->dev.platform_data;
 	uint32_t val_tmp, chan;
+	ktime_t t0;
 
 	mutex_lock(&devpriv->drvdata_lock);
 	chan = CR_CHAN(devpriv->ao_chan);
@@ -1416,15 +1869,81 @@ static void daqgert_ao_put_sample(struct comedi_device *dev,
 	spi->mode = thisboard->spi_mode;
 	spi->max_speed_hz = thisboard->ao_max_speed_hz;
 	spi_setup(spi);
+	this_cpu_inc(devpriv->stats->spi_setups);
+	t0 = ktime_get();
 	spi_write_then_read(spi, pdata->tx_buff, 2,
 			pdata->rx_buff, 2);
+	daqgert_stat_spi(devpriv, t0);
+	trace_daqgert_ao_put(dev->minor, chan, val);
 	s->readback[chan] = val;
 	devpriv->ao_count++;
+	this_cpu_inc(devpriv->stats->ao_samples);
 	mutex_unlock(&devpriv->drvdata_lock);
 	clear_bit(SPI_AO_RUN, &devpriv->state_bits);
 	smp_mb__after_atomic();
 }
 
+/*
+ * Send a hunk of len transfers as messages that end at the AO deadlines
+ * and put the AO sample between them, the AO update period comes first and
+ * the AI hunk has the bus for the rest. conv_ns is one transfer with its
+ * spacing. Called with drvdata_lock held, it is dropped while waiting for
+ * the AO slot and putting the sample.
+ */
+static int32_t daqgert_ai_hunk_segments(struct comedi_device *dev,
+					struct spi_device *spi,
+					struct spi_transfer *t,
+					uint32_t len,
+					uint32_t conv_ns)
+{
+	struct daqgert_private *devpriv = dev->private;
+	struct spi_message m;
+	uint32_t pos = 0, seg;
+	int64_t left;
+	ktime_t t0, deadline;
+	bool cs;
+
+	conv_ns = max_t(uint32_t, conv_ns, 1);
+	while (pos < len) {
+		deadline = daqgert_ao_deadline(devpriv);
+		left = ktime_to_ns(ktime_sub(deadline, ktime_get()))
+			- devpriv->calib.hunk_msg_ns;
+		if (left < conv_ns && daqgert_ao_sched(dev)) {
+			/* not even one more conversion fits, wait for the slot */
+			mutex_unlock(&devpriv->drvdata_lock);
+			while (ktime_before(ktime_get(), deadline))
+				cpu_relax();
+			daqgert_ao_service(dev);
+			mutex_lock(&devpriv->drvdata_lock);
+			left = ktime_to_ns(ktime_sub(daqgert_ao_deadline(devpriv),
+						ktime_get())) - devpriv->calib.hunk_msg_ns;
+		}
+		if (!daqgert_ao_sched(dev))
+			seg = len - pos;
+		else if (left < conv_ns)
+			seg = 1;
+		else
+			seg = min_t(int64_t, len - pos, div_s64(left, conv_ns));
+
+		/* chip select up after the last transfer of the piece */
+		cs = t[pos + seg - 1].cs_change;
+		t[pos + seg - 1].cs_change = false;
+		spi_message_init_with_transfers(&m, &t[pos], seg);
+		t0 = ktime_get();
+		spi_bus_lock(spi->master);
+		spi_sync_locked(spi, &m);
+		spi_bus_unlock(spi->master);
+		daqgert_stat_spi(devpriv, t0);
+		t[pos + seg - 1].cs_change = cs;
+		if (seg < len)
+			this_cpu_inc(devpriv->stats->segments);
+		if (unlikely(m.status))
+			return m.status;
+		pos += seg;
+	}
+	return 0;
+}
+
 /*
  * returns one value from the ADC device
  */
@@ -1437,18 +1956,21 @@ static int32_t daqgert_ai_get_sample(struct comedi_device *dev,
 	struct spi_device *spi = spi_data->spi;
 	struct comedi_spigert *pdata = spi->dev.platform_data;
 	struct spi_message m;
-	int32_t chan, sync;
+	int32_t chan;
 	int32_t val;
+	ktime_t t0;
 
 	mutex_lock(&devpriv->drvdata_lock);
 	chan = CR_CHAN(devpriv->ai_chan);
 	/* Make SPI messages for the type of ADC are we talking to */
 	/* The PIC Slave needs 8 bit transfers only */
 	if (unlikely(spi_data->pic18)) { /*  PIC18 SPI slave device. NO MULTI_MODE ever */
+		daqgert_ai_stamp_at(devpriv, 0);
 		if (likely(devpriv->ai_spi->device_type != ADS1220)) {
 			spi->mode = thisboard->spi_mode;
 			spi->max_speed_hz = thisboard->ai_max_speed_hz;
 			spi_setup(spi);
+			this_cpu_inc(devpriv->stats->spi_setups);
 			udelay(devpriv->ai_cmd_delay_usecs); /* ADC conversion delay */
 			pdata->tx_buff[0] = CMD_ADC_GO + chan;
 			spi_write_then_read(spi, pdata->tx_buff, 1,
@@ -1481,9 +2003,12 @@ static int32_t daqgert_ai_get_sample(struct comedi_device *dev,
 			spi->mode = thisboard->spi_mode_ads1220;
 			spi->max_speed_hz = thisboard->ai_max_speed_hz_ads1220;
 			spi_setup(spi);
+			this_cpu_inc(devpriv->stats->spi_setups);
+			t0 = ktime_get();
 			spi_bus_lock(spi->master);
 			spi_sync_locked(spi, &m); /* exchange SPI data */
 			spi_bus_unlock(spi->master);
+			daqgert_stat_spi(devpriv, t0);
 			val = pdata->rx_buff[1];
 			val = (val << 8) | pdata->rx_buff[2];
 			val = (val << 8) | pdata->rx_buff[3];
@@ -1493,14 +2018,13 @@ static int32_t daqgert_ai_get_sample(struct comedi_device *dev,
 			val &= 0x0ffffff;
 			val ^= 0x0800000;
 
-			sync = ADS1220_CMD_SYNC;
-			spi_write(spi, &sync, 1);
+			daqgert_ads1220_sync(devpriv, spi);
 		}
 		devpriv->ai_count++;
 	} else { /* Gertboard onboard ADC device */
 		if (likely(devpriv->ai_hunk)) {
 			spi_message_init_with_transfers(&m,
-							&pdata->t[0], hunk_len);
+							&pdata->t[0], devpriv->ai_hunk_len);
 		} else {
 			pdata->one_t.len = daqgert_device_offset(spi_data->device_type);
 			pdata->tx_buff[0] = 0xd0 | ((chan & 0x01) << 5);
@@ -1510,9 +2034,25 @@ static int32_t daqgert_ai_get_sample(struct comedi_device *dev,
 		spi->mode = SPI_MODE;
 		spi->max_speed_hz = SPI_SPEED;
 		spi_setup(spi);
-		spi_bus_lock(spi->master);
-		spi_sync_locked(spi, &m); /* exchange SPI data */
-		spi_bus_unlock(spi->master);
+		this_cpu_inc(devpriv->stats->spi_setups);
+		if (likely(devpriv->ai_hunk))
+			trace_daqgert_hunk_submit(dev->minor, 0,
+						devpriv->ai_hunk_len);
+		daqgert_ai_stamp_at(devpriv, 0);
+		if (likely(devpriv->ai_hunk) && daqgert_ao_sched(dev)) {
+			m.status = daqgert_ai_hunk_segments(dev, spi, pdata->t,
+							devpriv->ai_hunk_len,
+							devpriv->calib.hunk_ns
+							+ pdata->delay_usecs * NSEC_PER_USEC);
+		} else {
+			t0 = ktime_get();
+			spi_bus_lock(spi->master);
+			spi_sync_locked(spi, &m); /* exchange SPI data */
+			spi_bus_unlock(spi->master);
+			daqgert_stat_spi(devpriv, t0);
+		}
+		if (likely(devpriv->ai_hunk))
+			trace_daqgert_hunk_complete(dev->minor, 0, m.status);
 		/* ADC type code result munging */
 		if (likely(devpriv->ai_hunk)) {
 			/* data will be sent to comedi buffers later */
@@ -1529,6 +2069,7 @@ static int32_t daqgert_ai_get_sample(struct comedi_device *dev,
 			devpriv->ai_count++;
 		}
 	}
+	daqgert_ai_stamp_at(devpriv, 1);
 	mutex_unlock(&devpriv->drvdata_lock);
 	clear_bit(SPI_AI_RUN, &devpriv->state_bits);
 	smp_mb__after_atomic();
@@ -1549,9 +2090,19 @@ static void daqgert_handle_ai_eoc(struct comedi_device *dev,
 	uint32_t chan = s->async->cur_chan;
 
 	val = daqgert_ai_get_sample(dev, s);
-	comedi_buf_write_samples(s, &val, 1);
+	if (unlikely(!comedi_buf_write_samples(s, &val, 1)))
+		this_cpu_inc(devpriv->stats->overruns);
+	this_cpu_inc(devpriv->stats->samples);
+	daqgert_stat_buf(devpriv, s);
+	trace_daqgert_buf_commit(dev->minor, devpriv->ai_count,
+				comedi_buf_n_bytes_ready(s));
 
 	next_chan = s->async->cur_chan;
+	if (!chan)
+		devpriv->ai_scan_stamp = devpriv->ai_stamp[0];
+	if (!next_chan) /* a whole scan is in the buffer */
+		daqgert_ai_stamp(dev, devpriv->ai_scan_stamp,
+				devpriv->ai_stamp[1], cmd->chanlist_len);
 	if (cmd->chanlist[chan] != cmd->chanlist[next_chan])
 		daqgert_ai_set_chan_range(dev, cmd->chanlist[next_chan], 1);
 
@@ -1605,6 +2156,44 @@ static void daqgert_handle_ao_eoc(struct comedi_device *dev,
 	daqgert_ao_next_chan(dev, s);
 }
 
+/*
+ * put the AO sample if its deadline has come, from the AO thread or
+ * between AI hunk segments, whichever gets there first
+ */
+static void daqgert_ao_service(struct comedi_device *dev)
+{
+	struct daqgert_private *devpriv = dev->private;
+	struct comedi_subdevice *s = &dev->subdevices[2];
+	ktime_t now, deadline;
+	int64_t late;
+
+	if (test_and_set_bit_lock(AO_SERVE, &devpriv->state_bits))
+		return;
+	now = ktime_get();
+	deadline = daqgert_ao_deadline(devpriv);
+	if (test_bit(AO_CMD_RUNNING, &devpriv->state_bits)
+		&& !ktime_before(now, deadline)) {
+		late = ktime_to_ns(ktime_sub(now, deadline));
+		set_bit(SPI_AO_RUN, &devpriv->state_bits);
+		smp_mb__after_atomic();
+		daqgert_handle_ao_eoc(dev, s);
+		clear_bit(SPI_AO_RUN, &devpriv->state_bits);
+		smp_mb__after_atomic();
+		daqgert_hist(devpriv->stats->ao_late, late);
+		if (late > this_cpu_read(devpriv->stats->ao_late_max))
+			this_cpu_write(devpriv->stats->ao_late_max,
+				min_t(int64_t, late, U32_MAX));
+		/* keep to the period, skip the slots that were missed */
+		deadline = ktime_add_ns(deadline, devpriv->ao_period_ns);
+		while (!ktime_after(deadline, now)) {
+			deadline = ktime_add_ns(deadline, devpriv->ao_period_ns);
+			this_cpu_inc(devpriv->stats->ao_misses);
+		}
+		daqgert_ao_set_deadline(devpriv, deadline);
+	}
+	clear_bit_unlock(AO_SERVE, &devpriv->state_bits);
+}
+
 /*
  * moves the data from the SPI buffers into the Comedi buffer 10bit
  */
@@ -1614,6 +2203,7 @@ static void transfer_from_hunk_buf_3002(struct comedi_device *dev,
 					uint32_t bufpos,
 					uint32_t len)
 {
+	struct daqgert_private *devpriv = dev->private;
 	struct comedi_cmd *cmd = &s->async->cmd;
 	uint32_t i, val;
 
@@ -1621,7 +2211,8 @@ static void transfer_from_hunk_buf_3002(struct comedi_device *dev,
 	for (i = 0; i < len; i++) {
 		val = ((bufptr[0 + bufpos] << 7)
 			| (bufptr[1 + bufpos] >> 1)) & 0x3FF;
-		comedi_buf_write_samples(s, &val, 1);
+		if (unlikely(!comedi_buf_write_samples(s, &val, 1)))
+			this_cpu_inc(devpriv->stats->overruns);
 		bufpos += 2;
 
 		if (unlikely(cmd->stop_src == TRIG_COUNT &&
@@ -1643,6 +2234,7 @@ static void transfer_from_hunk_buf_3202(struct comedi_device *dev,
 					uint32_t bufpos,
 					uint32_t len)
 {
+	struct daqgert_private *devpriv = dev->private;
 	struct comedi_cmd *cmd = &s->async->cmd;
 	uint32_t i, val;
 
@@ -1651,7 +2243,8 @@ static void transfer_from_hunk_buf_3202(struct comedi_device *dev,
 		val = (bufptr[2 + bufpos]&0x80) >> 7;
 		val += bufptr[1 + bufpos] << 1;
 		val += (bufptr[0 + bufpos]&0x0f) << 9;
-		comedi_buf_write_samples(s, &val, 1);
+		if (unlikely(!comedi_buf_write_samples(s, &val, 1)))
+			this_cpu_inc(devpriv->stats->overruns);
 		bufpos += 3;
 
 		if (unlikely(cmd->stop_src == TRIG_COUNT &&
@@ -1742,26 +2335,24 @@ static int32_t transfer_to_hunk_buf(struct comedi_device *dev,
 	return ret;
 }
 
-static void daqgert_handle_ai_hunk(struct comedi_device *dev,
-				   struct comedi_subdevice * s)
+/*
+ * moves one hunk of received SPI data into the Comedi buffer
+ */
+static int32_t daqgert_ai_decode_hunk(struct comedi_device *dev,
+				      struct comedi_subdevice *s,
+				      uint8_t *bufptr,
+				      int32_t id,
+				      int32_t n)
 {
 	struct daqgert_private *devpriv = dev->private;
 	struct comedi_cmd *cmd = &s->async->cmd;
 	struct spi_param_type *spi_data = s->private;
-	struct spi_device *spi = spi_data->spi;
-	struct comedi_spigert *pdata = spi->dev.platform_data;
-	int32_t len, bufpos;
-	uint8_t *bufptr;
-
-	daqgert_ai_get_sample(dev, s); /* get the data from the ADC via SPI */
-	bufptr = (uint8_t *) pdata->rx_buff;
-	bufpos = 0;
+	int32_t len, bufpos = 0;
 
-	len = devpriv->ai_scans;
+	len = n;
 	if (cmd->stop_src == TRIG_COUNT) {
-		if (devpriv->ai_scans_left > hunk_len) {
-			devpriv->ai_scans_left -= hunk_len;
-			len = hunk_len;
+		if (devpriv->ai_scans_left > n) {
+			devpriv->ai_scans_left -= n;
 		} else {
 			len = devpriv->ai_scans_left;
 			devpriv->ai_scans_left = 0;
@@ -1769,6 +2360,9 @@ static void daqgert_handle_ai_hunk(struct comedi_device *dev,
 	}
 
 	devpriv->ai_count += len;
+	this_cpu_add(devpriv->stats->samples, len);
+	this_cpu_inc(devpriv->stats->hunks);
+	trace_daqgert_decode_begin(dev->minor, id, len);
 	/*
 	 * two routines to optimize speed in each
 	 */
@@ -1776,44 +2370,305 @@ static void daqgert_handle_ai_hunk(struct comedi_device *dev,
 		transfer_from_hunk_buf_3202(dev, s, bufptr, bufpos, len);
 	else
 		transfer_from_hunk_buf_3002(dev, s, bufptr, bufpos, len);
-	/* 
-	 * debug comment
-	if (cmd->stop_src == TRIG_COUNT)
-		dev_info(dev->class_dev, "From hunk %i %i\n",
-			s->async->scans_done, cmd->stop_arg);
-	 */
+	trace_daqgert_decode_end(dev->minor, id, len);
+	daqgert_stat_buf(devpriv, s);
+	return len;
+}
+
+/*
+ * with hunk_adapt, double the hunk while the Comedi buffer is over half
+ * full, a reader that is behind gets fewer and bigger hunks for less
+ * overhead, and halve it back to the latency target once it has drained
+ * the buffer below an eighth
+ */
+static uint32_t daqgert_ai_hunk_adapt(struct comedi_device *dev,
+				      struct comedi_subdevice *s,
+				      uint32_t len)
+{
+	struct daqgert_private *devpriv = dev->private;
+
+	if (!hunk_adapt)
+		return len;
+	return daqgert_hunk_adapt(len, comedi_buf_n_bytes_ready(s),
+				s->async->prealloc_bufsz, devpriv->ai_hunk_min,
+				devpriv->ai_hunk_max, s->async->cmd.chanlist_len);
 }
 
 /*
- * test for conditions that allow for the hunk_len transfer buffer
+ * move the end of a hunk message from transfer old to len, the chip
+ * select has to go up after the last transfer
+ */
+static void daqgert_ai_hunk_end(struct spi_transfer *t,
+				uint32_t old,
+				uint32_t len)
+{
+	t[old - 1].cs_change = true;
+	t[len - 1].cs_change = false;
+}
+
+static void daqgert_handle_ai_hunk(struct comedi_device *dev,
+				   struct comedi_subdevice * s)
+{
+	struct daqgert_private *devpriv = dev->private;
+	struct spi_param_type *spi_data = s->private;
+	struct spi_device *spi = spi_data->spi;
+	struct comedi_spigert *pdata = spi->dev.platform_data;
+	uint32_t len = devpriv->ai_hunk_len, next;
+	int32_t done;
+
+	daqgert_ai_get_sample(dev, s); /* get the data from the ADC via SPI */
+	done = daqgert_ai_decode_hunk(dev, s, (uint8_t *) pdata->rx_buff, 0, len);
+	daqgert_ai_stamp(dev, devpriv->ai_stamp[0], devpriv->ai_stamp[1], done);
+	if (test_bit(AI_CMD_RUNNING, &devpriv->state_bits))
+		comedi_handle_events(dev, s);
+	trace_daqgert_buf_commit(dev->minor, devpriv->ai_count,
+				comedi_buf_n_bytes_ready(s));
+	next = daqgert_ai_hunk_adapt(dev, s, len);
+	if (next != len) {
+		daqgert_ai_hunk_end(pdata->t, len, next);
+		devpriv->ai_hunk_len = next;
+	}
+}
+
+/*
+ * send a hunk message unless the command has stopped,
+ * SPI_AI_RUN is set while a message is on the bus,
+ * a refused hunk ends the chain
+ */
+static int32_t daqgert_ai_async_submit(struct comedi_device *dev,
+				       struct daqgert_hunk *h)
+{
+	struct daqgert_private *devpriv = dev->private;
+	int32_t ret;
+
+	set_bit(SPI_AI_RUN, &devpriv->state_bits);
+	smp_mb__after_atomic();
+	if (unlikely(!devpriv->run ||
+		!test_bit(AI_CMD_RUNNING, &devpriv->state_bits))) {
+		ret = -ESHUTDOWN;
+	} else {
+		h->start = ktime_get();
+		if (devpriv->ai_stamps)
+			h->stamp[0] = daqgert_timer_us(devpriv);
+		trace_daqgert_hunk_submit(dev->minor, h == &devpriv->ai_hunks[1],
+					h->len);
+		ret = spi_async(devpriv->ai_spi->spi, &h->m);
+		if (likely(!ret))
+			return 0;
+	}
+	clear_bit(SPI_AI_RUN, &devpriv->state_bits);
+	smp_mb__after_atomic();
+	complete_all(&devpriv->ai_async_done);
+	return ret;
+}
+
+/*
+ * SPI completion, from the controller interrupt or message pump:
+ * send the other hunk and queue this one for decoding. If the other
+ * hunk is still being decoded the chain stalls and its work item
+ * sends it when done.
+ */
+static void daqgert_ai_async_complete(void *context)
+{
+	struct daqgert_hunk *h = context, *next;
+	struct comedi_device *dev = h->dev;
+	struct daqgert_private *devpriv = dev->private;
+
+	if (devpriv->ai_stamps)
+		h->stamp[1] = daqgert_timer_us(devpriv);
+	clear_bit(SPI_AI_RUN, &devpriv->state_bits);
+	smp_mb__after_atomic();
+	daqgert_stat_spi(devpriv, h->start);
+	trace_daqgert_hunk_complete(dev->minor, h == &devpriv->ai_hunks[1],
+				h->m.status);
+	if (unlikely(h->m.status)) {
+		dev_err(dev->class_dev, "async hunk spi error %i\n",
+			h->m.status);
+		complete_all(&devpriv->ai_async_done);
+		return;
+	}
+	if (unlikely(!devpriv->run ||
+		!test_bit(AI_CMD_RUNNING, &devpriv->state_bits))) {
+		complete_all(&devpriv->ai_async_done);
+		return;
+	}
+
+	if (h == &devpriv->ai_hunks[0])
+		next = &devpriv->ai_hunks[1];
+	else
+		next = &devpriv->ai_hunks[0];
+
+	set_bit(HUNK_DECODE, &h->flags);
+	set_bit(SPI_AI_STALL, &devpriv->state_bits);
+	smp_mb__after_atomic();
+	if (!test_bit(HUNK_DECODE, &next->flags) &&
+		test_and_clear_bit(SPI_AI_STALL, &devpriv->state_bits))
+		daqgert_ai_async_submit(dev, next);
+	queue_work(devpriv->ai_wq, &h->work);
+}
+
+/*
+ * workqueue side of the async engine, the queue is ordered so the
+ * hunks reach the Comedi buffer in the order they were sampled
+ */
+static void daqgert_ai_async_work(struct work_struct *work)
+{
+	struct daqgert_hunk *h = container_of(work, struct daqgert_hunk, work);
+	struct comedi_device *dev = h->dev;
+	struct comedi_subdevice *s = dev->read_subdev;
+	struct daqgert_private *devpriv = dev->private;
+	uint32_t len;
+	int32_t done;
+
+	devpriv->ai_wq_task = current; /* a stop count cancel must not wait on us */
+	if (likely(test_bit(AI_CMD_RUNNING, &devpriv->state_bits))) {
+		done = daqgert_ai_decode_hunk(dev, s, h->rx_buff,
+					h == &devpriv->ai_hunks[1], h->len);
+		daqgert_ai_stamp(dev, h->stamp[0], h->stamp[1], done);
+		devpriv->hunk_count++;
+		hunk_count = devpriv->hunk_count;
+		if (test_bit(AI_CMD_RUNNING, &devpriv->state_bits))
+			comedi_handle_events(dev, s);
+		trace_daqgert_buf_commit(dev->minor, devpriv->ai_count,
+					comedi_buf_n_bytes_ready(s));
+		/* not on the bus until HUNK_DECODE clears, resize it now */
+		len = daqgert_ai_hunk_adapt(dev, s, h->len);
+		if (len != h->len) {
+			daqgert_ai_hunk_end(h->t, h->len, len);
+			spi_message_init_with_transfers(&h->m, h->t, len);
+			h->m.complete = daqgert_ai_async_complete;
+			h->m.context = h;
+			h->len = len;
+			devpriv->ai_hunk_len = len;
+		}
+	}
+	devpriv->ai_wq_task = NULL;
+	clear_bit(HUNK_DECODE, &h->flags);
+	smp_mb__after_atomic();
+	if (test_and_clear_bit(SPI_AI_STALL, &devpriv->state_bits)) {
+		devpriv->ai_async_stalls++;
+		this_cpu_inc(devpriv->stats->stalls);
+		daqgert_ai_async_submit(dev, h);
+	}
+}
+
+/*
+ * a cancel at the stop count runs in the decode and does not wait, the
+ * other hunk can still be on the bus; wait for the chain to end before a
+ * new command touches the transfers or the messages the SPI core holds
+ */
+static int32_t daqgert_ai_async_idle(struct comedi_device *dev)
+{
+	struct daqgert_private *devpriv = dev->private;
+
+	if (!devpriv->ai_async)
+		return 0;
+	if (!wait_for_completion_timeout(&devpriv->ai_async_done,
+					msecs_to_jiffies(500))) {
+		dev_err(dev->class_dev, "async hunk chain still running\n");
+		return -EBUSY;
+	}
+	return 0;
+}
+
+/*
+ * build the two hunk messages from the transfer array made by
+ * daqgert_ai_setup_hunk, the second one receives into its own buffer,
+ * after daqgert_ai_async_idle
+ */
+static void daqgert_ai_async_setup(struct comedi_device *dev,
+				   struct comedi_subdevice *s)
+{
+	struct daqgert_private *devpriv = dev->private;
+	struct spi_param_type *spi_data = s->private;
+	struct spi_device *spi = spi_data->spi;
+	struct comedi_spigert *pdata = spi->dev.platform_data;
+	struct daqgert_hunk *h;
+	uint32_t i, j;
+
+	flush_workqueue(devpriv->ai_wq); /* decodes left from the last cmd */
+	devpriv->ai_hunks[0].t = pdata->t;
+	devpriv->ai_hunks[0].rx_buff = pdata->rx_buff;
+	h = &devpriv->ai_hunks[1];
+	for (i = 0; i < devpriv->ai_hunk_max; i++) {
+		h->t[i] = pdata->t[i];
+		if (pdata->t[i].rx_buf)
+			h->t[i].rx_buf = h->rx_buff + ((uint8_t *) pdata->t[i].rx_buf
+			- pdata->rx_buff);
+	}
+	for (j = 0; j < 2; j++) {
+		h = &devpriv->ai_hunks[j];
+		spi_message_init_with_transfers(&h->m, h->t,
+						devpriv->ai_hunk_len);
+		h->m.complete = daqgert_ai_async_complete;
+		h->m.context = h;
+		h->len = devpriv->ai_hunk_len;
+		h->flags = 0;
+	}
+	clear_bit(SPI_AI_STALL, &devpriv->state_bits);
+	devpriv->ai_async_stalls = 0;
+	spi->mode = SPI_MODE;
+	spi->max_speed_hz = SPI_SPEED;
+	spi_setup(spi);
+	this_cpu_inc(devpriv->stats->spi_setups);
+}
+
+/*
+ * transfers per hunk for a command from the module parameters, see
+ * daqgert_hunk_size in daq_gert_hunk.h
+ */
+static uint32_t daqgert_ai_hunk_size(struct comedi_device *dev,
+				     struct comedi_subdevice *s,
+				     struct comedi_cmd *cmd,
+				     uint32_t *max_len)
+{
+	struct daqgert_hunk_cmd c = {
+		.hunk_len = hunk_len,
+		.hunk_cap = HUNK_LEN,
+		.latency_us = hunk_latency_us,
+		.chans = cmd->chanlist_len,
+		.counted = cmd->stop_src == TRIG_COUNT,
+		.stop_arg = cmd->stop_arg,
+		.wake_eos = !!(cmd->flags & CMDF_WAKE_EOS),
+	};
+
+	if (s->async && s->async->prealloc_bufsz)
+		c.buf_samples = s->async->prealloc_bufsz
+			/ comedi_bytes_per_sample(s);
+	if (cmd->scan_begin_src == TRIG_TIMER)
+		c.scan_ns = cmd->scan_begin_arg;
+	else if (cmd->convert_src == TRIG_TIMER)
+		c.convert_ns = cmd->convert_arg;
+	return daqgert_hunk_size(&c, max_len);
+}
+
+/*
+ * build the ai_hunk_max transfer buffer for the command
  */
 static int32_t daqgert_ai_setup_hunk(struct comedi_device *dev,
 				     struct comedi_subdevice *s,
 				     bool mix_mode)
 {
 	struct daqgert_private *devpriv = dev->private;
-	struct comedi_cmd *cmd = &s->async->cmd;
 	struct spi_param_type *spi_data = s->private;
 	struct spi_device *spi = spi_data->spi;
 	struct comedi_spigert *pdata = spi->dev.platform_data;
 	uint32_t len, offset, bufpos;
 	uint8_t *bufptr;
+	int32_t ret;
 
-	len = devpriv->ai_scans;
-	if (cmd->stop_src == TRIG_COUNT) { /* optimize small samples */
-		if (devpriv->ai_scans > hunk_len)
-			len = hunk_len;
-		else
-			len = devpriv->ai_scans;
-	}
+	len = devpriv->ai_hunk_max;
 
 	bufptr = (uint8_t *) pdata->tx_buff;
 	bufpos = 0;
 	offset = daqgert_device_offset(spi_data->device_type);
 
 	/* load the message for the ADC conversions in to the tx buffer */
-	return transfer_to_hunk_buf(dev, s, bufptr, bufpos, len, offset,
+	ret = transfer_to_hunk_buf(dev, s, bufptr, bufpos, len, offset,
 				mix_mode);
+	/* the messages start at the latency target length */
+	daqgert_ai_hunk_end(pdata->t, len, devpriv->ai_hunk_len);
+	return ret;
 }
 
 /*
@@ -1890,6 +2745,7 @@ static int32_t daqgert_ao_inttrig(struct comedi_device *dev,
 	dev_info(dev->class_dev, "ao inttrig\n");
 
 	if (!test_bit(AO_CMD_RUNNING, &devpriv->state_bits)) {
+		daqgert_ao_set_deadline(devpriv, ktime_get());
 		smp_mb__before_atomic();
 		set_bit(AO_CMD_RUNNING, &devpriv->state_bits);
 		smp_mb__after_atomic();
@@ -1951,14 +2807,18 @@ static int32_t daqgert_ao_cmd(struct comedi_device *dev,
 		goto ao_cmd_exit;
 	}
 	devpriv->ao_counter = devpriv->ao_timer;
+	/* one sample per channel each scan, on absolute deadlines */
+	devpriv->ao_period_ns = cmd->scan_begin_arg
+		/ max_t(uint32_t, cmd->chanlist_len, 1);
 	s->async->cur_chan = 0;
 	daqgert_ao_set_chan_range(dev, cmd->chanlist[s->async->cur_chan], 1);
 
 	if (cmd->start_src == TRIG_NOW) {
 		s->async->inttrig = NULL;
 		/* enable this acquisition operation */
+		daqgert_ao_set_deadline(devpriv, ktime_get());
 		smp_mb__before_atomic();
-		set_bit(AI_CMD_RUNNING, &devpriv->state_bits);
+		set_bit(AO_CMD_RUNNING, &devpriv->state_bits);
 		smp_mb__after_atomic();
 		devpriv->ao_cmd_canceled = false;
 	} else {
@@ -1993,6 +2853,9 @@ static int32_t daqgert_ai_cmd(struct comedi_device *dev,
 		ret = -EBUSY;
 		goto ai_cmd_exit;
 	}
+	ret = daqgert_ai_async_idle(dev);
+	if (ret)
+		goto ai_cmd_exit;
 
 	/* 
 	 * inter-spacing speed adjustments from cmd_test
@@ -2009,6 +2872,12 @@ static int32_t daqgert_ai_cmd(struct comedi_device *dev,
 		devpriv->ai_neverending = true;
 	}
 	devpriv->ai_scans_left = devpriv->ai_scans; /* a count down */
+	devpriv->ai_stamps = !!ai_stamps;
+	devpriv->stamp_pos = 0;
+	/* records left from the last command have sample indexes of its own */
+	mutex_lock(&devpriv->stamp_lock);
+	kfifo_reset(&devpriv->stamps);
+	mutex_unlock(&devpriv->stamp_lock);
 
 	/* 
 	 * check if we can use HUNK transfer 
@@ -2045,23 +2914,25 @@ static int32_t daqgert_ai_cmd(struct comedi_device *dev,
 	s->async->cur_chan = 0;
 	daqgert_ai_set_chan_range(dev, cmd->chanlist[s->async->cur_chan], 1);
 
-	/* want wake up every scan? */
-	if (cmd->flags & CMDF_WAKE_EOS) {
-		/* HUNK is useless for this situation */
-		devpriv->ai_hunk = false;
-		dev_info(dev->class_dev,
-			"hunk transfers disabled from CMDF_WAKE_EOS\n");
-	}
-	if (devpriv->timing_lockout) {
+	if (devpriv->timing_lockout && !ao_sched) {
 		devpriv->ai_hunk = false;
 		dev_info(dev->class_dev,
 			"hunk transfers disabled from timing lockout\n");
 	}
 
-	if (devpriv->ai_hunk) /* run batch conversions in background */
+	if (devpriv->ai_hunk) { /* run batch conversions in background */
+		devpriv->ai_hunk_min = daqgert_ai_hunk_size(dev, s, cmd,
+							&devpriv->ai_hunk_max);
+		devpriv->ai_hunk_len = devpriv->ai_hunk_min;
+		dev_info(dev->class_dev, "hunk length %u, up to %u\n",
+			devpriv->ai_hunk_min, devpriv->ai_hunk_max);
 		ret = daqgert_ai_setup_hunk(dev, s, true);
-	else
+		if (devpriv->ai_async)
+			daqgert_ai_async_setup(dev, s);
+	} else
 		daqgert_ai_setup_eoc(dev, s);
+	trace_daqgert_cmd_start(dev->minor, devpriv->ai_hunk, devpriv->ai_async,
+				devpriv->ai_scans, cmd->chanlist_len);
 
 	if (cmd->start_src == TRIG_NOW) {
 		s->async->inttrig = NULL;
@@ -2237,132 +3108,200 @@ static int32_t daqgert_ai_poll(struct comedi_device *dev,
 	return num_bytes;
 }
 
-/* 
- * get close to a good sample spacing for one second, 
- * test_mode is to see what the max sample rate is 
+/*
+ * time CAL_RUNS messages of n hunk transfers, mean ns per message
  */
-static int32_t daqgert_ai_delay_rate(struct comedi_device *dev,
-				     int32_t rate,
-				     int32_t device_type,
-				     bool test_mode)
+static int64_t daqgert_ai_cal_hunk(struct comedi_device *dev,
+				   struct comedi_subdevice *s,
+				   uint32_t n)
+{
+	struct spi_param_type *spi_data = s->private;
+	struct spi_device *spi = spi_data->spi;
+	struct comedi_spigert *pdata = spi->dev.platform_data;
+	struct spi_message m;
+	int64_t total = 0;
+	ktime_t t0;
+	uint32_t i;
+
+	transfer_to_hunk_buf(dev, s, pdata->tx_buff, 0, n,
+			daqgert_device_offset(spi_data->device_type), true);
+	for (i = 0; i <= CAL_RUNS; i++) {
+		spi_message_init_with_transfers(&m, pdata->t, n);
+		t0 = ktime_get();
+		if (spi_sync(spi, &m) || m.status)
+			return -EIO;
+		if (i) /* the first one warms the caches */
+			total += ktime_to_ns(ktime_sub(ktime_get(), t0));
+	}
+	return div_s64(total, CAL_RUNS);
+}
+
+/*
+ * Time the conversions the AI modes really make on this device: single EOC
+ * samples through daqgert_ai_get_sample with the thread hrtimeout overshoot,
+ * and for the onboard ADC hunk messages of two lengths for the cost of one
+ * transfer and of the message around them. Only with no command running,
+ * at attach and from the debugfs calibration file.
+ */
+static int32_t daqgert_ai_calibrate(struct comedi_device *dev)
 {
-	const struct daqgert_board *board = dev->board_ptr;
 	struct daqgert_private *devpriv = dev->private;
-	int32_t spacing_usecs = 0, sample_freq, total_sample_time, delay_time;
+	struct comedi_subdevice *s = dev->read_subdev;
+	struct spi_param_type *spi_data;
+	struct spi_device *spi;
+	struct comedi_spigert *pdata;
+	struct daqgert_calib cal = {0};
+	int64_t ns, t_short, t_long;
+	int32_t ai_count, ret = 0;
+	uint32_t i, n_long;
+	ktime_t t0;
 
-	if (test_mode) {
-		dev_info(dev->class_dev,
-			"ai speed testing: rate %i, spacing usecs %i\n",
-			rate, spacing_usecs);
-		return spacing_usecs;
+	if (!s)
+		return -ENODEV;
+	spi_data = s->private;
+	spi = spi_data->spi;
+	pdata = spi->dev.platform_data;
+
+	mutex_lock(&devpriv->cmd_lock);
+	if (test_bit(AI_CMD_RUNNING, &devpriv->state_bits)) {
+		ret = -EBUSY;
+		goto calibrate_exit;
 	}
+	ai_count = devpriv->ai_count;
+	devpriv->ai_hunk = false;
+	daqgert_ai_setup_eoc(dev, s);
 
-	if (rate <= 0)
-		rate = board->ai_rate_min;
-	if (rate > devpriv->ai_rate_max)
-		rate = devpriv->ai_rate_max;
-	sample_freq = devpriv->ai_rate_max / rate;
-	total_sample_time = board->ai_ns_min * sample_freq;
-	delay_time = devpriv->ai_rate_max - total_sample_time;
-	if (delay_time >= sample_freq) {
-		spacing_usecs = (delay_time / sample_freq) / NSEC_PER_USEC;
-		if (spacing_usecs < 0)
-			spacing_usecs = 0;
+	for (ns = 0, i = 0; i <= CAL_SINGLE; i++) {
+		t0 = ktime_get();
+		daqgert_ai_get_sample(dev, s);
+		if (i)
+			ns += ktime_to_ns(ktime_sub(ktime_get(), t0));
+	}
+	cal.single_ns = div_s64(ns, CAL_SINGLE);
+
+	for (ns = 0, i = 0; i < CAL_SINGLE; i++) {
+		__set_current_state(TASK_UNINTERRUPTIBLE);
+		pdata->kmin = ktime_set(0, CAL_SLEEP_NS);
+		t0 = ktime_get();
+		schedule_hrtimeout_range(&pdata->kmin, 0, HRTIMER_MODE_REL);
+		ns += ktime_to_ns(ktime_sub(ktime_get(), t0)) - CAL_SLEEP_NS;
+	}
+	cal.wake_ns = max_t(int64_t, div_s64(ns, CAL_SINGLE), 0);
+	cal.hz = spi->max_speed_hz;
+	cal.ns_min = cal.single_ns + cal.wake_ns;
+
+	n_long = min_t(uint32_t, hunk_len, HUNK_LEN);
+	if (devpriv->use_hunking && !spi_data->pic18 && n_long > CAL_SHORT) {
+		pdata->delay_usecs = 0;
+		pdata->mix_delay_usecs = 0;
+		devpriv->mix_chan = CR_CHAN(devpriv->ai_chan);
+		spi->mode = SPI_MODE;
+		spi->max_speed_hz = SPI_SPEED;
+		spi_setup(spi);
+		this_cpu_inc(devpriv->stats->spi_setups);
+		t_short = daqgert_ai_cal_hunk(dev, s, CAL_SHORT);
+		t_long = daqgert_ai_cal_hunk(dev, s, n_long);
+		if (t_short > 0 && t_long > t_short) {
+			/* a line through the two lengths */
+			cal.hunk_ns = div_s64(t_long - t_short, n_long - CAL_SHORT);
+			ns = t_short - (int64_t) cal.hunk_ns * CAL_SHORT;
+			cal.hunk_msg_ns = max_t(int64_t, ns, 0);
+			cal.hz = spi->max_speed_hz;
+			cal.ns_min = min(cal.ns_min, cal.hunk_ns
+					+ cal.hunk_msg_ns / n_long);
+		}
+		daqgert_ai_setup_eoc(dev, s);
+	}
+	devpriv->ai_count = ai_count;
+
+	if (cal.single_ns) {
+		cal.valid = true;
+		devpriv->calib = cal;
 	} else {
-		spacing_usecs = 0;
+		ret = -EIO;
 	}
-	if (devpriv->use_hunking)
-		spacing_usecs += CONV_SPEED_FIX;
-	else
-		spacing_usecs += CONV_SPEED_FIX_FREERUN;
-	if (device_type == MCP3002)
-		spacing_usecs += CONV_SPEED_FIX_FAST;
-	//	dev_info(dev->class_dev, "ai rate %i, spacing usecs %i\n", rate, spacing_usecs);
-	return spacing_usecs;
+	dev_info(dev->class_dev,
+		"ai calibrated at %u Hz: hunk %u ns/conv + %u ns/msg, eoc %u + %u ns/sample, min %u ns\n",
+		cal.hz, cal.hunk_ns, cal.hunk_msg_ns, cal.single_ns,
+		cal.wake_ns, cal.ns_min);
+calibrate_exit:
+	mutex_unlock(&devpriv->cmd_lock);
+	return ret;
 }
 
-/**
- * comedi_8254_cascade_ns_to_timer - calculate the cascaded divisor values
- * @i8254:	comedi_8254 struct for the timer
- * @nanosec:	the desired ns time
- * @flags:	comedi_cmd flags
- */
-void comedi_8254_cascade_ns_to_timer(struct comedi_8254 *i8254,
-				     unsigned int *nanosec,
-				     unsigned int flags)
-{
-	unsigned int d1 = i8254->next_div1 ? i8254->next_div1 : I8254_MAX_COUNT;
-	unsigned int d2 = i8254->next_div2 ? i8254->next_div2 : I8254_MAX_COUNT;
-	unsigned int div = d1 * d2;
-	unsigned int ns_lub = 0xffffffff;
-	unsigned int ns_glb = 0;
-	unsigned int d1_lub = 0;
-	unsigned int d1_glb = 0;
-	unsigned int d2_lub = 0;
-	unsigned int d2_glb = 0;
-	unsigned int start;
-	unsigned int ns;
-	unsigned int ns_low;
-	unsigned int ns_high;
-
-	/* exit early if everything is already correct */
-	if (div * i8254->osc_base == *nanosec &&
-	d1 > 1 && d1 <= I8254_MAX_COUNT &&
-	d2 > 1 && d2 <= I8254_MAX_COUNT &&
-	/* check for overflow */
-	div > d1 && div > d2 &&
-	div * i8254->osc_base > div &&
-	div * i8254->osc_base > i8254->osc_base)
-		return;
+/*
+ * the board table guess until daqgert_ai_calibrate has run
+ */
+static void daqgert_ai_calib_default(struct comedi_device *dev)
+{
+	const struct daqgert_board *board = dev->board_ptr;
+	struct daqgert_private *devpriv = dev->private;
 
-	div = *nanosec / i8254->osc_base;
-	d2 = I8254_MAX_COUNT;
-	start = div / d2;
-	if (start < 2)
-		start = 2;
-	for (d1 = start; d1 <= div / d1 + 1 && d1 <= I8254_MAX_COUNT; d1++) {
-		for (d2 = div / d1;
-		d1 * d2 <= div + d1 + 1 && d2 <= I8254_MAX_COUNT; d2++) {
-			ns = i8254->osc_base * d1 * d2;
-			if (ns <= *nanosec && ns > ns_glb) {
-				ns_glb = ns;
-				d1_glb = d1;
-				d2_glb = d2;
-			}
-			if (ns >= *nanosec && ns < ns_lub) {
-				ns_lub = ns;
-				d1_lub = d1;
-				d2_lub = d2;
-			}
-		}
-	}
+	memset(&devpriv->calib, 0, sizeof(devpriv->calib));
+	devpriv->calib.hunk_ns = board->ai_ns_min;
+	devpriv->calib.single_ns = board->ai_ns_min;
+	devpriv->calib.ns_min = board->ai_ns_min;
+}
 
-	switch (flags & CMDF_ROUND_MASK) {
-	case CMDF_ROUND_NEAREST:
-	default:
-		ns_high = d1_lub * d2_lub * i8254->osc_base;
-		ns_low = d1_glb * d2_glb * i8254->osc_base;
-		if (ns_high - *nanosec < *nanosec - ns_low) {
-			d1 = d1_lub;
-			d2 = d2_lub;
-		} else {
-			d1 = d1_glb;
-			d2 = d2_glb;
-		}
-		break;
-	case CMDF_ROUND_UP:
-		d1 = d1_lub;
-		d2 = d2_lub;
-		break;
-	case CMDF_ROUND_DOWN:
-		d1 = d1_glb;
-		d2 = d2_glb;
-		break;
+/*
+ * ns per conversion with no spacing for hunks of len or EOC with len 0
+ */
+static uint32_t daqgert_ai_cost(struct comedi_device *dev, uint32_t len)
+{
+	struct daqgert_private *devpriv = dev->private;
+	struct daqgert_calib *cal = &devpriv->calib;
+
+	if (len && cal->hunk_ns)
+		return cal->hunk_ns + cal->hunk_msg_ns / len;
+	return cal->single_ns + cal->wake_ns;
+}
+
+/*
+ * daqgert_ai_cmd runs this command as hunks if true
+ */
+static bool daqgert_ai_cmd_hunks(struct comedi_device *dev,
+				 struct comedi_subdevice *s,
+				 struct comedi_cmd *cmd)
+{
+	struct daqgert_private *devpriv = dev->private;
+	struct spi_param_type *spi_data = s->private;
+	uint32_t i;
+
+	if (!devpriv->use_hunking || spi_data->pic18 || !cmd->chanlist
+		|| (devpriv->timing_lockout && !ao_sched))
+		return false;
+	if (cmd->chanlist_len == 2) /* mix_mode */
+		return true;
+	for (i = 1; i < cmd->chanlist_len; i++)
+		if (cmd->chanlist[0] != cmd->chanlist[i])
+			return false;
+	return true;
+}
+
+/* 
+ * whole usecs of spacing after each conversion for a period_ns sample
+ * period from one costing cost_ns, test_mode is to see what the max sample
+ * rate is 
+ */
+static int32_t daqgert_ai_delay_rate(struct comedi_device *dev,
+				     uint32_t period_ns,
+				     uint32_t cost_ns,
+				     bool test_mode)
+{
+	int32_t spacing_usecs = 0;
+
+	if (test_mode) {
+		dev_info(dev->class_dev,
+			"ai speed testing: period %u, spacing usecs %i\n",
+			period_ns, spacing_usecs);
+		return spacing_usecs;
 	}
 
-	*nanosec = d1 * d2 * i8254->osc_base;
-	i8254->next_div1 = d1;
-	i8254->next_div2 = d2;
+	if (period_ns > cost_ns)
+		spacing_usecs = DIV_ROUND_CLOSEST(period_ns - cost_ns,
+						NSEC_PER_USEC);
+	//	dev_info(dev->class_dev, "ai period %u, spacing usecs %i\n", period_ns, spacing_usecs);
+	return spacing_usecs;
 }
 
 /* 
@@ -2373,14 +3312,12 @@ static int32_t daqgert_ai_cmdtest(struct comedi_device *dev,
 				  struct comedi_subdevice *s,
 				  struct comedi_cmd * cmd)
 {
-	const struct daqgert_board *board = dev->board_ptr;
 	struct daqgert_private *devpriv = dev->private;
 	struct spi_param_type *spi_data = s->private;
 	struct spi_device *spi = spi_data->spi;
 	struct comedi_spigert *pdata = spi->dev.platform_data;
-	int32_t i, err = 0;
-	uint32_t arg;
-	uint32_t tmp_timer;
+	int32_t err = 0;
+	uint32_t arg, cost, chans;
 
 	if (unlikely(!devpriv))
 		return -EFAULT;
@@ -2417,30 +3354,28 @@ static int32_t daqgert_ai_cmdtest(struct comedi_device *dev,
 	if (cmd->scan_begin_src == TRIG_FOLLOW) /* internal trigger */
 		err |= comedi_check_trigger_arg_is(&cmd->scan_begin_arg, 0);
 
+	/* the calibrated cost of one conversion in the mode ai_cmd will use */
+	cost = daqgert_ai_cost(dev, daqgert_ai_cmd_hunks(dev, s, cmd) ?
+		daqgert_ai_hunk_size(dev, s, cmd, NULL) : 0);
+	chans = max_t(uint32_t, cmd->chanlist_len, 1);
+
 	if (cmd->scan_begin_src == TRIG_TIMER) {
-		i = 1;
-		/* find a power of 2 for the number of channels */
-		while (i < (cmd->chanlist_len))
-			i = i * 2;
 		err |= comedi_check_trigger_arg_min(&cmd->scan_begin_arg,
-						board->ai_ns_min_calc / 2 * i);
-		/* now calc the real sampling rate with all the
-		 * rounding errors */
-		tmp_timer = ((uint32_t) (cmd->scan_begin_arg
-			/ board->ai_ns_min)) * board->ai_ns_min;
-		pdata->delay_usecs_calc = daqgert_ai_delay_rate(dev, tmp_timer,
-								spi_data->device_type,
-								speed_test);
+						cost * chans);
+		/* now calc the real sampling rate with the usec spacing */
+		pdata->delay_usecs_calc = daqgert_ai_delay_rate(dev,
+								cmd->scan_begin_arg / chans,
+								cost, speed_test);
 		/* double delay with zero for the first scan chan */
 		pdata->mix_delay_usecs_calc = pdata->delay_usecs_calc * 2;
 		//				dev_info(dev->class_dev, "ai cmd spacing usecs %i, mix %i\n", pdata->delay_usecs, pdata->mix_delay_usecs);
 		err |= comedi_check_trigger_arg_is(&cmd->scan_begin_arg,
-						tmp_timer);
+						(cost + pdata->delay_usecs_calc
+						* NSEC_PER_USEC) * chans);
 	}
 
 	if (cmd->convert_src == TRIG_TIMER)
-		err |= comedi_check_trigger_arg_min(&cmd->convert_arg,
-						board->ai_ns_min);
+		err |= comedi_check_trigger_arg_min(&cmd->convert_arg, cost);
 
 	err |= comedi_check_trigger_arg_min(&cmd->chanlist_len, 1);
 	err |= comedi_check_trigger_arg_is(&cmd->scan_end_arg,
@@ -2463,19 +3398,17 @@ static int32_t daqgert_ai_cmdtest(struct comedi_device *dev,
 	if (cmd->convert_src == TRIG_NOW) {
 		pdata->delay_usecs_calc = 0;
 		/* double delay with zero for the first scan chan */
-		pdata->mix_delay_usecs_calc = CONV_SPEED_FIX * 2;
+		pdata->mix_delay_usecs_calc = 0;
 	}
 
 	if (cmd->convert_src == TRIG_TIMER) {
-		arg = cmd->convert_arg;
-		devpriv->pacer.osc_base = devpriv->ai_conv_delay_10nsecs;
-		comedi_8254_cascade_ns_to_timer(&devpriv->pacer, &arg,
-						cmd->flags);
-		pdata->delay_usecs_calc = daqgert_ai_delay_rate(dev, arg,
-								spi_data->device_type,
-								speed_test);
+		pdata->delay_usecs_calc = daqgert_ai_delay_rate(dev,
+								cmd->convert_arg,
+								cost, speed_test);
 		pdata->mix_delay_usecs_calc = pdata->delay_usecs_calc * 2; /* double delay with zero for the first scan chan */
 		//				dev_info(dev->class_dev, "ai cmd spacing usecs %i, mix %i\n", pdata->delay_usecs, pdata->mix_delay_usecs);
+		/* the period the spacing really gives */
+		arg = cost + pdata->delay_usecs_calc * NSEC_PER_USEC;
 		err |= comedi_check_trigger_arg_is(&cmd->convert_arg, arg);
 	}
 
@@ -2492,22 +3425,17 @@ static void my_timer_ai_callback(unsigned long data)
 {
 	struct comedi_device *dev = (void*) data;
 	struct daqgert_private *devpriv = dev->private;
-	static uint32_t time_marks = 0;
 
 	if (!devpriv->run) {
 		devpriv->run = true;
 		devpriv->timer = true;
+		/* start the hunk chain, the completions keep it going */
+		if (devpriv->ai_async && devpriv->ai_hunk) {
+			reinit_completion(&devpriv->ai_async_done);
+			daqgert_ai_async_submit(dev, &devpriv->ai_hunks[0]);
+		}
 	}
 	daqgert_ai_start_pacer(dev, true);
-	if (speed_test) {
-		if (!(time_marks++ % 1000))
-			dev_info(dev->class_dev,
-				"speed testing %i: count %i, hunk %i, "
-				"length %i 1Mhz timer value 0x%x:0x%x\n",
-				time_marks, ai_count, hunk_count, hunk_len,
-				(uint32_t) ioread32(devpriv->timer_1mhz + 2),
-				(uint32_t) ioread32(devpriv->timer_1mhz + 1));
-	}
 }
 
 static void daqgert_ai_clear_eoc(struct comedi_device * dev)
@@ -2520,10 +3448,23 @@ static void daqgert_ai_clear_eoc(struct comedi_device * dev)
 		(unsigned long) dev);
 	devpriv->run = false;
 	devpriv->timer = false;
-	do { /* wait if needed to SPI to clear or timeout */
-		schedule(); /* force a context switch */
-		usleep_range(750, 1000);
-	} while (test_bit(SPI_AI_RUN, &devpriv->state_bits) && (count--));
+	smp_mb(); /* stop the async hunk chain before looking at SPI_AI_RUN */
+	if (devpriv->ai_async && devpriv->ai_hunk) {
+		/*
+		 * the completion of the hunk on the bus, or the decode of a
+		 * stalled chain, ends it; a decode canceling at the stop count
+		 * is that decode, the chain ends when it returns
+		 */
+		if (devpriv->ai_wq_task != current &&
+			!wait_for_completion_timeout(&devpriv->ai_async_done,
+						msecs_to_jiffies(500)))
+			dev_err(dev->class_dev, "async hunk chain did not end\n");
+	} else {
+		do { /* wait if needed to SPI to clear or timeout */
+			schedule(); /* force a context switch */
+			usleep_range(750, 1000);
+		} while (test_bit(SPI_AI_RUN, &devpriv->state_bits) && (count--));
+	}
 
 	devpriv->run = false;
 	devpriv->timer = false;
@@ -2544,12 +3485,20 @@ static int32_t daqgert_ai_cancel(struct comedi_device *dev,
 	dev_info(dev->class_dev, "ai cancel\n");
 	ai_count = devpriv->ai_count;
 	hunk_count = devpriv->hunk_count;
+	trace_daqgert_cmd_cancel(dev->minor, devpriv->ai_count,
+				devpriv->hunk_count);
+	if (devpriv->ai_async && devpriv->ai_hunk)
+		dev_info(dev->class_dev, "async hunks %i, decode stalls %u\n",
+			devpriv->hunk_count, devpriv->ai_async_stalls);
 	devpriv->ai_hunk = false;
 	s->async->cur_chan = 0;
 	s->async->inttrig = NULL;
 	devpriv->ai_cmd_canceled = true;
 	clear_bit(AI_CMD_RUNNING, &devpriv->state_bits);
 	smp_mb__after_atomic();
+	if (devpriv->ai_async && devpriv->ai_wq_task != current)
+		flush_workqueue(devpriv->ai_wq); /* queued hunks see the stop and skip the decode */
+	wake_up_interruptible(&devpriv->stamp_wait); /* readers see the end */
 	devpriv->timing_lockout--;
 	if (devpriv->timing_lockout < 0)
 		devpriv->timing_lockout = 0;
@@ -2695,8 +3644,10 @@ static int32_t daqgert_ai_rinsn(struct comedi_device *dev,
 
 	devpriv->ai_chan = CR_CHAN(insn->chanspec);
 
-	/* convert n samples */
+	/* convert n samples, each ADS1220 one a new conversion */
 	for (n = 0; n < insn->n; n++) {
+		if (devpriv->ai_spi->device_type == ADS1220)
+			daqgert_ads1220_wait(devpriv);
 		data[n] = daqgert_ai_get_sample(dev, s);
 	}
 	ai_count = devpriv->ai_count;
@@ -2773,6 +3724,258 @@ static int32_t daqgert_ao_config(struct comedi_device *dev,
 	return spi_data->chan;
 }
 
+/*
+ * sum the per cpu statistics into one "name value" line each, the
+ * histograms are one line of DAQGERT_HIST bucket counts
+ */
+static int daqgert_stats_show(struct seq_file *m, void *unused)
+{
+	struct comedi_device *dev = m->private;
+	struct daqgert_private *devpriv = dev->private;
+	struct daqgert_stats sum, *st;
+	int32_t cpu, i;
+
+	memset(&sum, 0, sizeof(sum));
+	for_each_possible_cpu(cpu) {
+		st = per_cpu_ptr(devpriv->stats, cpu);
+		sum.samples += st->samples;
+		sum.hunks += st->hunks;
+		sum.ao_samples += st->ao_samples;
+		sum.overruns += st->overruns;
+		sum.stalls += st->stalls;
+		sum.spi_msgs += st->spi_msgs;
+		sum.spi_setups += st->spi_setups;
+		sum.segments += st->segments;
+		sum.ao_misses += st->ao_misses;
+		sum.stamp_drops += st->stamp_drops;
+		sum.buf_hwm = max(sum.buf_hwm, st->buf_hwm);
+		sum.ao_late_max = max(sum.ao_late_max, st->ao_late_max);
+		for (i = 0; i < DAQGERT_HIST; i++) {
+			sum.spi_lat[i] += st->spi_lat[i];
+			sum.wake_lat[i] += st->wake_lat[i];
+			sum.ao_late[i] += st->ao_late[i];
+		}
+	}
+
+	seq_printf(m, "elapsed_ns %lld\n",
+		ktime_to_ns(ktime_sub(ktime_get(), devpriv->stats_start)));
+	seq_printf(m, "samples %llu\n", sum.samples);
+	seq_printf(m, "hunks %llu\n", sum.hunks);
+	seq_printf(m, "ao_samples %llu\n", sum.ao_samples);
+	seq_printf(m, "overruns %llu\n", sum.overruns);
+	seq_printf(m, "stalls %llu\n", sum.stalls);
+	seq_printf(m, "spi_msgs %llu\n", sum.spi_msgs);
+	seq_printf(m, "spi_setups %llu\n", sum.spi_setups);
+	seq_printf(m, "segments %llu\n", sum.segments);
+	seq_printf(m, "ao_misses %llu\n", sum.ao_misses);
+	seq_printf(m, "stamp_drops %llu\n", sum.stamp_drops);
+	seq_printf(m, "buf_hwm %u\n", sum.buf_hwm);
+	seq_printf(m, "ao_late_max_ns %u\n", sum.ao_late_max);
+	seq_printf(m, "hunk_len %u\n", devpriv->ai_hunk_len);
+	if (devpriv->timer_1mhz)
+		seq_printf(m, "timer_1mhz 0x%x:0x%x\n",
+			(uint32_t) ioread32(devpriv->timer_1mhz + 2),
+			(uint32_t) ioread32(devpriv->timer_1mhz + 1));
+	seq_puts(m, "spi_lat_ns");
+	for (i = 0; i < DAQGERT_HIST; i++)
+		seq_printf(m, " %u", sum.spi_lat[i]);
+	seq_puts(m, "\nwake_lat_ns");
+	for (i = 0; i < DAQGERT_HIST; i++)
+		seq_printf(m, " %u", sum.wake_lat[i]);
+	seq_puts(m, "\nao_late_ns");
+	for (i = 0; i < DAQGERT_HIST; i++)
+		seq_printf(m, " %u", sum.ao_late[i]);
+	seq_putc(m, '\n');
+	return 0;
+}
+
+static int daqgert_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, daqgert_stats_show, inode->i_private);
+}
+
+/*
+ * any write zeros the statistics
+ */
+static ssize_t daqgert_stats_write(struct file *file, const char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	struct seq_file *m = file->private_data;
+	struct comedi_device *dev = m->private;
+	struct daqgert_private *devpriv = dev->private;
+	int32_t cpu;
+
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(devpriv->stats, cpu), 0,
+		sizeof(struct daqgert_stats));
+	devpriv->stats_start = ktime_get();
+	return count;
+}
+
+static const struct file_operations daqgert_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = daqgert_stats_open,
+	.read = seq_read,
+	.write = daqgert_stats_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int daqgert_calib_show(struct seq_file *m, void *v)
+{
+	struct comedi_device *dev = m->private;
+	struct daqgert_private *devpriv = dev->private;
+	struct daqgert_calib *cal = &devpriv->calib;
+
+	seq_printf(m, "valid %i\n", cal->valid);
+	seq_printf(m, "spi_hz %u\n", cal->hz);
+	seq_printf(m, "hunk_ns %u\n", cal->hunk_ns);
+	seq_printf(m, "hunk_msg_ns %u\n", cal->hunk_msg_ns);
+	seq_printf(m, "single_ns %u\n", cal->single_ns);
+	seq_printf(m, "wake_ns %u\n", cal->wake_ns);
+	seq_printf(m, "ns_min %u\n", cal->ns_min);
+	return 0;
+}
+
+static int daqgert_calib_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, daqgert_calib_show, inode->i_private);
+}
+
+/*
+ * any write measures again, -EBUSY while an AI command runs
+ */
+static ssize_t daqgert_calib_write(struct file *file, const char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	struct seq_file *m = file->private_data;
+	int32_t ret;
+
+	ret = daqgert_ai_calibrate(m->private);
+	return ret ? ret : count;
+}
+
+static const struct file_operations daqgert_calib_fops = {
+	.owner = THIS_MODULE,
+	.open = daqgert_calib_open,
+	.read = seq_read,
+	.write = daqgert_calib_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/*
+ * binary struct daqgert_stamp records, blocks while an AI command runs and
+ * there are none, end of file once it has stopped and they are all read
+ */
+static ssize_t daqgert_stamps_read(struct file *file, char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	struct comedi_device *dev = file->private_data;
+	struct daqgert_private *devpriv = dev->private;
+	uint32_t copied;
+	int32_t ret;
+
+	if (count < sizeof(struct daqgert_stamp))
+		return -EINVAL;
+	while (kfifo_is_empty(&devpriv->stamps)) {
+		if (!test_bit(AI_CMD_RUNNING, &devpriv->state_bits))
+			return 0;
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		if (wait_event_interruptible(devpriv->stamp_wait,
+			!kfifo_is_empty(&devpriv->stamps) ||
+			!test_bit(AI_CMD_RUNNING, &devpriv->state_bits)))
+			return -ERESTARTSYS;
+	}
+	if (mutex_lock_interruptible(&devpriv->stamp_lock))
+		return -ERESTARTSYS;
+	ret = kfifo_to_user(&devpriv->stamps, buf, count, &copied);
+	mutex_unlock(&devpriv->stamp_lock);
+	return ret ? ret : copied;
+}
+
+static const struct file_operations daqgert_stamps_fops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.read = daqgert_stamps_read,
+	.llseek = no_llseek,
+};
+
+static int32_t daqgert_stats_init(struct comedi_device *dev)
+{
+	struct daqgert_private *devpriv = dev->private;
+	char name[32];
+
+	devpriv->stats = alloc_percpu(struct daqgert_stats);
+	if (!devpriv->stats)
+		return -ENOMEM;
+	devpriv->stats_start = ktime_get();
+	if (kfifo_alloc(&devpriv->stamps, STAMP_RECS, GFP_KERNEL))
+		return -ENOMEM;
+	init_waitqueue_head(&devpriv->stamp_wait);
+	mutex_init(&devpriv->stamp_lock);
+
+	/* debugfs is optional, the counters run without it */
+	snprintf(name, sizeof(name), "daq_gert-%s", dev_name(dev->class_dev));
+	devpriv->debugfs = debugfs_create_dir(name, NULL);
+	if (!IS_ERR_OR_NULL(devpriv->debugfs)) {
+		debugfs_create_file("stats", S_IRUGO | S_IWUSR, devpriv->debugfs,
+				dev, &daqgert_stats_fops);
+		debugfs_create_file("calibration", S_IRUGO | S_IWUSR,
+				devpriv->debugfs, dev, &daqgert_calib_fops);
+		debugfs_create_file("timestamps", S_IRUSR, devpriv->debugfs,
+				dev, &daqgert_stamps_fops);
+	}
+	return 0;
+}
+
+/*
+ * second hunk buffers and the decode workqueue for the async engine
+ */
+static int32_t daqgert_ai_async_alloc(struct comedi_device *dev)
+{
+	struct daqgert_private *devpriv = dev->private;
+	int32_t i;
+
+	devpriv->ai_hunks[1].t = kcalloc(HUNK_LEN, sizeof(struct spi_transfer),
+					GFP_KERNEL);
+	devpriv->ai_hunks[1].rx_buff = kzalloc(SPI_BUFF_SIZE,
+					GFP_KERNEL | GFP_DMA);
+	devpriv->ai_wq = alloc_ordered_workqueue("daqgert_ai", WQ_HIGHPRI);
+	init_completion(&devpriv->ai_async_done);
+	complete_all(&devpriv->ai_async_done); /* no chain yet */
+	if (!devpriv->ai_hunks[1].t || !devpriv->ai_hunks[1].rx_buff
+		|| !devpriv->ai_wq)
+		return -ENOMEM;
+
+	for (i = 0; i < 2; i++) {
+		devpriv->ai_hunks[i].dev = dev;
+		INIT_WORK(&devpriv->ai_hunks[i].work, daqgert_ai_async_work);
+	}
+	return 0;
+}
+
+static void daqgert_ai_async_free(struct comedi_device *dev)
+{
+	struct daqgert_private *devpriv = dev->private;
+
+	if (!devpriv->ai_async)
+		return;
+
+	devpriv->run = false;
+	clear_bit(AI_CMD_RUNNING, &devpriv->state_bits);
+	smp_mb__after_atomic();
+	if (devpriv->ai_wq) {
+		wait_for_completion_timeout(&devpriv->ai_async_done,
+					msecs_to_jiffies(500));
+		destroy_workqueue(devpriv->ai_wq);
+	}
+	devpriv->ai_wq = NULL;
+	kfree(devpriv->ai_hunks[1].rx_buff);
+	kfree(devpriv->ai_hunks[1].t);
+}
+
 /*
  * make two threads for the i/o streams
  */
@@ -2800,6 +4003,9 @@ static int32_t daqgert_create_thread(struct comedi_device *dev,
 		return PTR_ERR(devpriv->ai_spi->daqgert_task);
 	}
 
+	if (!devpriv->smp) /* async hunk mode only, no AO cmd thread */
+		return 0;
+
 	devpriv->ao_spi->daqgert_task =
 		kthread_create_on_node(&daqgert_ao_thread_function,
 				(void *) dev,
@@ -2846,13 +4052,23 @@ static int32_t daqgert_auto_attach(struct comedi_device *dev,
 			devpriv->cpu_nodes);
 		devpriv->ai_node = thisboard->ai_node;
 		devpriv->ao_node = thisboard->ao_node;
+		if (isolated) {
+			devpriv->ai_node = daqgert_isolated_cpu(0, devpriv->ai_node);
+			devpriv->ao_node = daqgert_isolated_cpu(1, devpriv->ao_node);
+		}
 		devpriv->smp = true;
-	} else {
+	} else if (!use_async) {
 		use_hunking = false;
 	}
 	if (daqgert_conf == 4)
 		use_hunking = 0; /* single transfers, ADC is in continuous conversion mode */
 	devpriv->use_hunking = use_hunking;
+	/* no spare core for the hunk thread, chain the hunks from SPI completions */
+	devpriv->ai_async = !devpriv->smp && devpriv->use_hunking;
+	if (devpriv->ai_async)
+		dev_info(dev->class_dev,
+			"%d cpu(s) online, async spi hunk transfers\n",
+			devpriv->cpu_nodes);
 
 	/*
 	 * loop the spi device queue for needed devices
@@ -2982,13 +4198,23 @@ static int32_t daqgert_auto_attach(struct comedi_device *dev,
 	mutex_init(&devpriv->cmd_lock);
 	mutex_init(&devpriv->drvdata_lock);
 
+	ret = daqgert_stats_init(dev);
+	if (ret)
+		return ret;
+
+	if (devpriv->ai_async) {
+		ret = daqgert_ai_async_alloc(dev);
+		if (ret)
+			return ret;
+	}
+
 	/* Board  operation data */
 	dev->board_name = thisboard->name;
 	devpriv->ai_cmd_delay_usecs = 10; /* PIC slave delays */
 	devpriv->ai_conv_delay_usecs = 30;
 	devpriv->ai_neverending = true;
 	devpriv->ai_mix = false;
-	devpriv->ai_conv_delay_10nsecs = CONV_SPEED;
+	daqgert_ai_calib_default(dev);
 	devpriv->timing_lockout = false;
 	devpriv->ai_rate_max = MAX_BOARD_RATE; /* lowest samples per second */
 	devpriv->ao_rate_max = MAX_BOARD_RATE;
@@ -3013,7 +4239,7 @@ static int32_t daqgert_auto_attach(struct comedi_device *dev,
 		return -EINVAL;
 	}
 
-	devpriv->timer_1mhz = ioremap(ST_BASE, 8);
+	devpriv->timer_1mhz = ioremap(ST_BASE, 12); /* CS, CLO and CHI */
 	if (!devpriv->timer_1mhz) {
 		dev_err(dev->class_dev, "invalid 1mhz timer base address!\n");
 		return -EINVAL;
@@ -3111,7 +4337,7 @@ static int32_t daqgert_auto_attach(struct comedi_device *dev,
 		else
 			s->range_table = &daqgert_ai_range3_300;
 		s->insn_read = daqgert_ai_rinsn;
-		if (devpriv->smp) {
+		if (devpriv->smp || devpriv->ai_async) {
 			s->subdev_flags = SDF_READABLE | SDF_GROUND
 				| SDF_CMD_READ | SDF_COMMON;
 			s->do_cmdtest = daqgert_ai_cmdtest;
@@ -3129,7 +4355,7 @@ static int32_t daqgert_auto_attach(struct comedi_device *dev,
 			s->n_chan = thisboard->n_aichan_ads1220;
 			s->len_chanlist = 1;
 			s->insn_config = daqgert_ai_insn_config;
-			if (devpriv->smp) {
+			if (devpriv->smp || devpriv->ai_async) {
 				s->subdev_flags = SDF_READABLE | SDF_DIFF | SDF_GROUND
 					| SDF_CMD_READ | SDF_COMMON;
 				s->do_cmdtest = daqgert_ai_cmdtest;
@@ -3171,6 +4397,10 @@ static int32_t daqgert_auto_attach(struct comedi_device *dev,
 				"alloc subdevice readback failed!\n");
 			return ret;
 		}
+
+		/* measure the AI costs, cmdtest keeps the board guess if it fails */
+		if (daqgert_ai_calibrate(dev))
+			dev_err(dev->class_dev, "ai calibration failed\n");
 	}
 
 	/* 
@@ -3181,7 +4411,7 @@ static int32_t daqgert_auto_attach(struct comedi_device *dev,
 	/* 
 	 * setup kthreads on other cores if possible
 	 */
-	if (devpriv->smp) {
+	if (devpriv->smp || devpriv->ai_async) {
 		ret = daqgert_create_thread(dev, devpriv);
 		if (ret) {
 			dev_err(dev->class_dev, "cpu thread creation failed\n");
@@ -3212,7 +4442,7 @@ static void daqgert_detach(struct comedi_device * dev)
 {
 	struct daqgert_private *devpriv = dev->private;
 
-	if (devpriv->smp) {
+	if (devpriv->smp || devpriv->ai_async) {
 		if (devpriv->ao_spi->daqgert_task)
 			kthread_stop(devpriv->ao_spi->daqgert_task);
 		devpriv->ao_spi->daqgert_task = NULL;
@@ -3223,6 +4453,13 @@ static void daqgert_detach(struct comedi_device * dev)
 	}
 
 	del_timer_sync(&devpriv->ai_spi->my_timer);
+	daqgert_ai_async_free(dev);
+	/* a reader blocked on the timestamps file must leave before it goes */
+	clear_bit(AI_CMD_RUNNING, &devpriv->state_bits);
+	wake_up_interruptible_all(&devpriv->stamp_wait);
+	debugfs_remove_recursive(devpriv->debugfs);
+	free_percpu(devpriv->stats);
+	kfifo_free(&devpriv->stamps);
 
 	iounmap(devpriv->timer_1mhz);
 	iounmap(dev->mmio);